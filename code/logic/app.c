@@ -107,6 +107,9 @@ void show_commands(char *app_name)
     fossil_io_printf("{bright_black}    --dry-run           Simulate\n");
     fossil_io_printf("{bright_black}    --exclude <pat>     Exclude files\n");
     fossil_io_printf("{bright_black}    --include <pat>     Include files\n");
+    fossil_io_printf("{bright_black}    --bwlimit <rate>    Limit bandwidth (e.g. 10M)\n");
+    fossil_io_printf("{bright_black}    --iops-limit <n>    Limit I/O operations per second\n");
+    fossil_io_printf("{bright_black}    --idle              Run at idle I/O and CPU priority\n");
 
     fossil_io_printf("{cyan}  remove, delete   {reset}Delete files or directories\n");
     fossil_io_printf("{bright_black}    -r, --recursive     Delete contents\n");
@@ -119,6 +122,9 @@ void show_commands(char *app_name)
     fossil_io_printf("{bright_black}    --larger-than <s>   Delete files larger than size\n");
     fossil_io_printf("{bright_black}    --empty-only        Delete empty dirs only\n");
     fossil_io_printf("{bright_black}    --log-file <path>   Write deletion log\n");
+    fossil_io_printf("{bright_black}    --bwlimit <rate>    Limit bandwidth (e.g. 10M)\n");
+    fossil_io_printf("{bright_black}    --iops-limit <n>    Limit I/O operations per second\n");
+    fossil_io_printf("{bright_black}    --idle              Run at idle I/O and CPU priority\n");
 
     fossil_io_printf("{cyan}  rename           {reset}Rename files or directories\n");
     fossil_io_printf("{bright_black}    -f, --force         Overwrite target\n");
@@ -148,8 +154,15 @@ void show_commands(char *app_name)
     fossil_io_printf("{cyan}  compare          {reset}Compare two files/directories\n");
     fossil_io_printf("{bright_black}    -t, --text          Line diff\n");
     fossil_io_printf("{bright_black}    -b, --binary        Binary diff\n");
+    fossil_io_printf("{bright_black}    -r, --recursive     Compare two directory trees\n");
+    fossil_io_printf("{bright_black}    --jobs <n>          Worker threads (tree hashing, binary ranges)\n");
     fossil_io_printf("{bright_black}    --context <n>       Context lines\n");
     fossil_io_printf("{bright_black}    --ignore-case       Ignore case\n");
+    fossil_io_printf("{bright_black}    --ignore-space      Treat whitespace runs as one space\n");
+    fossil_io_printf("{bright_black}    --diff-algorithm <a> Text diff: myers/histogram\n");
+    fossil_io_printf("{bright_black}    --ranges            List every differing byte range\n");
+    fossil_io_printf("{bright_black}    --delta <patch>     Write a binary delta from file1 to file2\n");
+    fossil_io_printf("{bright_black}    --apply <patch>     Rebuild file2 from file1 and a delta\n");
 
     fossil_io_printf("{cyan}  help             {reset}Display help for commands\n");
     fossil_io_printf("{bright_black}    --examples          Usage examples\n");
@@ -159,11 +172,26 @@ void show_commands(char *app_name)
     fossil_io_printf("{bright_black}    -r, --recursive     Include subdirs\n");
     fossil_io_printf("{bright_black}    -u, --update        Only newer\n");
     fossil_io_printf("{bright_black}    --delete            Remove extraneous files\n");
+    fossil_io_printf("{bright_black}    --compare <mode>    Change detection: mtime-size/size/xxh3/sha256\n");
+    fossil_io_printf("{bright_black}    --checksum          Hash files even when size+mtime match\n");
+    fossil_io_printf("{bright_black}    --continuous        Keep watching and sync changes as they happen\n");
+    fossil_io_printf("{bright_black}    --durable           Flush copies to disk before renaming them, batched per pass\n");
+    fossil_io_printf("{bright_black}    --bwlimit <rate>    Limit bandwidth (e.g. 10M)\n");
+    fossil_io_printf("{bright_black}    --iops-limit <n>    Limit I/O operations per second\n");
+    fossil_io_printf("{bright_black}    --idle              Run at idle I/O and CPU priority\n");
 
     fossil_io_printf("{cyan}  watch            {reset}Monitor files or directories\n");
     fossil_io_printf("{bright_black}    -r, --recursive     Include subdirs\n");
     fossil_io_printf("{bright_black}    -e, --events <list> Event filter\n");
     fossil_io_printf("{bright_black}    -t, --interval <n>  Poll interval\n");
+    fossil_io_printf("{bright_black}    --poll              Poll snapshots (network filesystems)\n");
+    fossil_io_printf("{bright_black}    --debounce <ms>     Coalesce events per path\n");
+    fossil_io_printf("{bright_black}    --batch             Print changes in batches\n");
+    fossil_io_printf("{bright_black}    --exec <cmd>        Run command per batch\n");
+    fossil_io_printf("{bright_black}    --jobs <n>          Max concurrent --exec runs\n");
+    fossil_io_printf("{bright_black}    --restart           Cancel stale --exec runs\n");
+    fossil_io_printf("{bright_black}    --media <text/jsonl> Output format\n");
+    fossil_io_printf("{bright_black}    --content           Ignore touches with no content change\n");
 
     fossil_io_printf("{cyan}  rewrite          {reset}Modify file contents or metadata\n");
     fossil_io_printf("{bright_black}    -a, --append        Append\n");
@@ -221,7 +249,16 @@ void show_commands(char *app_name)
     fossil_io_printf("{bright_black}    -i, --interactive   Confirm deletions\n");
     fossil_io_printf("{bright_black}    -d, --delete        Remove duplicates\n");
     fossil_io_printf("{bright_black}    -l, --link          Replace duplicates with links\n");
+    fossil_io_printf("{bright_black}    --reflink           Share extents with the kept copy (btrfs/XFS)\n");
+    fossil_io_printf("{bright_black}    --hardlink          Replace duplicates with hard links\n");
+    fossil_io_printf("{bright_black}    --verify            Byte-compare hash matches\n");
+    fossil_io_printf("{bright_black}    --blocks            Report shared chunks between files\n");
+    fossil_io_printf("{bright_black}    -r, --recursive     Include subdirectories\n");
+    fossil_io_printf("{bright_black}    --jobs <n>          Hashing worker threads\n");
     fossil_io_printf("{bright_black}    --media             Preferd structured media format text/fson/json\n");
+    fossil_io_printf("{bright_black}    --bwlimit <rate>    Limit bandwidth (e.g. 10M)\n");
+    fossil_io_printf("{bright_black}    --iops-limit <n>    Limit I/O operations per second\n");
+    fossil_io_printf("{bright_black}    --idle              Run at idle I/O and CPU priority\n");
 
     fossil_io_printf("{cyan}  link             {reset}Create hard or symbolic links\n");
     fossil_io_printf("{bright_black}    -s, --symbolic      Create symbolic link\n");
@@ -285,6 +322,51 @@ void show_name(void)
     exit(FOSSIL_IO_SUCCESS);
 }
 
+// Helper: consume one of the I/O QoS flags shared by the bulk commands.
+// Returns 1 if argv[*j] was one, 0 if it was not, -1 on a bad value.
+static int parse_qos_flag(int argc, char **argv, int *j,
+                          uint64_t *bwlimit, uint64_t *iops_limit, bool *idle)
+{
+    if (fossil_io_cstring_compare(argv[*j], "--idle") == 0)
+    {
+        *idle = true;
+        return 1;
+    }
+    if (fossil_io_cstring_compare(argv[*j], "--bwlimit") == 0 && *j + 1 < argc)
+    {
+        ccstring value = argv[++*j];
+        if (fossil_shark_qos_parse_rate(value, bwlimit) != 0)
+        {
+            fossil_io_printf("{red}Invalid --bwlimit value: %s (e.g. 512K, 10M, 1G){reset}\n", value);
+            return -1;
+        }
+        return 1;
+    }
+    if (fossil_io_cstring_compare(argv[*j], "--iops-limit") == 0 && *j + 1 < argc)
+    {
+        ccstring value = argv[++*j];
+        char *end = NULL;
+        *iops_limit = strtoull(value, &end, 10);
+        if (end == value || *end != '\0' || *iops_limit == 0)
+        {
+            fossil_io_printf("{red}Invalid --iops-limit value: %s{reset}\n", value);
+            return -1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// Helper: install the parsed QoS limits before a bulk command starts
+static bool apply_qos(bool ok, uint64_t bwlimit, uint64_t iops_limit, bool idle)
+{
+    if (!ok)
+        return false;
+    if (fossil_shark_qos_configure(bwlimit, iops_limit, idle) != 0)
+        fossil_io_printf("{yellow}Warning: could not switch to idle priority{reset}\n");
+    return true;
+}
+
 bool app_entry(int argc, char **argv)
 {
     // List of supported commands for suggestion
@@ -719,10 +801,17 @@ bool app_entry(int argc, char **argv)
             bool checksum = false, sparse = false, link = false, reflink = false;
             bool progress = false, dry_run = false;
             ccstring exclude_pattern = cnull, include_pattern = cnull;
+            uint64_t bwlimit = 0, iops_limit = 0;
+            bool idle = false, qos_ok = true;
 
             for (int j = i + 1; j < argc; j++)
             {
-                if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
+                int qos = parse_qos_flag(argc, argv, &j, &bwlimit, &iops_limit, &idle);
+                if (qos != 0)
+                {
+                    qos_ok = qos_ok && qos > 0;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
                 {
                     recursive = true;
                 }
@@ -782,7 +871,7 @@ bool app_entry(int argc, char **argv)
                 }
                 i = j;
             }
-            if (src_count > 1)
+            if (src_count > 1 && apply_qos(qos_ok, bwlimit, iops_limit, idle))
             {
                 ccstring dest = src_paths[src_count - 1];
                 for (size_t k = 0; k + 1 < src_count; ++k)
@@ -800,10 +889,17 @@ bool app_entry(int argc, char **argv)
             int shred_passes = 0;
             ccstring older_than = cnull, log_file = cnull;
             size_t larger_than = 0;
+            uint64_t bwlimit = 0, iops_limit = 0;
+            bool idle = false, qos_ok = true;
 
             for (int j = i + 1; j < argc; j++)
             {
-                if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
+                int qos = parse_qos_flag(argc, argv, &j, &bwlimit, &iops_limit, &idle);
+                if (qos != 0)
+                {
+                    qos_ok = qos_ok && qos > 0;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
                 {
                     recursive = true;
                 }
@@ -859,12 +955,12 @@ bool app_entry(int argc, char **argv)
                 }
                 i = j;
             }
-            if (path_count > 0)
+            if (path_count > 0 && apply_qos(qos_ok, bwlimit, iops_limit, idle))
             {
                 for (size_t k = 0; k < path_count; ++k)
                     fossil_shark_remove(paths[k], recursive, force, interactive, use_trash, wipe, shred_passes, older_than, larger_than, empty_only, log_file);
-                free(paths);
             }
+            free(paths);
         }
         else if (fossil_io_cstring_compare(argv[i], "rename") == 0)
         {
@@ -1011,7 +1107,10 @@ bool app_entry(int argc, char **argv)
         else if (fossil_io_cstring_compare(argv[i], "compare") == 0)
         {
             ccstring path1 = cnull, path2 = cnull;
-            bool text_diff = false, binary_diff = false, ignore_case = false;
+            ccstring algorithm = cnull, delta = cnull, apply = cnull;
+            bool text_diff = false, binary_diff = false, ignore_case = false, all_ranges = false;
+            bool ignore_space = false, recursive = false;
+            int jobs = 0;
             int context_lines = 3;
 
             for (int j = i + 1; j < argc; j++)
@@ -1032,6 +1131,34 @@ bool app_entry(int argc, char **argv)
                 {
                     context_lines = atoi(argv[++j]);
                 }
+                else if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
+                {
+                    recursive = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--jobs") == 0 && j + 1 < argc)
+                {
+                    jobs = atoi(argv[++j]);
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--ignore-space") == 0)
+                {
+                    ignore_space = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--ranges") == 0)
+                {
+                    all_ranges = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--diff-algorithm") == 0 && j + 1 < argc)
+                {
+                    algorithm = argv[++j];
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--delta") == 0 && j + 1 < argc)
+                {
+                    delta = argv[++j];
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--apply") == 0 && j + 1 < argc)
+                {
+                    apply = argv[++j];
+                }
                 else if (!cnotnull(path1))
                 {
                     path1 = argv[j];
@@ -1042,8 +1169,13 @@ bool app_entry(int argc, char **argv)
                 }
                 i = j;
             }
-            if (cnotnull(path1) && cnotnull(path2))
-                fossil_shark_compare(path1, path2, text_diff, binary_diff, context_lines, ignore_case);
+            if (cnotnull(path1) && cnotnull(path2) && cnotnull(delta))
+                fossil_shark_compare_delta(path1, path2, delta);
+            else if (cnotnull(path1) && cnotnull(path2) && cnotnull(apply))
+                fossil_shark_compare_apply(path1, apply, path2);
+            else if (cnotnull(path1) && cnotnull(path2))
+                fossil_shark_compare(path1, path2, text_diff, binary_diff, context_lines, ignore_case, algorithm,
+                                     all_ranges, ignore_space, recursive, jobs > 0 ? (size_t)jobs : 0);
         }
         else if (fossil_io_cstring_compare(argv[i], "help") == 0)
         {
@@ -1075,11 +1207,18 @@ bool app_entry(int argc, char **argv)
         }
         else if (fossil_io_cstring_compare(argv[i], "sync") == 0)
         {
-            ccstring src = cnull, dest = cnull;
-            bool recursive = false, update = false, delete_flag = false;
+            ccstring src = cnull, dest = cnull, compare_mode = "xxh3";
+            bool recursive = false, update = false, delete_flag = false, checksum = false, continuous = false, durable = false;
+            uint64_t bwlimit = 0, iops_limit = 0;
+            bool idle = false, qos_ok = true;
             for (int j = i + 1; j < argc; j++)
             {
-                if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
+                int qos = parse_qos_flag(argc, argv, &j, &bwlimit, &iops_limit, &idle);
+                if (qos != 0)
+                {
+                    qos_ok = qos_ok && qos > 0;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
                 {
                     recursive = true;
                 }
@@ -1091,6 +1230,26 @@ bool app_entry(int argc, char **argv)
                 {
                     delete_flag = true;
                 }
+                else if (fossil_io_cstring_compare(argv[j], "--compare") == 0 && j + 1 < argc)
+                {
+                    compare_mode = argv[++j];
+                }
+                else if (fossil_io_cstring_starts_with(argv[j], "--compare="))
+                {
+                    compare_mode = argv[j] + strlen("--compare=");
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--checksum") == 0)
+                {
+                    checksum = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--continuous") == 0)
+                {
+                    continuous = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--durable") == 0)
+                {
+                    durable = true;
+                }
                 else if (!cnotnull(src))
                 {
                     src = argv[j];
@@ -1101,14 +1260,14 @@ bool app_entry(int argc, char **argv)
                 }
                 i = j;
             }
-            if (cnotnull(src) && cnotnull(dest))
-                fossil_shark_sync(src, dest, recursive, update, delete_flag);
+            if (cnotnull(src) && cnotnull(dest) && apply_qos(qos_ok, bwlimit, iops_limit, idle))
+                fossil_shark_sync(src, dest, recursive, update, delete_flag, compare_mode, checksum, continuous, durable);
         }
         else if (fossil_io_cstring_compare(argv[i], "watch") == 0)
         {
-            ccstring path = cnull, events = cnull;
-            bool recursive = false;
-            int interval = 1;
+            ccstring path = cnull, events = cnull, exec = cnull, media = cnull;
+            bool recursive = false, poll = false, batch = false, restart = false, content = false;
+            int interval = 1, debounce = 0, jobs = 1;
             for (int j = i + 1; j < argc; j++)
             {
                 if (fossil_io_cstring_compare(argv[j], "-r") == 0 || fossil_io_cstring_compare(argv[j], "--recursive") == 0)
@@ -1125,6 +1284,42 @@ bool app_entry(int argc, char **argv)
                     if (j + 1 < argc)
                         interval = atoi(argv[++j]);
                 }
+                else if (fossil_io_cstring_compare(argv[j], "--poll") == 0)
+                {
+                    poll = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--debounce") == 0)
+                {
+                    if (j + 1 < argc)
+                        debounce = atoi(argv[++j]);
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--batch") == 0)
+                {
+                    batch = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--exec") == 0)
+                {
+                    if (j + 1 < argc)
+                        exec = argv[++j];
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--jobs") == 0)
+                {
+                    if (j + 1 < argc)
+                        jobs = atoi(argv[++j]);
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--restart") == 0)
+                {
+                    restart = true;
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--media") == 0)
+                {
+                    if (j + 1 < argc)
+                        media = argv[++j];
+                }
+                else if (fossil_io_cstring_compare(argv[j], "--content") == 0)
+                {
+                    content = true;
+                }
                 else if (!cnotnull(path))
                 {
                     path = argv[j];
@@ -1132,7 +1327,8 @@ bool app_entry(int argc, char **argv)
                 i = j;
             }
             if (cnotnull(path))
-                fossil_shark_watch(path, recursive, events, interval);
+                fossil_shark_watch(path, recursive, events, interval, poll, debounce, batch,
+                                   exec, jobs > 0 ? (size_t)jobs : 1, restart, media, content);
         }
         else if (fossil_io_cstring_compare(argv[i], "rewrite") == 0)
         {
@@ -1618,11 +1814,18 @@ bool app_entry(int argc, char **argv)
         {
             ccstring dir = cnull;
             cstring media = "text";
-            bool use_hash = false, interactive = false, del = false, link = false;
+            bool use_hash = false, interactive = false, del = false, link = false, verify = false;
+            bool recursive = false, reflink = false, hardlink = false, blocks = false;
+            int jobs = 0;
+            uint64_t bwlimit = 0, iops_limit = 0;
+            bool idle = false, qos_ok = true;
 
             for (int j = i + 1; j < argc; j++)
             {
-                if (fossil_io_cstring_compare(argv[j], "--hash") == 0)
+                int qos = parse_qos_flag(argc, argv, &j, &bwlimit, &iops_limit, &idle);
+                if (qos != 0)
+                    qos_ok = qos_ok && qos > 0;
+                else if (fossil_io_cstring_compare(argv[j], "--hash") == 0)
                     use_hash = true;
                 else if (fossil_io_cstring_compare(argv[j], "-i") == 0)
                     interactive = true;
@@ -1630,16 +1833,37 @@ bool app_entry(int argc, char **argv)
                     del = true;
                 else if (fossil_io_cstring_compare(argv[j], "--link") == 0)
                     link = true;
+                else if (fossil_io_cstring_compare(argv[j], "--verify") == 0)
+                    verify = true;
+                else if (fossil_io_cstring_compare(argv[j], "--reflink") == 0)
+                    reflink = true;
+                else if (fossil_io_cstring_compare(argv[j], "--hardlink") == 0)
+                    hardlink = true;
+                else if (fossil_io_cstring_compare(argv[j], "--blocks") == 0)
+                    blocks = true;
+                else if (fossil_io_cstring_compare(argv[j], "-r") == 0 ||
+                         fossil_io_cstring_compare(argv[j], "--recursive") == 0)
+                    recursive = true;
+                else if (fossil_io_cstring_compare(argv[j], "--jobs") == 0)
+                {
+                    if (j + 1 < argc)
+                        jobs = atoi(argv[++j]);
+                }
                 else if (fossil_io_cstring_compare(argv[j], "--media") == 0)
-                    media = argv[j];
+                {
+                    if (j + 1 < argc)
+                        media = argv[++j];
+                }
                 else if (!cnotnull(dir))
                     dir = argv[j];
 
                 i = j;
             }
 
-            if (cnotnull(dir))
-                fossil_shark_dedupe(dir, use_hash, interactive, del, link, media);
+            if (cnotnull(dir) && apply_qos(qos_ok, bwlimit, iops_limit, idle))
+                fossil_shark_dedupe(dir, use_hash, interactive, del, link, media, verify,
+                                    recursive, jobs > 0 ? (size_t)jobs : 0, reflink, hardlink,
+                                    blocks);
         }
         //
         else
@@ -0,0 +1,197 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#include "fossil/code/chunk.h"
+#include "fossil/code/qos.h"
+
+/*
+ * FastCDC with normalized chunking: a gear hash rolls over the bytes and a
+ * cut is made where its masked bits are zero. The first CHUNK_MIN bytes are
+ * never tested, a stricter mask (15 bits) applies until CHUNK_AVG and a
+ * looser one (11 bits) after it, which pulls chunk sizes toward the
+ * average. Shifting the hash left by one per byte means a byte stops
+ * affecting the mask after 64 steps, giving the rolling window for free.
+ */
+#define CHUNK_MASK_SMALL 0x0003590703530000ull
+#define CHUNK_MASK_LARGE 0x0000d90003530000ull
+
+/* splitmix64 from a fixed seed; any fixed random table works */
+static const uint64_t k_gear[256] = {
+    0x23503e32e73f23f5ull, 0x91b8f7ff2709a8e6ull, 0x78a3c2dae1a6069cull, 0xffda850938bdc21dull,
+    0xdd2b7833b86728d2ull, 0x64857562e113a7f7ull, 0x490ce97bedb8e341ull, 0x0c8a9a5216b2c214ull,
+    0xf013c00a78dd4f02ull, 0x5fb5773c4e738550ull, 0x0a3999a5c24dea54ull, 0x6310757ed45e3369ull,
+    0x3dbdee59295c80b9ull, 0xb2fbd374b2bf1d61ull, 0xca3bd3b0bb710ac0ull, 0x17f55733f8a64fb2ull,
+    0xe49bdbbcd36b154cull, 0xebbbe9403dd0c917ull, 0x3535453d75e2cf8eull, 0xdb72208481704096ull,
+    0x0ab39e52ffe436e2ull, 0xda21b79fac58b56eull, 0x2300a049ea782bb0ull, 0xabd5b85a481cf276ull,
+    0xdca281c046d59bf5ull, 0xb7d4fc4a25f4b218ull, 0x014a323acee15a19ull, 0x8fc066bba643182aull,
+    0x8ef3fbf83468b162ull, 0x958319abc0193313ull, 0x61918e0b018e4473ull, 0x4230c614c84d7340ull,
+    0x94771f1cd3ee1b0bull, 0xf5a9fdbc6b83655dull, 0x8610c8b2d9a146fbull, 0xf77d22d83ca24c69ull,
+    0xa374dfb754d2dd8eull, 0x0b975b9f2e6f3e93ull, 0xa7e0d1a505d5d443ull, 0x0ce174958071b8f4ull,
+    0x5df4286e51b3c756ull, 0x7785251fae607f03ull, 0x647cc496283e0350ull, 0x8e6d20f50ebffcd8ull,
+    0x633a49aeb0f4157dull, 0x791e95872f25e7e4ull, 0x3eb143edfaf68762ull, 0x24aba4b5acfd57bfull,
+    0x47dd0ec846c824bfull, 0x041ccdebb5ac9719ull, 0x01b8e852de537f7bull, 0x6f4d69b7a100bd79ull,
+    0xe09532c2d78ee75cull, 0x0cccb2d1d0f31804ull, 0xcb41f87a9fb9bf68ull, 0xda5607de528833c9ull,
+    0xe882ce96a7840057ull, 0x3a1c2c5fbbe04414ull, 0x8864845d389adc05ull, 0xa90ca785c876652bull,
+    0x4f6810508a97d519ull, 0x948eb53288556987ull, 0x96547e95583fb49eull, 0x6d4ecdf53e9df386ull,
+    0x306b41ee82058f7eull, 0xd60b915b3abe6cb9ull, 0x07dcd7600cbe9c15ull, 0x5c91806dfdb9fedfull,
+    0x031e04d9d7498a0full, 0x343fb8eabb36cc9dull, 0x12b93ca50aefb58eull, 0x7682763f3420f8b4ull,
+    0xf59c34a2af36ae74ull, 0x6f2b00741c79708eull, 0xb439356e54660f7cull, 0xe7eb17f66bf94f6aull,
+    0xb725d3d0a41098a9ull, 0x2f9899230ec80de4ull, 0x71af72faf79e1a0full, 0x5bfa2418f7d500b8ull,
+    0x796ae0fa731a8f06ull, 0x7d9b1d708dbd8a3bull, 0xc3744170bc449822ull, 0xe8faf759e3df259aull,
+    0x979c29f791e8049cull, 0x6b42d737f11578cbull, 0xbb5f64d5db0b67f2ull, 0x7d1150c6c0c33a5full,
+    0x0fc742bef3b30abcull, 0xc470866fbb74b706ull, 0x7c58ca1327dda494ull, 0x0e12926eaf0aebaaull,
+    0xaa663198f3306352ull, 0xaac7a84c1842db3full, 0x4a69a5c07c4683a7ull, 0x3f5d0c25726324d6ull,
+    0x7f234569c0f0d5a5ull, 0x858887e1d285d2c2ull, 0x9fac5a9ef43d755bull, 0x468d3e578a282f81ull,
+    0xd55b151ace9de3dfull, 0xd73fea967884fa55ull, 0x30ce152ef01c3372ull, 0x91c2ca5e73fad262ull,
+    0x4554f2404e5ff483ull, 0xb3f379d6fc4eda24ull, 0x86556c4a7445236full, 0x199dfb1ea202f6c8ull,
+    0x09bf83f08917ecdeull, 0xe8495c7fcf0c2b31ull, 0x3ec3b04822e3874bull, 0xefa60f1c5aef1a24ull,
+    0xfb5d76525c223765ull, 0x42bfe2012bc48c52ull, 0x0f6b3db0daab25c7ull, 0xb478a7383368195bull,
+    0x392fa1cca1e29525ull, 0xbc735391269a2f29ull, 0x3157f38b6501213aull, 0x48a9bbec1ac91bcfull,
+    0x622a3a3972642761ull, 0x0017d562cdba147bull, 0xd1889b38b9b07ff7ull, 0xc924ba0c9849fc74ull,
+    0xe8434928d4b0c062ull, 0x7db71213c1042bddull, 0xbf10e8f579b6d1e1ull, 0x99a62398e7b052d6ull,
+    0xcb3f1d26150266a1ull, 0x5d7d6a4f1645e134ull, 0x8e62a8160e2de12bull, 0x3bd0b142529b4ac3ull,
+    0x218c0ade0b0f6357ull, 0x04810dc1f1ace204ull, 0x6863ef8dfa92eb72ull, 0x05f732dd456405caull,
+    0x7c03eac420760132ull, 0x0c4af8fcc0102b70ull, 0x2d770ed670d80a38ull, 0xf4f5110573a6ecfdull,
+    0xc330b3e7a4a8fbe2ull, 0xf1650533eab372fdull, 0x48be4df8ccf32720ull, 0x1556ea930a187156ull,
+    0x4d6c79369865df73ull, 0x0cffaf2c7371e090ull, 0xcacc4fb27c9a030full, 0x128b478394c785eeull,
+    0x879b45cf0814d827ull, 0xde30a103c70a11daull, 0x1c478e5c0d8ec18aull, 0xe92b54eec8dd3851ull,
+    0xc52a628b280d46d9ull, 0x1e2ace35da2dc0bbull, 0x7191b88b8ccce390ull, 0x0cdaba63504e0df2ull,
+    0xec9f183146eb114eull, 0x2790c183f1e178dbull, 0x4494f11f5bbf09b1ull, 0x3eb71c56f45baf19ull,
+    0xd6e8c93d726bd95dull, 0x7b04cbddb26c1705ull, 0x7a04fea4a286a414ull, 0x7b50b27a5700761eull,
+    0xc88350b0745ce3ceull, 0x0ea8f1d2d8c551dbull, 0x06d59dc158739e38ull, 0xe7998576e3ea49f5ull,
+    0x880407209ff54c50ull, 0x5f4e949efe4d5be6ull, 0xbc6b52ff7128d5ebull, 0xfc044194ba5e3048ull,
+    0x5e0dcddc08b97fe6ull, 0x92c9bbc7c793c461ull, 0xc749ead243b5e05full, 0xf1cc024b2ddddcf1ull,
+    0x3ed3ff6fc0614a77ull, 0xa82e0214324c21a3ull, 0x2cda8c374376cca7ull, 0x82c3ddc125e65cc8ull,
+    0xe7d30dacde6eba62ull, 0xa6b32fd831d224f9ull, 0xb700da7a1cc510a9ull, 0xc5d315bfdd99d63bull,
+    0x75da9b1953767693ull, 0xcafabe804748ad0bull, 0xfa314176a49fe04full, 0x2281bbc3c96dcf30ull,
+    0xe32df7a38657e736ull, 0x3d5856693f8bbfa8ull, 0xab5ee0ada14b6035ull, 0x260fbb418c3d3c14ull,
+    0xadd81c84cd7829deull, 0x384ca0cae1043478ull, 0xeab52d974bc0b1e6ull, 0xc08ca00b3ad16d83ull,
+    0xb63bbe67e7a75099ull, 0xa39d785d455a8b6aull, 0xbce7ad57d5439528ull, 0x8abdbfd3eb20d3b1ull,
+    0x82a7aa83ee33fb3dull, 0x40193f178d3cba0eull, 0x3be4fa302833b397ull, 0x5e9e652e1151e286ull,
+    0xd5fad9e3b846f78bull, 0xefd3da5eb8a2558cull, 0x1025d8bbe1a0a2d4ull, 0x6307d0ddad874112ull,
+    0x8943a5d2672307c5ull, 0x8af46dabc28f1acdull, 0x0eb18b70e5822fcfull, 0x2a67c13c4d1e9624ull,
+    0x7b04bb27037a6d50ull, 0x980b4003c8b104f1ull, 0xc4ad8eb9b009069dull, 0x728a120a558da204ull,
+    0xbec389781b1afdddull, 0x3723d4a863d71630ull, 0x562b836b0bd61518ull, 0xca00ba646d841b6cull,
+    0xf39e8cd3a8d48b76ull, 0x4a3516c2f40f37ffull, 0x39443f11769f1953ull, 0x0c829ee3f0b691e1ull,
+    0xadc2f4f9c3a49855ull, 0xc75097d3da811175ull, 0x6e7fb5d4e907d18eull, 0xd40ba6cc57eaeeb0ull,
+    0x8f0b19b08d0cac40ull, 0x34af4f1ab633627cull, 0x86c8c164299a3010ull, 0xb96c127025329ec8ull,
+    0xc73a398a1e676a47ull, 0x5036e3e6c5b8b04bull, 0xb9cd6489af5831f0ull, 0xe999d12b31b5a40aull,
+    0x3b9484342b1316eaull, 0x7a4d8875fd151642ull, 0x87cc80810d9fec8bull, 0x0c4e6fd12e4cfd02ull,
+    0x5d48ff99269cd9dfull, 0x6e1fc5ddba1e704eull, 0x4d22fb476f8807b3ull, 0x7c36d49206b781adull,
+    0x133503a60b2e7d51ull, 0x7b96051c6dd93dc9ull, 0x445cff4d1c21db7cull, 0xc08541bc0775c4b2ull,
+    0x7c49799fd21ad08cull, 0x289e241f826f073cull, 0xa691cc642e5cc9cfull, 0x6a36b2435251af48ull,
+    0x1f418a4cfebf204bull, 0x9d340aa265d88809ull, 0xe2486faf32dabe8cull, 0x2e27d96a97106b80ull,
+};
+
+void fossil_shark_chunker_init(fossil_shark_chunker_t *chunker)
+{
+    chunker->fingerprint = 0;
+    chunker->offset = 0;
+    chunker->length = 0;
+    fossil_shark_hash_init(&chunker->hash);
+}
+
+// Helper: report the current chunk and start the next one
+static void chunker_cut(fossil_shark_chunker_t *chunker, fossil_shark_chunk_fn emit, void *user)
+{
+    emit(user, chunker->offset, (uint32_t)chunker->length, fossil_shark_hash_digest128(&chunker->hash));
+    chunker->offset += chunker->length;
+    chunker->length = 0;
+    chunker->fingerprint = 0;
+    fossil_shark_hash_init(&chunker->hash);
+}
+
+void fossil_shark_chunker_update(fossil_shark_chunker_t *chunker, const void *data, size_t len,
+                                 fossil_shark_chunk_fn emit, void *user)
+{
+    const uint8_t *in = (const uint8_t *)data;
+    while (len > 0)
+    {
+        // Bytes below the minimum are only hashed, never tested for a cut
+        size_t span = 0;
+        if (chunker->length < FOSSIL_SHARK_CHUNK_MIN)
+        {
+            span = FOSSIL_SHARK_CHUNK_MIN - chunker->length;
+            if (span > len)
+                span = len;
+            chunker->length += span;
+        }
+
+        bool cut = false;
+        uint64_t fp = chunker->fingerprint;
+        size_t length = chunker->length;
+        while (span < len && !cut)
+        {
+            fp = (fp << 1) + k_gear[in[span++]];
+            length++;
+            uint64_t mask = length <= FOSSIL_SHARK_CHUNK_AVG ? CHUNK_MASK_SMALL : CHUNK_MASK_LARGE;
+            cut = (fp & mask) == 0 || length == FOSSIL_SHARK_CHUNK_MAX;
+        }
+        chunker->fingerprint = fp;
+        chunker->length = length;
+
+        fossil_shark_hash_update(&chunker->hash, in, span);
+        in += span;
+        len -= span;
+        if (cut)
+            chunker_cut(chunker, emit, user);
+    }
+}
+
+void fossil_shark_chunker_finish(fossil_shark_chunker_t *chunker, fossil_shark_chunk_fn emit, void *user)
+{
+    if (chunker->length > 0)
+        chunker_cut(chunker, emit, user);
+}
+
+int fossil_shark_chunk_file(ccstring path, fossil_shark_chunk_fn emit, void *user)
+{
+    if (!cnotnull(path) || !emit)
+        return EINVAL;
+
+    fossil_io_filesys_file_t stream;
+    if (fossil_io_filesys_file_open(&stream, path, "rb") != 0)
+        return errno ? errno : EIO;
+
+    uint8_t *buffer = (uint8_t *)fossil_sys_memory_alloc(FOSSIL_SHARK_HASH_BUFFER_SIZE);
+    if (!cnotnull(buffer))
+    {
+        fossil_io_filesys_file_close(&stream);
+        return ENOMEM;
+    }
+
+    fossil_shark_chunker_t chunker;
+    fossil_shark_chunker_init(&chunker);
+    size_t n;
+    while ((n = fossil_io_filesys_file_read(&stream, buffer, 1, FOSSIL_SHARK_HASH_BUFFER_SIZE)) > 0)
+    {
+        fossil_shark_qos_throttle(n, 1);
+        fossil_shark_chunker_update(&chunker, buffer, n, emit, user);
+    }
+    fossil_shark_chunker_finish(&chunker, emit, user);
+
+    fossil_sys_memory_free(buffer);
+    fossil_io_filesys_file_close(&stream);
+    return 0;
+}
@@ -22,272 +22,1857 @@
  * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "fossil/code/compare.h"
+#include "fossil/code/diff.h"
+#include "fossil/code/hash.h"
+#include "fossil/code/pool.h"
+#include "fossil/code/qos.h"
 
-// Helper: read line from file, return dynamically allocated string
-static cstring read_line(fossil_io_filesys_file_t *stream)
+#include <ctype.h>
+#include <stdatomic.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define COMPARE_BLOCK (1024 * 1024)     /* bytes read from each file per step */
+#define COMPARE_SPAN (8u * 1024u * 1024u) /* bytes a parallel worker claims at a time */
+
+// Helper: check if file is regular file (cross-platform)
+static bool is_regular_file(ccstring path)
+{
+    fossil_io_filesys_obj_t obj;
+    if (fossil_io_filesys_stat(path, &obj) != 0)
+        return false;
+    return obj.type == FOSSIL_FILESYS_TYPE_FILE;
+}
+
+/* ============================================================================
+ * File access
+ * ============================================================================ */
+
+// A file opened for large sequential reads
+typedef struct
+{
+#ifdef _WIN32
+    fossil_io_filesys_file_t file;
+#else
+    int fd;
+#endif
+} compare_stream_t;
+
+static int compare_open(compare_stream_t *stream, ccstring path)
+{
+#ifdef _WIN32
+    return fossil_io_filesys_file_open(&stream->file, path, "rb") != 0 ? (errno ? errno : EIO) : 0;
+#else
+    stream->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (stream->fd < 0)
+        return errno;
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(stream->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return 0;
+#endif
+}
+
+// Helper: fill buf unless the file ends first; returns the bytes read
+static int compare_read(compare_stream_t *stream, void *buf, size_t len, size_t *got)
+{
+    *got = 0;
+#ifdef _WIN32
+    *got = fossil_io_filesys_file_read(&stream->file, buf, 1, len);
+#else
+    while (*got < len)
+    {
+        ssize_t n = read(stream->fd, (uint8_t *)buf + *got, len - *got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return errno;
+        if (n == 0)
+            break;
+        *got += (size_t)n;
+    }
+#endif
+    fossil_shark_qos_throttle(*got, 1);
+    return 0;
+}
+
+static void compare_close(compare_stream_t *stream)
+{
+#ifdef _WIN32
+    fossil_io_filesys_file_close(&stream->file);
+#else
+    close(stream->fd);
+#endif
+}
+
+/* ============================================================================
+ * Text compare
+ * ============================================================================ */
+
+// One line of a loaded file, trimmed of surrounding whitespace
+typedef struct
+{
+    size_t offset;
+    size_t length;
+} compare_line_t;
+
+/*
+ * A whole file in memory, mapped where possible so loading it costs no
+ * copy, with an index of its lines. Lines are never copied out; they are
+ * compared, hashed and printed in place.
+ */
+typedef struct
+{
+    const char *data;
+    size_t size;
+    void *map;   // the mapping, or cnull
+    char *owned; // heap copy when the file could not be mapped
+    compare_line_t *lines;
+    size_t count;
+} compare_text_t;
+
+typedef struct
 {
-    size_t size = 128;
-    size_t len = 0;
-    cstring line = (cstring)fossil_sys_memory_alloc(size);
+    bool ignore_case;
+    bool ignore_space; // whitespace runs compare equal to a single space
+} compare_norm_t;
 
-    if (cunlikely(!cnotnull(line)))
+static void compare_text_free(compare_text_t *text)
+{
+#ifndef _WIN32
+    if (text->map)
+        munmap(text->map, text->size);
+#endif
+    fossil_sys_memory_free(text->owned);
+    fossil_sys_memory_free(text->lines);
+    memset(text, 0, sizeof(*text));
+}
+
+// Helper: map a file, or read it into memory where mapping is unavailable
+static int compare_text_load(compare_text_t *text, ccstring path)
+{
+    memset(text, 0, sizeof(*text));
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX)
     {
-        return cnull;
+        void *map = mmap(cnull, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+#if defined(MADV_SEQUENTIAL)
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+            text->map = map;
+            text->data = (const char *)map;
+            text->size = (size_t)st.st_size;
+        }
     }
+    close(fd);
+    if (text->map)
+        return 0;
+#endif
+
+    fossil_io_filesys_obj_t obj;
+    if (fossil_io_filesys_stat(path, &obj) != 0)
+        return errno ? errno : ENOENT;
+    compare_stream_t stream;
+    int rc = compare_open(&stream, path);
+    if (rc != 0)
+        return rc;
+    text->owned = (char *)fossil_sys_memory_alloc((size_t)obj.size + 1);
+    if (!cnotnull(text->owned))
+        rc = ENOMEM;
+    else
+        rc = compare_read(&stream, text->owned, (size_t)obj.size, &text->size);
+    compare_close(&stream);
+    text->data = text->owned;
+    return rc;
+}
+
+/*
+ * Index the lines of a loaded file. memchr is vectorized by the C
+ * library, so the scan for newlines runs a register width at a time; only
+ * the ends of each line are inspected byte by byte for trimming.
+ */
+static int compare_text_index(compare_text_t *text)
+{
+    size_t cap = 1024;
+    text->lines = (compare_line_t *)fossil_sys_memory_alloc(cap * sizeof(compare_line_t));
+    if (!cnotnull(text->lines))
+        return ENOMEM;
 
-    int c;
-    while (1)
+    const char *p = text->data;
+    const char *end = text->data + text->size;
+    while (p < end)
     {
-        unsigned char ch;
-        size_t n = fossil_io_filesys_file_read(stream, &ch, 1, 1);
-        if (n != 1)
-            break;
-        c = ch;
-        if (len + 1 >= size)
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        const char *stop = nl ? nl : end;
+        const char *next = nl ? nl + 1 : end;
+        while (p < stop && isspace((unsigned char)*p))
+            ++p;
+        while (stop > p && isspace((unsigned char)stop[-1]))
+            --stop;
+
+        if (text->count == cap)
+        {
+            cap *= 2;
+            compare_line_t *grown = (compare_line_t *)fossil_sys_memory_realloc(text->lines, cap * sizeof(compare_line_t));
+            if (!cnotnull(grown))
+                return ENOMEM;
+            text->lines = grown;
+        }
+        text->lines[text->count].offset = (size_t)(p - text->data);
+        text->lines[text->count].length = (size_t)(stop - p);
+        text->count++;
+        p = next;
+    }
+    return 0;
+}
+
+static const char *compare_line_data(const compare_text_t *text, size_t i)
+{
+    return text->data + text->lines[i].offset;
+}
+
+// Helper: compare two lines under the normalization in effect
+static bool line_equal(const char *a, size_t la, const char *b, size_t lb, compare_norm_t norm)
+{
+    if (!norm.ignore_case && !norm.ignore_space)
+        return la == lb && memcmp(a, b, la) == 0;
+
+    size_t i = 0, j = 0;
+    while (i < la && j < lb)
+    {
+        unsigned char x = (unsigned char)a[i], y = (unsigned char)b[j];
+        if (norm.ignore_space && isspace(x) && isspace(y))
+        {
+            while (i < la && isspace((unsigned char)a[i]))
+                ++i;
+            while (j < lb && isspace((unsigned char)b[j]))
+                ++j;
+            continue;
+        }
+        if (norm.ignore_case ? tolower(x) != tolower(y) : x != y)
+            return false;
+        ++i;
+        ++j;
+    }
+    return i == la && j == lb;
+}
+
+// Helper: hash a line as line_equal sees it, so equal lines hash equal
+static uint64_t line_hash(const char *line, size_t len, compare_norm_t norm)
+{
+    if (!norm.ignore_case && !norm.ignore_space)
+        return fossil_shark_hash64(line, len);
+
+    fossil_shark_hash_state_t state;
+    fossil_shark_hash_init(&state);
+    char folded[256];
+    size_t n = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char c = (unsigned char)line[i];
+        if (norm.ignore_space && isspace(c))
+        {
+            while (i + 1 < len && isspace((unsigned char)line[i + 1]))
+                ++i;
+            c = ' ';
+        }
+        folded[n++] = (char)(norm.ignore_case ? tolower(c) : c);
+        if (n == sizeof(folded))
+        {
+            fossil_shark_hash_update(&state, folded, n);
+            n = 0;
+        }
+    }
+    fossil_shark_hash_update(&state, folded, n);
+    return fossil_shark_hash_digest64(&state);
+}
+
+typedef struct
+{
+    uint64_t hash;
+    uint32_t id;   // UINT32_MAX while the slot is empty
+    uint32_t line; // first line seen with this ID, for collision checks
+} line_slot_t;
+
+/*
+ * Give every distinct line an ID so the diff compares integers. Both files
+ * share one table, so equal lines get the same ID wherever they are; ids
+ * receives the lines of t1 followed by those of t2.
+ */
+static int intern_lines(const compare_text_t *t1, const compare_text_t *t2, compare_norm_t norm,
+                        uint32_t *ids, size_t *id_count)
+{
+    size_t count = t1->count + t2->count;
+    if (count >= UINT32_MAX)
+        return EOVERFLOW;
+    size_t size = 16;
+    while (size < 2 * count)
+        size <<= 1;
+    line_slot_t *table = (line_slot_t *)fossil_sys_memory_alloc(size * sizeof(line_slot_t));
+    if (!cnotnull(table))
+        return ENOMEM;
+    for (size_t i = 0; i < size; ++i)
+        table[i].id = UINT32_MAX;
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const compare_text_t *t = i < t1->count ? t1 : t2;
+        size_t k = i < t1->count ? i : i - t1->count;
+        const char *line = compare_line_data(t, k);
+        size_t len = t->lines[k].length;
+
+        uint64_t h = line_hash(line, len, norm);
+        size_t slot = (size_t)(h ^ (h >> 32)) & (size - 1);
+        while (table[slot].id != UINT32_MAX)
         {
-            size *= 2;
-            cstring new_line = (cstring)fossil_sys_memory_realloc(line, size);
-            if (cunlikely(!cnotnull(new_line)))
+            if (table[slot].hash == h)
             {
-                fossil_sys_memory_free(line);
-                return cnull;
+                uint32_t o = table[slot].line;
+                const compare_text_t *ot = o < t1->count ? t1 : t2;
+                size_t ok = o < t1->count ? o : o - t1->count;
+                if (line_equal(compare_line_data(ot, ok), ot->lines[ok].length, line, len, norm))
+                    break;
             }
-            line = new_line;
+            slot = (slot + 1) & (size - 1);
+        }
+        if (table[slot].id == UINT32_MAX)
+        {
+            table[slot].hash = h;
+            table[slot].id = next++;
+            table[slot].line = (uint32_t)i;
+        }
+        ids[i] = table[slot].id;
+    }
+
+    fossil_sys_memory_free(table);
+    *id_count = next;
+    return 0;
+}
+
+static void print_line(char mark, const compare_text_t *text, size_t i)
+{
+    int len = (int)text->lines[i].length;
+    const char *line = compare_line_data(text, i);
+    if (mark == '-')
+        fossil_io_printf("{red}-%.*s{normal}\n", len, line);
+    else if (mark == '+')
+        fossil_io_printf("{green}+%.*s{normal}\n", len, line);
+    else
+        fossil_io_printf(" %.*s\n", len, line);
+}
+
+// Helper: one side of a hunk header as diff -u writes it: the count is
+// dropped when it is 1, and an empty side is numbered by the line before it
+static void compare_unified_range(char *buf, size_t size, size_t start, size_t len)
+{
+    if (len == 1)
+        snprintf(buf, size, "%zu", start + 1);
+    else
+        snprintf(buf, size, "%zu,%zu", len ? start + 1 : start, len);
+}
+
+/*
+ * Print the edit script as a unified diff. Changes closer together than
+ * twice the context share a hunk, as in diff -u.
+ */
+static void print_unified(ccstring path1, ccstring path2,
+                          const compare_text_t *t1, const bool *removed,
+                          const compare_text_t *t2, const bool *added,
+                          size_t context)
+{
+    size_t n = t1->count, m = t2->count;
+    fossil_io_printf("{bold}--- %s{normal}\n", path1);
+    fossil_io_printf("{bold}+++ %s{normal}\n", path2);
+
+    size_t i = 0, j = 0;
+    for (;;)
+    {
+        while (i < n && j < m && !removed[i] && !added[j])
+        {
+            ++i;
+            ++j;
         }
-        line[len++] = (char)c;
-        if (c == '\n')
+        if (i == n && j == m)
+            break;
+
+        size_t lead = i < context ? i : context;
+        size_t start1 = i - lead, start2 = j - lead;
+        size_t end1 = i, end2 = j;
+        for (;;)
+        {
+            while (end1 < n && removed[end1])
+                ++end1;
+            while (end2 < m && added[end2])
+                ++end2;
+            size_t run = 0;
+            while (end1 + run < n && end2 + run < m && !removed[end1 + run] && !added[end2 + run])
+                ++run;
+            bool more = end1 + run < n || end2 + run < m;
+            if (more && run <= 2 * context)
+            {
+                end1 += run;
+                end2 += run;
+                continue;
+            }
+            size_t tail = run < context ? run : context;
+            end1 += tail;
+            end2 += tail;
             break;
+        }
+
+        char range1[48], range2[48];
+        compare_unified_range(range1, sizeof(range1), start1, end1 - start1);
+        compare_unified_range(range2, sizeof(range2), start2, end2 - start2);
+        fossil_io_printf("{blue}@@ -%s +%s @@{normal}\n", range1, range2);
+        for (size_t x = start1, y = start2; x < end1 || y < end2;)
+        {
+            if (x < end1 && removed[x])
+                print_line('-', t1, x++);
+            else if (y < end2 && added[y])
+                print_line('+', t2, y++);
+            else
+            {
+                print_line(' ', t1, x++);
+                ++y;
+            }
+        }
+        i = end1;
+        j = end2;
     }
+}
 
-    if (len == 0)
+static int compare_text(ccstring path1, ccstring path2, int context_lines, compare_norm_t norm,
+                        ccstring algorithm)
+{
+    fossil_shark_diff_algorithm_t algo;
+    if (!fossil_shark_diff_algorithm_parse(algorithm, &algo))
     {
-        fossil_sys_memory_free(line);
-        return cnull;
+        fossil_io_printf("{red}Error: Unknown diff algorithm '%s' (use myers or histogram).{normal}\n", algorithm);
+        return 1;
+    }
+
+    compare_text_t t1, t2;
+    int rc = compare_text_load(&t1, path1);
+    if (rc == 0)
+    {
+        rc = compare_text_load(&t2, path2);
+        if (rc != 0)
+            compare_text_free(&t1);
     }
-    line[len] = cterm;
+    if (rc != 0)
+    {
+        fossil_io_printf("{red}Error: Failed to open files for text comparison.{normal}\n");
+        return 1;
+    }
+
+    rc = compare_text_index(&t1);
+    if (rc == 0)
+        rc = compare_text_index(&t2);
 
-    // Trim whitespace from the line
-    fossil_io_trim(line);
+    // Lines shared at both ends need no IDs; most edits touch a small middle
+    size_t head = 0, tail = 0;
+    while (rc == 0 && head < t1.count && head < t2.count &&
+           line_equal(compare_line_data(&t1, head), t1.lines[head].length,
+                      compare_line_data(&t2, head), t2.lines[head].length, norm))
+        ++head;
+    while (rc == 0 && tail < t1.count - head && tail < t2.count - head &&
+           line_equal(compare_line_data(&t1, t1.count - 1 - tail), t1.lines[t1.count - 1 - tail].length,
+                      compare_line_data(&t2, t2.count - 1 - tail), t2.lines[t2.count - 1 - tail].length, norm))
+        ++tail;
 
-    return line;
+    // Intern the rest of both files together, then diff the ID sequences
+    size_t total = t1.count + t2.count;
+    uint32_t *ids = (uint32_t *)fossil_sys_memory_alloc((total ? total : 1) * sizeof(uint32_t));
+    bool *marks = (bool *)fossil_sys_memory_calloc(total ? total : 1, sizeof(bool));
+    if (rc == 0 && (!cnotnull(ids) || !cnotnull(marks)))
+        rc = ENOMEM;
+
+    size_t id_count = 0;
+    if (rc == 0)
+    {
+        compare_text_t mid1 = t1, mid2 = t2;
+        mid1.lines += head;
+        mid1.count -= head + tail;
+        mid2.lines += head;
+        mid2.count -= head + tail;
+        rc = intern_lines(&mid1, &mid2, norm, ids, &id_count);
+        if (rc == 0)
+            rc = fossil_shark_diff(ids, mid1.count, ids + mid1.count, mid2.count, id_count, algo,
+                                   marks + head, marks + t1.count + head);
+    }
+
+    bool differences = false;
+    if (rc == 0)
+    {
+        for (size_t i = 0; i < total && !differences; i++)
+            differences = marks[i];
+        if (differences)
+            print_unified(path1, path2, &t1, marks, &t2, marks + t1.count,
+                          context_lines > 0 ? (size_t)context_lines : 0);
+    }
+    else
+    {
+        fossil_io_printf("{red}Error: Cannot compare files: %s{normal}\n", strerror(rc));
+    }
+
+    fossil_sys_memory_free(marks);
+    fossil_sys_memory_free(ids);
+    compare_text_free(&t2);
+    compare_text_free(&t1);
+    return rc != 0 || differences ? 1 : 0;
 }
 
-// Helper: compare lines with optional case-insensitivity
-static bool line_equal(ccstring a, ccstring b, bool ignore_case)
+/* ============================================================================
+ * Binary compare
+ * ============================================================================ */
+
+/*
+ * Offset of the first differing byte, or len. memcmp is vectorized by the
+ * C library, so equal stretches are skipped a page at a time before the
+ * difference is narrowed down by word and then by byte.
+ */
+static size_t compare_mismatch(const uint8_t *a, const uint8_t *b, size_t len)
 {
-    if (!cnotnull(a) || !cnotnull(b))
-        return false;
+    size_t i = 0;
+    while (i + 4096 <= len && memcmp(a + i, b + i, 4096) == 0)
+        i += 4096;
+    while (i + sizeof(uint64_t) <= len)
+    {
+        uint64_t x, y;
+        memcpy(&x, a + i, sizeof(x));
+        memcpy(&y, b + i, sizeof(y));
+        if (x != y)
+            break;
+        i += sizeof(uint64_t);
+    }
+    while (i < len && a[i] == b[i])
+        ++i;
+    return i;
+}
 
-    if (!ignore_case)
-        return fossil_io_cstring_compare(a, b) == 0;
-    return fossil_io_cstring_case_compare(a, b) == 0;
+// Helper: offset of the first equal byte, or len
+static size_t compare_match(const uint8_t *a, const uint8_t *b, size_t len)
+{
+    size_t i = 0;
+    while (i < len && a[i] != b[i])
+        ++i;
+    return i;
 }
 
-// Helper: check if file is regular file (cross-platform)
-static bool is_regular_file(ccstring path)
+// Differing ranges handed back to fossil_shark_compare_binary callers
+typedef struct
 {
-    fossil_io_filesys_obj_t obj;
-    if (fossil_io_filesys_stat(path, &obj) != 0)
-        return false;
-    return obj.type == FOSSIL_FILESYS_TYPE_FILE;
+    fossil_shark_compare_range_t *ranges;
+    size_t max;
+    size_t count;
+} compare_ranges_t;
+
+// Helper: record [start, end) when a caller asked for the ranges
+static void compare_note_range(compare_ranges_t *out, uint64_t start, uint64_t end)
+{
+    if (!out)
+        return;
+    if (out->count < out->max)
+    {
+        out->ranges[out->count].start = start;
+        out->ranges[out->count].end = end;
+    }
+    out->count++;
 }
 
-int fossil_shark_compare(ccstring path1, ccstring path2,
-                         bool text_diff, bool binary_diff,
-                         int context_lines, bool ignore_case)
+static void compare_print_range(uint64_t start, uint64_t end)
 {
-    if (!cnotnull(path1) || !cnotnull(path2))
+    fossil_io_printf("{cyan}Bytes %llu-%llu differ (%llu bytes){normal}\n",
+                     (unsigned long long)start, (unsigned long long)(end - 1),
+                     (unsigned long long)(end - start));
+}
+
+#ifndef _WIN32
+typedef struct
+{
+    int fd1;
+    int fd2;
+    uint64_t size;
+    _Atomic uint64_t next;  // next span to claim
+    _Atomic uint64_t first; // lowest differing offset found so far, or UINT64_MAX
+    _Atomic int error;
+} compare_parallel_t;
+
+// Helper: lower first to offset unless a lower difference is already known
+static void compare_found(compare_parallel_t *ctx, uint64_t offset)
+{
+    uint64_t seen = atomic_load_explicit(&ctx->first, memory_order_relaxed);
+    while (offset < seen &&
+           !atomic_compare_exchange_weak_explicit(&ctx->first, &seen, offset,
+                                                  memory_order_relaxed, memory_order_relaxed))
     {
-        fossil_io_printf("{red}Error: Two paths must be specified.{normal}\n");
+    }
+}
+
+static int compare_pread(int fd, uint8_t *buf, size_t len, uint64_t offset)
+{
+    size_t got = 0;
+    while (got < len)
+    {
+        ssize_t n = pread(fd, buf + got, len - got, (off_t)(offset + got));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return n < 0 ? errno : EIO; // the file shrank under us
+        got += (size_t)n;
+    }
+    fossil_shark_qos_throttle(got, 1);
+    return 0;
+}
+
+/*
+ * Claim spans in file order and compare them a block at a time. A worker
+ * stops once its position passes the lowest difference found by anyone,
+ * so work beyond it is abandoned while every span below it is still
+ * finished, which keeps the reported offset the true first difference.
+ */
+static void compare_parallel_worker(void *arg)
+{
+    compare_parallel_t *ctx = (compare_parallel_t *)arg;
+    uint8_t *buf1 = (uint8_t *)fossil_sys_memory_alloc(COMPARE_BLOCK);
+    uint8_t *buf2 = (uint8_t *)fossil_sys_memory_alloc(COMPARE_BLOCK);
+    if (!cnotnull(buf1) || !cnotnull(buf2))
+    {
+        atomic_store(&ctx->error, ENOMEM);
+    }
+
+    while (cnotnull(buf1) && cnotnull(buf2) && atomic_load(&ctx->error) == 0)
+    {
+        uint64_t start = atomic_fetch_add(&ctx->next, 1) * COMPARE_SPAN;
+        if (start >= ctx->size || start >= atomic_load_explicit(&ctx->first, memory_order_relaxed))
+            break;
+        uint64_t end = ctx->size - start < COMPARE_SPAN ? ctx->size : start + COMPARE_SPAN;
+
+        for (uint64_t pos = start; pos < end;)
+        {
+            if (pos >= atomic_load_explicit(&ctx->first, memory_order_relaxed))
+                break;
+            size_t len = end - pos < COMPARE_BLOCK ? (size_t)(end - pos) : COMPARE_BLOCK;
+            int rc = compare_pread(ctx->fd1, buf1, len, pos);
+            if (rc == 0)
+                rc = compare_pread(ctx->fd2, buf2, len, pos);
+            if (rc != 0)
+            {
+                atomic_store(&ctx->error, rc);
+                break;
+            }
+            size_t at = compare_mismatch(buf1, buf2, len);
+            if (at < len)
+            {
+                compare_found(ctx, pos + at);
+                break;
+            }
+            pos += len;
+        }
+    }
+
+    fossil_sys_memory_free(buf2);
+    fossil_sys_memory_free(buf1);
+}
+
+/*
+ * Equal-size files split into spans compared by jobs threads with
+ * positional reads on shared descriptors. One sequential reader leaves
+ * most of a striped NVMe array idle; several keep more requests in
+ * flight.
+ */
+static int compare_binary_parallel(ccstring path1, ccstring path2, uint64_t size, size_t jobs,
+                                   compare_ranges_t *out)
+{
+    compare_parallel_t ctx;
+    ctx.fd1 = open(path1, O_RDONLY | O_CLOEXEC);
+    ctx.fd2 = ctx.fd1 < 0 ? -1 : open(path2, O_RDONLY | O_CLOEXEC);
+    if (ctx.fd2 < 0)
+    {
+        if (ctx.fd1 >= 0)
+            close(ctx.fd1);
+        fossil_io_printf("{red}Error: Failed to open files for binary comparison.{normal}\n");
         return 1;
     }
+    ctx.size = size;
+    atomic_init(&ctx.next, 0);
+    atomic_init(&ctx.first, UINT64_MAX);
+    atomic_init(&ctx.error, 0);
 
-    if (cunlikely(!is_regular_file(path1) || !is_regular_file(path2)))
+    fossil_shark_pool_run(jobs, compare_parallel_worker, &ctx);
+
+    int rc = atomic_load(&ctx.error);
+    uint64_t first = atomic_load(&ctx.first);
+    uint8_t b1 = 0, b2 = 0;
+    if (rc == 0 && first != UINT64_MAX)
     {
-        fossil_io_printf("{red}Error: Failed to access files or not regular files.{normal}\n");
+        rc = compare_pread(ctx.fd1, &b1, 1, first);
+        if (rc == 0)
+            rc = compare_pread(ctx.fd2, &b2, 1, first);
+    }
+    close(ctx.fd2);
+    close(ctx.fd1);
+
+    if (rc != 0)
+    {
+        fossil_io_printf("{red}Error: Failed to read files for binary comparison.{normal}\n");
         return 1;
     }
+    if (first == UINT64_MAX)
+        return 0;
+    compare_note_range(out, first, first + 1);
+    fossil_io_printf("{cyan}Binary difference at byte %llu: %02x != %02x{normal}\n",
+                     (unsigned long long)first, b1, b2);
+    return 1;
+}
+#endif
 
-    if (binary_diff)
+/*
+ * Compare two files a block at a time. Files of different sizes cannot be
+ * equal, so unless every range is wanted that is reported without reading
+ * either one. With all_ranges, adjacent differing bytes are collapsed into
+ * one range, including across block boundaries.
+ */
+static int compare_binary(ccstring path1, ccstring path2, bool all_ranges, size_t jobs,
+                          compare_ranges_t *out)
+{
+    fossil_io_filesys_obj_t st1, st2;
+    if (fossil_io_filesys_stat(path1, &st1) != 0 || fossil_io_filesys_stat(path2, &st2) != 0)
     {
-        fossil_io_filesys_file_t f1, f2;
-        if (cunlikely(fossil_io_filesys_file_open(&f1, path1, "rb") != 0 ||
-                      fossil_io_filesys_file_open(&f2, path2, "rb") != 0))
-        {
-            fossil_io_printf("{red}Error: Failed to open files for binary comparison.{normal}\n");
+        fossil_io_printf("{red}Error: Failed to open files for binary comparison.{normal}\n");
+        return 1;
+    }
+    uint64_t size1 = (uint64_t)st1.size, size2 = (uint64_t)st2.size;
+    if (size1 != size2)
+    {
+        fossil_io_printf("{cyan}Binary files differ in size: %llu != %llu bytes{normal}\n",
+                         (unsigned long long)size1, (unsigned long long)size2);
+        if (!all_ranges)
             return 1;
-        }
+    }
+#ifndef _WIN32
+    if (size1 == size2 && !all_ranges && jobs > 1 && size1 >= 2 * (uint64_t)COMPARE_SPAN)
+        return compare_binary_parallel(path1, path2, size1, jobs, out);
+#endif
+
+    compare_stream_t f1, f2;
+    if (compare_open(&f1, path1) != 0)
+    {
+        fossil_io_printf("{red}Error: Failed to open files for binary comparison.{normal}\n");
+        return 1;
+    }
+    if (compare_open(&f2, path2) != 0)
+    {
+        compare_close(&f1);
+        fossil_io_printf("{red}Error: Failed to open files for binary comparison.{normal}\n");
+        return 1;
+    }
+
+    uint8_t *buf1 = (uint8_t *)fossil_sys_memory_alloc(COMPARE_BLOCK);
+    uint8_t *buf2 = (uint8_t *)fossil_sys_memory_alloc(COMPARE_BLOCK);
+    int diff_found = size1 != size2;
+    int rc = (!cnotnull(buf1) || !cnotnull(buf2)) ? ENOMEM : 0;
+    uint64_t pos = 0, open_at = UINT64_MAX, ranges = 0, differing = 0;
+
+    while (rc == 0)
+    {
+        size_t n1 = 0, n2 = 0;
+        rc = compare_read(&f1, buf1, COMPARE_BLOCK, &n1);
+        if (rc == 0)
+            rc = compare_read(&f2, buf2, COMPARE_BLOCK, &n2);
+        size_t n = n1 < n2 ? n1 : n2;
+        if (rc != 0 || n == 0)
+            break;
 
-        int diff_found = 0;
-        int c1, c2;
-        size_t pos = 0;
-        unsigned char b1, b2;
-        while (fossil_io_filesys_file_read(&f1, &b1, 1, 1) == 1 &&
-               fossil_io_filesys_file_read(&f2, &b2, 1, 1) == 1)
+        for (size_t i = 0; i < n;)
         {
-            c1 = b1;
-            c2 = b2;
-            if (c1 != c2)
+            if (open_at == UINT64_MAX)
             {
-                fossil_io_printf("{cyan}Binary difference at byte %zu: %02x != %02x{normal}\n", pos, c1 & 0xFF, c2 & 0xFF);
+                i += compare_mismatch(buf1 + i, buf2 + i, n - i);
+                if (i == n)
+                    break;
                 diff_found = 1;
-                break;
+                if (!all_ranges)
+                {
+                    compare_note_range(out, pos + i, pos + i + 1);
+                    fossil_io_printf("{cyan}Binary difference at byte %llu: %02x != %02x{normal}\n",
+                                     (unsigned long long)(pos + i), buf1[i], buf2[i]);
+                    break;
+                }
+                open_at = pos + i;
+            }
+            i += compare_match(buf1 + i, buf2 + i, n - i);
+            if (i < n)
+            {
+                compare_print_range(open_at, pos + i);
+                compare_note_range(out, open_at, pos + i);
+                ranges++;
+                differing += pos + i - open_at;
+                open_at = UINT64_MAX;
             }
-            pos++;
         }
-        // Check for length difference
-        if (!diff_found &&
-            (fossil_io_filesys_file_read(&f1, &b1, 1, 1) == 1 ||
-             fossil_io_filesys_file_read(&f2, &b2, 1, 1) == 1))
-            diff_found = 1;
-        fossil_io_filesys_file_close(&f1);
-        fossil_io_filesys_file_close(&f2);
-        return diff_found;
+        pos += n;
+        if ((diff_found && !all_ranges) || n1 != n2 || n < COMPARE_BLOCK)
+            break;
     }
 
-    if (text_diff)
+    if (open_at != UINT64_MAX)
     {
-        fossil_io_filesys_file_t f1, f2;
-        if (cunlikely(fossil_io_filesys_file_open(&f1, path1, "r") != 0 ||
-                      fossil_io_filesys_file_open(&f2, path2, "r") != 0))
+        compare_print_range(open_at, pos);
+        compare_note_range(out, open_at, pos);
+        ranges++;
+        differing += pos - open_at;
+    }
+    if (rc == 0 && all_ranges && diff_found)
+        fossil_io_printf("{blue}%llu differing ranges, %llu bytes{normal}\n",
+                         (unsigned long long)ranges, (unsigned long long)differing);
+    if (rc != 0)
+        fossil_io_printf("{red}Error: Failed to read files for binary comparison.{normal}\n");
+
+    fossil_sys_memory_free(buf2);
+    fossil_sys_memory_free(buf1);
+    compare_close(&f2);
+    compare_close(&f1);
+    return rc != 0 || diff_found ? 1 : 0;
+}
+
+/* ============================================================================
+ * Directory compare
+ * ============================================================================ */
+
+typedef enum
+{
+    TREE_FILE,
+    TREE_DIR,
+    TREE_LINK,
+    TREE_OTHER
+} tree_kind_t;
+
+// One entry of a listed tree, keyed by its path relative to the root
+typedef struct
+{
+    const char *name; // set once the listing is complete
+    size_t path;      // offset of the relative path in the arena
+    uint64_t size;
+    tree_kind_t kind;
+} tree_entry_t;
+
+typedef struct
+{
+    tree_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    char *arena;
+    size_t arena_len;
+    size_t arena_cap;
+} tree_list_t;
+
+typedef enum
+{
+    TREE_SAME,
+    TREE_DIFFERS,
+    TREE_ONLY_A,
+    TREE_ONLY_B
+} tree_status_t;
+
+// One row of the joined listings
+typedef struct
+{
+    const tree_entry_t *a;
+    const tree_entry_t *b;
+    tree_status_t status;
+} tree_pair_t;
+
+typedef struct
+{
+    ccstring root_a;
+    ccstring root_b;
+    tree_pair_t *pairs;
+    size_t *pending; // pairs whose contents still need hashing
+    size_t pending_count;
+    size_t next;
+    fossil_shark_lock_t lock;
+} tree_ctx_t;
+
+static void tree_list_free(tree_list_t *list)
+{
+    fossil_sys_memory_free(list->entries);
+    fossil_sys_memory_free(list->arena);
+    memset(list, 0, sizeof(*list));
+}
+
+static int tree_list_add(tree_list_t *list, const char *rel, uint64_t size, tree_kind_t kind)
+{
+    size_t len = strlen(rel) + 1;
+    if (list->count == list->capacity)
+    {
+        size_t cap = list->capacity ? list->capacity * 2 : 1024;
+        tree_entry_t *grown = (tree_entry_t *)fossil_sys_memory_realloc(list->entries, cap * sizeof(tree_entry_t));
+        if (!cnotnull(grown))
+            return ENOMEM;
+        list->entries = grown;
+        list->capacity = cap;
+    }
+    if (list->arena_len + len > list->arena_cap)
+    {
+        size_t cap = list->arena_cap ? list->arena_cap : 64 * 1024;
+        while (cap < list->arena_len + len)
+            cap *= 2;
+        char *grown = (char *)fossil_sys_memory_realloc(list->arena, cap);
+        if (!cnotnull(grown))
+            return ENOMEM;
+        list->arena = grown;
+        list->arena_cap = cap;
+    }
+    tree_entry_t *e = &list->entries[list->count++];
+    e->name = cnull;
+    e->path = list->arena_len;
+    e->size = size;
+    e->kind = kind;
+    memcpy(list->arena + list->arena_len, rel, len);
+    list->arena_len += len;
+    return 0;
+}
+
+/*
+ * Order paths component by component: '/' sorts below every other byte,
+ * so a directory's contents follow it directly and "a/b" precedes "a-b".
+ */
+static int tree_path_cmp(const char *a, const char *b)
+{
+    for (;; ++a, ++b)
+    {
+        unsigned char x = (unsigned char)*a, y = (unsigned char)*b;
+        if (x != y || x == '\0')
         {
-            fossil_io_printf("{red}Error: Failed to open files for text comparison.{normal}\n");
-            return 1;
+            x = x == '/' ? 1 : x;
+            y = y == '/' ? 1 : y;
+            return (x > y) - (x < y);
         }
+    }
+}
 
-        // Read all lines first
-        cstring *lines1 = cnull, *lines2 = cnull;
-        size_t count1 = 0, count2 = 0;
-        size_t capacity1 = 64, capacity2 = 64;
+static int tree_entry_cmp(const void *a, const void *b)
+{
+    return tree_path_cmp(((const tree_entry_t *)a)->name, ((const tree_entry_t *)b)->name);
+}
 
-        lines1 = (cstring *)fossil_sys_memory_alloc(capacity1 * sizeof(cstring));
-        lines2 = (cstring *)fossil_sys_memory_alloc(capacity2 * sizeof(cstring));
+// List every entry below root without following symlinks, sorted by relative path
+static int tree_list(ccstring root, tree_list_t *list)
+{
+    memset(list, 0, sizeof(*list));
+    size_t *dirs = cnull; // arena offsets of directories still to read
+    size_t dir_count = 0, dir_cap = 0;
+    char dir_rel[FOSSIL_FILESYS_MAX_PATH] = "";
+    char rel[FOSSIL_FILESYS_MAX_PATH];
+    char full[FOSSIL_FILESYS_MAX_PATH];
+    int rc = 0;
 
-        if (!cnotnull(lines1) || !cnotnull(lines2))
+    for (bool first = true; rc == 0; first = false)
+    {
+        if (!first)
         {
-            if (cnotnull(lines1))
-                fossil_sys_memory_free(lines1);
-            if (cnotnull(lines2))
-                fossil_sys_memory_free(lines2);
-            fossil_io_filesys_file_close(&f1);
-            fossil_io_filesys_file_close(&f2);
-            return 1;
+            if (dir_count == 0)
+                break;
+            snprintf(dir_rel, sizeof(dir_rel), "%s", list->arena + dirs[--dir_count]);
         }
+        int n = snprintf(full, sizeof(full), "%s%s%s", root, *dir_rel ? "/" : "", dir_rel);
+        if (n < 0 || (size_t)n >= sizeof(full))
+            continue;
 
-        cstring line;
-        while ((line = read_line(&f1)) != cnull)
+#ifdef _WIN32
+        fossil_io_filesys_obj_t items[1024];
+        size_t found = 0;
+        if (fossil_io_filesys_dir_list(full, items, 1024, &found) != 0)
+            continue;
+        for (size_t i = 0; i < found && rc == 0; ++i)
+        {
+            const fossil_io_filesys_obj_t *obj = &items[i];
+            const char *name = obj->path;
+            for (const char *p = obj->path; *p; ++p)
+            {
+                if (*p == '/' || *p == '\\')
+                    name = p + 1;
+            }
+            tree_kind_t kind = obj->type == FOSSIL_FILESYS_TYPE_FILE  ? TREE_FILE
+                               : obj->type == FOSSIL_FILESYS_TYPE_DIR ? TREE_DIR
+                                                                      : TREE_OTHER;
+            uint64_t size = (uint64_t)obj->size;
+#else
+        DIR *d = opendir(full);
+        if (!d)
+            continue;
+        struct dirent *ent;
+        while (rc == 0 && (ent = readdir(d)) != cnull)
         {
-            if (count1 >= capacity1)
+            const char *name = ent->d_name;
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+                continue;
+            n = snprintf(full, sizeof(full), "%s/%s%s%s", root, dir_rel, *dir_rel ? "/" : "", name);
+            if (n < 0 || (size_t)n >= sizeof(full))
+                continue;
+            struct stat st;
+            if (lstat(full, &st) != 0)
+                continue; // vanished while listing
+            tree_kind_t kind = S_ISREG(st.st_mode)   ? TREE_FILE
+                               : S_ISDIR(st.st_mode) ? TREE_DIR
+                               : S_ISLNK(st.st_mode) ? TREE_LINK
+                                                     : TREE_OTHER;
+            uint64_t size = (uint64_t)st.st_size;
+#endif
+            n = snprintf(rel, sizeof(rel), "%s%s%s", dir_rel, *dir_rel ? "/" : "", name);
+            if (n < 0 || (size_t)n >= sizeof(rel))
+                continue;
+            rc = tree_list_add(list, rel, size, kind);
+            if (rc == 0 && kind == TREE_DIR)
             {
-                capacity1 *= 2;
-                cstring *new_lines = (cstring *)fossil_sys_memory_realloc(lines1, capacity1 * sizeof(cstring));
-                if (!cnotnull(new_lines))
+                if (dir_count == dir_cap)
                 {
-                    // Cleanup on realloc failure
-                    for (size_t i = 0; i < count1; i++)
-                        fossil_sys_memory_free(lines1[i]);
-                    fossil_sys_memory_free(lines1);
-                    fossil_sys_memory_free(lines2);
-                    fossil_io_filesys_file_close(&f1);
-                    fossil_io_filesys_file_close(&f2);
-                    return 1;
+                    size_t cap = dir_cap ? dir_cap * 2 : 64;
+                    size_t *grown = (size_t *)fossil_sys_memory_realloc(dirs, cap * sizeof(size_t));
+                    if (!cnotnull(grown))
+                    {
+                        rc = ENOMEM;
+                        break;
+                    }
+                    dirs = grown;
+                    dir_cap = cap;
                 }
-                lines1 = new_lines;
+                dirs[dir_count++] = list->entries[list->count - 1].path;
             }
-            lines1[count1++] = line;
+        }
+#ifndef _WIN32
+        closedir(d);
+#endif
+    }
+    fossil_sys_memory_free(dirs);
+    if (rc != 0)
+        return rc;
+
+    for (size_t i = 0; i < list->count; ++i)
+        list->entries[i].name = list->arena + list->entries[i].path;
+    qsort(list->entries, list->count, sizeof(tree_entry_t), tree_entry_cmp);
+    return 0;
+}
+
+#ifndef _WIN32
+// Helper: do two symlinks point at the same target?
+static bool tree_same_link(ccstring root_a, ccstring root_b, const char *rel)
+{
+    char pa[FOSSIL_FILESYS_MAX_PATH], pb[FOSSIL_FILESYS_MAX_PATH];
+    char ta[FOSSIL_FILESYS_MAX_PATH], tb[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(pa, sizeof(pa), "%s/%s", root_a, rel);
+    snprintf(pb, sizeof(pb), "%s/%s", root_b, rel);
+    ssize_t la = readlink(pa, ta, sizeof(ta));
+    ssize_t lb = readlink(pb, tb, sizeof(tb));
+    return la >= 0 && la == lb && memcmp(ta, tb, (size_t)la) == 0;
+}
+#endif
+
+// Hash both sides of pending pairs until none are left
+static void tree_hash_worker(void *arg)
+{
+    tree_ctx_t *ctx = (tree_ctx_t *)arg;
+    char pa[FOSSIL_FILESYS_MAX_PATH], pb[FOSSIL_FILESYS_MAX_PATH];
+    for (;;)
+    {
+        fossil_shark_lock_acquire(&ctx->lock);
+        size_t k = ctx->next < ctx->pending_count ? ctx->pending[ctx->next++] : SIZE_MAX;
+        fossil_shark_lock_release(&ctx->lock);
+        if (k == SIZE_MAX)
+            return;
+
+        tree_pair_t *pair = &ctx->pairs[k];
+        snprintf(pa, sizeof(pa), "%s/%s", ctx->root_a, pair->a->name);
+        snprintf(pb, sizeof(pb), "%s/%s", ctx->root_b, pair->b->name);
+        fossil_shark_hash128_t ha, hb;
+        bool same = fossil_shark_hash_file128(pa, &ha) == 0 &&
+                    fossil_shark_hash_file128(pb, &hb) == 0 &&
+                    ha.low == hb.low && ha.high == hb.high;
+        pair->status = same ? TREE_SAME : TREE_DIFFERS;
+    }
+}
+
+/*
+ * Compare two trees: list and sort both, then merge-join the listings.
+ * Entries present on both sides are settled by type and size where
+ * possible; only same-size file pairs are hashed, by a pool of workers.
+ * Contents are always read: a verify must not trust digests cached from
+ * an earlier run, nor write to the cache. A directory present on one side
+ * only, or facing a file of the same name, is reported once, not once per
+ * file inside it.
+ */
+static int compare_tree(ccstring root_a, ccstring root_b, size_t jobs)
+{
+    tree_list_t la, lb;
+    int rc = tree_list(root_a, &la);
+    if (rc == 0)
+    {
+        rc = tree_list(root_b, &lb);
+        if (rc != 0)
+            tree_list_free(&la);
+    }
+    if (rc != 0)
+    {
+        fossil_io_printf("{red}Error: Cannot list directories: %s{normal}\n", strerror(rc));
+        return 1;
+    }
+
+    tree_ctx_t ctx = {0};
+    ctx.root_a = root_a;
+    ctx.root_b = root_b;
+    size_t rows = la.count + lb.count;
+    ctx.pairs = (tree_pair_t *)fossil_sys_memory_alloc((rows ? rows : 1) * sizeof(tree_pair_t));
+    ctx.pending = (size_t *)fossil_sys_memory_alloc((rows ? rows : 1) * sizeof(size_t));
+    if (!cnotnull(ctx.pairs) || !cnotnull(ctx.pending))
+        rc = ENOMEM;
+
+    size_t count = 0;
+    for (size_t i = 0, j = 0; rc == 0 && (i < la.count || j < lb.count);)
+    {
+        const tree_entry_t *a = i < la.count ? &la.entries[i] : cnull;
+        const tree_entry_t *b = j < lb.count ? &lb.entries[j] : cnull;
+        int order = !a ? 1 : !b ? -1 : tree_path_cmp(a->name, b->name);
+        tree_pair_t *pair = &ctx.pairs[count++];
+        pair->a = order <= 0 ? a : cnull;
+        pair->b = order >= 0 ? b : cnull;
+
+        if (order != 0)
+        {
+            // Skip the contents of a directory missing on the other side
+            const tree_list_t *list = order < 0 ? &la : &lb;
+            size_t *at = order < 0 ? &i : &j;
+            const tree_entry_t *only = &list->entries[(*at)++];
+            size_t len = strlen(only->name);
+            while (only->kind == TREE_DIR && *at < list->count &&
+                   strncmp(list->entries[*at].name, only->name, len) == 0 && list->entries[*at].name[len] == '/')
+                (*at)++;
+            pair->status = order < 0 ? TREE_ONLY_A : TREE_ONLY_B;
+            continue;
         }
 
-        while ((line = read_line(&f2)) != cnull)
+        ++i;
+        ++j;
+        if (a->kind != b->kind)
         {
-            if (count2 >= capacity2)
+            // Skip the contents of the directory side; the pair stands for them
+            const tree_list_t *list = a->kind == TREE_DIR ? &la : &lb;
+            size_t *at = a->kind == TREE_DIR ? &i : &j;
+            size_t len = strlen(a->name);
+            if (a->kind == TREE_DIR || b->kind == TREE_DIR)
             {
-                capacity2 *= 2;
-                cstring *new_lines = (cstring *)fossil_sys_memory_realloc(lines2, capacity2 * sizeof(cstring));
-                if (!cnotnull(new_lines))
-                {
-                    // Cleanup on realloc failure
-                    for (size_t i = 0; i < count1; i++)
-                        fossil_sys_memory_free(lines1[i]);
-                    for (size_t i = 0; i < count2; i++)
-                        fossil_sys_memory_free(lines2[i]);
-                    fossil_sys_memory_free(lines1);
-                    fossil_sys_memory_free(lines2);
-                    fossil_io_filesys_file_close(&f1);
-                    fossil_io_filesys_file_close(&f2);
-                    return 1;
-                }
-                lines2 = new_lines;
+                while (*at < list->count && strncmp(list->entries[*at].name, a->name, len) == 0 &&
+                       list->entries[*at].name[len] == '/')
+                    (*at)++;
             }
-            lines2[count2++] = line;
+            pair->status = TREE_DIFFERS;
         }
+        else if (a->kind == TREE_FILE && a->size != b->size)
+            pair->status = TREE_DIFFERS;
+        else if (a->kind == TREE_FILE)
+        {
+            pair->status = TREE_SAME;
+            ctx.pending[ctx.pending_count++] = count - 1;
+        }
+#ifndef _WIN32
+        else if (a->kind == TREE_LINK)
+            pair->status = tree_same_link(root_a, root_b, a->name) ? TREE_SAME : TREE_DIFFERS;
+#endif
+        else
+            pair->status = TREE_SAME;
+    }
 
-        fossil_io_filesys_file_close(&f1);
-        fossil_io_filesys_file_close(&f2);
-
-        int differences = 0;
-        size_t max_lines = count1 > count2 ? count1 : count2;
+    if (rc == 0 && ctx.pending_count > 0)
+    {
+        fossil_shark_lock_init(&ctx.lock);
+        fossil_shark_pool_run(jobs ? jobs : fossil_shark_pool_default_jobs(), tree_hash_worker, &ctx);
+        fossil_shark_lock_destroy(&ctx.lock);
+    }
 
-        for (size_t i = 0; i < max_lines; i++)
+    size_t same = 0, differ = 0, only_a = 0, only_b = 0;
+    for (size_t k = 0; rc == 0 && k < count; ++k)
+    {
+        const tree_pair_t *pair = &ctx.pairs[k];
+        switch (pair->status)
         {
-            cstring line1 = i < count1 ? lines1[i] : cnull;
-            cstring line2 = i < count2 ? lines2[i] : cnull;
+        case TREE_SAME:
+            same++;
+            break;
+        case TREE_DIFFERS:
+            differ++;
+            fossil_io_printf("{cyan}Differs: %s{normal}\n", pair->a->name);
+            break;
+        case TREE_ONLY_A:
+            only_a++;
+            fossil_io_printf("{yellow}Only in %s: %s{normal}\n", root_a, pair->a->name);
+            break;
+        case TREE_ONLY_B:
+            only_b++;
+            fossil_io_printf("{yellow}Only in %s: %s{normal}\n", root_b, pair->b->name);
+            break;
+        }
+    }
+    if (rc == 0)
+        fossil_io_printf("{blue}%zu same, %zu differ, %zu only in %s, %zu only in %s{normal}\n",
+                         same, differ, only_a, root_a, only_b, root_b);
+    else
+        fossil_io_printf("{red}Error: Cannot compare directories: %s{normal}\n", strerror(rc));
+
+    fossil_sys_memory_free(ctx.pending);
+    fossil_sys_memory_free(ctx.pairs);
+    tree_list_free(&lb);
+    tree_list_free(&la);
+    return rc != 0 || differ || only_a || only_b ? 1 : 0;
+}
+
+/* ============================================================================
+ * Binary delta
+ * ============================================================================ */
 
-            if (!cnotnull(line1) || !cnotnull(line2) || !line_equal(line1, line2, ignore_case))
+/*
+ * Patch layout, loosely after VCDIFF (RFC 3284) with a single window:
+ *
+ *   "SHKD" version:u8 source_size:varint source_hash:u64
+ *   instructions, each an opcode byte:
+ *     DELTA_ADD  length:varint bytes        literal target bytes
+ *     DELTA_COPY offset:zvarint length:varint
+ *                                           source bytes; offset is relative
+ *                                           to the end of the previous copy
+ *     DELTA_END
+ *   target_size:varint target_hash:u64
+ *
+ * Integers are little-endian; varints are LEB128 and zvarints zigzag
+ * encoded, so copies walking forward through the source cost a byte or two.
+ */
+#define DELTA_MAGIC "SHKD"
+#define DELTA_VERSION 1
+#define DELTA_END 0
+#define DELTA_ADD 1
+#define DELTA_COPY 2
+#define DELTA_MIN_BLOCK 16         /* smallest source block the index matches on */
+#define DELTA_MAX_BLOCKS (1u << 22) /* index entries; the block size grows past this */
+#define DELTA_PRIME 0x100000001b3ULL
+
+// Buffered patch or output writer; the first error sticks
+typedef struct
+{
+    fossil_io_filesys_file_t file;
+    uint8_t *buf;
+    size_t used;
+    uint64_t written;
+    int error;
+} delta_out_t;
+
+static void delta_flush(delta_out_t *out)
+{
+    if (out->error == 0 && out->used > 0 &&
+        fossil_io_filesys_file_write(&out->file, out->buf, 1, out->used) != out->used)
+        out->error = EIO;
+    if (out->error == 0)
+        fossil_shark_qos_throttle(out->used, 1);
+    out->used = 0;
+}
+
+static void delta_put(delta_out_t *out, const void *data, size_t len)
+{
+    out->written += len;
+    if (out->used + len > COMPARE_BLOCK)
+        delta_flush(out);
+    if (len >= COMPARE_BLOCK)
+    {
+        if (out->error == 0 && fossil_io_filesys_file_write(&out->file, data, 1, len) != len)
+            out->error = EIO;
+        fossil_shark_qos_throttle(len, 1);
+        return;
+    }
+    memcpy(out->buf + out->used, data, len);
+    out->used += len;
+}
+
+static void delta_put_varint(delta_out_t *out, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t n = 0;
+    do
+    {
+        bytes[n] = (uint8_t)(value & 0x7f);
+        value >>= 7;
+        bytes[n++] |= value ? 0x80 : 0;
+    } while (value);
+    delta_put(out, bytes, n);
+}
+
+static void delta_put_u64(delta_out_t *out, uint64_t value)
+{
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    delta_put(out, bytes, 8);
+}
+
+// Buffered patch reader over compare_stream_t
+typedef struct
+{
+    compare_stream_t stream;
+    uint8_t *buf;
+    size_t pos;
+    size_t len;
+    int error;
+} delta_in_t;
+
+static bool delta_get(delta_in_t *in, void *data, size_t len)
+{
+    uint8_t *dst = (uint8_t *)data;
+    while (len > 0)
+    {
+        if (in->pos == in->len)
+        {
+            in->pos = 0;
+            in->error = compare_read(&in->stream, in->buf, COMPARE_BLOCK, &in->len);
+            if (in->error != 0 || in->len == 0)
             {
-                // Print context lines before difference
-                int start_context = (int)i - context_lines;
-                if (start_context < 0)
-                    start_context = 0;
+                if (in->error == 0)
+                    in->error = EINVAL; // truncated patch
+                return false;
+            }
+        }
+        size_t take = in->len - in->pos < len ? in->len - in->pos : len;
+        memcpy(dst, in->buf + in->pos, take);
+        in->pos += take;
+        dst += take;
+        len -= take;
+    }
+    return true;
+}
 
-                for (int ctx = start_context; ctx < (int)i; ctx++)
-                {
-                    if (ctx < (int)count1 && cnotnull(lines1[ctx]))
-                    {
-                        fossil_io_printf("  %d: %s\n", ctx + 1, lines1[ctx]);
-                    }
-                }
+static bool delta_get_varint(delta_in_t *in, uint64_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t byte;
+        if (!delta_get(in, &byte, 1))
+            return false;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    in->error = EINVAL;
+    return false;
+}
 
-                fossil_io_printf("{blue}Difference at line %zu:{normal}\n", i + 1);
-                if (cnotnull(line1))
-                    fossil_io_printf("{cyan}< %s{normal}\n", line1);
-                if (cnotnull(line2))
-                    fossil_io_printf("{cyan}> %s{normal}\n", line2);
+static bool delta_get_u64(delta_in_t *in, uint64_t *value)
+{
+    uint8_t bytes[8];
+    if (!delta_get(in, bytes, 8))
+        return false;
+    *value = 0;
+    for (int i = 0; i < 8; i++)
+        *value |= (uint64_t)bytes[i] << (8 * i);
+    return true;
+}
 
-                // Print context lines after difference
-                int end_context = (int)i + context_lines + 1;
-                if (end_context > (int)max_lines)
-                    end_context = (int)max_lines;
+/*
+ * Source index: the polynomial hash of every block-aligned source block,
+ * in a direct-mapped table holding the first block seen per slot. The
+ * same hash rolls over the target one byte at a time, so each target
+ * position costs a multiply, a lookup and, on a hit, one memcmp.
+ */
+typedef struct
+{
+    const uint8_t *src;
+    size_t src_size;
+    size_t block;
+    uint64_t out_factor; // DELTA_PRIME^(block-1), to drop the outgoing byte
+    uint32_t *slots;     // block number + 1, or 0 when empty
+    unsigned shift;
+} delta_index_t;
 
-                for (int ctx = (int)i + 1; ctx < end_context; ctx++)
-                {
-                    if (ctx < (int)count1 && cnotnull(lines1[ctx]))
-                    {
-                        fossil_io_printf("  %d: %s\n", ctx + 1, lines1[ctx]);
-                    }
-                }
-                fossil_io_printf("\n");
-                differences++;
+static uint64_t delta_hash(const uint8_t *p, size_t len)
+{
+    uint64_t h = 0;
+    for (size_t i = 0; i < len; i++)
+        h = h * DELTA_PRIME + p[i];
+    return h;
+}
+
+static size_t delta_slot(const delta_index_t *index, uint64_t h)
+{
+    return (size_t)((h * 0x9e3779b97f4a7c15ULL) >> index->shift);
+}
+
+static int delta_index_build(delta_index_t *index, const uint8_t *src, size_t src_size)
+{
+    memset(index, 0, sizeof(*index));
+    index->src = src;
+    index->src_size = src_size;
+    index->block = DELTA_MIN_BLOCK;
+    while (src_size / index->block > DELTA_MAX_BLOCKS)
+        index->block *= 2;
+    index->out_factor = 1;
+    for (size_t i = 1; i < index->block; i++)
+        index->out_factor *= DELTA_PRIME;
+
+    size_t blocks = src_size / index->block;
+    size_t cap = 1024;
+    index->shift = 54;
+    while (cap < blocks * 2)
+    {
+        cap *= 2;
+        index->shift--;
+    }
+    index->slots = (uint32_t *)fossil_sys_memory_calloc(cap, sizeof(uint32_t));
+    if (!cnotnull(index->slots))
+        return ENOMEM;
+
+    for (size_t b = 0; b < blocks; b++)
+    {
+        size_t slot = delta_slot(index, delta_hash(src + b * index->block, index->block));
+        if (index->slots[slot] == 0)
+            index->slots[slot] = (uint32_t)(b + 1);
+    }
+    return 0;
+}
+
+typedef struct
+{
+    delta_out_t *out;
+    uint64_t last_copy; // end of the previous copy in the source
+    uint64_t copied;
+    uint64_t literal;
+} delta_emit_t;
+
+static void delta_emit_add(delta_emit_t *emit, const uint8_t *data, size_t len)
+{
+    if (len == 0)
+        return;
+    uint8_t op = DELTA_ADD;
+    delta_put(emit->out, &op, 1);
+    delta_put_varint(emit->out, len);
+    delta_put(emit->out, data, len);
+    emit->literal += len;
+}
+
+static void delta_emit_copy(delta_emit_t *emit, uint64_t offset, uint64_t len)
+{
+    int64_t rel = (int64_t)(offset - emit->last_copy);
+    uint8_t op = DELTA_COPY;
+    delta_put(emit->out, &op, 1);
+    delta_put_varint(emit->out, ((uint64_t)rel << 1) ^ (uint64_t)(rel >> 63));
+    delta_put_varint(emit->out, len);
+    emit->last_copy = offset + len;
+    emit->copied += len;
+}
+
+/*
+ * Stream the target through a window, emitting literals until a window
+ * position hashes to a source block that really matches, then extend the
+ * match backwards over pending literal bytes and forwards as far as it
+ * holds, refilling the window as needed. Only the source is held whole;
+ * the target and the patch are streamed.
+ */
+static int delta_encode(const delta_index_t *index, compare_stream_t *target, delta_emit_t *emit,
+                        uint64_t *target_size, uint64_t *target_hash)
+{
+    const size_t cap = 2 * COMPARE_BLOCK;
+    uint8_t *win = (uint8_t *)fossil_sys_memory_alloc(cap);
+    if (!cnotnull(win))
+        return ENOMEM;
+
+    fossil_shark_hash_state_t hash;
+    fossil_shark_hash_init(&hash);
+    const size_t block = index->block;
+    size_t filled = 0, pos = 0, lit = 0;
+    bool eof = false, rolling = false;
+    uint64_t h = 0;
+    int rc = 0;
+
+    for (;;)
+    {
+        if (pos + block > filled && !eof)
+        {
+            // Flush long literal runs so the window always has room to refill
+            if (lit < pos && pos - lit >= COMPARE_BLOCK / 2)
+            {
+                delta_emit_add(emit, win + lit, pos - lit);
+                lit = pos;
             }
+            memmove(win, win + lit, filled - lit);
+            filled -= lit;
+            pos -= lit;
+            lit = 0;
+            size_t got = 0;
+            rc = compare_read(target, win + filled, cap - filled, &got);
+            if (rc != 0)
+                break;
+            fossil_shark_hash_update(&hash, win + filled, got);
+            *target_size += got;
+            filled += got;
+            eof = filled < cap;
+            rolling = false; // the byte before pos may have been shifted out
+            continue;
+        }
+        if (pos + block > filled)
+            break;
+
+        if (rolling)
+            h = (h - win[pos - 1] * index->out_factor) * DELTA_PRIME + win[pos + block - 1];
+        else
+            h = delta_hash(win + pos, block);
+        rolling = true;
+
+        uint32_t cand = index->slots[delta_slot(index, h)];
+        uint64_t soff = (uint64_t)(cand - 1) * block;
+        if (cand == 0 || memcmp(index->src + soff, win + pos, block) != 0)
+        {
+            ++pos;
+            continue;
         }
 
-        // Clean up
-        for (size_t i = 0; i < count1; i++)
+        while (pos > lit && soff > 0 && win[pos - 1] == index->src[soff - 1])
         {
-            if (cnotnull(lines1[i]))
-                fossil_sys_memory_free(lines1[i]);
+            --pos;
+            --soff;
         }
-        for (size_t i = 0; i < count2; i++)
+        delta_emit_add(emit, win + lit, pos - lit);
+
+        uint64_t start = soff, len = 0;
+        for (;;)
         {
-            if (cnotnull(lines2[i]))
-                fossil_sys_memory_free(lines2[i]);
+            size_t avail = filled - pos;
+            if (index->src_size - soff < avail)
+                avail = (size_t)(index->src_size - soff);
+            size_t run = compare_mismatch(index->src + soff, win + pos, avail);
+            pos += run;
+            soff += run;
+            len += run;
+            if (run < avail || pos < filled || eof || soff == index->src_size)
+                break;
+            // The match reaches the end of the window: slide and keep going
+            filled = 0;
+            pos = 0;
+            size_t got = 0;
+            rc = compare_read(target, win, cap, &got);
+            if (rc != 0)
+                break;
+            fossil_shark_hash_update(&hash, win, got);
+            *target_size += got;
+            filled = got;
+            eof = filled < cap;
         }
-        fossil_sys_memory_free(lines1);
-        fossil_sys_memory_free(lines2);
+        delta_emit_copy(emit, start, len);
+        lit = pos;
+        rolling = false;
+        if (rc != 0)
+            break;
+    }
+
+    if (rc == 0)
+        delta_emit_add(emit, win + lit, filled - lit);
+    *target_hash = fossil_shark_hash_digest64(&hash);
+    fossil_sys_memory_free(win);
+    return rc;
+}
+
+int fossil_shark_compare_delta(ccstring source, ccstring target, ccstring patch)
+{
+    if (!cnotnull(source) || !cnotnull(target) || !cnotnull(patch))
+    {
+        fossil_io_printf("{red}Error: Source, target and patch paths must be specified.{normal}\n");
+        return 1;
+    }
+    if (cunlikely(!is_regular_file(source) || !is_regular_file(target)))
+    {
+        fossil_io_printf("{red}Error: Failed to access files or not regular files.{normal}\n");
+        return 1;
+    }
+
+    compare_text_t src;
+    int rc = compare_text_load(&src, source);
+    if (rc != 0)
+    {
+        fossil_io_printf("{red}Error: Failed to read '%s'.{normal}\n", source);
+        return 1;
+    }
+    compare_stream_t stream;
+    if (compare_open(&stream, target) != 0)
+    {
+        compare_text_free(&src);
+        fossil_io_printf("{red}Error: Failed to read '%s'.{normal}\n", target);
+        return 1;
+    }
+
+    delta_index_t index;
+    delta_out_t out = {0};
+    out.buf = (uint8_t *)fossil_sys_memory_alloc(COMPARE_BLOCK);
+    rc = cnotnull(out.buf) ? delta_index_build(&index, (const uint8_t *)src.data, src.size) : ENOMEM;
+    if (rc == 0 && fossil_io_filesys_file_open(&out.file, patch, "wb") != 0)
+    {
+        fossil_sys_memory_free(index.slots);
+        rc = EIO;
+    }
+    if (rc != 0)
+    {
+        fossil_sys_memory_free(out.buf);
+        compare_close(&stream);
+        compare_text_free(&src);
+        fossil_io_printf("{red}Error: Failed to create patch '%s'.{normal}\n", patch);
+        return 1;
+    }
+
+    uint8_t version = DELTA_VERSION;
+    delta_put(&out, DELTA_MAGIC, 4);
+    delta_put(&out, &version, 1);
+    delta_put_varint(&out, src.size);
+    delta_put_u64(&out, fossil_shark_hash64(src.data, src.size));
+
+    delta_emit_t emit = {&out, 0, 0, 0};
+    uint64_t target_size = 0, target_hash = 0;
+    rc = delta_encode(&index, &stream, &emit, &target_size, &target_hash);
+    uint8_t op = DELTA_END;
+    delta_put(&out, &op, 1);
+    delta_put_varint(&out, target_size);
+    delta_put_u64(&out, target_hash);
+    delta_flush(&out);
+    if (rc == 0)
+        rc = out.error;
+
+    fossil_io_filesys_file_close(&out.file);
+    fossil_sys_memory_free(out.buf);
+    fossil_sys_memory_free(index.slots);
+    compare_close(&stream);
+    compare_text_free(&src);
+
+    if (rc != 0)
+    {
+        remove(patch);
+        fossil_io_printf("{red}Error: Failed to write patch '%s'.{normal}\n", patch);
+        return 1;
+    }
+    fossil_io_printf("{cyan}Delta: %llu bytes copied, %llu literal, patch %llu bytes{normal}\n",
+                     (unsigned long long)emit.copied, (unsigned long long)emit.literal,
+                     (unsigned long long)out.written);
+    return 0;
+}
 
-        return differences > 0 ? 1 : 0;
+// Helper: run the instructions of an opened patch against the source
+static int delta_decode(delta_in_t *in, const uint8_t *src, size_t src_size, delta_out_t *out,
+                        fossil_shark_hash_state_t *hash)
+{
+    uint64_t last_copy = 0;
+    for (;;)
+    {
+        uint8_t op;
+        uint64_t a, len;
+        if (!delta_get(in, &op, 1))
+            return in->error;
+        if (op == DELTA_END)
+            return 0;
+        if (op == DELTA_ADD)
+        {
+            if (!delta_get_varint(in, &len))
+                return in->error;
+            while (len > 0)
+            {
+                uint8_t chunk[4096];
+                size_t take = len < sizeof(chunk) ? (size_t)len : sizeof(chunk);
+                if (!delta_get(in, chunk, take))
+                    return in->error;
+                fossil_shark_hash_update(hash, chunk, take);
+                delta_put(out, chunk, take);
+                len -= take;
+            }
+        }
+        else if (op == DELTA_COPY)
+        {
+            if (!delta_get_varint(in, &a) || !delta_get_varint(in, &len))
+                return in->error;
+            uint64_t offset = last_copy + (uint64_t)((int64_t)(a >> 1) ^ -(int64_t)(a & 1));
+            if (offset > src_size || len > src_size - offset)
+                return EINVAL;
+            fossil_shark_hash_update(hash, src + offset, (size_t)len);
+            delta_put(out, src + offset, (size_t)len);
+            last_copy = offset + len;
+        }
+        else
+        {
+            return EINVAL;
+        }
+        if (out->error != 0)
+            return out->error;
+    }
+}
+
+int fossil_shark_compare_apply(ccstring source, ccstring patch, ccstring output)
+{
+    if (!cnotnull(source) || !cnotnull(patch) || !cnotnull(output))
+    {
+        fossil_io_printf("{red}Error: Source, patch and output paths must be specified.{normal}\n");
+        return 1;
+    }
+    if (cunlikely(!is_regular_file(source) || !is_regular_file(patch)))
+    {
+        fossil_io_printf("{red}Error: Failed to access files or not regular files.{normal}\n");
+        return 1;
+    }
+
+    compare_text_t src;
+    if (compare_text_load(&src, source) != 0)
+    {
+        fossil_io_printf("{red}Error: Failed to read '%s'.{normal}\n", source);
+        return 1;
+    }
+    delta_in_t in = {0};
+    in.buf = (uint8_t *)fossil_sys_memory_alloc(COMPARE_BLOCK);
+    if (!cnotnull(in.buf) || compare_open(&in.stream, patch) != 0)
+    {
+        fossil_sys_memory_free(in.buf);
+        compare_text_free(&src);
+        fossil_io_printf("{red}Error: Failed to read '%s'.{normal}\n", patch);
+        return 1;
+    }
+
+    char magic[4];
+    uint8_t version = 0;
+    uint64_t src_size = 0, src_hash = 0;
+    bool valid = delta_get(&in, magic, 4) && memcmp(magic, DELTA_MAGIC, 4) == 0 &&
+                 delta_get(&in, &version, 1) && version == DELTA_VERSION &&
+                 delta_get_varint(&in, &src_size) && delta_get_u64(&in, &src_hash);
+    int rc = 0;
+    if (!valid)
+    {
+        fossil_io_printf("{red}Error: '%s' is not a compare delta.{normal}\n", patch);
+        rc = 1;
+    }
+    else if (src_size != src.size || src_hash != fossil_shark_hash64(src.data, src.size))
+    {
+        fossil_io_printf("{red}Error: Patch '%s' was made against a different source.{normal}\n", patch);
+        rc = 1;
+    }
+    if (rc != 0)
+    {
+        compare_close(&in.stream);
+        fossil_sys_memory_free(in.buf);
+        compare_text_free(&src);
+        return rc;
+    }
+
+    // Write beside the output and rename over it, so a failed apply leaves
+    // nothing behind and the source itself can be patched in place
+    cstring part = fossil_io_cstring_format("%s.part", output);
+    delta_out_t out = {0};
+    out.buf = (uint8_t *)fossil_sys_memory_alloc(COMPARE_BLOCK);
+    rc = cnotnull(out.buf) && fossil_io_filesys_file_open(&out.file, part, "wb") == 0 ? 0 : EIO;
+    if (rc == 0)
+    {
+        fossil_shark_hash_state_t hash;
+        fossil_shark_hash_init(&hash);
+        uint64_t size = 0, digest = 0;
+        rc = delta_decode(&in, (const uint8_t *)src.data, src.size, &out, &hash);
+        if (rc == 0 && (!delta_get_varint(&in, &size) || !delta_get_u64(&in, &digest)))
+            rc = in.error;
+        delta_flush(&out);
+        if (rc == 0)
+            rc = out.error;
+        if (rc == 0 && (size != out.written || digest != fossil_shark_hash_digest64(&hash)))
+            rc = EINVAL;
+        fossil_io_filesys_file_close(&out.file);
+    }
+    compare_close(&in.stream);
+    fossil_sys_memory_free(in.buf);
+    compare_text_free(&src);
+
+    if (rc == 0)
+    {
+#ifdef _WIN32
+        remove(output);
+#endif
+        if (rename(part, output) != 0)
+            rc = errno ? errno : EIO;
+    }
+    if (rc != 0)
+    {
+        remove(part);
+        fossil_io_printf(rc == EINVAL ? "{red}Error: Patch '%s' is corrupt.{normal}\n"
+                                      : "{red}Error: Failed to write '%s'.{normal}\n",
+                         rc == EINVAL ? patch : output);
+    }
+    else
+    {
+        fossil_io_printf("{cyan}Patched: wrote %llu bytes to %s{normal}\n",
+                         (unsigned long long)out.written, output);
+    }
+    fossil_sys_memory_free(out.buf);
+    fossil_io_cstring_free(part);
+    return rc != 0 ? 1 : 0;
+}
+
+int fossil_shark_compare(ccstring path1, ccstring path2,
+                         bool text_diff, bool binary_diff,
+                         int context_lines, bool ignore_case,
+                         ccstring algorithm, bool all_ranges,
+                         bool ignore_space, bool recursive, size_t jobs)
+{
+    if (!cnotnull(path1) || !cnotnull(path2))
+    {
+        fossil_io_printf("{red}Error: Two paths must be specified.{normal}\n");
+        return 1;
+    }
+
+    fossil_io_filesys_obj_t dir1, dir2;
+    if (recursive && fossil_io_filesys_stat(path1, &dir1) == 0 && fossil_io_filesys_stat(path2, &dir2) == 0 &&
+        dir1.type == FOSSIL_FILESYS_TYPE_DIR && dir2.type == FOSSIL_FILESYS_TYPE_DIR)
+        return compare_tree(path1, path2, jobs);
+
+    if (cunlikely(!is_regular_file(path1) || !is_regular_file(path2)))
+    {
+        fossil_io_printf("{red}Error: Failed to access files or not regular files.{normal}\n");
+        return 1;
+    }
+
+    if (binary_diff)
+        return compare_binary(path1, path2, all_ranges, jobs, cnull);
+
+    if (text_diff)
+    {
+        compare_norm_t norm = {ignore_case, ignore_space};
+        return compare_text(path1, path2, context_lines, norm, algorithm);
     }
 
     fossil_io_printf("{red}Error: Specify at least text_diff or binary_diff.{normal}\n");
     return 1;
 }
+
+int fossil_shark_compare_binary(ccstring path1, ccstring path2, bool all_ranges, size_t jobs,
+                                fossil_shark_compare_range_t *ranges, size_t max_ranges, size_t *range_count)
+{
+    if (!cnotnull(path1) || !cnotnull(path2) || !cnotnull(range_count) || (max_ranges && !cnotnull(ranges)))
+        return 1;
+    *range_count = 0;
+    if (cunlikely(!is_regular_file(path1) || !is_regular_file(path2)))
+    {
+        fossil_io_printf("{red}Error: Failed to access files or not regular files.{normal}\n");
+        return 1;
+    }
+
+    compare_ranges_t out = {ranges, max_ranges, 0};
+    int rc = compare_binary(path1, path2, all_ranges, jobs, &out);
+    *range_count = out.count;
+    return rc;
+}
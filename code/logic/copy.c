@@ -23,9 +23,21 @@
  * -----------------------------------------------------------------------------
  */
 #include "fossil/code/copy.h"
+#include "fossil/code/hashcache.h"
+#include "fossil/code/qos.h"
+
+// Helper: compare contents by XXH3-128, reusing cached digests of unchanged files
+static bool copy_same_content(fossil_shark_hashcache_t *cache, ccstring a, ccstring b)
+{
+    fossil_shark_hash128_t ha, hb;
+    if (fossil_shark_hashcache_file128(cache, a, &ha) != 0 ||
+        fossil_shark_hashcache_file128(cache, b, &hb) != 0)
+        return false;
+    return ha.low == hb.low && ha.high == hb.high;
+}
 
 static int copy_file(ccstring src, ccstring dest, bool update, bool preserve,
-                     bool checksum, bool dry_run)
+                     bool checksum, bool dry_run, fossil_shark_hashcache_t *cache)
 {
     if (cunlikely(!cnotnull(src) || !cnotnull(dest)))
     {
@@ -50,10 +62,7 @@ static int copy_file(ccstring src, ccstring dest, bool update, bool preserve,
 
     if (update && dest_exists)
     {
-        char src_hash[128] = {0}, dest_hash[128] = {0};
-        int src_hash_res = fossil_io_filesys_file_hash(src, (unsigned char*)src_hash, sizeof(src_hash), "xxhash64");
-        int dest_hash_res = fossil_io_filesys_file_hash(dest, (unsigned char*)dest_hash, sizeof(dest_hash), "xxhash64");
-        if (src_hash_res == 0 && dest_hash_res == 0 && memcmp(src_hash, dest_hash, sizeof(src_hash)) == 0)
+        if (src_obj.size == dest_obj.size && copy_same_content(cache, src, dest))
         {
             fossil_io_printf("{cyan}Skipping '%s' - destination is up to date (hash match){normal}\n", src);
             return 0;
@@ -81,6 +90,7 @@ static int copy_file(ccstring src, ccstring dest, bool update, bool preserve,
     size_t n;
     while ((n = fossil_io_filesys_file_read(&src_stream, buffer, 1, sizeof(buffer))) > 0)
     {
+        fossil_shark_qos_throttle(n, 2);
         if (cunlikely(fossil_io_filesys_file_write(&dest_stream, buffer, 1, n) != n))
         {
             fossil_io_printf("{red}Error: Write failed for '%s'{normal}\n", dest);
@@ -95,10 +105,7 @@ static int copy_file(ccstring src, ccstring dest, bool update, bool preserve,
 
     if (checksum)
     {
-        char src_hash[128] = {0}, dest_hash[128] = {0};
-        int src_hash_res = fossil_io_filesys_file_hash(src, (unsigned char*)src_hash, sizeof(src_hash), "xxhash64");
-        int dest_hash_res = fossil_io_filesys_file_hash(dest, (unsigned char*)dest_hash, sizeof(dest_hash), "xxhash64");
-        if (src_hash_res != 0 || dest_hash_res != 0 || memcmp(src_hash, dest_hash, sizeof(src_hash)) != 0)
+        if (!copy_same_content(cache, src, dest))
         {
             fossil_io_printf("{red}Error: Checksum verification failed for '%s'{normal}\n", dest);
             return 1;
@@ -127,7 +134,8 @@ static int copy_directory(ccstring src, ccstring dest,
                           bool recursive, bool update, bool preserve,
                           bool checksum, bool sparse, bool link, bool reflink,
                           bool progress, bool dry_run,
-                          ccstring exclude_pattern, ccstring include_pattern)
+                          ccstring exclude_pattern, ccstring include_pattern,
+                          fossil_shark_hashcache_t *cache)
 {
     if (cunlikely(!cnotnull(src) || !cnotnull(dest)))
     {
@@ -184,7 +192,7 @@ static int copy_directory(ccstring src, ccstring dest,
             {
                 if (copy_directory(entry->path, dest_path, recursive, update, preserve,
                                    checksum, sparse, link, reflink, progress, dry_run,
-                                   exclude_pattern, include_pattern) != 0)
+                                   exclude_pattern, include_pattern, cache) != 0)
                 {
                     return 1;
                 }
@@ -193,7 +201,7 @@ static int copy_directory(ccstring src, ccstring dest,
         else if (entry->type == FOSSIL_FILESYS_TYPE_FILE)
         {
             if (copy_file(entry->path, dest_path, update, preserve,
-                          checksum, dry_run) != 0)
+                          checksum, dry_run, cache) != 0)
             {
                 return 1;
             }
@@ -230,27 +238,36 @@ int fossil_shark_copy(ccstring src, ccstring dest,
         return 1;
     }
 
-    if (src_obj.type == FOSSIL_FILESYS_TYPE_DIR)
+    if (src_obj.type != FOSSIL_FILESYS_TYPE_DIR && src_obj.type != FOSSIL_FILESYS_TYPE_FILE)
     {
-        if (!recursive)
-        {
-            fossil_io_printf("{red}Error: Source is a directory. Use recursive flag to copy directories{normal}\n");
-            return 1;
-        }
-        fossil_io_printf("{cyan}Starting recursive copy of directory: %s -> %s{normal}\n", src, dest);
-        return copy_directory(src, dest, recursive, update, preserve,
-                              checksum, sparse, link, reflink, progress, dry_run,
-                              exclude_pattern, include_pattern);
+        fossil_io_printf("{red}Error: Unsupported file type for '%s'{normal}\n", src);
+        return 1;
     }
-    else if (src_obj.type == FOSSIL_FILESYS_TYPE_FILE)
+    if (src_obj.type == FOSSIL_FILESYS_TYPE_DIR && !recursive)
     {
-        return copy_file(src, dest, update, preserve,
-                         checksum, dry_run);
+        fossil_io_printf("{red}Error: Source is a directory. Use recursive flag to copy directories{normal}\n");
+        return 1;
+    }
+
+    // Content comparisons reuse digests of files unchanged since an earlier run
+    fossil_shark_hashcache_t *cache = cnull;
+    if ((update || checksum) && !dry_run)
+        fossil_shark_hashcache_open(&cache, cnull);
+
+    int rc;
+    if (src_obj.type == FOSSIL_FILESYS_TYPE_DIR)
+    {
+        fossil_io_printf("{cyan}Starting recursive copy of directory: %s -> %s{normal}\n", src, dest);
+        rc = copy_directory(src, dest, recursive, update, preserve,
+                            checksum, sparse, link, reflink, progress, dry_run,
+                            exclude_pattern, include_pattern, cache);
     }
     else
     {
-        fossil_io_printf("{red}Error: Unsupported file type for '%s'{normal}\n", src);
-        return 1;
+        rc = copy_file(src, dest, update, preserve,
+                       checksum, dry_run, cache);
     }
-    return 0;
+
+    fossil_shark_hashcache_close(cache);
+    return rc;
 }
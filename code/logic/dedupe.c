@@ -22,165 +22,1601 @@
  * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "fossil/code/dedupe.h"
+#include "fossil/code/chunk.h"
+#include "fossil/code/hash.h"
+#include "fossil/code/hashcache.h"
+#include "fossil/code/pool.h"
+#include "fossil/code/qos.h"
 
-#define MAX_HASH_LEN 128
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#endif
+#if defined(__linux__)
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#endif
 
-int fossil_shark_dedupe(
-    const char* dir_path,
-    bool use_hash,
-    bool interactive,
-    bool delete_files,
-    bool link_files,
-    const char* media /* "text", "json", "fson" */
-)
+/*
+ * Duplicates are found in stages, each run only on files that still
+ * collide after the cheaper one before it:
+ *
+ *   1. exact size (metadata only; a unique size cannot have a duplicate)
+ *   2. 128-bit hash of the first and last DEDUPE_PARTIAL_BYTES
+ *   3. 128-bit hash of the whole file, streamed through a fixed buffer
+ *   4. optionally, a byte-for-byte comparison with the kept original
+ *
+ * Files no larger than two partial windows are fully covered by stage 2,
+ * so stage 3 is skipped for them. The tree is walked by a pool of workers
+ * and stages 2 and 3 are hashed by another, with at most one reader per
+ * spinning disk so its head is not thrashed between files.
+ *
+ * Full hashes are kept in the persistent hash cache. A size group with a
+ * cached member skips stage 2, so an unchanged tree is compared without
+ * reading file data.
+ *
+ * Paths that are hard links to one inode are collapsed before stage 1:
+ * only the lexically first is hashed and grouped, and the others follow
+ * it. Duplicates whose extents are already shared with the kept file
+ * (an earlier reflink) are left out, as they hold no reclaimable space.
+ */
+#define DEDUPE_PARTIAL_BYTES 4096
+#define DEDUPE_COMPARE_CHUNK (64 * 1024)
+#define DEDUPE_ROTATIONAL_JOBS 1
+#define DEDUPE_REFLINK_CHUNK (16u * 1024u * 1024u) /* largest range btrfs takes per call */
+#define DEDUPE_REFLINK_BATCH 120                   /* destinations per call; the request must fit a page */
+#define DEDUPE_NONE UINT32_MAX
+#define DEDUPE_RUN_RECORDS (2u * 1024u * 1024u) /* chunk records held before a sorted run is spilled (48 MiB) */
+#define DEDUPE_RUN_READ 4096                    /* records read at a time from each run while merging */
+#define DEDUPE_CHUNK_BATCH 1024                 /* records a worker collects before taking the lock */
+#define DEDUPE_PAIR_FANOUT 16                   /* chunks in more files than this are not paired */
+#define DEDUPE_PAIR_MAX (1u << 20)              /* cap on the file-pair table */
+#define DEDUPE_FIEMAP_EXTENTS 32                /* extents fetched per FIEMAP call */
+
+typedef enum
+{
+    DEDUPE_STAGE_CACHED,
+    DEDUPE_STAGE_PARTIAL,
+    DEDUPE_STAGE_FULL,
+    DEDUPE_STAGE_BLOCKS
+} dedupe_stage_t;
+
+/*
+ * Per-file state is a few dozen bytes: paths live back to back in one
+ * arena and are referenced by offset, and the digest of the current stage
+ * is kept in binary.
+ */
+typedef struct
+{
+    uint64_t size;
+    uint64_t digest[2]; // key of the current stage; 128-bit XXH3 once hashed
+    uint64_t inode;     // set only for files with more than one link
+    size_t path;        // offset of the NUL-terminated path in the arena
+    uint32_t next;      // next file in the same bucket
+    uint32_t alias;     // next path of the same inode
+    uint32_t device;    // index into the device table
+    bool failed;        // could not be read; never grouped
+    bool cached;        // digest is the full hash, taken from the hash cache
+    bool linked;        // another path of the same inode stands for this one
+} dedupe_file_t;
+
+// One open-addressing slot: a digest and the chain of files that share it
+typedef struct
 {
-    if (!dir_path) return -1;
+    uint64_t key[2];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t count; // 0 marks an empty slot
+} dedupe_bucket_t;
 
-    /* Default media */
-    const char* fmt = (media) ? media : "text";
+// Files that still collide after a stage, stored group after group
+typedef struct
+{
+    uint32_t *members;
+    size_t count;
+    size_t *ends; // ends[g] is one past the last member of group g
+    size_t groups;
+} dedupe_groups_t;
+
+// One content-defined chunk of a file, as recorded by --blocks
+typedef struct
+{
+    uint64_t hash[2];
+    uint32_t file;
+    uint32_t length;
+} dedupe_chunk_t;
+
+typedef struct
+{
+    uint64_t id;
+    unsigned limit;   // hashing workers allowed on this device at once
+    unsigned active;
+    uint32_t *queue;  // files of this device waiting in the current pass
+    size_t queued;
+    size_t taken;
+} dedupe_device_t;
+
+typedef struct
+{
+    const char *fmt;
+    bool use_hash;
+    bool interactive;
+    bool delete_files;
+    bool link_files;
+    bool reflink_files;
+    bool hardlink_files;
+    bool verify;
+    bool recursive;
+    bool blocks;
+    size_t jobs;
+    fossil_shark_hashcache_t *cache;
+    dedupe_file_t *files;
+    size_t count;
+    size_t capacity;
+    char *arena;
+    size_t arena_len;
+    size_t arena_cap;
+    dedupe_device_t *devices;
+    size_t device_count;
+    size_t device_cap;
+    // shared by the walk and hashing workers
+    fossil_shark_lock_t lock;
+    cstring *dirs;    // directories waiting to be listed
+    size_t dir_len;
+    size_t dir_cap;
+    size_t busy;      // walkers currently listing a directory
+    size_t remaining; // files not yet claimed by a hashing worker
+    size_t rotor;     // spreads claims across devices
+    dedupe_stage_t stage;
+    int error;
+    // --blocks: chunk records awaiting a sort, and the runs already spilled
+    dedupe_chunk_t *chunks;
+    size_t chunk_count;
+    FILE **runs;
+    size_t run_count;
+    size_t run_cap;
+    fossil_shark_dedupe_blocks_t *stats; // filled instead of printing when set
+} dedupe_ctx_t;
+
+static void dedupe_output(const char *fmt, const char *dup, const char *orig)
+{
+    if (strcmp(fmt, "json") == 0)
+        fossil_io_printf("{\"duplicate\":\"%s\",\"original\":\"%s\"}\n", dup, orig);
+    else if (strcmp(fmt, "fson") == 0)
+        fossil_io_printf("duplicate:cstr=%s original:cstr=%s\n", dup, orig);
+    else
+        fossil_io_printf("Duplicate found: %s -> %s\n", dup, orig);
+}
+
+/* ============================================================================
+ * Storage
+ * ============================================================================ */
+
+// Helper: how many hashing workers one device can use; spinning disks get one
+static unsigned dedupe_device_limit(uint64_t id, size_t jobs)
+{
+#if defined(__linux__)
+    // Partitions have no queue directory of their own, so also ask the parent disk
+    static const char *const layouts[] = {
+        "/sys/dev/block/%u:%u/queue/rotational",
+        "/sys/dev/block/%u:%u/../queue/rotational"
+    };
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); ++i)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), layouts[i], major((dev_t)id), minor((dev_t)id));
+        fossil_io_filesys_file_t f = {0};
+        if (fossil_io_filesys_file_open(&f, path, "r") != 0)
+            continue;
+        char flag = 0;
+        fossil_io_filesys_file_read(&f, &flag, 1, 1);
+        fossil_io_filesys_file_close(&f);
+        if (flag == '1')
+            return DEDUPE_ROTATIONAL_JOBS;
+        if (flag == '0')
+            break;
+    }
+#else
+    (void)id;
+#endif
+    return (unsigned)jobs;
+}
+
+// Helper: index of a device in the table, adding it on first sight
+static int dedupe_device(dedupe_ctx_t *ctx, uint64_t id, uint32_t *out)
+{
+    for (size_t i = 0; i < ctx->device_count; ++i)
+    {
+        if (ctx->devices[i].id == id)
+        {
+            *out = (uint32_t)i;
+            return 0;
+        }
+    }
+    if (ctx->device_count == ctx->device_cap)
+    {
+        size_t cap = ctx->device_cap ? ctx->device_cap * 2 : 4;
+        dedupe_device_t *grown = fossil_sys_memory_realloc(ctx->devices, cap * sizeof(dedupe_device_t));
+        if (!grown)
+            return ENOMEM;
+        ctx->devices = grown;
+        ctx->device_cap = cap;
+    }
+    dedupe_device_t *d = &ctx->devices[ctx->device_count];
+    memset(d, 0, sizeof(*d));
+    d->id = id;
+    d->limit = ctx->jobs ? dedupe_device_limit(id, ctx->jobs) : 0; // walk batches resolve limits on merge
+    *out = (uint32_t)ctx->device_count++;
+    return 0;
+}
+
+// Helper: append a file, interning its path in the arena
+static int dedupe_add(dedupe_ctx_t *ctx, const char *path, uint64_t size, int64_t mtime, uint64_t dev,
+                      uint64_t inode)
+{
+    size_t len = strlen(path) + 1;
+    if (ctx->count == ctx->capacity)
+    {
+        if (ctx->count >= DEDUPE_NONE)
+            return EOVERFLOW;
+        size_t cap = ctx->capacity ? ctx->capacity * 2 : 1024;
+        dedupe_file_t *grown = fossil_sys_memory_realloc(ctx->files, cap * sizeof(dedupe_file_t));
+        if (!grown)
+            return ENOMEM;
+        ctx->files = grown;
+        ctx->capacity = cap;
+    }
+    if (ctx->arena_len + len > ctx->arena_cap)
+    {
+        size_t cap = ctx->arena_cap ? ctx->arena_cap : 64 * 1024;
+        while (cap < ctx->arena_len + len)
+            cap *= 2;
+        char *grown = fossil_sys_memory_realloc(ctx->arena, cap);
+        if (!grown)
+            return ENOMEM;
+        ctx->arena = grown;
+        ctx->arena_cap = cap;
+    }
+
+    dedupe_file_t *f = &ctx->files[ctx->count];
+    memset(f, 0, sizeof(*f));
+    if (dedupe_device(ctx, dev, &f->device) != 0)
+        return ENOMEM;
+    f->size = size;
+    f->inode = inode;
+    f->alias = DEDUPE_NONE;
+    // The first stage keys on size and, without --hash, the mtime
+    f->digest[0] = size;
+    f->digest[1] = ctx->use_hash ? 0 : (uint64_t)mtime;
+    f->path = ctx->arena_len;
+    memcpy(ctx->arena + ctx->arena_len, path, len);
+    ctx->arena_len += len;
+    ctx->count++;
+    return 0;
+}
 
+static int dedupe_push_dir(dedupe_ctx_t *ctx, const char *path)
+{
+    if (ctx->dir_len == ctx->dir_cap)
+    {
+        size_t cap = ctx->dir_cap ? ctx->dir_cap * 2 : 64;
+        cstring *grown = fossil_sys_memory_realloc(ctx->dirs, cap * sizeof(cstring));
+        if (!grown)
+            return ENOMEM;
+        ctx->dirs = grown;
+        ctx->dir_cap = cap;
+    }
+    cstring copy = fossil_io_cstring_dup(path);
+    if (!copy)
+        return ENOMEM;
+    ctx->dirs[ctx->dir_len++] = copy;
+    return 0;
+}
+
+static void dedupe_release(dedupe_ctx_t *ctx)
+{
+    while (ctx->dir_len > 0)
+        fossil_io_cstring_free(ctx->dirs[--ctx->dir_len]);
+    fossil_sys_memory_free(ctx->dirs);
+    while (ctx->run_count > 0)
+        fclose(ctx->runs[--ctx->run_count]);
+    fossil_sys_memory_free(ctx->runs);
+    fossil_sys_memory_free(ctx->chunks);
+    fossil_sys_memory_free(ctx->devices);
+    fossil_sys_memory_free(ctx->files);
+    fossil_sys_memory_free(ctx->arena);
+}
+
+static const char *dedupe_path(const dedupe_ctx_t *ctx, uint32_t file)
+{
+    return ctx->arena + ctx->files[file].path;
+}
+
+/* ============================================================================
+ * Parallel walk
+ * ============================================================================ */
+
+// Helper: list one directory into a walker's private batch
+static void dedupe_list_dir(dedupe_ctx_t *batch, const char *dir)
+{
+#ifdef _WIN32
     fossil_io_filesys_obj_t entries[1024];
     size_t count = 0;
+    if (fossil_io_filesys_dir_list(dir, entries, 1024, &count) != 0)
+        return;
+    for (size_t i = 0; i < count && batch->error == 0; ++i)
+    {
+        const fossil_io_filesys_obj_t *obj = &entries[i];
+        if (obj->type == FOSSIL_FILESYS_TYPE_FILE)
+            batch->error = dedupe_add(batch, obj->path, obj->size, (int64_t)obj->modified_at, 0, 0);
+        else if (obj->type == FOSSIL_FILESYS_TYPE_DIR && batch->recursive)
+            batch->error = dedupe_push_dir(batch, obj->path);
+    }
+#else
+    DIR *d = opendir(dir);
+    if (!d)
+        return;
+    struct dirent *ent;
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    while (batch->error == 0 && (ent = readdir(d)) != cnull)
+    {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+            continue;
+        int n = snprintf(path, sizeof(path), "%s/%s", strcmp(dir, "/") == 0 ? "" : dir, ent->d_name);
+        if (n < 0 || (size_t)n >= sizeof(path))
+            continue;
+
+        // Symlinks are neither followed nor reported
+        struct stat st;
+        if (lstat(path, &st) != 0)
+            continue; // vanished while scanning
+        if (S_ISREG(st.st_mode))
+            batch->error = dedupe_add(batch, path, (uint64_t)st.st_size, (int64_t)st.st_mtime, (uint64_t)st.st_dev,
+                                      st.st_nlink > 1 ? (uint64_t)st.st_ino : 0);
+        else if (S_ISDIR(st.st_mode) && batch->recursive)
+            batch->error = dedupe_push_dir(batch, path);
+    }
+    closedir(d);
+#endif
+}
+
+// Helper: move a walker's batch into the shared file list and queue its subdirectories
+static int dedupe_merge(dedupe_ctx_t *ctx, dedupe_ctx_t *batch)
+{
+    for (size_t i = 0; i < batch->count; ++i)
+    {
+        const dedupe_file_t *f = &batch->files[i];
+        int rc = dedupe_add(ctx, batch->arena + f->path, f->size, (int64_t)f->digest[1],
+                            batch->devices[f->device].id, f->inode);
+        if (rc != 0)
+            return rc;
+    }
+    while (batch->dir_len > 0)
+    {
+        cstring dir = batch->dirs[--batch->dir_len];
+        int rc = dedupe_push_dir(ctx, dir);
+        fossil_io_cstring_free(dir);
+        if (rc != 0)
+            return rc;
+    }
+    return batch->error;
+}
+
+static void dedupe_walk_worker(void *arg)
+{
+    dedupe_ctx_t *ctx = (dedupe_ctx_t *)arg;
+    dedupe_ctx_t batch = {0};
+    batch.recursive = ctx->recursive;
+
+    fossil_shark_lock_acquire(&ctx->lock);
+    for (;;)
+    {
+        while (ctx->dir_len == 0 && ctx->busy > 0)
+            fossil_shark_lock_wait(&ctx->lock);
+        if (ctx->dir_len == 0 || ctx->error != 0)
+            break;
+
+        cstring dir = ctx->dirs[--ctx->dir_len];
+        ctx->busy++;
+        fossil_shark_lock_release(&ctx->lock);
+
+        dedupe_list_dir(&batch, dir);
+        fossil_io_cstring_free(dir);
+
+        fossil_shark_lock_acquire(&ctx->lock);
+        int rc = dedupe_merge(ctx, &batch);
+        if (rc != 0 && ctx->error == 0)
+            ctx->error = rc;
+        batch.count = 0;
+        batch.arena_len = 0;
+        batch.device_count = 0;
+        batch.error = 0;
+        ctx->busy--;
+        fossil_shark_lock_wake_all(&ctx->lock);
+    }
+    fossil_shark_lock_wake_all(&ctx->lock);
+    fossil_shark_lock_release(&ctx->lock);
+    dedupe_release(&batch);
+}
+
+/* ============================================================================
+ * Hashing stages
+ * ============================================================================ */
+
+// Helper: hash the head and tail of a file; the whole file when it is small
+static int dedupe_hash_partial(const char *path, const dedupe_file_t *file, fossil_shark_hash128_t *out)
+{
+    fossil_io_filesys_file_t f = {0};
+    if (fossil_io_filesys_file_open(&f, path, "rb") != 0)
+        return errno ? errno : EIO;
+
+    uint8_t buffer[2 * DEDUPE_PARTIAL_BYTES];
+    size_t want = file->size <= sizeof(buffer) ? (size_t)file->size : DEDUPE_PARTIAL_BYTES;
+    size_t got = fossil_io_filesys_file_read(&f, buffer, 1, want);
+    if (got == want && file->size > sizeof(buffer))
+    {
+        if (fossil_io_filesys_file_seek(&f, (int64_t)(file->size - DEDUPE_PARTIAL_BYTES), SEEK_SET) == 0)
+            got += fossil_io_filesys_file_read(&f, buffer + got, 1, DEDUPE_PARTIAL_BYTES);
+        want += DEDUPE_PARTIAL_BYTES;
+    }
+    fossil_io_filesys_file_close(&f);
+    fossil_shark_qos_throttle(got, 1);
+
+    if (got != want)
+        return EIO; // changed size since it was listed
+    *out = fossil_shark_hash128(buffer, got);
+    return 0;
+}
 
-    int rc = fossil_io_filesys_dir_list(dir_path, entries, 1024, &count);
-    if (rc < 0) return rc;
-
-    typedef struct file_node_t {
-        char path[FOSSIL_FILESYS_MAX_PATH];
-        char hash[MAX_HASH_LEN];
-        struct file_node_t* next;
-    } file_node_t;
-
-    file_node_t* head = NULL;
-
-    /* Output helper */
-    #define OUTPUT_DUP(dup, orig)                                     \
-        do {                                                          \
-            if (strcmp(fmt, "json") == 0) {                           \
-                fossil_io_printf(                                     \
-                    "{\"duplicate\":\"%s\",\"original\":\"%s\"}\n",   \
-                    dup, orig                                         \
-                );                                                    \
-            } else if (strcmp(fmt, "fson") == 0) {                    \
-                fossil_io_printf(                                     \
-                    "duplicate:cstr=%s original:cstr=%s\n",                     \
-                    dup, orig                                         \
-                );                                                    \
-            } else {                                                  \
-                fossil_io_printf(                                     \
-                    "Duplicate found: %s -> %s\n",                    \
-                    dup, orig                                         \
-                );                                                    \
-            }                                                         \
-        } while (0)
-
-    for (size_t i = 0; i < count; ++i) {
-        fossil_io_filesys_obj_t* obj = &entries[i];
-
-        if (obj->type != FOSSIL_FILESYS_TYPE_FILE)
+static bool dedupe_fully_covered(const dedupe_file_t *file)
+{
+    return file->size <= 2 * DEDUPE_PARTIAL_BYTES;
+}
+
+/* ============================================================================
+ * Block-level analysis
+ * ============================================================================ */
+
+// Helper: order chunk records by digest, then by file
+static int dedupe_chunk_cmp(const void *a, const void *b)
+{
+    const dedupe_chunk_t *x = (const dedupe_chunk_t *)a;
+    const dedupe_chunk_t *y = (const dedupe_chunk_t *)b;
+    if (x->hash[0] != y->hash[0])
+        return x->hash[0] < y->hash[0] ? -1 : 1;
+    if (x->hash[1] != y->hash[1])
+        return x->hash[1] < y->hash[1] ? -1 : 1;
+    return (x->file > y->file) - (x->file < y->file);
+}
+
+// Helper: sort the shared record buffer and write it out as one run (lock held)
+static int dedupe_spill(dedupe_ctx_t *ctx)
+{
+    qsort(ctx->chunks, ctx->chunk_count, sizeof(dedupe_chunk_t), dedupe_chunk_cmp);
+    if (ctx->run_count == ctx->run_cap)
+    {
+        size_t cap = ctx->run_cap ? ctx->run_cap * 2 : 8;
+        FILE **grown = fossil_sys_memory_realloc(ctx->runs, cap * sizeof(FILE *));
+        if (!grown)
+            return ENOMEM;
+        ctx->runs = grown;
+        ctx->run_cap = cap;
+    }
+    FILE *run = tmpfile();
+    if (!run)
+        return errno ? errno : EIO;
+    ctx->runs[ctx->run_count++] = run;
+    if (fwrite(ctx->chunks, sizeof(dedupe_chunk_t), ctx->chunk_count, run) != ctx->chunk_count)
+        return errno ? errno : EIO;
+    ctx->chunk_count = 0;
+    return 0;
+}
+
+typedef struct
+{
+    dedupe_ctx_t *ctx;
+    uint32_t file;
+    dedupe_chunk_t local[DEDUPE_CHUNK_BATCH];
+    size_t count;
+} dedupe_chunker_t;
+
+// Helper: move a worker's records into the shared buffer, spilling a run when it fills
+static void dedupe_chunk_flush(dedupe_chunker_t *c)
+{
+    dedupe_ctx_t *ctx = c->ctx;
+    fossil_shark_lock_acquire(&ctx->lock);
+    for (size_t i = 0; i < c->count && ctx->error == 0; ++i)
+    {
+        if (ctx->chunk_count == DEDUPE_RUN_RECORDS)
+            ctx->error = dedupe_spill(ctx);
+        if (ctx->error == 0)
+            ctx->chunks[ctx->chunk_count++] = c->local[i];
+    }
+    fossil_shark_lock_release(&ctx->lock);
+    c->count = 0;
+}
+
+static void dedupe_chunk_emit(void *user, uint64_t offset, uint32_t length, fossil_shark_hash128_t digest)
+{
+    (void)offset;
+    dedupe_chunker_t *c = (dedupe_chunker_t *)user;
+    dedupe_chunk_t *rec = &c->local[c->count++];
+    rec->hash[0] = digest.low;
+    rec->hash[1] = digest.high;
+    rec->file = c->file;
+    rec->length = length;
+    if (c->count == DEDUPE_CHUNK_BATCH)
+        dedupe_chunk_flush(c);
+}
+
+// Helper: split one file into content-defined chunks and record them
+static void dedupe_chunk_one(dedupe_ctx_t *ctx, uint32_t file)
+{
+    dedupe_chunker_t *c = fossil_sys_memory_alloc(sizeof(dedupe_chunker_t));
+    if (!c)
+    {
+        ctx->files[file].failed = true;
+        return;
+    }
+    c->ctx = ctx;
+    c->file = file;
+    c->count = 0;
+    ctx->files[file].failed = fossil_shark_chunk_file(dedupe_path(ctx, file), dedupe_chunk_emit, c) != 0;
+    dedupe_chunk_flush(c);
+    fossil_sys_memory_free(c);
+}
+
+// Helper: compute the current stage's digest of one file
+static void dedupe_hash_one(dedupe_ctx_t *ctx, uint32_t file)
+{
+    dedupe_file_t *f = &ctx->files[file];
+    const char *path = dedupe_path(ctx, file);
+    if (ctx->stage == DEDUPE_STAGE_BLOCKS)
+    {
+        dedupe_chunk_one(ctx, file);
+        return;
+    }
+
+    fossil_shark_hash128_t digest = {0, 0};
+    if (ctx->stage == DEDUPE_STAGE_CACHED)
+    {
+        f->cached = fossil_shark_hashcache_lookup(ctx->cache, path, &digest);
+        if (f->cached)
+        {
+            f->digest[0] = digest.low;
+            f->digest[1] = digest.high;
+        }
+        return;
+    }
+    if (ctx->stage == DEDUPE_STAGE_FULL && f->cached)
+        return;
+
+    int rc = ctx->stage == DEDUPE_STAGE_PARTIAL ? dedupe_hash_partial(path, f, &digest)
+                                                : fossil_shark_hashcache_file128(ctx->cache, path, &digest);
+    f->failed = rc != 0;
+    f->digest[0] = digest.low;
+    f->digest[1] = digest.high;
+}
+
+static void dedupe_hash_worker(void *arg)
+{
+    dedupe_ctx_t *ctx = (dedupe_ctx_t *)arg;
+
+    fossil_shark_lock_acquire(&ctx->lock);
+    while (ctx->remaining > 0)
+    {
+        // Take a file from the next device that still has both work and a free slot
+        dedupe_device_t *dev = cnull;
+        for (size_t i = 0; i < ctx->device_count && !dev; ++i)
+        {
+            dedupe_device_t *d = &ctx->devices[(ctx->rotor + i) % ctx->device_count];
+            if (d->taken < d->queued && d->active < d->limit)
+                dev = d;
+        }
+        if (!dev)
+        {
+            fossil_shark_lock_wait(&ctx->lock);
             continue;
+        }
 
-        char file_hash[MAX_HASH_LEN] = {0};
+        uint32_t file = dev->queue[dev->taken++];
+        dev->active++;
+        ctx->remaining--;
+        ctx->rotor++;
+        fossil_shark_lock_release(&ctx->lock);
 
-        if (use_hash) {
-            fossil_io_filesys_file_t f = {0};
+        dedupe_hash_one(ctx, file);
 
-            if (fossil_io_filesys_file_open(&f, obj->path, "rb") != 0)
-                continue;
+        fossil_shark_lock_acquire(&ctx->lock);
+        dev->active--;
+        fossil_shark_lock_wake_all(&ctx->lock);
+    }
+    fossil_shark_lock_wake_all(&ctx->lock);
+    fossil_shark_lock_release(&ctx->lock);
+}
 
-            uint8_t* buffer = malloc(obj->size);
-            if (!buffer) {
-                fossil_io_filesys_file_close(&f);
-                continue;
+// Hash every member for one stage, fanning out across devices
+static int dedupe_hash_all(dedupe_ctx_t *ctx, const uint32_t *members, size_t n, dedupe_stage_t stage)
+{
+    if (n == 0)
+        return 0;
+    uint32_t *order = fossil_sys_memory_alloc(n * sizeof(uint32_t));
+    if (!order)
+        return ENOMEM;
+
+    // Bucket the members by device, keeping each device's files in group order
+    for (size_t d = 0; d < ctx->device_count; ++d)
+        ctx->devices[d].queued = ctx->devices[d].taken = 0;
+    for (size_t i = 0; i < n; ++i)
+        ctx->devices[ctx->files[members[i]].device].queued++;
+    size_t offset = 0;
+    for (size_t d = 0; d < ctx->device_count; ++d)
+    {
+        ctx->devices[d].queue = order + offset;
+        offset += ctx->devices[d].queued;
+        ctx->devices[d].queued = 0;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        dedupe_device_t *d = &ctx->devices[ctx->files[members[i]].device];
+        d->queue[d->queued++] = members[i];
+    }
+
+    ctx->stage = stage;
+    ctx->remaining = n;
+    ctx->rotor = 0;
+    fossil_shark_pool_run(ctx->jobs, dedupe_hash_worker, ctx);
+
+    fossil_sys_memory_free(order);
+    return 0;
+}
+
+// Helper: confirm two files are byte-for-byte identical
+static bool dedupe_same_bytes(const char *a, const char *b)
+{
+    fossil_io_filesys_file_t fa = {0}, fb = {0};
+    if (fossil_io_filesys_file_open(&fa, a, "rb") != 0)
+        return false;
+    if (fossil_io_filesys_file_open(&fb, b, "rb") != 0)
+    {
+        fossil_io_filesys_file_close(&fa);
+        return false;
+    }
+
+    uint8_t *ba = fossil_sys_memory_alloc(2 * DEDUPE_COMPARE_CHUNK);
+    bool same = ba != NULL;
+    while (same)
+    {
+        uint8_t *bb = ba + DEDUPE_COMPARE_CHUNK;
+        size_t na = fossil_io_filesys_file_read(&fa, ba, 1, DEDUPE_COMPARE_CHUNK);
+        size_t nb = fossil_io_filesys_file_read(&fb, bb, 1, DEDUPE_COMPARE_CHUNK);
+        fossil_shark_qos_throttle(na + nb, 2);
+        if (na != nb || memcmp(ba, bb, na) != 0)
+            same = false;
+        if (na < DEDUPE_COMPARE_CHUNK)
+            break;
+    }
+
+    fossil_sys_memory_free(ba);
+    fossil_io_filesys_file_close(&fa);
+    fossil_io_filesys_file_close(&fb);
+    return same;
+}
+
+/* ============================================================================
+ * Reclaiming space
+ * ============================================================================ */
+
+/*
+ * Replace dup with a hard link to orig. The link is made under a temporary
+ * name and renamed over dup, so dup never stops existing.
+ */
+static int dedupe_hardlink(const char *orig, const char *dup)
+{
+    char tmp[FOSSIL_FILESYS_MAX_PATH];
+    int n = snprintf(tmp, sizeof(tmp), "%s.shark-link.tmp", dup);
+    if (n < 0 || (size_t)n >= sizeof(tmp))
+        return ENAMETOOLONG;
+
+    remove(tmp);
+    if (fossil_io_filesys_link_create(orig, tmp, false) != 0)
+        return errno ? errno : EIO;
+#ifdef _WIN32
+    int rc = MoveFileExA(tmp, dup, MOVEFILE_REPLACE_EXISTING) ? 0 : (int)GetLastError();
+#else
+    int rc = rename(tmp, dup) != 0 ? errno : 0;
+#endif
+    if (rc != 0)
+        remove(tmp);
+    return rc;
+}
+
+#if defined(__linux__) && defined(FIDEDUPERANGE)
+/*
+ * Ask the kernel to share orig's extents with every dup, one range call
+ * covering many destinations. The kernel locks and compares the bytes
+ * itself and refuses ranges that differ, so nothing here has to be
+ * trusted. A call may dedupe less than asked (btrfs caps each at 16 MiB),
+ * so each destination tracks its own progress and the next call starts at
+ * the lowest offset still outstanding.
+ */
+static void dedupe_reflink(const char *orig, const char *const *dups, size_t count, uint64_t size)
+{
+    int src = open(orig, O_RDONLY | O_CLOEXEC);
+    if (src < 0)
+    {
+        fossil_io_printf("{red}Error: Cannot open '%s' for reflink{normal}\n", orig);
+        return;
+    }
+
+    size_t batch = count < DEDUPE_REFLINK_BATCH ? count : DEDUPE_REFLINK_BATCH;
+    struct file_dedupe_range *range = fossil_sys_memory_calloc(
+        1, sizeof(struct file_dedupe_range) + batch * sizeof(struct file_dedupe_range_info));
+    int *fds = fossil_sys_memory_alloc(batch * sizeof(int));
+    uint64_t *done = fossil_sys_memory_alloc(batch * sizeof(uint64_t));
+    int *slot = fossil_sys_memory_alloc(batch * sizeof(int));
+
+    for (size_t first = 0; range && fds && done && slot && first < count; first += batch)
+    {
+        size_t n = count - first < batch ? count - first : batch;
+        for (size_t i = 0; i < n; ++i)
+        {
+            // Older kernels insist on a writable destination
+            fds[i] = open(dups[first + i], O_RDWR | O_CLOEXEC);
+            if (fds[i] < 0)
+                fds[i] = open(dups[first + i], O_RDONLY | O_CLOEXEC);
+            done[i] = fds[i] < 0 ? size : 0;
+            if (fds[i] < 0)
+                fossil_io_printf("{red}Error: Cannot open '%s' for reflink{normal}\n", dups[first + i]);
+        }
+
+        for (;;)
+        {
+            uint64_t offset = size;
+            for (size_t i = 0; i < n; ++i)
+                offset = done[i] < offset ? done[i] : offset;
+            if (offset >= size)
+                break;
+
+            uint16_t dests = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (done[i] != offset)
+                    continue;
+                struct file_dedupe_range_info *info = &range->info[dests];
+                memset(info, 0, sizeof(*info));
+                info->dest_fd = fds[i];
+                info->dest_offset = offset;
+                slot[dests++] = (int)i;
             }
+            range->src_offset = offset;
+            range->src_length = size - offset < DEDUPE_REFLINK_CHUNK ? size - offset : DEDUPE_REFLINK_CHUNK;
+            range->dest_count = dests;
+
+            int rc = ioctl(src, FIDEDUPERANGE, range) != 0 ? errno : 0;
+            for (uint16_t d = 0; d < dests; ++d)
+            {
+                const struct file_dedupe_range_info *info = &range->info[d];
+                int i = slot[d];
+                const char *why = cnull;
+                if (rc != 0)
+                    why = strerror(rc);
+                else if (info->status == FILE_DEDUPE_RANGE_DIFFERS)
+                    why = "contents differ";
+                else if (info->status < 0)
+                    why = strerror(-info->status);
+                else if (info->bytes_deduped == 0)
+                    why = "no progress";
 
-            size_t read_bytes = fossil_io_filesys_file_read(
-                &f, buffer, 1, obj->size
-            );
+                if (why)
+                {
+                    fossil_io_printf("{red}Error: Cannot reflink '%s': %s{normal}\n", dups[first + (size_t)i], why);
+                    done[i] = size;
+                }
+                else
+                {
+                    done[i] += info->bytes_deduped;
+                }
+            }
+        }
 
-            fossil_io_filesys_file_close(&f);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (fds[i] >= 0)
+                close(fds[i]);
+        }
+    }
 
-            if (read_bytes != obj->size) {
-                free(buffer);
+    fossil_sys_memory_free(slot);
+    fossil_sys_memory_free(done);
+    fossil_sys_memory_free(fds);
+    fossil_sys_memory_free(range);
+    close(src);
+}
+#else
+static void dedupe_reflink(const char *orig, const char *const *dups, size_t count, uint64_t size)
+{
+    (void)dups;
+    (void)count;
+    (void)size;
+    fossil_io_printf("{red}Error: Cannot reflink duplicates of '%s': not supported on this platform{normal}\n", orig);
+}
+#endif
+
+#if defined(__linux__) && defined(FS_IOC_FIEMAP)
+// Helper: map up to DEDUPE_FIEMAP_EXTENTS extents of fd from start
+static bool dedupe_fiemap(int fd, uint64_t start, struct fiemap *map)
+{
+    memset(map, 0, sizeof(*map));
+    map->fm_start = start;
+    map->fm_length = FIEMAP_MAX_OFFSET - start;
+    map->fm_flags = FIEMAP_FLAG_SYNC;
+    map->fm_extent_count = DEDUPE_FIEMAP_EXTENTS;
+    return ioctl(fd, FS_IOC_FIEMAP, map) == 0;
+}
+
+/*
+ * Do dup's bytes already live in orig's extents? Only exact, shared,
+ * plainly mapped extents count; anything the map cannot vouch for
+ * (delayed allocation, inline or encoded data, an ioctl error) is
+ * treated as not shared so the duplicate is still reported.
+ */
+static bool dedupe_shares_extents(const char *orig, const char *dup)
+{
+    const uint32_t opaque = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+                            FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL | FIEMAP_EXTENT_NOT_ALIGNED;
+    size_t bytes = sizeof(struct fiemap) + DEDUPE_FIEMAP_EXTENTS * sizeof(struct fiemap_extent);
+    struct fiemap *a = fossil_sys_memory_alloc(bytes);
+    struct fiemap *b = fossil_sys_memory_alloc(bytes);
+    int fa = open(orig, O_RDONLY | O_CLOEXEC);
+    int fb = open(dup, O_RDONLY | O_CLOEXEC);
+
+    bool shared = false;
+    uint64_t start = 0;
+    while (a && b && fa >= 0 && fb >= 0 && dedupe_fiemap(fa, start, a) && dedupe_fiemap(fb, start, b))
+    {
+        uint32_t n = a->fm_mapped_extents;
+        if (n == 0 || n != b->fm_mapped_extents)
+            break;
+        bool same = true;
+        for (uint32_t i = 0; i < n && same; ++i)
+        {
+            const struct fiemap_extent *x = &a->fm_extents[i];
+            const struct fiemap_extent *y = &b->fm_extents[i];
+            same = x->fe_logical == y->fe_logical && x->fe_physical == y->fe_physical &&
+                   x->fe_length == y->fe_length && (y->fe_flags & FIEMAP_EXTENT_SHARED) &&
+                   !((x->fe_flags | y->fe_flags) & opaque);
+        }
+        if (!same)
+            break;
+        const struct fiemap_extent *last = &a->fm_extents[n - 1];
+        if (last->fe_flags & FIEMAP_EXTENT_LAST)
+        {
+            shared = (b->fm_extents[n - 1].fe_flags & FIEMAP_EXTENT_LAST) != 0;
+            break;
+        }
+        start = last->fe_logical + last->fe_length;
+    }
+
+    if (fb >= 0)
+        close(fb);
+    if (fa >= 0)
+        close(fa);
+    fossil_sys_memory_free(b);
+    fossil_sys_memory_free(a);
+    return shared;
+}
+#else
+static bool dedupe_shares_extents(const char *orig, const char *dup)
+{
+    (void)orig;
+    (void)dup;
+    return false;
+}
+#endif
+
+/* ============================================================================
+ * Grouping
+ * ============================================================================ */
+
+// Helper: ask before acting on one duplicate
+static bool dedupe_confirm(const char *verb, const char *dup)
+{
+    fossil_io_printf("%s %s? (y/n): ", verb, dup);
+    int c = getchar();
+    for (int rest = c; rest != EOF && rest != '\n';)
+        rest = getchar();
+    return c == 'y' || c == 'Y';
+}
+
+/*
+ * Report and act on one group of identical files. Walk order depends on
+ * thread timing, so the lexically first path is the one kept.
+ */
+static void dedupe_group(const dedupe_ctx_t *ctx, const uint32_t *group, size_t n)
+{
+    size_t keep = 0;
+    for (size_t i = 1; i < n; ++i)
+    {
+        if (strcmp(dedupe_path(ctx, group[i]), dedupe_path(ctx, group[keep])) < 0)
+            keep = i;
+    }
+
+    const dedupe_file_t *kept = &ctx->files[group[keep]];
+    const char *orig = dedupe_path(ctx, group[keep]);
+    const char **share = ctx->reflink_files ? fossil_sys_memory_alloc(n * sizeof(char *)) : cnull;
+    size_t shared = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i == keep)
+            continue;
+        const char *dup = dedupe_path(ctx, group[i]);
+        if (ctx->verify && !dedupe_same_bytes(orig, dup))
+            continue;
+        if (ctx->files[group[i]].device == kept->device && dedupe_shares_extents(orig, dup))
+            continue; // already reflinked; nothing to reclaim
+
+        // Every name of the duplicate's inode is reported and acted on together
+        for (uint32_t m = group[i]; m != DEDUPE_NONE; m = ctx->files[m].alias)
+            dedupe_output(ctx->fmt, dedupe_path(ctx, m), orig);
+
+        if (ctx->reflink_files)
+        {
+            // Sharing extents with one name covers them all
+            if (share && (!ctx->interactive || dedupe_confirm("Reflink", dup)))
+                share[shared++] = dup;
+        }
+        else if (ctx->hardlink_files)
+        {
+            if (ctx->interactive && !dedupe_confirm("Hardlink", dup))
                 continue;
+            for (uint32_t m = group[i]; m != DEDUPE_NONE; m = ctx->files[m].alias)
+            {
+                // Hard links cannot cross filesystems; leave those copies alone
+                int rc = ctx->files[m].device != kept->device ? EXDEV : dedupe_hardlink(orig, dedupe_path(ctx, m));
+                if (rc != 0)
+                    fossil_io_printf("{red}Error: Cannot hardlink '%s': %s{normal}\n", dedupe_path(ctx, m), strerror(rc));
+            }
+        }
+        else
+        {
+            bool do_delete = ctx->interactive ? dedupe_confirm("Delete", dup) : ctx->delete_files;
+            for (uint32_t m = group[i]; do_delete && m != DEDUPE_NONE; m = ctx->files[m].alias)
+            {
+                fossil_io_filesys_remove(dedupe_path(ctx, m), false);
+                if (ctx->link_files)
+                    fossil_io_filesys_link_create(orig, dedupe_path(ctx, m), true);
             }
+        }
+    }
+
+    if (shared > 0)
+        dedupe_reflink(orig, share, shared, kept->size);
+    fossil_sys_memory_free(share);
+}
 
-            fossil_cryptic_hash_compute(
-                "xor", "auto", "hex",
-                file_hash, sizeof(file_hash),
-                buffer, obj->size
-            );
+// Helper: spread a digest over the table; digests are already uniform, sizes are not
+static size_t dedupe_slot(const uint64_t key[2], size_t mask)
+{
+    uint64_t h = (key[0] ^ (key[1] * 0x9E3779B97F4A7C15ull)) * 0xC2B2AE3D27D4EB4Full;
+    return (size_t)(h ^ (h >> 29)) & mask;
+}
+
+/*
+ * Chain every path of a multiply-linked inode behind the lexically first
+ * one. Linking or deleting one name of such an inode frees nothing while
+ * the others remain, so only the first is hashed and grouped, and any
+ * action on it is repeated for the rest.
+ */
+static int dedupe_collapse_links(dedupe_ctx_t *ctx)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < ctx->count; ++i)
+        n += ctx->files[i].inode != 0;
+    if (n < 2)
+        return 0;
 
-            free(buffer);
-        } else {
-            snprintf(
-                file_hash,
-                sizeof(file_hash),
-                "%zu-%lld",
-                obj->size,
-                (long long)obj->modified_at
-            );
+    size_t size = 16;
+    while (size < 2 * n)
+        size <<= 1;
+    uint32_t *table = fossil_sys_memory_alloc(size * sizeof(uint32_t));
+    if (!table)
+        return ENOMEM;
+    memset(table, 0xff, size * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < ctx->count; ++i)
+    {
+        dedupe_file_t *f = &ctx->files[i];
+        if (f->inode == 0)
+            continue;
+        uint64_t key[2] = {f->inode, f->device};
+        size_t slot = dedupe_slot(key, size - 1);
+        while (table[slot] != DEDUPE_NONE &&
+               (ctx->files[table[slot]].inode != f->inode || ctx->files[table[slot]].device != f->device))
+            slot = (slot + 1) & (size - 1);
+
+        uint32_t first = table[slot];
+        if (first == DEDUPE_NONE)
+        {
+            table[slot] = i;
+        }
+        else if (strcmp(dedupe_path(ctx, i), dedupe_path(ctx, first)) < 0)
+        {
+            // The new path leads; the old leader and its chain follow it
+            ctx->files[first].linked = true;
+            f->alias = first;
+            table[slot] = i;
+        }
+        else
+        {
+            f->linked = true;
+            f->alias = ctx->files[first].alias;
+            ctx->files[first].alias = i;
         }
+    }
 
-        file_node_t* node = head;
-        bool duplicate_found = false;
+    fossil_sys_memory_free(table);
+    return 0;
+}
 
-        while (node) {
-            if (strcmp(node->hash, file_hash) == 0) {
-                duplicate_found = true;
+static void dedupe_groups_free(dedupe_groups_t *groups)
+{
+    fossil_sys_memory_free(groups->members);
+    fossil_sys_memory_free(groups->ends);
+    memset(groups, 0, sizeof(*groups));
+}
 
-                OUTPUT_DUP(obj->path, node->path);
+/*
+ * Bucket members by size and current digest and keep every bucket with two
+ * or more files. Members are appended at the tail of their bucket, so
+ * each group keeps the order the members came in.
+ */
+static int dedupe_partition(dedupe_ctx_t *ctx, const uint32_t *members, size_t n, dedupe_groups_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    size_t size = 16;
+    while (size < 2 * n)
+        size <<= 1;
+    dedupe_bucket_t *table = fossil_sys_memory_calloc(size, sizeof(dedupe_bucket_t));
+    out->members = fossil_sys_memory_alloc((n ? n : 1) * sizeof(uint32_t));
+    out->ends = fossil_sys_memory_alloc((n / 2 + 1) * sizeof(size_t));
+    if (!table || !out->members || !out->ends)
+    {
+        fossil_sys_memory_free(table);
+        dedupe_groups_free(out);
+        return ENOMEM;
+    }
 
-                bool do_delete = delete_files;
+    for (size_t i = 0; i < n; ++i)
+    {
+        dedupe_file_t *f = &ctx->files[members[i]];
+        if (f->failed || f->linked)
+            continue;
+        f->next = DEDUPE_NONE;
 
-                if (interactive) {
-                    fossil_io_printf("Delete %s? (y/n): ", obj->path);
-                    int c = getchar();
-                    while (getchar() != '\n');
-                    do_delete = (c == 'y' || c == 'Y');
-                }
+        size_t slot = dedupe_slot(f->digest, size - 1);
+        while (table[slot].count &&
+               (table[slot].key[0] != f->digest[0] || table[slot].key[1] != f->digest[1] ||
+                ctx->files[table[slot].head].size != f->size))
+            slot = (slot + 1) & (size - 1);
 
-                if (do_delete) {
-                    fossil_io_filesys_remove(obj->path, false);
+        dedupe_bucket_t *b = &table[slot];
+        if (b->count == 0)
+        {
+            b->key[0] = f->digest[0];
+            b->key[1] = f->digest[1];
+            b->head = members[i];
+        }
+        else
+        {
+            ctx->files[b->tail].next = members[i];
+        }
+        b->tail = members[i];
+        b->count++;
+    }
 
-                    if (link_files) {
-                        fossil_io_filesys_link_create(
-                            node->path,
-                            obj->path,
-                            true
-                        );
-                    }
-                }
+    for (size_t slot = 0; slot < size; ++slot)
+    {
+        if (table[slot].count < 2)
+            continue;
+        for (uint32_t m = table[slot].head; m != DEDUPE_NONE; m = ctx->files[m].next)
+            out->members[out->count++] = m;
+        out->ends[out->groups++] = out->count;
+    }
 
-                break;
-            }
+    fossil_sys_memory_free(table);
+    return 0;
+}
+
+static void dedupe_report(const dedupe_ctx_t *ctx, const dedupe_groups_t *groups)
+{
+    size_t begin = 0;
+    for (size_t g = 0; g < groups->groups; ++g)
+    {
+        dedupe_group(ctx, groups->members + begin, groups->ends[g] - begin);
+        begin = groups->ends[g];
+    }
+}
+
+// Run the hashing stages over the size groups and act on what survives
+static int dedupe_refine(dedupe_ctx_t *ctx, dedupe_groups_t *sized)
+{
+    // Members that skip the partial stage and go straight to a full hash
+    uint32_t *whole = fossil_sys_memory_alloc((sized->count ? sized->count : 1) * sizeof(uint32_t));
+    if (!whole)
+        return ENOMEM;
+    size_t whole_len = 0;
+
+    // A cache hit reads no data, so a size group with one is compared by full digest
+    int rc = 0;
+    if (ctx->cache)
+        rc = dedupe_hash_all(ctx, sized->members, sized->count, DEDUPE_STAGE_CACHED);
+    size_t unknown = 0, begin = 0;
+    for (size_t g = 0; g < sized->groups && rc == 0; ++g)
+    {
+        const uint32_t *group = sized->members + begin;
+        size_t n = sized->ends[g] - begin;
+        bool cached = false;
+        for (size_t i = 0; i < n && !cached; ++i)
+            cached = ctx->files[group[i]].cached;
+        if (cached)
+        {
+            memcpy(whole + whole_len, group, n * sizeof(uint32_t));
+            whole_len += n;
+        }
+        else
+        {
+            memmove(sized->members + unknown, group, n * sizeof(uint32_t));
+            unknown += n;
+        }
+        begin = sized->ends[g];
+    }
 
-            node = node->next;
+    dedupe_groups_t partial = {0}, full = {0};
+    if (rc == 0)
+        rc = dedupe_hash_all(ctx, sized->members, unknown, DEDUPE_STAGE_PARTIAL);
+    if (rc == 0)
+        rc = dedupe_partition(ctx, sized->members, unknown, &partial);
+
+    // Groups of small files are settled by the partial hash; the rest go on
+    begin = 0;
+    for (size_t g = 0; g < partial.groups && rc == 0; ++g)
+    {
+        const uint32_t *group = partial.members + begin;
+        size_t n = partial.ends[g] - begin;
+        if (dedupe_fully_covered(&ctx->files[group[0]]))
+            dedupe_group(ctx, group, n);
+        else
+        {
+            memcpy(whole + whole_len, group, n * sizeof(uint32_t));
+            whole_len += n;
         }
+        begin = partial.ends[g];
+    }
 
-        if (!duplicate_found) {
-            file_node_t* new_node = malloc(sizeof(file_node_t));
-            if (!new_node) continue;
+    if (rc == 0)
+        rc = dedupe_hash_all(ctx, whole, whole_len, DEDUPE_STAGE_FULL);
+    if (rc == 0)
+        rc = dedupe_partition(ctx, whole, whole_len, &full);
+    if (rc == 0)
+        dedupe_report(ctx, &full);
 
-            strncpy(new_node->path, obj->path, sizeof(new_node->path) - 1);
-            new_node->path[sizeof(new_node->path) - 1] = '\0';
+    dedupe_groups_free(&full);
+    dedupe_groups_free(&partial);
+    fossil_sys_memory_free(whole);
+    return rc;
+}
 
-            strncpy(new_node->hash, file_hash, sizeof(new_node->hash) - 1);
-            new_node->hash[sizeof(new_node->hash) - 1] = '\0';
+/* ============================================================================
+ * Block-level report
+ * ============================================================================ */
+
+// A sorted run being merged: either the in-memory tail or a spilled file
+typedef struct
+{
+    FILE *file;
+    dedupe_chunk_t *buf;
+    size_t len;
+    size_t pos;
+} dedupe_run_t;
 
-            new_node->next = head;
-            head = new_node;
+static bool dedupe_run_next(dedupe_run_t *run)
+{
+    if (++run->pos < run->len)
+        return true;
+    if (!run->file)
+        return false;
+    run->len = fread(run->buf, sizeof(dedupe_chunk_t), DEDUPE_RUN_READ, run->file);
+    run->pos = 0;
+    return run->len > 0;
+}
+
+// Helper: restore the min-heap of run indices below position i
+static void dedupe_heap_down(dedupe_run_t *runs, size_t *heap, size_t n, size_t i)
+{
+    for (;;)
+    {
+        size_t least = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && dedupe_chunk_cmp(&runs[heap[l]].buf[runs[heap[l]].pos], &runs[heap[least]].buf[runs[heap[least]].pos]) < 0)
+            least = l;
+        if (r < n && dedupe_chunk_cmp(&runs[heap[r]].buf[runs[heap[r]].pos], &runs[heap[least]].buf[runs[heap[least]].pos]) < 0)
+            least = r;
+        if (least == i)
+            return;
+        size_t t = heap[i];
+        heap[i] = heap[least];
+        heap[least] = t;
+        i = least;
+    }
+}
+
+typedef struct
+{
+    uint32_t a;
+    uint32_t b;
+    uint64_t shared;
+} dedupe_pair_t;
+
+typedef struct
+{
+    dedupe_pair_t *slots;
+    size_t size;
+    size_t used;
+    bool truncated; // the table hit its cap and later pairs were not counted
+} dedupe_pairs_t;
+
+static dedupe_pair_t *dedupe_pair_slot(dedupe_pair_t *slots, size_t size, uint32_t a, uint32_t b)
+{
+    uint64_t h = (((uint64_t)a << 32) | b) * 0x9E3779B97F4A7C15ull;
+    size_t i = (size_t)(h >> 17) & (size - 1);
+    while (slots[i].shared && (slots[i].a != a || slots[i].b != b))
+        i = (i + 1) & (size - 1);
+    return &slots[i];
+}
+
+static void dedupe_pair_add(dedupe_pairs_t *pairs, uint32_t a, uint32_t b, uint64_t bytes)
+{
+    if ((pairs->used + 1) * 2 > pairs->size)
+    {
+        size_t size = pairs->size ? pairs->size * 2 : 1024;
+        dedupe_pair_t *grown = size <= DEDUPE_PAIR_MAX ? fossil_sys_memory_calloc(size, sizeof(dedupe_pair_t)) : cnull;
+        if (grown)
+        {
+            for (size_t i = 0; i < pairs->size; ++i)
+            {
+                if (pairs->slots[i].shared)
+                    *dedupe_pair_slot(grown, size, pairs->slots[i].a, pairs->slots[i].b) = pairs->slots[i];
+            }
+            fossil_sys_memory_free(pairs->slots);
+            pairs->slots = grown;
+            pairs->size = size;
+        }
+    }
+
+    dedupe_pair_t *slot = pairs->size ? dedupe_pair_slot(pairs->slots, pairs->size, a, b) : cnull;
+    if (slot && slot->shared == 0 && (pairs->used + 1) * 2 > pairs->size)
+        slot = cnull;
+    if (!slot)
+    {
+        pairs->truncated = true;
+        return;
+    }
+    if (slot->shared == 0)
+    {
+        slot->a = a;
+        slot->b = b;
+        pairs->used++;
+    }
+    slot->shared += bytes;
+}
+
+static int dedupe_pair_cmp(const void *x, const void *y)
+{
+    const dedupe_pair_t *a = (const dedupe_pair_t *)x;
+    const dedupe_pair_t *b = (const dedupe_pair_t *)y;
+    return (a->shared < b->shared) - (a->shared > b->shared);
+}
+
+static void dedupe_pair_output(const dedupe_ctx_t *ctx, const dedupe_pair_t *pair)
+{
+    uint32_t first = pair->a, second = pair->b;
+    if (strcmp(dedupe_path(ctx, first), dedupe_path(ctx, second)) > 0)
+    {
+        first = pair->b;
+        second = pair->a;
+    }
+    const char *a = dedupe_path(ctx, first);
+    const char *b = dedupe_path(ctx, second);
+    double ra = (double)pair->shared / (double)ctx->files[first].size;
+    double rb = (double)pair->shared / (double)ctx->files[second].size;
+    unsigned long long shared = (unsigned long long)pair->shared;
+
+    if (strcmp(ctx->fmt, "json") == 0)
+        fossil_io_printf("{\"file\":\"%s\",\"other\":\"%s\",\"shared_bytes\":%llu,\"file_ratio\":%.4f,\"other_ratio\":%.4f}\n",
+                         a, b, shared, ra, rb);
+    else if (strcmp(ctx->fmt, "fson") == 0)
+        fossil_io_printf("file:cstr=%s other:cstr=%s shared_bytes:u64=%llu file_ratio:f64=%.4f other_ratio:f64=%.4f\n",
+                         a, b, shared, ra, rb);
+    else
+        fossil_io_printf("Shared blocks: %s <-> %s: %llu bytes (%.1f%% / %.1f%%)\n", a, b, shared, ra * 100.0, rb * 100.0);
+}
+
+static void dedupe_blocks_summary(const dedupe_ctx_t *ctx, uint64_t total, uint64_t unique, uint64_t chunks)
+{
+    unsigned long long t = (unsigned long long)total, u = (unsigned long long)unique;
+    unsigned long long c = (unsigned long long)chunks;
+    if (strcmp(ctx->fmt, "json") == 0)
+        fossil_io_printf("{\"total_bytes\":%llu,\"unique_bytes\":%llu,\"reclaimable_bytes\":%llu,\"chunks\":%llu}\n",
+                         t, u, t - u, c);
+    else if (strcmp(ctx->fmt, "fson") == 0)
+        fossil_io_printf("total_bytes:u64=%llu unique_bytes:u64=%llu reclaimable_bytes:u64=%llu chunks:u64=%llu\n",
+                         t, u, t - u, c);
+    else
+        fossil_io_printf("Block dedupe: %llu of %llu bytes reclaimable (%.1f%%) across %llu chunks\n",
+                         t - u, t, t ? 100.0 * (double)(t - u) / (double)t : 0.0, c);
+}
+
+/*
+ * Chunk every file, then merge the sorted runs so equal chunks arrive
+ * together. Each group adds its length once to the unique total, and once
+ * to every pair of distinct files holding it. Chunks found in more than
+ * DEDUPE_PAIR_FANOUT files (runs of zeros, common headers) still count as
+ * reclaimable but are left out of the pairs, which would grow
+ * quadratically and say little about which files are near-copies.
+ */
+static int dedupe_blocks(dedupe_ctx_t *ctx)
+{
+    ctx->chunks = fossil_sys_memory_alloc(DEDUPE_RUN_RECORDS * sizeof(dedupe_chunk_t));
+    uint32_t *members = fossil_sys_memory_alloc((ctx->count ? ctx->count : 1) * sizeof(uint32_t));
+    if (!ctx->chunks || !members)
+    {
+        fossil_sys_memory_free(members);
+        return ENOMEM;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < ctx->count; ++i)
+    {
+        if (ctx->files[i].size > 0 && !ctx->files[i].linked)
+            members[n++] = (uint32_t)i;
+    }
+    int rc = dedupe_hash_all(ctx, members, n, DEDUPE_STAGE_BLOCKS);
+    fossil_sys_memory_free(members);
+    if (rc == 0)
+        rc = ctx->error;
+    if (rc != 0)
+        return rc;
+
+    // The unspilled tail is the last run; it is sorted in place
+    qsort(ctx->chunks, ctx->chunk_count, sizeof(dedupe_chunk_t), dedupe_chunk_cmp);
+    size_t count = ctx->run_count + 1;
+    dedupe_run_t *runs = fossil_sys_memory_calloc(count, sizeof(dedupe_run_t));
+    size_t *heap = fossil_sys_memory_alloc(count * sizeof(size_t));
+    uint32_t *owners = fossil_sys_memory_alloc((DEDUPE_PAIR_FANOUT + 1) * sizeof(uint32_t));
+    dedupe_pairs_t pairs = {0};
+    if (!runs || !heap || !owners)
+        rc = ENOMEM;
+
+    size_t live = 0;
+    for (size_t r = 0; r < ctx->run_count && rc == 0; ++r)
+    {
+        runs[r].file = ctx->runs[r];
+        runs[r].buf = fossil_sys_memory_alloc(DEDUPE_RUN_READ * sizeof(dedupe_chunk_t));
+        if (!runs[r].buf)
+            rc = ENOMEM;
+        else
+        {
+            rewind(runs[r].file);
+            runs[r].pos = (size_t)-1;
+            if (dedupe_run_next(&runs[r]))
+                heap[live++] = r;
         }
     }
+    if (rc == 0 && ctx->chunk_count > 0)
+    {
+        runs[ctx->run_count].buf = ctx->chunks;
+        runs[ctx->run_count].len = ctx->chunk_count;
+        heap[live++] = ctx->run_count;
+    }
+    for (size_t i = live; i-- > 0 && rc == 0;)
+        dedupe_heap_down(runs, heap, live, i);
+
+    uint64_t total = 0, unique = 0, chunks = 0;
+    while (live > 0 && rc == 0)
+    {
+        dedupe_chunk_t group = runs[heap[0]].buf[runs[heap[0]].pos];
+        size_t owned = 0;
+        uint32_t last = DEDUPE_NONE;
+        unique += group.length;
+        chunks++;
+
+        // Pop every record with this digest; they come in file order
+        while (live > 0)
+        {
+            dedupe_run_t *top = &runs[heap[0]];
+            const dedupe_chunk_t *rec = &top->buf[top->pos];
+            if (rec->hash[0] != group.hash[0] || rec->hash[1] != group.hash[1])
+                break;
+            total += rec->length;
+            if (rec->file != last && owned <= DEDUPE_PAIR_FANOUT)
+                owners[owned++] = rec->file;
+            last = rec->file;
+            if (!dedupe_run_next(top))
+                heap[0] = heap[--live];
+            dedupe_heap_down(runs, heap, live, 0);
+        }
 
-    /* Cleanup */
-    file_node_t* tmp;
-    while (head) {
-        tmp = head;
-        head = head->next;
-        free(tmp);
+        if (owned > 1 && owned <= DEDUPE_PAIR_FANOUT)
+        {
+            for (size_t i = 0; i < owned; ++i)
+                for (size_t j = i + 1; j < owned; ++j)
+                    dedupe_pair_add(&pairs, owners[i], owners[j], group.length);
+        }
+    }
+
+    size_t found = 0;
+    if (rc == 0)
+    {
+        for (size_t i = 0; i < pairs.size; ++i)
+        {
+            if (pairs.slots[i].shared)
+                pairs.slots[found++] = pairs.slots[i];
+        }
+        qsort(pairs.slots, found, sizeof(dedupe_pair_t), dedupe_pair_cmp);
+    }
+    if (rc == 0 && ctx->stats)
+    {
+        ctx->stats->total_bytes = total;
+        ctx->stats->unique_bytes = unique;
+        ctx->stats->chunks = chunks;
+        ctx->stats->pairs = found;
+        ctx->stats->top_shared = found ? pairs.slots[0].shared : 0;
     }
+    else if (rc == 0)
+    {
+        for (size_t i = 0; i < found; ++i)
+            dedupe_pair_output(ctx, &pairs.slots[i]);
+        if (pairs.truncated)
+            fossil_io_printf("{yellow}Warning: too many file pairs; only the first %zu were compared{normal}\n", found);
+        dedupe_blocks_summary(ctx, total, unique, chunks);
+    }
+
+    for (size_t r = 0; runs && r < ctx->run_count; ++r)
+        fossil_sys_memory_free(runs[r].buf);
+    fossil_sys_memory_free(pairs.slots);
+    fossil_sys_memory_free(owners);
+    fossil_sys_memory_free(heap);
+    fossil_sys_memory_free(runs);
+    return rc;
+}
 
+// Helper: the root must be an existing directory
+static int dedupe_check_root(const char *dir_path)
+{
+    fossil_io_filesys_obj_t root;
+    if (fossil_io_filesys_stat(dir_path, &root) != 0)
+        return errno ? errno : ENOENT;
+    if (root.type != FOSSIL_FILESYS_TYPE_DIR)
+        return ENOTDIR;
     return 0;
 }
+
+// Helper: list every file under dir_path into ctx, one entry per inode
+static int dedupe_walk(dedupe_ctx_t *ctx, const char *dir_path)
+{
+    int rc = dedupe_push_dir(ctx, dir_path);
+    if (rc == 0)
+    {
+        fossil_shark_pool_run(ctx->recursive ? ctx->jobs : 1, dedupe_walk_worker, ctx);
+        rc = ctx->error;
+    }
+    if (rc == 0)
+        rc = dedupe_collapse_links(ctx);
+    return rc;
+}
+
+/*
+ * --blocks: walk and chunk the tree, then print the shared chunks, or fill
+ * stats instead when it is given.
+ */
+static int dedupe_run_blocks(const char *dir_path, const char *fmt, bool recursive, size_t jobs,
+                             fossil_shark_dedupe_blocks_t *stats)
+{
+    int rc = dedupe_check_root(dir_path);
+    if (rc != 0)
+        return rc;
+
+    dedupe_ctx_t ctx = {0};
+    ctx.fmt = fmt;
+    ctx.recursive = recursive;
+    ctx.blocks = true;
+    ctx.stats = stats;
+    ctx.jobs = jobs ? jobs : fossil_shark_pool_default_jobs();
+    fossil_shark_lock_init(&ctx.lock);
+
+    rc = dedupe_walk(&ctx, dir_path);
+    if (rc == 0)
+        rc = dedupe_blocks(&ctx);
+    fossil_shark_lock_destroy(&ctx.lock);
+    dedupe_release(&ctx);
+    return rc;
+}
+
+int fossil_shark_dedupe(const char *dir_path, bool use_hash, bool interactive,
+                        bool delete_files, bool link_files, const char *media, bool verify,
+                        bool recursive, size_t jobs, bool reflink_files, bool hardlink_files,
+                        bool blocks)
+{
+    if (!dir_path)
+        return EINVAL;
+    if (blocks)
+        return dedupe_run_blocks(dir_path, (media) ? media : "text", recursive, jobs, cnull);
+
+    int rc = dedupe_check_root(dir_path);
+    if (rc != 0)
+        return rc;
+
+    // Size and mtime alone never justify touching a file: anything that
+    // deletes, links or reflinks is decided by the content hashes
+    if (interactive || delete_files || link_files || reflink_files || hardlink_files)
+        use_hash = true;
+
+    dedupe_ctx_t ctx = {0};
+    ctx.fmt = (media) ? media : "text";
+    ctx.use_hash = use_hash;
+    ctx.interactive = interactive;
+    ctx.delete_files = delete_files;
+    ctx.link_files = link_files;
+    ctx.reflink_files = reflink_files;
+    ctx.hardlink_files = hardlink_files;
+    ctx.verify = verify;
+    ctx.recursive = recursive;
+    ctx.jobs = jobs ? jobs : fossil_shark_pool_default_jobs();
+    fossil_shark_lock_init(&ctx.lock);
+    if (use_hash)
+        fossil_shark_hashcache_open(&ctx.cache, cnull); // optional; hashing works without it
+
+    rc = dedupe_walk(&ctx, dir_path);
+
+    uint32_t *members = fossil_sys_memory_alloc((ctx.count ? ctx.count : 1) * sizeof(uint32_t));
+    if (rc == 0 && !members)
+        rc = ENOMEM;
+
+    dedupe_groups_t sized = {0};
+    if (rc == 0)
+    {
+        for (size_t i = 0; i < ctx.count; ++i)
+            members[i] = (uint32_t)i;
+        rc = dedupe_partition(&ctx, members, ctx.count, &sized);
+    }
+    fossil_sys_memory_free(members);
+
+    if (rc == 0)
+    {
+        if (use_hash)
+            rc = dedupe_refine(&ctx, &sized);
+        else
+            dedupe_report(&ctx, &sized);
+    }
+
+    dedupe_groups_free(&sized);
+    fossil_shark_hashcache_close(ctx.cache);
+    fossil_shark_lock_destroy(&ctx.lock);
+    dedupe_release(&ctx);
+    return rc;
+}
+
+int fossil_shark_dedupe_blocks(const char *dir_path, bool recursive, size_t jobs,
+                               fossil_shark_dedupe_blocks_t *stats)
+{
+    if (!dir_path || !stats)
+        return EINVAL;
+    memset(stats, 0, sizeof(*stats));
+    return dedupe_run_blocks(dir_path, "text", recursive, jobs, stats);
+}
@@ -0,0 +1,464 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#include "fossil/code/diff.h"
+
+/*
+ * Both algorithms mark lines as removed or added instead of building an
+ * edit list, and both work through an explicit stack of ranges so deep
+ * inputs cannot overflow the call stack. Every range first drops its
+ * common prefix and suffix, which is all the work most real edits need.
+ *
+ * Myers finds the middle snake of a range by running the forward and
+ * backward searches until they meet, then splits there; only two diagonal
+ * vectors are kept, so memory is linear. When a split costs more than
+ * DIFF_MIN_COST or about the square root of the input, the furthest
+ * reaching diagonal is taken instead: the script may then be slightly
+ * longer than minimal, but two unrelated files no longer cost O(N^2).
+ *
+ * Histogram picks the longest common region around the rarest lines
+ * shared by both sides, splits on it, and hands ranges with no usable
+ * anchor to Myers.
+ */
+#define DIFF_MIN_COST 256
+#define DIFF_HISTOGRAM_CHAIN 64 /* lines more frequent than this never anchor a split */
+#define DIFF_NONE UINT32_MAX
+
+typedef struct
+{
+    size_t a0, a1;
+    size_t b0, b1;
+    bool myers;
+} diff_range_t;
+
+typedef struct
+{
+    const uint32_t *a;
+    const uint32_t *b;
+    bool *removed;
+    bool *added;
+
+    ptrdiff_t *fwd; // furthest a index per diagonal, indexed by k; see diff_split
+    ptrdiff_t *bwd;
+    ptrdiff_t max_cost;
+
+    uint32_t *count; // per ID: occurrences in the current a range
+    uint32_t *head;  // per ID: first position in the current a range
+    uint32_t *next;  // per a position: next position with the same ID
+
+    diff_range_t *stack;
+    size_t depth;
+    size_t cap;
+} diff_ctx_t;
+
+bool fossil_shark_diff_algorithm_parse(ccstring name, fossil_shark_diff_algorithm_t *out)
+{
+    if (!cnotnull(name) || fossil_io_cstring_compare(name, "myers") == 0)
+        *out = FOSSIL_SHARK_DIFF_MYERS;
+    else if (fossil_io_cstring_compare(name, "histogram") == 0 || fossil_io_cstring_compare(name, "patience") == 0)
+        *out = FOSSIL_SHARK_DIFF_HISTOGRAM;
+    else
+        return false;
+    return true;
+}
+
+static int diff_push(diff_ctx_t *ctx, size_t a0, size_t a1, size_t b0, size_t b1, bool myers)
+{
+    if (a0 == a1 && b0 == b1)
+        return 0;
+    if (ctx->depth == ctx->cap)
+    {
+        size_t cap = ctx->cap ? ctx->cap * 2 : 64;
+        diff_range_t *grown = fossil_sys_memory_realloc(ctx->stack, cap * sizeof(diff_range_t));
+        if (!grown)
+            return ENOMEM;
+        ctx->stack = grown;
+        ctx->cap = cap;
+    }
+    diff_range_t *r = &ctx->stack[ctx->depth++];
+    r->a0 = a0;
+    r->a1 = a1;
+    r->b0 = b0;
+    r->b1 = b1;
+    r->myers = myers;
+    return 0;
+}
+
+/*
+ * Find where to split a[off1, lim1) against b[off2, lim2). Diagonal k
+ * holds the points with i - j == k; fwd[k] is the furthest i the forward
+ * search has reached on it, bwd[k] the lowest the backward search has.
+ * Both ends of the range must differ, so the split is strictly inside.
+ */
+static void diff_split(diff_ctx_t *ctx, ptrdiff_t off1, ptrdiff_t lim1, ptrdiff_t off2, ptrdiff_t lim2,
+                       ptrdiff_t *s1, ptrdiff_t *s2)
+{
+    const uint32_t *a = ctx->a;
+    const uint32_t *b = ctx->b;
+    ptrdiff_t *kf = ctx->fwd;
+    ptrdiff_t *kb = ctx->bwd;
+    ptrdiff_t dmin = off1 - lim2, dmax = lim1 - off2;
+    ptrdiff_t fmid = off1 - off2, bmid = lim1 - lim2;
+    bool odd = ((fmid - bmid) & 1) != 0;
+    ptrdiff_t fmin = fmid, fmax = fmid, bmin = bmid, bmax = bmid;
+
+    kf[fmid] = off1;
+    kb[bmid] = lim1;
+    for (ptrdiff_t cost = 1;; ++cost)
+    {
+        // Extend every forward diagonal by one edit, then along its snake
+        if (fmin > dmin)
+            kf[--fmin - 1] = -1;
+        else
+            ++fmin;
+        if (fmax < dmax)
+            kf[++fmax + 1] = -1;
+        else
+            --fmax;
+        for (ptrdiff_t d = fmax; d >= fmin; d -= 2)
+        {
+            ptrdiff_t i1 = kf[d - 1] >= kf[d + 1] ? kf[d - 1] + 1 : kf[d + 1];
+            ptrdiff_t i2 = i1 - d;
+            while (i1 < lim1 && i2 < lim2 && a[i1] == b[i2])
+            {
+                ++i1;
+                ++i2;
+            }
+            kf[d] = i1;
+            if (odd && bmin <= d && d <= bmax && kb[d] <= i1)
+            {
+                *s1 = i1;
+                *s2 = i2;
+                return;
+            }
+        }
+
+        // And every backward diagonal
+        if (bmin > dmin)
+            kb[--bmin - 1] = PTRDIFF_MAX;
+        else
+            ++bmin;
+        if (bmax < dmax)
+            kb[++bmax + 1] = PTRDIFF_MAX;
+        else
+            --bmax;
+        for (ptrdiff_t d = bmax; d >= bmin; d -= 2)
+        {
+            ptrdiff_t i1 = kb[d - 1] < kb[d + 1] ? kb[d - 1] : kb[d + 1] - 1;
+            ptrdiff_t i2 = i1 - d;
+            while (i1 > off1 && i2 > off2 && a[i1 - 1] == b[i2 - 1])
+            {
+                --i1;
+                --i2;
+            }
+            kb[d] = i1;
+            if (!odd && fmin <= d && d <= fmax && i1 <= kf[d])
+            {
+                *s1 = i1;
+                *s2 = i2;
+                return;
+            }
+        }
+
+        if (cost < ctx->max_cost)
+            continue;
+
+        // Too expensive: split at whichever search got furthest from its start
+        ptrdiff_t fbest = -1, fbest1 = -1;
+        for (ptrdiff_t d = fmax; d >= fmin; d -= 2)
+        {
+            ptrdiff_t i1 = kf[d] < lim1 ? kf[d] : lim1;
+            ptrdiff_t i2 = i1 - d;
+            if (i2 > lim2)
+            {
+                i1 = lim2 + d;
+                i2 = lim2;
+            }
+            if (i1 + i2 > fbest)
+            {
+                fbest = i1 + i2;
+                fbest1 = i1;
+            }
+        }
+        ptrdiff_t bbest = PTRDIFF_MAX, bbest1 = PTRDIFF_MAX;
+        for (ptrdiff_t d = bmax; d >= bmin; d -= 2)
+        {
+            ptrdiff_t i1 = kb[d] > off1 ? kb[d] : off1;
+            ptrdiff_t i2 = i1 - d;
+            if (i2 < off2)
+            {
+                i1 = off2 + d;
+                i2 = off2;
+            }
+            if (i1 + i2 < bbest)
+            {
+                bbest = i1 + i2;
+                bbest1 = i1;
+            }
+        }
+        if ((lim1 + lim2) - bbest < fbest - (off1 + off2))
+        {
+            *s1 = fbest1;
+            *s2 = fbest - fbest1;
+        }
+        else
+        {
+            *s1 = bbest1;
+            *s2 = bbest - bbest1;
+        }
+        return;
+    }
+}
+
+static int diff_myers_step(diff_ctx_t *ctx, const diff_range_t *r)
+{
+    ptrdiff_t s1, s2;
+    diff_split(ctx, (ptrdiff_t)r->a0, (ptrdiff_t)r->a1, (ptrdiff_t)r->b0, (ptrdiff_t)r->b1, &s1, &s2);
+    if (((size_t)s1 == r->a0 && (size_t)s2 == r->b0) || ((size_t)s1 == r->a1 && (size_t)s2 == r->b1))
+    {
+        // Cannot happen for a trimmed range; replace it wholesale rather than loop
+        for (size_t i = r->a0; i < r->a1; ++i)
+            ctx->removed[i] = true;
+        for (size_t j = r->b0; j < r->b1; ++j)
+            ctx->added[j] = true;
+        return 0;
+    }
+    int rc = diff_push(ctx, r->a0, (size_t)s1, r->b0, (size_t)s2, true);
+    if (rc == 0)
+        rc = diff_push(ctx, (size_t)s1, r->a1, (size_t)s2, r->b1, true);
+    return rc;
+}
+
+/*
+ * Split a range on its best common region: the longest one among those
+ * whose rarest line occurs least often in a. Unique lines anchor first,
+ * which keeps moved blocks and repeated boilerplate (braces, blank lines)
+ * from being matched out of place.
+ */
+static int diff_histogram_step(diff_ctx_t *ctx, const diff_range_t *r)
+{
+    const uint32_t *a = ctx->a;
+    const uint32_t *b = ctx->b;
+
+    for (size_t i = r->a1; i-- > r->a0;)
+    {
+        uint32_t id = a[i];
+        if (ctx->count[id] == 0)
+            ctx->head[id] = DIFF_NONE;
+        ctx->next[i] = ctx->head[id];
+        ctx->head[id] = (uint32_t)i;
+        ctx->count[id]++;
+    }
+
+    size_t best_a = 0, best_b = 0, best_len = 0;
+    uint32_t best_count = DIFF_HISTOGRAM_CHAIN + 1;
+    for (size_t j = r->b0; j < r->b1;)
+    {
+        uint32_t occurrences = ctx->count[b[j]];
+        if (occurrences == 0 || occurrences > best_count)
+        {
+            ++j;
+            continue;
+        }
+
+        size_t next_j = j + 1;
+        for (uint32_t i = ctx->head[b[j]]; i != DIFF_NONE; i = ctx->next[i])
+        {
+            size_t sa = i, sb = j, ea = (size_t)i + 1, eb = j + 1;
+            while (sa > r->a0 && sb > r->b0 && a[sa - 1] == b[sb - 1])
+            {
+                --sa;
+                --sb;
+            }
+            while (ea < r->a1 && eb < r->b1 && a[ea] == b[eb])
+            {
+                ++ea;
+                ++eb;
+            }
+            if (eb > next_j)
+                next_j = eb;
+
+            uint32_t rarest = occurrences;
+            for (size_t k = sa; k < ea; ++k)
+                rarest = ctx->count[a[k]] < rarest ? ctx->count[a[k]] : rarest;
+            if (rarest < best_count || (rarest == best_count && ea - sa > best_len))
+            {
+                best_a = sa;
+                best_b = sb;
+                best_len = ea - sa;
+                best_count = rarest;
+            }
+        }
+        j = next_j;
+    }
+
+    for (size_t i = r->a0; i < r->a1; ++i)
+        ctx->count[a[i]] = 0;
+
+    if (best_len == 0)
+        return diff_push(ctx, r->a0, r->a1, r->b0, r->b1, true);
+    int rc = diff_push(ctx, r->a0, best_a, r->b0, best_b, false);
+    if (rc == 0)
+        rc = diff_push(ctx, best_a + best_len, r->a1, best_b + best_len, r->b1, false);
+    return rc;
+}
+
+// Run the selected algorithm over two sequences that share every line
+static int diff_run(const uint32_t *a, size_t n, const uint32_t *b, size_t m, size_t id_count,
+                    bool histogram, bool *removed, bool *added)
+{
+    if (n > 0)
+        memset(removed, 0, n * sizeof(bool));
+    if (m > 0)
+        memset(added, 0, m * sizeof(bool));
+
+    diff_ctx_t ctx = {0};
+    ctx.a = a;
+    ctx.b = b;
+    ctx.removed = removed;
+    ctx.added = added;
+    ctx.max_cost = 1;
+    while ((size_t)(ctx.max_cost * ctx.max_cost) < n + m)
+        ctx.max_cost <<= 1;
+    if (ctx.max_cost < DIFF_MIN_COST)
+        ctx.max_cost = DIFF_MIN_COST;
+
+    // Diagonals run from -(m + 1) to n + 1
+    size_t diagonals = n + m + 3;
+    ptrdiff_t *fwd = fossil_sys_memory_alloc(diagonals * sizeof(ptrdiff_t));
+    ptrdiff_t *bwd = fossil_sys_memory_alloc(diagonals * sizeof(ptrdiff_t));
+    if (histogram)
+    {
+        ctx.count = fossil_sys_memory_calloc(id_count ? id_count : 1, sizeof(uint32_t));
+        ctx.head = fossil_sys_memory_alloc((id_count ? id_count : 1) * sizeof(uint32_t));
+        ctx.next = fossil_sys_memory_alloc((n ? n : 1) * sizeof(uint32_t));
+    }
+
+    int rc = 0;
+    if (!fwd || !bwd || (histogram && (!ctx.count || !ctx.head || !ctx.next)))
+        rc = ENOMEM;
+    else
+    {
+        ctx.fwd = fwd + m + 1;
+        ctx.bwd = bwd + m + 1;
+        rc = diff_push(&ctx, 0, n, 0, m, !histogram);
+    }
+
+    while (rc == 0 && ctx.depth > 0)
+    {
+        diff_range_t r = ctx.stack[--ctx.depth];
+        while (r.a0 < r.a1 && r.b0 < r.b1 && a[r.a0] == b[r.b0])
+        {
+            ++r.a0;
+            ++r.b0;
+        }
+        while (r.a0 < r.a1 && r.b0 < r.b1 && a[r.a1 - 1] == b[r.b1 - 1])
+        {
+            --r.a1;
+            --r.b1;
+        }
+
+        if (r.a0 == r.a1 || r.b0 == r.b1)
+        {
+            for (size_t i = r.a0; i < r.a1; ++i)
+                removed[i] = true;
+            for (size_t j = r.b0; j < r.b1; ++j)
+                added[j] = true;
+        }
+        else
+        {
+            rc = r.myers ? diff_myers_step(&ctx, &r) : diff_histogram_step(&ctx, &r);
+        }
+    }
+
+    fossil_sys_memory_free(ctx.stack);
+    fossil_sys_memory_free(ctx.next);
+    fossil_sys_memory_free(ctx.head);
+    fossil_sys_memory_free(ctx.count);
+    fossil_sys_memory_free(bwd);
+    fossil_sys_memory_free(fwd);
+    return rc;
+}
+
+/*
+ * A line with no equal on the other side can never be kept, so it is
+ * marked up front and left out of the search. This does not change the
+ * result, but it keeps the expensive part to the lines that might match:
+ * rewritten sections cost no more than the edits around them.
+ */
+int fossil_shark_diff(const uint32_t *a, size_t n, const uint32_t *b, size_t m, size_t id_count,
+                      fossil_shark_diff_algorithm_t algorithm, bool *removed, bool *added)
+{
+    uint8_t *sides = fossil_sys_memory_calloc(id_count ? id_count : 1, 1);
+    uint32_t *ids = fossil_sys_memory_alloc((n + m ? n + m : 1) * sizeof(uint32_t));
+    size_t *where = fossil_sys_memory_alloc((n + m ? n + m : 1) * sizeof(size_t));
+    bool *marks = fossil_sys_memory_alloc((n + m ? n + m : 1) * sizeof(bool));
+    if (!sides || !ids || !where || !marks)
+    {
+        fossil_sys_memory_free(marks);
+        fossil_sys_memory_free(where);
+        fossil_sys_memory_free(ids);
+        fossil_sys_memory_free(sides);
+        return ENOMEM;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        sides[a[i]] |= 1;
+    for (size_t j = 0; j < m; ++j)
+        sides[b[j]] |= 2;
+
+    // The candidates of a, then those of b, each with its original index
+    size_t cn = 0, cm = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        removed[i] = sides[a[i]] != 3;
+        if (!removed[i])
+        {
+            ids[cn] = a[i];
+            where[cn++] = i;
+        }
+    }
+    for (size_t j = 0; j < m; ++j)
+    {
+        added[j] = sides[b[j]] != 3;
+        if (!added[j])
+        {
+            ids[cn + cm] = b[j];
+            where[cn + cm++] = j;
+        }
+    }
+
+    int rc = diff_run(ids, cn, ids + cn, cm, id_count, algorithm == FOSSIL_SHARK_DIFF_HISTOGRAM,
+                      marks, marks + cn);
+    for (size_t k = 0; rc == 0 && k < cn; ++k)
+        removed[where[k]] = marks[k];
+    for (size_t k = 0; rc == 0 && k < cm; ++k)
+        added[where[cn + k]] = marks[cn + k];
+
+    fossil_sys_memory_free(marks);
+    fossil_sys_memory_free(where);
+    fossil_sys_memory_free(ids);
+    fossil_sys_memory_free(sides);
+    return rc;
+}
@@ -0,0 +1,101 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_CHUNK_H
+#define FOSSIL_APP_CHUNK_H
+
+#include "common.h"
+#include "hash.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Content-Defined Chunking
+    * ========================================================================== */
+
+#define FOSSIL_SHARK_CHUNK_MIN (2 * 1024)   /**< No cut before this many bytes */
+#define FOSSIL_SHARK_CHUNK_AVG (8 * 1024)   /**< Target average chunk size */
+#define FOSSIL_SHARK_CHUNK_MAX (64 * 1024)  /**< Forced cut at this size */
+
+/**
+ * @brief Called for every completed chunk.
+ *
+ * @param user Caller context.
+ * @param offset Offset of the chunk in the stream.
+ * @param length Chunk length in bytes.
+ * @param digest XXH3-128 of the chunk bytes.
+ */
+typedef void (*fossil_shark_chunk_fn)(void *user, uint64_t offset, uint32_t length,
+                                      fossil_shark_hash128_t digest);
+
+/**
+ * @brief Streaming FastCDC chunker.
+ *
+ * Cut points depend only on the bytes near them, so an insertion or
+ * deletion moves the boundaries of the chunks around it and no others;
+ * two files that differ in a few places still share most chunks. Input may
+ * be fed in pieces of any size with identical results.
+ */
+typedef struct fossil_shark_chunker_s
+{
+    uint64_t fingerprint;           /**< Gear hash of the current chunk */
+    uint64_t offset;                /**< Stream offset of the current chunk */
+    size_t length;                  /**< Bytes in the current chunk so far */
+    fossil_shark_hash_state_t hash; /**< Digest of the current chunk */
+} fossil_shark_chunker_t;
+
+/**
+ * @brief Reset a chunker to the start of a stream.
+ */
+void fossil_shark_chunker_init(fossil_shark_chunker_t *chunker);
+
+/**
+ * @brief Feed bytes, reporting every chunk they complete.
+ */
+void fossil_shark_chunker_update(fossil_shark_chunker_t *chunker, const void *data, size_t len,
+                                 fossil_shark_chunk_fn emit, void *user);
+
+/**
+ * @brief End the stream, reporting the final partial chunk if any.
+ */
+void fossil_shark_chunker_finish(fossil_shark_chunker_t *chunker, fossil_shark_chunk_fn emit, void *user);
+
+/**
+ * @brief Chunk a whole file through a fixed-size read buffer.
+ *
+ * @param path File to chunk.
+ * @param emit Called for every chunk, in order.
+ * @param user Passed to emit.
+ * @return 0 on success, non-zero on error.
+ */
+int fossil_shark_chunk_file(ccstring path, fossil_shark_chunk_fn emit, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
@@ -40,11 +40,67 @@ extern "C"
  * @param binary_diff Perform binary difference comparison
  * @param context_lines Number of context lines to show around differences
  * @param ignore_case Ignore case differences in text comparison
+ * @param algorithm Text diff algorithm, "myers" or "histogram" (cnull for myers)
+ * @param all_ranges In binary comparison, report every differing byte range
+ *                   instead of stopping at the first difference
+ * @param ignore_space In text comparison, treat any run of whitespace as a
+ *                     single space (surrounding whitespace is always ignored)
+ * @param recursive Compare two directory trees: report entries only in one,
+ *                  and entries that differ by type, size or content
+ * @param jobs Worker threads: for directory trees, hashing workers (0 for one
+ *             per CPU); for binary comparison of large files, parallel
+ *             range readers (0 or 1 reads sequentially)
  * @return 0 on success, non-zero on error
  */
 int fossil_shark_compare(ccstring path1, ccstring path2,
                             bool text_diff, bool binary_diff,
-                            int context_lines, bool ignore_case);
+                            int context_lines, bool ignore_case,
+                            ccstring algorithm, bool all_ranges,
+                            bool ignore_space, bool recursive, size_t jobs);
+
+/**
+ * A run of differing bytes, [start, end)
+ */
+typedef struct
+{
+    uint64_t start; /**< Offset of the first differing byte */
+    uint64_t end;   /**< One past the last differing byte */
+} fossil_shark_compare_range_t;
+
+/**
+ * Binary comparison as fossil_shark_compare does it, handing back what was found
+ * @param path1 First file to compare
+ * @param path2 Second file to compare
+ * @param all_ranges Report every differing range instead of stopping at the
+ *                   first differing byte
+ * @param jobs Parallel range readers for large equal-size files (0 or 1 reads sequentially)
+ * @param ranges Receives up to max_ranges ranges in file order; without
+ *               all_ranges the only one is the first differing byte
+ * @param max_ranges Capacity of ranges
+ * @param range_count Receives the number of ranges found, which may exceed max_ranges
+ * @return 0 if the files are identical, non-zero if they differ or on error
+ */
+int fossil_shark_compare_binary(ccstring path1, ccstring path2, bool all_ranges, size_t jobs,
+                                fossil_shark_compare_range_t *ranges, size_t max_ranges, size_t *range_count);
+
+/**
+ * Write a binary delta that rebuilds target from source
+ * @param source File the patch will be applied to
+ * @param target File the patch produces
+ * @param patch Path of the delta to write
+ * @return 0 on success, non-zero on error
+ */
+int fossil_shark_compare_delta(ccstring source, ccstring target, ccstring patch);
+
+/**
+ * Rebuild a file from a source and a delta made by fossil_shark_compare_delta
+ * @param source File the patch was made against (checked by size and hash)
+ * @param patch Delta to apply
+ * @param output Path to write; replaced only once the result is verified,
+ *               so it may be the source itself
+ * @return 0 on success, non-zero on error
+ */
+int fossil_shark_compare_apply(ccstring source, ccstring patch, ccstring output);
 
 #ifdef __cplusplus
 }
@@ -35,11 +35,22 @@ extern "C"
 /**
  * Detect and optionally remove duplicate files
  * @param dir_path Target directory
- * @param use_hash Compare files using hash (true) or size+timestamp (false)
+ * @param use_hash Compare files using hash (true) or size+timestamp (false);
+ *                 forced on whenever files are deleted, linked or reflinked
  * @param interactive Confirm each deletion if true
  * @param delete Remove duplicate files if true
  * @param link Replace duplicates with links if true
  * @param media Report duplicates in a selected format type if true
+ * @param verify Confirm hash matches byte-for-byte before reporting (hash mode)
+ * @param recursive Descend into subdirectories if true
+ * @param jobs Worker threads for walking and hashing; 0 picks one per CPU.
+ *             Spinning disks are read by one worker at a time regardless.
+ * @param reflink_files Share the duplicates' extents with the kept file
+ *                      (FIDEDUPERANGE on btrfs/XFS); every path stays a regular file
+ * @param hardlink_files Replace duplicates with hard links to the kept file
+ * @param blocks Report shared content-defined chunks between files and the
+ *               bytes block-level dedupe would reclaim, instead of whole-file
+ *               duplicates; nothing is modified
  * @return 0 on success, non-zero on error
  */
 int fossil_shark_dedupe(
@@ -48,9 +59,39 @@ int fossil_shark_dedupe(
     bool interactive,
     bool delete_files,
     bool link_files,
-    const char* media /* "text", "json", "fson" */
+    const char* media, /* "text", "json", "fson" */
+    bool verify,
+    bool recursive,
+    size_t jobs,
+    bool reflink_files,
+    bool hardlink_files,
+    bool blocks
 );
 
+/**
+ * What block-level dedupe of a tree would share, as reported by --blocks
+ */
+typedef struct
+{
+    uint64_t total_bytes;  /**< Bytes chunked across all files */
+    uint64_t unique_bytes; /**< Bytes left once equal chunks are stored once */
+    uint64_t chunks;       /**< Distinct chunks */
+    size_t pairs;          /**< Pairs of files sharing at least one chunk */
+    uint64_t top_shared;   /**< Bytes shared by the closest pair */
+} fossil_shark_dedupe_blocks_t;
+
+/**
+ * Chunk every file under a directory and total the shared content, as
+ * fossil_shark_dedupe does with blocks set, without printing anything
+ * @param dir_path Target directory
+ * @param recursive Descend into subdirectories if true
+ * @param jobs Worker threads; 0 picks one per CPU
+ * @param stats Receives the totals; reclaimable bytes are total - unique
+ * @return 0 on success, non-zero on error
+ */
+int fossil_shark_dedupe_blocks(const char *dir_path, bool recursive, size_t jobs,
+                               fossil_shark_dedupe_blocks_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,82 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_DIFF_H
+#define FOSSIL_APP_DIFF_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Line Diff
+    * ========================================================================== */
+
+/**
+ * @brief Algorithms for fossil_shark_diff().
+ */
+typedef enum
+{
+    FOSSIL_SHARK_DIFF_MYERS,     /**< Shortest edit script, Myers O(ND) in linear space */
+    FOSSIL_SHARK_DIFF_HISTOGRAM  /**< Anchors on rare common lines first; reads better on moved blocks */
+} fossil_shark_diff_algorithm_t;
+
+/**
+ * @brief Parse an algorithm name ("myers" or "histogram").
+ *
+ * @param name Name to parse; cnull selects Myers.
+ * @param out Receives the algorithm.
+ * @return true if the name is known.
+ */
+bool fossil_shark_diff_algorithm_parse(ccstring name, fossil_shark_diff_algorithm_t *out);
+
+/**
+ * @brief Diff two sequences of line IDs.
+ *
+ * Lines are compared only by ID, so callers intern them first; equal lines
+ * must share an ID and IDs must be below id_count. On return removed[i] is
+ * set for every line of a that is not kept and added[j] for every line of
+ * b that is new; all other lines pair up in order.
+ *
+ * @param a Line IDs of the old sequence.
+ * @param n Length of a.
+ * @param b Line IDs of the new sequence.
+ * @param m Length of b.
+ * @param id_count One past the largest ID in either sequence.
+ * @param algorithm Algorithm to use.
+ * @param removed n flags, cleared and filled in.
+ * @param added m flags, cleared and filled in.
+ * @return 0 on success, ENOMEM if working memory cannot be allocated.
+ */
+int fossil_shark_diff(const uint32_t *a, size_t n, const uint32_t *b, size_t m, size_t id_count,
+                      fossil_shark_diff_algorithm_t algorithm, bool *removed, bool *added);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
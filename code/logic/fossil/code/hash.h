@@ -0,0 +1,149 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_HASH_H
+#define FOSSIL_APP_HASH_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Fast Content Hashing
+    * ========================================================================== */
+
+/**
+ * @brief Size of the read buffer used when hashing files.
+ */
+#define FOSSIL_SHARK_HASH_BUFFER_SIZE (256 * 1024)
+
+/**
+ * @brief 128-bit XXH3 digest, split into its two 64-bit halves.
+ */
+typedef struct fossil_shark_hash128_s
+{
+    uint64_t low;
+    uint64_t high;
+} fossil_shark_hash128_t;
+
+/**
+ * @brief Streaming XXH3 state.
+ *
+ * Stripes are consumed straight from the caller's buffer whenever possible,
+ * so only the unprocessed tail (at most 256 bytes) is ever copied.
+ */
+typedef struct fossil_shark_hash_state_s
+{
+    uint64_t acc[8];          /**< Lane accumulators */
+    uint8_t buffer[256];      /**< Unprocessed input tail */
+    uint8_t last_stripe[64];  /**< Last 64 consumed bytes, needed at digest */
+    size_t buffered;          /**< Bytes held in buffer */
+    size_t stripes_in_block;  /**< Stripes consumed in the current block */
+    uint64_t total_len;       /**< Total bytes fed so far */
+} fossil_shark_hash_state_t;
+
+/**
+ * @brief Reset a streaming hash state.
+ *
+ * @param state State to initialize.
+ */
+void fossil_shark_hash_init(fossil_shark_hash_state_t *state);
+
+/**
+ * @brief Feed data into a streaming hash state.
+ *
+ * @param state State previously initialized with fossil_shark_hash_init().
+ * @param data Input bytes.
+ * @param len Number of bytes.
+ */
+void fossil_shark_hash_update(fossil_shark_hash_state_t *state, const void *data, size_t len);
+
+/**
+ * @brief Produce the 64-bit XXH3 digest of everything fed so far.
+ *
+ * The state is left untouched, so more data may be fed afterwards.
+ *
+ * @param state Hash state.
+ * @return 64-bit digest.
+ */
+uint64_t fossil_shark_hash_digest64(const fossil_shark_hash_state_t *state);
+
+/**
+ * @brief Produce the 128-bit XXH3 digest of everything fed so far.
+ *
+ * Uses the same state as the 64-bit digest; prefer it wherever a collision
+ * would cost data, such as deciding two files are duplicates.
+ *
+ * @param state Hash state.
+ * @return 128-bit digest.
+ */
+fossil_shark_hash128_t fossil_shark_hash_digest128(const fossil_shark_hash_state_t *state);
+
+/**
+ * @brief One-shot 64-bit XXH3 of a memory buffer.
+ *
+ * @param data Input bytes.
+ * @param len Number of bytes.
+ * @return 64-bit digest.
+ */
+uint64_t fossil_shark_hash64(const void *data, size_t len);
+
+/**
+ * @brief One-shot 128-bit XXH3 of a memory buffer.
+ *
+ * @param data Input bytes.
+ * @param len Number of bytes.
+ * @return 128-bit digest.
+ */
+fossil_shark_hash128_t fossil_shark_hash128(const void *data, size_t len);
+
+/**
+ * @brief Hash a whole file with XXH3 using a fixed-size read buffer.
+ *
+ * Memory use does not depend on the file size. On POSIX the kernel is
+ * asked for sequential readahead.
+ *
+ * @param path File to hash.
+ * @param out Receives the 64-bit digest.
+ * @return 0 on success, non-zero on error.
+ */
+int fossil_shark_hash_file64(ccstring path, uint64_t *out);
+
+/**
+ * @brief Hash a whole file with 128-bit XXH3 using a fixed-size read buffer.
+ *
+ * @param path File to hash.
+ * @param out Receives the 128-bit digest.
+ * @return 0 on success, non-zero on error.
+ */
+int fossil_shark_hash_file128(ccstring path, fossil_shark_hash128_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
@@ -0,0 +1,101 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_HASHCACHE_H
+#define FOSSIL_APP_HASHCACHE_H
+
+#include "common.h"
+#include "hash.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Persistent Hash Cache
+    * ========================================================================== */
+
+/**
+ * @brief On-disk cache of whole-file XXH3-128 digests.
+ *
+ * Entries are keyed by device and inode and are only trusted while the
+ * file's size and nanosecond mtime still match, so a rescan of an
+ * unchanged tree reads metadata only. The cache is a single memory-mapped
+ * file shared by every shark process; readers and writers take a shared
+ * or exclusive file lock, and threads of one process also serialize on an
+ * internal lock. Losing or corrupting the file only costs re-hashing.
+ *
+ * Set SHARK_HASH_CACHE to choose the file, or to an empty string to turn
+ * caching off. The default is $XDG_CACHE_HOME/shark/hashes, falling back
+ * to ~/.cache/shark/hashes. Not available on Windows.
+ */
+typedef struct fossil_shark_hashcache fossil_shark_hashcache_t;
+
+/**
+ * @brief Open (creating if needed) the cache.
+ *
+ * @param out Receives the cache.
+ * @param path Cache file, or cnull for the default location.
+ * @return 0 on success; ENOTSUP when caching is off or unsupported,
+ *         otherwise the error from opening or mapping the file.
+ */
+int fossil_shark_hashcache_open(fossil_shark_hashcache_t **out, ccstring path);
+
+/**
+ * @brief Look a file up without reading its data.
+ *
+ * @param cache Cache, may be cnull.
+ * @param path File to look up.
+ * @param out Receives the cached digest on a hit.
+ * @return true on a hit for the file as it is now.
+ */
+bool fossil_shark_hashcache_lookup(fossil_shark_hashcache_t *cache, ccstring path, fossil_shark_hash128_t *out);
+
+/**
+ * @brief Hash a file, answering from the cache when possible.
+ *
+ * A miss streams the file through fossil_shark_hash_file128() and records
+ * the result, unless the file changed while it was read or its mtime is
+ * too recent to tell a later write in the same tick apart.
+ *
+ * @param cache Cache, may be cnull to always hash.
+ * @param path File to hash.
+ * @param out Receives the digest.
+ * @return 0 on success, non-zero on error.
+ */
+int fossil_shark_hashcache_file128(fossil_shark_hashcache_t *cache, ccstring path, fossil_shark_hash128_t *out);
+
+/**
+ * @brief Unmap and close the cache.
+ *
+ * @param cache Cache, may be cnull.
+ */
+void fossil_shark_hashcache_close(fossil_shark_hashcache_t *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
@@ -59,6 +59,21 @@ int fossil_shark_introspect(
     const char* media /* "text", "json", "fson" */
 );
 
+/**
+ * Count lines, words and bytes as wc does in the C locale
+ * @param path Path to the file to count
+ * @param lines Receives the number of newlines
+ * @param words Receives the number of words
+ * @param bytes Receives the number of bytes
+ * @return 0 on success, EINVAL for a NULL argument, or the errno of the failed open or read
+ */
+int fossil_shark_introspect_count(
+    ccstring path,
+    uint64_t *lines,
+    uint64_t *words,
+    uint64_t *bytes
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,93 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_JOBS_H
+#define FOSSIL_APP_JOBS_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Command Runner
+    * ========================================================================== */
+
+/**
+ * @brief Runs one shell command per batch of changed paths.
+ *
+ * At most max_jobs commands run at once. A batch that arrives while every
+ * slot is busy is merged into a single queued run, so a burst of batches
+ * costs one extra run rather than one per batch. In restart mode a new
+ * batch cancels the runs in flight instead, and their paths are carried
+ * into the replacement run.
+ */
+typedef struct fossil_shark_jobs fossil_shark_jobs_t;
+
+/**
+ * @brief Create a runner.
+ *
+ * Every "{}" in command is replaced by the changed paths, each quoted for
+ * the shell and separated by spaces. Commands run through /bin/sh -c
+ * (cmd /c on Windows). The runner's own status lines go to stderr.
+ *
+ * @param out Receives the runner.
+ * @param command Command template.
+ * @param max_jobs Concurrent runs allowed; 0 means 1.
+ * @param restart Cancel runs in flight when a new batch arrives.
+ * @param quiet Send the commands' stdout to stderr, for when stdout carries
+ *              machine-readable output.
+ * @return 0 on success, EINVAL or ENOMEM otherwise.
+ */
+int fossil_shark_jobs_create(fossil_shark_jobs_t **out, ccstring command, size_t max_jobs, bool restart,
+                             bool quiet);
+
+/**
+ * @brief Hand a batch of changed paths to the runner.
+ *
+ * Starts a run right away when a slot is free, otherwise queues it.
+ */
+void fossil_shark_jobs_submit(fossil_shark_jobs_t *jobs, const char *const *paths, size_t count);
+
+/**
+ * @brief Reap finished runs and start the queued one if a slot opened.
+ *
+ * Call this regularly; it never blocks.
+ *
+ * @return true while anything is running or queued.
+ */
+bool fossil_shark_jobs_poll(fossil_shark_jobs_t *jobs);
+
+/**
+ * @brief Wait for runs in flight, drop the queued one, and free the runner.
+ */
+void fossil_shark_jobs_free(fossil_shark_jobs_t *jobs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
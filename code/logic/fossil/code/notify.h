@@ -0,0 +1,111 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_NOTIFY_H
+#define FOSSIL_APP_NOTIFY_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Filesystem Change Notification
+    * ========================================================================== */
+
+/**
+ * @brief Event kinds reported by the notification backend.
+ */
+typedef enum
+{
+    FOSSIL_SHARK_NOTIFY_CREATE = 1 << 0,  /**< Entry created or moved in */
+    FOSSIL_SHARK_NOTIFY_DELETE = 1 << 1,  /**< Entry deleted */
+    FOSSIL_SHARK_NOTIFY_MODIFY = 1 << 2,  /**< Contents or attributes changed */
+    FOSSIL_SHARK_NOTIFY_RENAME = 1 << 3,  /**< Entry moved out (old name) */
+    FOSSIL_SHARK_NOTIFY_OVERFLOW = 1 << 4 /**< Events were lost; rescan needed */
+} fossil_shark_notify_kind_t;
+
+/**
+ * @brief A single change event.
+ */
+typedef struct fossil_shark_notify_event_s
+{
+    fossil_shark_notify_kind_t kind;      /**< What happened */
+    bool is_dir;                          /**< Non-zero if the entry is a directory */
+    uint32_t cookie;                      /**< Pairs the two halves of a rename */
+    uint64_t inode;                       /**< Inode number, 0 when not known */
+    char path[FOSSIL_FILESYS_MAX_PATH];   /**< Full path of the affected entry */
+} fossil_shark_notify_event_t;
+
+/**
+ * @brief Opaque notification handle.
+ */
+typedef struct fossil_shark_notify_s fossil_shark_notify_t;
+
+/**
+ * @brief Start watching a path.
+ *
+ * In recursive mode every subdirectory is registered up front, and new
+ * subdirectories are registered as soon as their creation is reported.
+ * Whatever a new subdirectory already holds when it is registered (it was
+ * moved in whole, or filled before its watch existed) is reported as
+ * created, so an entry may be reported twice but is never missed.
+ *
+ * @param out Receives the new handle.
+ * @param path File or directory to watch.
+ * @param recursive Watch subdirectories too.
+ * @return 0 on success, ENOSYS when the platform has no native backend,
+ *         other non-zero values on error.
+ */
+int fossil_shark_notify_open(fossil_shark_notify_t **out, ccstring path, bool recursive);
+
+/**
+ * @brief Wait for and return pending events.
+ *
+ * @param notify Handle from fossil_shark_notify_open().
+ * @param events Caller-provided event array.
+ * @param max Capacity of the events array.
+ * @param count Receives the number of events stored.
+ * @param timeout_ms Maximum wait in milliseconds; negative waits forever,
+ *        zero only drains what is already queued.
+ * @return 0 on success (count may be zero on timeout), non-zero on error.
+ */
+int fossil_shark_notify_read(fossil_shark_notify_t *notify,
+                             fossil_shark_notify_event_t *events, size_t max,
+                             size_t *count, int timeout_ms);
+
+/**
+ * @brief Stop watching and release the handle.
+ *
+ * @param notify Handle to close; may be null.
+ */
+void fossil_shark_notify_close(fossil_shark_notify_t *notify);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
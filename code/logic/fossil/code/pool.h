@@ -0,0 +1,129 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_POOL_H
+#define FOSSIL_APP_POOL_H
+
+#include "common.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Worker Threads
+    * ========================================================================== */
+
+/**
+ * @brief Mutex paired with a condition variable.
+ *
+ * Workers share one of these to guard a work queue and to wait for more
+ * work or for the queue to drain.
+ */
+typedef struct fossil_shark_lock_s
+{
+#if defined(_WIN32)
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE cond;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+} fossil_shark_lock_t;
+
+/**
+ * @brief A single background thread.
+ */
+typedef struct fossil_shark_thread_s
+{
+#if defined(_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    void (*run)(void *ctx);
+    void *ctx;
+} fossil_shark_thread_t;
+
+void fossil_shark_lock_init(fossil_shark_lock_t *lock);
+void fossil_shark_lock_destroy(fossil_shark_lock_t *lock);
+void fossil_shark_lock_acquire(fossil_shark_lock_t *lock);
+void fossil_shark_lock_release(fossil_shark_lock_t *lock);
+
+/**
+ * @brief Release the lock, sleep until woken, then re-acquire it.
+ */
+void fossil_shark_lock_wait(fossil_shark_lock_t *lock);
+
+/**
+ * @brief Wake every thread waiting on the lock.
+ */
+void fossil_shark_lock_wake_all(fossil_shark_lock_t *lock);
+
+/**
+ * @brief Start run(ctx) on a new thread.
+ *
+ * @param thread Caller-owned handle; must stay valid until joined.
+ * @return 0 on success, otherwise the error from the platform.
+ */
+int fossil_shark_thread_start(fossil_shark_thread_t *thread, void (*run)(void *ctx), void *ctx);
+
+/**
+ * @brief Wait for a thread started with fossil_shark_thread_start to finish.
+ */
+void fossil_shark_thread_join(fossil_shark_thread_t *thread);
+
+/**
+ * @brief Number of workers to use when the user did not ask for a count.
+ *
+ * @return Online CPU count, at least 1.
+ */
+size_t fossil_shark_pool_default_jobs(void);
+
+/**
+ * @brief Run worker on several threads and wait for all of them.
+ *
+ * The calling thread is one of the workers. Workers pull their own work
+ * from ctx; the pool only starts and joins them. If a thread cannot be
+ * started the remaining workers still run, so the job always completes.
+ *
+ * @param jobs Number of workers; 0 means fossil_shark_pool_default_jobs().
+ * @param worker Function each worker runs.
+ * @param ctx Shared context handed to every worker.
+ * @return Number of workers that ran.
+ */
+size_t fossil_shark_pool_run(size_t jobs, void (*worker)(void *ctx), void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
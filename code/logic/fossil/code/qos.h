@@ -0,0 +1,82 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_QOS_H
+#define FOSSIL_APP_QOS_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * I/O Quality of Service
+    * ========================================================================== */
+
+/**
+ * @brief Parse a byte rate such as "512K", "10M" or "1G" (powers of 1024).
+ *
+ * A trailing "B" or "/s" is accepted and ignored.
+ *
+ * @param text Rate to parse.
+ * @param out Receives the rate in bytes per second.
+ * @return 0 on success, EINVAL if the text is not a rate.
+ */
+int fossil_shark_qos_parse_rate(ccstring text, uint64_t *out);
+
+/**
+ * @brief Set the limits for the rest of the process.
+ *
+ * The limits are a single token bucket shared by every thread, so worker
+ * pools stay inside the budget as a whole.
+ *
+ * @param bytes_per_sec Bandwidth budget, 0 for unlimited.
+ * @param ops_per_sec I/O operation budget, 0 for unlimited.
+ * @param idle Drop to idle I/O priority and lowest CPU priority.
+ * @return 0 on success, non-zero if the idle priority could not be applied.
+ */
+int fossil_shark_qos_configure(uint64_t bytes_per_sec, uint64_t ops_per_sec, bool idle);
+
+/**
+ * @brief True when a bandwidth or IOPS limit is set.
+ */
+bool fossil_shark_qos_active(void);
+
+/**
+ * @brief Account for I/O about to be issued, sleeping until it fits the budget.
+ *
+ * Safe to call from any thread; returns at once when no limit is set.
+ *
+ * @param bytes Bytes about to be read or written.
+ * @param ops Number of I/O operations they take.
+ */
+void fossil_shark_qos_throttle(size_t bytes, unsigned ops);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
@@ -0,0 +1,101 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_RING_H
+#define FOSSIL_APP_RING_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Record Ring
+    * ========================================================================== */
+
+/**
+ * @brief Lock-free ring of variable-length records for one producer and
+ * one consumer.
+ *
+ * The producer never blocks: a record that does not fit is dropped and
+ * counted, so a slow consumer costs output rather than stalling whatever
+ * feeds the ring. The consumer may sleep when the ring is empty; the lock
+ * is only touched to wake it.
+ */
+typedef struct fossil_shark_ring fossil_shark_ring_t;
+
+/**
+ * @brief Create a ring.
+ *
+ * @param out Receives the ring.
+ * @param capacity Size in bytes, rounded up to a power of two.
+ * @return 0 on success, EINVAL or ENOMEM otherwise.
+ */
+int fossil_shark_ring_create(fossil_shark_ring_t **out, size_t capacity);
+
+/**
+ * @brief Append a record (producer side).
+ *
+ * @return true if stored, false if the ring was full and the record dropped.
+ */
+bool fossil_shark_ring_push(fossil_shark_ring_t *ring, const void *record, size_t len);
+
+/**
+ * @brief Take the oldest record (consumer side); never blocks.
+ *
+ * @param buffer Receives the record; must hold the largest record pushed.
+ * @param cap Size of buffer.
+ * @return Length of the record, or 0 if the ring is empty.
+ */
+size_t fossil_shark_ring_pop(fossil_shark_ring_t *ring, void *buffer, size_t cap);
+
+/**
+ * @brief Sleep until a record is available or the ring is closed.
+ *
+ * @return true if a record is available, false once closed and drained.
+ */
+bool fossil_shark_ring_wait(fossil_shark_ring_t *ring);
+
+/**
+ * @brief Stop accepting records and wake the consumer.
+ */
+void fossil_shark_ring_close(fossil_shark_ring_t *ring);
+
+/**
+ * @brief Number of records dropped so far because the ring was full.
+ */
+uint64_t fossil_shark_ring_dropped(const fossil_shark_ring_t *ring);
+
+/**
+ * @brief Free a ring; null is ignored.
+ */
+void fossil_shark_ring_free(fossil_shark_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
@@ -0,0 +1,154 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef FOSSIL_APP_SNAPSHOT_H
+#define FOSSIL_APP_SNAPSHOT_H
+
+#include "common.h"
+#include "notify.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* ==========================================================================
+    * Tree Snapshots
+    * ========================================================================== */
+
+/**
+ * @brief Compact record of a tree: inode, size and mtime (ns) per entry,
+ *        indexed by a hash of the path.
+ *
+ * Diffing two snapshots yields the same events a native notification
+ * backend would have reported, which makes snapshots both a polling backend
+ * for filesystems without notifications (NFS, SMB) and the recovery path
+ * after a notification queue overflow.
+ */
+typedef struct fossil_shark_snapshot_s fossil_shark_snapshot_t;
+
+/**
+ * @brief Callback receiving one event from fossil_shark_snapshot_diff().
+ */
+typedef void (*fossil_shark_snapshot_emit_fn)(const fossil_shark_notify_event_t *event, void *user);
+
+/**
+ * @brief Scan a tree into a new snapshot.
+ *
+ * Directories are scanned by several threads. When prev is given, a
+ * directory whose inode and mtime are unchanged since prev (and old enough
+ * that a same-tick change is impossible) reuses prev's name list instead of
+ * being read again; its entries are still stat'ed for modifications.
+ *
+ * @param out Receives the snapshot.
+ * @param root File or directory to scan.
+ * @param recursive Descend into subdirectories.
+ * @param prev Previous snapshot of the same root, or null.
+ * @param jobs Scanner threads; 0 picks a default suited to network latency.
+ * @return 0 on success, errno-style code on error (ENOENT if root is gone).
+ */
+int fossil_shark_snapshot_take(fossil_shark_snapshot_t **out, ccstring root, bool recursive,
+                               const fossil_shark_snapshot_t *prev, size_t jobs);
+
+/**
+ * @brief Report what changed between two snapshots.
+ *
+ * An entry that disappeared and an entry that appeared with the same inode
+ * are reported as a rename: RENAME for the old path followed by CREATE with
+ * a matching non-zero cookie for the new one.
+ *
+ * @return Number of events emitted.
+ */
+size_t fossil_shark_snapshot_diff(const fossil_shark_snapshot_t *old_snap,
+                                  const fossil_shark_snapshot_t *new_snap,
+                                  fossil_shark_snapshot_emit_fn emit, void *user);
+
+/**
+ * @brief Fold an event reported by a native backend into the snapshot.
+ *
+ * Keeps a snapshot current between rescans so that a later diff only
+ * reports what the event stream missed.
+ */
+void fossil_shark_snapshot_apply(fossil_shark_snapshot_t *snap, const fossil_shark_notify_event_t *event);
+
+/**
+ * @brief What a snapshot recorded about one live entry.
+ */
+typedef struct fossil_shark_snapshot_info_s
+{
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+    bool is_dir;
+    bool has_content;  /**< content is valid */
+    uint64_t content;  /**< Hash of the file's bytes at this size and mtime */
+} fossil_shark_snapshot_info_t;
+
+/**
+ * @brief Look up a live entry.
+ *
+ * @return true and fills out if the path is in the snapshot.
+ */
+bool fossil_shark_snapshot_lookup(const fossil_shark_snapshot_t *snap, ccstring path,
+                                  fossil_shark_snapshot_info_t *out);
+
+/**
+ * @brief Hash the contents of every regular file that lacks a fingerprint.
+ *
+ * Later snapshots taken with this one as prev reuse the hashes of files
+ * whose size and mtime did not change, so only changed files are read
+ * again.
+ *
+ * @param jobs Hashing threads; 0 means one per CPU.
+ * @return 0 on success, EINVAL for a null snapshot.
+ */
+int fossil_shark_snapshot_fingerprint(fossil_shark_snapshot_t *snap, size_t jobs);
+
+/**
+ * @brief Record the content hash of a file, e.g. after re-reading it.
+ */
+void fossil_shark_snapshot_set_content(fossil_shark_snapshot_t *snap, ccstring path, uint64_t content);
+
+/**
+ * @brief Inode last recorded for a path, including one since deleted.
+ *
+ * @return The inode number, or 0 if the path was never seen.
+ */
+uint64_t fossil_shark_snapshot_inode(const fossil_shark_snapshot_t *snap, ccstring path);
+
+/**
+ * @brief Number of live entries in the snapshot.
+ */
+size_t fossil_shark_snapshot_count(const fossil_shark_snapshot_t *snap);
+
+/**
+ * @brief Release a snapshot; null is ignored.
+ */
+void fossil_shark_snapshot_free(fossil_shark_snapshot_t *snap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FOSSIL_APP_CODE_H */
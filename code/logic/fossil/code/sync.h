@@ -39,10 +39,17 @@ extern "C"
  * @param recursive Include subdirectories
  * @param update Copy only newer files
  * @param delete Remove extraneous files from target
+ * @param compare_mode Change detection policy: "mtime-size", "size", "xxh3" (default) or "sha256"
+ * @param checksum Hash equal-sized files even when their mtimes match
+ * @param continuous Keep running after the first pass and mirror changes as they happen
+ * @param durable Make copies durable before renaming them into place: their data
+ *                and then the renames are flushed together once per pass (or per
+ *                batch in continuous mode) rather than after every file
  * @return 0 on success, non-zero on error
  */
 int fossil_shark_sync(ccstring src, ccstring dest,
-                        bool recursive, bool update, bool delete);
+                        bool recursive, bool update, bool delete,
+                        ccstring compare_mode, bool checksum, bool continuous, bool durable);
 
 #ifdef __cplusplus
 }
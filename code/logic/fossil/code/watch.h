@@ -26,6 +26,7 @@
 #define FOSSIL_APP_COMMAND_WATCH_H
 
 #include "common.h"
+#include "notify.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -33,15 +34,57 @@ extern "C"
 #endif
 
 /**
- * Continuously monitor files or directories for changes
+ * Continuously monitor files or directories for changes (inotify on Linux)
  * @param path Path to monitor
  * @param recursive Monitor subdirectories
  * @param events List of events to filter ("create", "modify", "delete")
- * @param interval Poll interval in seconds
+ * @param interval Poll interval in seconds, used only when polling
+ * @param poll Poll with tree snapshots instead of native notifications (network filesystems)
+ * @param debounce_ms Coalesce events per path until this many quiet milliseconds pass (0 = off)
+ * @param batch Print each coalesced window as one set of changes
+ * @param exec Command to run per coalesced window, "{}" expands to the changed paths (NULL = none)
+ * @param jobs Maximum concurrent runs of exec (0 = 1)
+ * @param restart Cancel runs still in flight when new changes arrive instead of queueing
+ * @param media Output format: "text" (default) or "jsonl", one JSON object per event
+ * @param content Report modify only when file contents changed, not on touch or chmod (implies a debounce window)
  * @return 0 on success, non-zero on error
  */
 int fossil_shark_watch(ccstring path, bool recursive,
-                        ccstring events, int interval);
+                        ccstring events, int interval, bool poll,
+                        int debounce_ms, bool batch,
+                        ccstring exec, size_t jobs, bool restart,
+                        ccstring media, bool content);
+
+/**
+ * Net effect of the events seen for one path within a debounce window
+ */
+typedef struct
+{
+    fossil_shark_notify_event_t event; /**< Last create/remove, carries cookie and is_dir */
+    bool existed;  /**< Path existed before its first event in the window */
+    bool exists;   /**< Path exists after its latest event */
+    bool modified; /**< Contents changed or the path was replaced */
+} fossil_shark_watch_net_t;
+
+/**
+ * Fold one event into the net change for its path
+ * @param net Net change so far; zero it before the first event of a window
+ * @param ev Event for the same path
+ * @param existed_before For the first event, whether the path existed before
+ *                       it (a create can land on an existing name)
+ */
+void fossil_shark_watch_fold(fossil_shark_watch_net_t *net, const fossil_shark_notify_event_t *ev,
+                             bool existed_before);
+
+/**
+ * Collapse a window's net change to the single event it stands for:
+ * create+modify is a create, create+delete is nothing and delete+create
+ * is a modify
+ * @param net Net change built by fossil_shark_watch_fold
+ * @param out Receives the event; may be &net->event
+ * @return false when nothing is left to report
+ */
+bool fossil_shark_watch_collapse(const fossil_shark_watch_net_t *net, fossil_shark_notify_event_t *out);
 
 #ifdef __cplusplus
 }
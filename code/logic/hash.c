@@ -0,0 +1,616 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "fossil/code/hash.h"
+#include "fossil/code/qos.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define FOSSIL_SHARK_HASH_SSE2 1
+#endif
+
+/* ==========================================================================
+ * XXH3 constants
+ * ========================================================================== */
+
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+#define PRIME_MX1 0x165667919E3779F9ULL
+#define PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define STRIPE_LEN 64
+#define SECRET_SIZE 192
+#define SECRET_CONSUME_RATE 8
+#define STRIPES_PER_BLOCK ((SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE)
+#define SECRET_LASTACC_START 7
+#define SECRET_MERGEACCS_START 11
+#define SECRET_SIZE_MIN 136
+#define MIDSIZE_STARTOFFSET 3
+#define MIDSIZE_LASTOFFSET 17
+
+static const uint8_t k_secret[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/* ==========================================================================
+ * Static Helpers (internal)
+ * ========================================================================== */
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+    return (uint64_t)read32(p) | ((uint64_t)read32(p + 4) << 32);
+}
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint32_t swap32(uint32_t x)
+{
+    return ((x << 24) & 0xff000000U) | ((x << 8) & 0x00ff0000U) |
+           ((x >> 8) & 0x0000ff00U) | ((x >> 24) & 0x000000ffU);
+}
+
+static inline uint64_t swap64(uint64_t x)
+{
+    return ((uint64_t)swap32((uint32_t)x) << 32) | swap32((uint32_t)(x >> 32));
+}
+
+static inline fossil_shark_hash128_t mul64to128(uint64_t lhs, uint64_t rhs)
+{
+    fossil_shark_hash128_t r;
+#if defined(__SIZEOF_INT128__)
+    __uint128_t product = (__uint128_t)lhs * rhs;
+    r.low = (uint64_t)product;
+    r.high = (uint64_t)(product >> 64);
+#else
+    uint64_t lo_lo = (lhs & 0xFFFFFFFFULL) * (rhs & 0xFFFFFFFFULL);
+    uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFFULL);
+    uint64_t lo_hi = (lhs & 0xFFFFFFFFULL) * (rhs >> 32);
+    uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+    r.high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    r.low = (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+#endif
+    return r;
+}
+
+static inline uint64_t mul128_fold64(uint64_t lhs, uint64_t rhs)
+{
+    fossil_shark_hash128_t product = mul64to128(lhs, rhs);
+    return product.low ^ product.high;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static inline uint64_t mix16(const uint8_t *in, const uint8_t *secret)
+{
+    return mul128_fold64(read64(in) ^ read64(secret), read64(in + 8) ^ read64(secret + 8));
+}
+
+static uint64_t hash_short64(const uint8_t *in, size_t len)
+{
+    const uint8_t *s = k_secret;
+
+    if (len == 0)
+        return xxh64_avalanche(read64(s + 56) ^ read64(s + 64));
+
+    if (len <= 3)
+    {
+        uint32_t combined = ((uint32_t)in[0] << 16) | ((uint32_t)in[len >> 1] << 24) |
+                            (uint32_t)in[len - 1] | ((uint32_t)len << 8);
+        uint64_t bitflip = read32(s) ^ read32(s + 4);
+        return xxh64_avalanche((uint64_t)combined ^ bitflip);
+    }
+
+    if (len <= 8)
+    {
+        uint64_t bitflip = read64(s + 8) ^ read64(s + 16);
+        uint64_t input64 = read32(in + len - 4) + ((uint64_t)read32(in) << 32);
+        return xxh3_rrmxmx(input64 ^ bitflip, len);
+    }
+
+    if (len <= 16)
+    {
+        uint64_t lo = read64(in) ^ (read64(s + 24) ^ read64(s + 32));
+        uint64_t hi = read64(in + len - 8) ^ (read64(s + 40) ^ read64(s + 48));
+        uint64_t acc = len + swap64(lo) + hi + mul128_fold64(lo, hi);
+        return xxh3_avalanche(acc);
+    }
+
+    if (len <= 128)
+    {
+        uint64_t acc = len * PRIME64_1;
+        if (len > 32)
+        {
+            if (len > 64)
+            {
+                if (len > 96)
+                {
+                    acc += mix16(in + 48, s + 96);
+                    acc += mix16(in + len - 64, s + 112);
+                }
+                acc += mix16(in + 32, s + 64);
+                acc += mix16(in + len - 48, s + 80);
+            }
+            acc += mix16(in + 16, s + 32);
+            acc += mix16(in + len - 32, s + 48);
+        }
+        acc += mix16(in, s);
+        acc += mix16(in + len - 16, s + 16);
+        return xxh3_avalanche(acc);
+    }
+
+    /* 129..240 bytes */
+    uint64_t acc = len * PRIME64_1;
+    size_t rounds = len / 16;
+    for (size_t i = 0; i < 8; ++i)
+        acc += mix16(in + 16 * i, s + 16 * i);
+    acc = xxh3_avalanche(acc);
+    for (size_t i = 8; i < rounds; ++i)
+        acc += mix16(in + 16 * i, s + 16 * (i - 8) + MIDSIZE_STARTOFFSET);
+    acc += mix16(in + len - 16, s + 136 - MIDSIZE_LASTOFFSET);
+    return xxh3_avalanche(acc);
+}
+
+/* XXH3-128 for inputs up to 240 bytes (seed 0, default secret). */
+static void mix32(fossil_shark_hash128_t *acc, const uint8_t *in1, const uint8_t *in2, const uint8_t *secret)
+{
+    acc->low += mix16(in1, secret);
+    acc->low ^= read64(in2) + read64(in2 + 8);
+    acc->high += mix16(in2, secret + 16);
+    acc->high ^= read64(in1) + read64(in1 + 8);
+}
+
+static fossil_shark_hash128_t mix32_finish(fossil_shark_hash128_t acc, size_t len)
+{
+    fossil_shark_hash128_t h;
+    h.low = xxh3_avalanche(acc.low + acc.high);
+    h.high = 0 - xxh3_avalanche(acc.low * PRIME64_1 + acc.high * PRIME64_4 + (uint64_t)len * PRIME64_2);
+    return h;
+}
+
+static fossil_shark_hash128_t hash_short128(const uint8_t *in, size_t len)
+{
+    const uint8_t *s = k_secret;
+    fossil_shark_hash128_t h;
+
+    if (len == 0)
+    {
+        h.low = xxh64_avalanche(read64(s + 64) ^ read64(s + 72));
+        h.high = xxh64_avalanche(read64(s + 80) ^ read64(s + 88));
+        return h;
+    }
+
+    if (len <= 3)
+    {
+        uint32_t combined_lo = ((uint32_t)in[0] << 16) | ((uint32_t)in[len >> 1] << 24) |
+                               (uint32_t)in[len - 1] | ((uint32_t)len << 8);
+        uint32_t swapped = swap32(combined_lo);
+        uint32_t combined_hi = (swapped << 13) | (swapped >> 19);
+        h.low = xxh64_avalanche((uint64_t)combined_lo ^ (uint64_t)(read32(s) ^ read32(s + 4)));
+        h.high = xxh64_avalanche((uint64_t)combined_hi ^ (uint64_t)(read32(s + 8) ^ read32(s + 12)));
+        return h;
+    }
+
+    if (len <= 8)
+    {
+        uint64_t input64 = read32(in) + ((uint64_t)read32(in + len - 4) << 32);
+        uint64_t keyed = input64 ^ (read64(s + 16) ^ read64(s + 24));
+        fossil_shark_hash128_t m = mul64to128(keyed, PRIME64_1 + ((uint64_t)len << 2));
+        m.high += m.low << 1;
+        m.low ^= m.high >> 3;
+        m.low ^= m.low >> 35;
+        m.low *= PRIME_MX2;
+        m.low ^= m.low >> 28;
+        m.high = xxh3_avalanche(m.high);
+        return m;
+    }
+
+    if (len <= 16)
+    {
+        uint64_t bitflip_lo = read64(s + 32) ^ read64(s + 40);
+        uint64_t bitflip_hi = read64(s + 48) ^ read64(s + 56);
+        uint64_t input_lo = read64(in);
+        uint64_t input_hi = read64(in + len - 8);
+        fossil_shark_hash128_t m = mul64to128(input_lo ^ input_hi ^ bitflip_lo, PRIME64_1);
+        m.low += (uint64_t)(len - 1) << 54;
+        input_hi ^= bitflip_hi;
+        m.high += input_hi + (uint64_t)(uint32_t)input_hi * (PRIME32_2 - 1);
+        m.low ^= swap64(m.high);
+        h = mul64to128(m.low, PRIME64_2);
+        h.high += m.high * PRIME64_2;
+        h.low = xxh3_avalanche(h.low);
+        h.high = xxh3_avalanche(h.high);
+        return h;
+    }
+
+    fossil_shark_hash128_t acc = {len * PRIME64_1, 0};
+    if (len <= 128)
+    {
+        size_t i = (len - 1) / 32;
+        do
+            mix32(&acc, in + 16 * i, in + len - 16 * (i + 1), s + 32 * i);
+        while (i-- != 0);
+        return mix32_finish(acc, len);
+    }
+
+    /* 129..240 bytes */
+    size_t rounds = len / 32;
+    for (size_t i = 0; i < 4; ++i)
+        mix32(&acc, in + 32 * i, in + 32 * i + 16, s + 32 * i);
+    acc.low = xxh3_avalanche(acc.low);
+    acc.high = xxh3_avalanche(acc.high);
+    for (size_t i = 4; i < rounds; ++i)
+        mix32(&acc, in + 32 * i, in + 32 * i + 16, s + MIDSIZE_STARTOFFSET + 32 * (i - 4));
+    mix32(&acc, in + len - 16, in + len - 32, s + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET - 16);
+    return mix32_finish(acc, len);
+}
+
+/*
+ * The stripe kernel: every lane multiplies the low and high halves of
+ * (data ^ secret) and adds the neighbouring lane's raw input. SSE2 and AVX2
+ * process two and four lanes per instruction; the scalar loop is laid out so
+ * compilers can auto-vectorize it on other targets.
+ */
+static inline void accumulate_stripe(uint64_t *acc, const uint8_t *in, const uint8_t *secret)
+{
+#if defined(__AVX2__)
+    for (size_t i = 0; i < 2; ++i)
+    {
+        __m256i data = _mm256_loadu_si256((const __m256i *)(const void *)(in + 32 * i));
+        __m256i key = _mm256_loadu_si256((const __m256i *)(const void *)(secret + 32 * i));
+        __m256i data_key = _mm256_xor_si256(data, key);
+        __m256i data_key_hi = _mm256_srli_epi64(data_key, 32);
+        __m256i product = _mm256_mul_epu32(data_key, data_key_hi);
+        __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        __m256i a = _mm256_loadu_si256((const __m256i *)(void *)(acc + 4 * i));
+        a = _mm256_add_epi64(a, _mm256_add_epi64(product, swapped));
+        _mm256_storeu_si256((__m256i *)(void *)(acc + 4 * i), a);
+    }
+#elif defined(FOSSIL_SHARK_HASH_SSE2)
+    for (size_t i = 0; i < 4; ++i)
+    {
+        __m128i data = _mm_loadu_si128((const __m128i *)(const void *)(in + 16 * i));
+        __m128i key = _mm_loadu_si128((const __m128i *)(const void *)(secret + 16 * i));
+        __m128i data_key = _mm_xor_si128(data, key);
+        __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i product = _mm_mul_epu32(data_key, data_key_hi);
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128i a = _mm_loadu_si128((const __m128i *)(void *)(acc + 2 * i));
+        a = _mm_add_epi64(a, _mm_add_epi64(product, swapped));
+        _mm_storeu_si128((__m128i *)(void *)(acc + 2 * i), a);
+    }
+#else
+    for (size_t i = 0; i < 8; ++i)
+    {
+        uint64_t data_key = read64(in + 8 * i) ^ read64(secret + 8 * i);
+        acc[i] += read64(in + 8 * (i ^ 1)) + (data_key & 0xFFFFFFFFULL) * (data_key >> 32);
+    }
+#endif
+}
+
+static inline void scramble_accs(uint64_t *acc, const uint8_t *secret)
+{
+    for (size_t i = 0; i < 8; ++i)
+    {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * i);
+        a *= PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+/* Consume whole stripes, scrambling at every block boundary. */
+static void consume_stripes(uint64_t *acc, size_t *stripes_in_block, const uint8_t *in, size_t stripes)
+{
+    while (stripes > 0)
+    {
+        size_t room = STRIPES_PER_BLOCK - *stripes_in_block;
+        size_t n = stripes < room ? stripes : room;
+        for (size_t i = 0; i < n; ++i)
+            accumulate_stripe(acc, in + i * STRIPE_LEN, k_secret + (*stripes_in_block + i) * SECRET_CONSUME_RATE);
+        *stripes_in_block += n;
+        in += n * STRIPE_LEN;
+        stripes -= n;
+        if (*stripes_in_block == STRIPES_PER_BLOCK)
+        {
+            scramble_accs(acc, k_secret + SECRET_SIZE - STRIPE_LEN);
+            *stripes_in_block = 0;
+        }
+    }
+}
+
+static uint64_t merge_accs(const uint64_t *acc, const uint8_t *secret, uint64_t start)
+{
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; ++i)
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i), acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    return xxh3_avalanche(result);
+}
+
+/* Finish the long-input path on a copy of the accumulators. */
+static void finish_long(const fossil_shark_hash_state_t *state, uint64_t *acc)
+{
+    size_t stripes_in_block = state->stripes_in_block;
+    memcpy(acc, state->acc, sizeof(state->acc));
+
+    if (state->buffered >= STRIPE_LEN)
+    {
+        size_t stripes = (state->buffered - 1) / STRIPE_LEN;
+        consume_stripes(acc, &stripes_in_block, state->buffer, stripes);
+        accumulate_stripe(acc, state->buffer + state->buffered - STRIPE_LEN,
+                          k_secret + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC_START);
+    }
+    else
+    {
+        uint8_t last[STRIPE_LEN];
+        size_t carry = STRIPE_LEN - state->buffered;
+        memcpy(last, state->last_stripe + STRIPE_LEN - carry, carry);
+        memcpy(last + carry, state->buffer, state->buffered);
+        accumulate_stripe(acc, last, k_secret + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC_START);
+    }
+}
+
+/* ==========================================================================
+ * Public API
+ * ========================================================================== */
+
+void fossil_shark_hash_init(fossil_shark_hash_state_t *state)
+{
+    static const uint64_t init_acc[8] = {
+        PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+        PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+
+    memcpy(state->acc, init_acc, sizeof(init_acc));
+    state->buffered = 0;
+    state->stripes_in_block = 0;
+    state->total_len = 0;
+}
+
+void fossil_shark_hash_update(fossil_shark_hash_state_t *state, const void *data, size_t len)
+{
+    const uint8_t *in = (const uint8_t *)data;
+    state->total_len += len;
+
+    if (state->buffered + len <= sizeof(state->buffer))
+    {
+        memcpy(state->buffer + state->buffered, in, len);
+        state->buffered += len;
+        return;
+    }
+
+    /* Top up and flush the buffer; at least one byte of input remains. */
+    if (state->buffered > 0)
+    {
+        size_t fill = sizeof(state->buffer) - state->buffered;
+        memcpy(state->buffer + state->buffered, in, fill);
+        in += fill;
+        len -= fill;
+        consume_stripes(state->acc, &state->stripes_in_block, state->buffer, sizeof(state->buffer) / STRIPE_LEN);
+        memcpy(state->last_stripe, state->buffer + sizeof(state->buffer) - STRIPE_LEN, STRIPE_LEN);
+        state->buffered = 0;
+    }
+
+    /* Consume directly from the input, always keeping the final bytes back. */
+    if (len > sizeof(state->buffer))
+    {
+        size_t stripes = (len - 1) / STRIPE_LEN;
+        consume_stripes(state->acc, &state->stripes_in_block, in, stripes);
+        in += stripes * STRIPE_LEN;
+        len -= stripes * STRIPE_LEN;
+        memcpy(state->last_stripe, in - STRIPE_LEN, STRIPE_LEN);
+    }
+
+    memcpy(state->buffer, in, len);
+    state->buffered = len;
+}
+
+uint64_t fossil_shark_hash_digest64(const fossil_shark_hash_state_t *state)
+{
+    if (state->total_len <= 240)
+        return hash_short64(state->buffer, (size_t)state->total_len);
+
+    uint64_t acc[8];
+    finish_long(state, acc);
+    return merge_accs(acc, k_secret + SECRET_MERGEACCS_START, state->total_len * PRIME64_1);
+}
+
+fossil_shark_hash128_t fossil_shark_hash_digest128(const fossil_shark_hash_state_t *state)
+{
+    if (state->total_len <= 240)
+        return hash_short128(state->buffer, (size_t)state->total_len);
+
+    uint64_t acc[8];
+    finish_long(state, acc);
+    fossil_shark_hash128_t h;
+    h.low = merge_accs(acc, k_secret + SECRET_MERGEACCS_START, state->total_len * PRIME64_1);
+    h.high = merge_accs(acc, k_secret + SECRET_SIZE - sizeof(acc) - SECRET_MERGEACCS_START,
+                        ~(state->total_len * PRIME64_2));
+    return h;
+}
+
+uint64_t fossil_shark_hash64(const void *data, size_t len)
+{
+    if (len <= 240)
+        return hash_short64((const uint8_t *)data, len);
+
+    fossil_shark_hash_state_t state;
+    fossil_shark_hash_init(&state);
+    fossil_shark_hash_update(&state, data, len);
+    return fossil_shark_hash_digest64(&state);
+}
+
+fossil_shark_hash128_t fossil_shark_hash128(const void *data, size_t len)
+{
+    if (len <= 240)
+        return hash_short128((const uint8_t *)data, len);
+
+    fossil_shark_hash_state_t state;
+    fossil_shark_hash_init(&state);
+    fossil_shark_hash_update(&state, data, len);
+    return fossil_shark_hash_digest128(&state);
+}
+
+/*
+ * Stream a file through one fixed buffer, so memory stays flat however
+ * large the file is. On POSIX the kernel is told the access is sequential
+ * so it reads ahead aggressively while the previous chunk is hashed.
+ */
+static int hash_file(ccstring path, fossil_shark_hash_state_t *state)
+{
+    if (!cnotnull(path))
+        return EINVAL;
+
+    uint8_t *buffer = (uint8_t *)fossil_sys_memory_alloc(FOSSIL_SHARK_HASH_BUFFER_SIZE);
+    if (!cnotnull(buffer))
+        return ENOMEM;
+    fossil_shark_hash_init(state);
+    int rc = 0;
+
+#ifdef _WIN32
+    fossil_io_filesys_file_t stream;
+    if (fossil_io_filesys_file_open(&stream, path, "rb") != 0)
+    {
+        fossil_sys_memory_free(buffer);
+        return errno ? errno : EIO;
+    }
+    size_t n;
+    while ((n = fossil_io_filesys_file_read(&stream, buffer, 1, FOSSIL_SHARK_HASH_BUFFER_SIZE)) > 0)
+    {
+        fossil_shark_qos_throttle(n, 1);
+        fossil_shark_hash_update(state, buffer, n);
+    }
+    fossil_io_filesys_file_close(&stream);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fossil_sys_memory_free(buffer);
+        return errno;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    for (;;)
+    {
+        ssize_t n = read(fd, buffer, FOSSIL_SHARK_HASH_BUFFER_SIZE);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            rc = errno;
+        if (n <= 0)
+            break;
+        fossil_shark_qos_throttle((size_t)n, 1);
+        fossil_shark_hash_update(state, buffer, (size_t)n);
+    }
+    close(fd);
+#endif
+
+    fossil_sys_memory_free(buffer);
+    return rc;
+}
+
+int fossil_shark_hash_file64(ccstring path, uint64_t *out)
+{
+    if (!cnotnull(out))
+        return EINVAL;
+
+    fossil_shark_hash_state_t state;
+    int rc = hash_file(path, &state);
+    if (rc == 0)
+        *out = fossil_shark_hash_digest64(&state);
+    return rc;
+}
+
+int fossil_shark_hash_file128(ccstring path, fossil_shark_hash128_t *out)
+{
+    if (!cnotnull(out))
+        return EINVAL;
+
+    fossil_shark_hash_state_t state;
+    int rc = hash_file(path, &state);
+    if (rc == 0)
+        *out = fossil_shark_hash_digest128(&state);
+    return rc;
+}
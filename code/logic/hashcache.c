@@ -0,0 +1,457 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "fossil/code/hashcache.h"
+#include "fossil/code/pool.h"
+#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#endif
+
+#define HASHCACHE_MIN_SLOTS (16u * 1024u)
+#define HASHCACHE_MAX_SLOTS (4u * 1024u * 1024u) /* about 224 MiB; reset instead of growing past it */
+#define HASHCACHE_RACY_NS 1000000000ll          /* mtimes this close to now are not trusted */
+
+static const char k_hashcache_magic[8] = {'S', 'H', 'R', 'K', 'H', 'C', '0', '1'};
+
+/*
+ * The file is a header followed by an open-addressing table of fixed-size
+ * slots, probed linearly from a mix of device and inode. check is a hash
+ * of the other fields, so an empty slot (all zero) and a torn or corrupt
+ * one are both recognized and never trusted. A writer that dies while
+ * growing the table therefore only loses entries.
+ */
+typedef struct
+{
+    char magic[8];
+    uint64_t slots;
+    uint64_t used;
+    uint8_t reserved[40];
+} hashcache_header_t;
+
+typedef struct
+{
+    uint64_t dev;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t low;
+    uint64_t high;
+    uint64_t check;
+} hashcache_slot_t;
+
+typedef struct
+{
+    uint64_t dev;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+} hashcache_key_t;
+
+struct fossil_shark_hashcache
+{
+    fossil_shark_lock_t lock; // threads of this process; the file lock covers other processes
+    int fd;
+    uint8_t *map;
+    size_t map_len;
+    uint64_t slots;           // table size this process has mapped
+};
+
+#ifndef _WIN32
+
+/* ==========================================================================
+    * Table
+    * ========================================================================== */
+
+static size_t hashcache_bytes(uint64_t slots)
+{
+    return sizeof(hashcache_header_t) + (size_t)slots * sizeof(hashcache_slot_t);
+}
+
+static hashcache_header_t *hashcache_header(const fossil_shark_hashcache_t *cache)
+{
+    return (hashcache_header_t *)(void *)cache->map;
+}
+
+static hashcache_slot_t *hashcache_table(const fossil_shark_hashcache_t *cache)
+{
+    return (hashcache_slot_t *)(void *)(cache->map + sizeof(hashcache_header_t));
+}
+
+static uint64_t hashcache_check(const hashcache_slot_t *slot)
+{
+    return fossil_shark_hash64(slot, offsetof(hashcache_slot_t, check)) | 1;
+}
+
+static size_t hashcache_home(uint64_t dev, uint64_t inode, uint64_t slots)
+{
+    uint64_t h = (inode ^ (dev * 0x9E3779B97F4A7C15ull)) * 0xC2B2AE3D27D4EB4Full;
+    return (size_t)((h ^ (h >> 29)) & (slots - 1));
+}
+
+// Helper: (re)map the file at whatever size the header now says
+static int hashcache_map(fossil_shark_hashcache_t *cache)
+{
+    hashcache_header_t header;
+    if (pread(cache->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        return EIO;
+    if (cache->map && header.slots == cache->slots)
+        return 0;
+
+    struct stat st;
+    if (fstat(cache->fd, &st) != 0)
+        return errno;
+    size_t len = hashcache_bytes(header.slots);
+    if (header.slots < HASHCACHE_MIN_SLOTS || header.slots > HASHCACHE_MAX_SLOTS ||
+        (header.slots & (header.slots - 1)) != 0 || (uint64_t)st.st_size < len)
+        return EIO;
+
+    if (cache->map)
+        munmap(cache->map, cache->map_len);
+    void *map = mmap(cnull, len, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        cache->map = cnull;
+        return errno;
+    }
+    cache->map = (uint8_t *)map;
+    cache->map_len = len;
+    cache->slots = header.slots;
+    return 0;
+}
+
+// Helper: write a fresh, empty table of the given size (exclusive lock held)
+static int hashcache_format(fossil_shark_hashcache_t *cache, uint64_t slots)
+{
+    hashcache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, k_hashcache_magic, sizeof(header.magic));
+    header.slots = slots;
+
+    // Shrink to nothing first so every slot reads back as zero
+    if (ftruncate(cache->fd, 0) != 0 || ftruncate(cache->fd, (off_t)hashcache_bytes(slots)) != 0)
+        return errno;
+    if (pwrite(cache->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        return EIO;
+    return hashcache_map(cache);
+}
+
+static hashcache_slot_t *hashcache_find(const fossil_shark_hashcache_t *cache, uint64_t dev, uint64_t inode)
+{
+    hashcache_slot_t *table = hashcache_table(cache);
+    uint64_t mask = cache->slots - 1;
+    for (size_t i = hashcache_home(dev, inode, cache->slots), n = 0; n < cache->slots; i = (i + 1) & mask, ++n)
+    {
+        hashcache_slot_t *slot = &table[i];
+        if (slot->check == 0)
+            return slot; // first empty slot: not present
+        if (slot->dev == dev && slot->inode == inode)
+            return slot;
+    }
+    return cnull;
+}
+
+// Helper: double the table in place, or clear it once it reaches the cap
+static int hashcache_grow(fossil_shark_hashcache_t *cache)
+{
+    hashcache_header_t *header = hashcache_header(cache);
+    uint64_t slots = cache->slots * 2;
+    if (slots > HASHCACHE_MAX_SLOTS)
+        return hashcache_format(cache, cache->slots);
+
+    size_t live = 0;
+    hashcache_slot_t *keep = fossil_sys_memory_alloc((size_t)header->used * sizeof(hashcache_slot_t) + 1);
+    if (!keep)
+        return ENOMEM;
+    hashcache_slot_t *table = hashcache_table(cache);
+    for (uint64_t i = 0; i < cache->slots && live < header->used; ++i)
+    {
+        if (table[i].check != 0 && table[i].check == hashcache_check(&table[i]))
+            keep[live++] = table[i];
+    }
+
+    int rc = hashcache_format(cache, slots);
+    if (rc == 0)
+    {
+        header = hashcache_header(cache);
+        for (size_t i = 0; i < live; ++i)
+        {
+            hashcache_slot_t *slot = hashcache_find(cache, keep[i].dev, keep[i].inode);
+            if (slot && slot->check == 0)
+            {
+                *slot = keep[i];
+                header->used++;
+            }
+        }
+    }
+    fossil_sys_memory_free(keep);
+    return rc;
+}
+
+/* ==========================================================================
+    * Locking
+    * ========================================================================== */
+
+static int hashcache_lock(fossil_shark_hashcache_t *cache, int mode)
+{
+    fossil_shark_lock_acquire(&cache->lock);
+    while (flock(cache->fd, mode) != 0)
+    {
+        if (errno != EINTR)
+        {
+            fossil_shark_lock_release(&cache->lock);
+            return errno;
+        }
+    }
+    int rc = hashcache_map(cache);
+    if (rc != 0)
+    {
+        flock(cache->fd, LOCK_UN);
+        fossil_shark_lock_release(&cache->lock);
+    }
+    return rc;
+}
+
+static void hashcache_unlock(fossil_shark_hashcache_t *cache)
+{
+    flock(cache->fd, LOCK_UN);
+    fossil_shark_lock_release(&cache->lock);
+}
+
+/* ==========================================================================
+    * Keys
+    * ========================================================================== */
+
+static int64_t hashcache_now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static int hashcache_stat(ccstring path, hashcache_key_t *key)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return errno;
+    if (!S_ISREG(st.st_mode))
+        return EINVAL;
+    key->dev = (uint64_t)st.st_dev;
+    key->inode = (uint64_t)st.st_ino;
+    key->size = (uint64_t)st.st_size;
+#if defined(__APPLE__)
+    key->mtime_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000ll + st.st_mtimespec.tv_nsec;
+#else
+    key->mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+#endif
+    return 0;
+}
+
+static bool hashcache_get(fossil_shark_hashcache_t *cache, const hashcache_key_t *key, fossil_shark_hash128_t *out)
+{
+    if (hashcache_lock(cache, LOCK_SH) != 0)
+        return false;
+
+    bool hit = false;
+    const hashcache_slot_t *slot = hashcache_find(cache, key->dev, key->inode);
+    if (slot && slot->check != 0 && slot->check == hashcache_check(slot) &&
+        slot->size == key->size && slot->mtime_ns == key->mtime_ns)
+    {
+        out->low = slot->low;
+        out->high = slot->high;
+        hit = true;
+    }
+    hashcache_unlock(cache);
+    return hit;
+}
+
+static void hashcache_put(fossil_shark_hashcache_t *cache, const hashcache_key_t *key, fossil_shark_hash128_t digest)
+{
+    if (hashcache_lock(cache, LOCK_EX) != 0)
+        return;
+
+    int rc = 0;
+    if ((hashcache_header(cache)->used + 1) * 2 > cache->slots)
+        rc = hashcache_grow(cache);
+
+    hashcache_slot_t *slot = rc == 0 ? hashcache_find(cache, key->dev, key->inode) : cnull;
+    if (slot)
+    {
+        if (slot->check == 0)
+            hashcache_header(cache)->used++;
+        hashcache_slot_t entry = {key->dev, key->inode, key->size, key->mtime_ns, digest.low, digest.high, 0};
+        entry.check = hashcache_check(&entry);
+        *slot = entry;
+    }
+    hashcache_unlock(cache);
+}
+
+// Helper: the cache file named by SHARK_HASH_CACHE or the XDG cache directory
+static cstring hashcache_default_path(void)
+{
+    const char *env = getenv("SHARK_HASH_CACHE");
+    if (env)
+        return *env ? fossil_io_cstring_dup(env) : cnull;
+
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    cstring dir = cnull;
+    if (xdg && *xdg)
+        dir = fossil_io_cstring_format("%s/shark", xdg);
+    else if (home && *home)
+        dir = fossil_io_cstring_format("%s/.cache/shark", home);
+    if (!dir)
+        return cnull;
+
+    // Create the parent as well; ~/.cache may not exist yet on a fresh account
+    char *slash = strrchr(dir, '/');
+    *slash = '\0';
+    mkdir(dir, 0700);
+    *slash = '/';
+    mkdir(dir, 0700);
+
+    cstring path = fossil_io_cstring_format("%s/hashes", dir);
+    fossil_io_cstring_free(dir);
+    return path;
+}
+
+#endif
+
+/* ==========================================================================
+    * Public API
+    * ========================================================================== */
+
+int fossil_shark_hashcache_open(fossil_shark_hashcache_t **out, ccstring path)
+{
+    if (!out)
+        return EINVAL;
+    *out = cnull;
+#ifdef _WIN32
+    (void)path;
+    return ENOTSUP;
+#else
+    cstring owned = cnotnull(path) ? fossil_io_cstring_dup(path) : hashcache_default_path();
+    if (!owned)
+        return ENOTSUP;
+
+    fossil_shark_hashcache_t *cache = fossil_sys_memory_calloc(1, sizeof(fossil_shark_hashcache_t));
+    if (!cache)
+    {
+        fossil_io_cstring_free(owned);
+        return ENOMEM;
+    }
+    cache->fd = open(owned, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    fossil_io_cstring_free(owned);
+    if (cache->fd < 0)
+    {
+        int rc = errno;
+        fossil_sys_memory_free(cache);
+        return rc;
+    }
+    fossil_shark_lock_init(&cache->lock);
+
+    // A new, foreign or damaged file is reformatted; it only holds derived data
+    int rc = hashcache_lock(cache, LOCK_EX);
+    if (rc == 0)
+    {
+        if (memcmp(hashcache_header(cache)->magic, k_hashcache_magic, sizeof(k_hashcache_magic)) != 0)
+            rc = hashcache_format(cache, HASHCACHE_MIN_SLOTS);
+        hashcache_unlock(cache);
+    }
+    else
+    {
+        while (flock(cache->fd, LOCK_EX) != 0 && errno == EINTR)
+            ;
+        rc = hashcache_format(cache, HASHCACHE_MIN_SLOTS);
+        flock(cache->fd, LOCK_UN);
+    }
+
+    if (rc != 0)
+    {
+        fossil_shark_hashcache_close(cache);
+        return rc;
+    }
+    *out = cache;
+    return 0;
+#endif
+}
+
+bool fossil_shark_hashcache_lookup(fossil_shark_hashcache_t *cache, ccstring path, fossil_shark_hash128_t *out)
+{
+#ifdef _WIN32
+    (void)cache;
+    (void)path;
+    (void)out;
+    return false;
+#else
+    hashcache_key_t key;
+    if (!cache || !cnotnull(path) || !out || hashcache_stat(path, &key) != 0)
+        return false;
+    return hashcache_get(cache, &key, out);
+#endif
+}
+
+int fossil_shark_hashcache_file128(fossil_shark_hashcache_t *cache, ccstring path, fossil_shark_hash128_t *out)
+{
+#ifdef _WIN32
+    (void)cache;
+    return fossil_shark_hash_file128(path, out);
+#else
+    hashcache_key_t before;
+    if (!cache || !cnotnull(path) || !out || hashcache_stat(path, &before) != 0)
+        return fossil_shark_hash_file128(path, out);
+    if (hashcache_get(cache, &before, out))
+        return 0;
+
+    int rc = fossil_shark_hash_file128(path, out);
+    if (rc != 0)
+        return rc;
+
+    // Only remember a digest that belongs to one settled version of the file
+    hashcache_key_t after;
+    if (hashcache_stat(path, &after) == 0 && memcmp(&before, &after, sizeof(before)) == 0 &&
+        after.mtime_ns + HASHCACHE_RACY_NS < hashcache_now_ns())
+        hashcache_put(cache, &after, *out);
+    return 0;
+#endif
+}
+
+void fossil_shark_hashcache_close(fossil_shark_hashcache_t *cache)
+{
+    if (!cache)
+        return;
+#ifndef _WIN32
+    if (cache->map)
+        munmap(cache->map, cache->map_len);
+    close(cache->fd);
+    fossil_shark_lock_destroy(&cache->lock);
+#endif
+    fossil_sys_memory_free(cache);
+}
@@ -418,6 +418,9 @@ int fossil_shark_help(ccstring command, ccstring ask, bool show_examples, bool f
             fossil_io_printf("  {cyan,bold}--dry-run{normal}        Preview changes\n");
             fossil_io_printf("  {cyan,bold}--exclude <pattern>{normal} Exclude files\n");
             fossil_io_printf("  {cyan,bold}--include <pattern>{normal} Include files\n");
+            fossil_io_printf("  {cyan,bold}--bwlimit <rate>{normal}    Limit bandwidth (e.g. 512K, 10M, 1G)\n");
+            fossil_io_printf("  {cyan,bold}--iops-limit <n>{normal}    Limit I/O operations per second\n");
+            fossil_io_printf("  {cyan,bold}--idle{normal}              Run at idle I/O and CPU priority\n");
         }
         else if (fossil_io_cstring_equals(command, "remove") || fossil_io_cstring_equals(command, "delete"))
         {
@@ -433,6 +436,9 @@ int fossil_shark_help(ccstring command, ccstring ask, bool show_examples, bool f
             fossil_io_printf("  {cyan,bold}--larger-than <s>{normal}    Delete files larger than size\n");
             fossil_io_printf("  {cyan,bold}--empty-only{normal}         Delete empty dirs only\n");
             fossil_io_printf("  {cyan,bold}--log-file <path>{normal}    Write deletion log\n");
+            fossil_io_printf("  {cyan,bold}--bwlimit <rate>{normal}     Limit bandwidth (e.g. 512K, 10M, 1G)\n");
+            fossil_io_printf("  {cyan,bold}--iops-limit <n>{normal}     Limit I/O operations per second\n");
+            fossil_io_printf("  {cyan,bold}--idle{normal}               Run at idle I/O and CPU priority\n");
         }
         else if (fossil_io_cstring_equals(command, "rename"))
         {
@@ -496,6 +502,13 @@ int fossil_shark_help(ccstring command, ccstring ask, bool show_examples, bool f
             fossil_io_printf("  {cyan,bold}-r, --recursive{normal}  Include subdirs\n");
             fossil_io_printf("  {cyan,bold}-u, --update{normal}     Only newer\n");
             fossil_io_printf("  {cyan,bold}--delete{normal}         Remove extraneous files\n");
+            fossil_io_printf("  {cyan,bold}--compare <mode>{normal} Change detection: mtime-size/size/xxh3/sha256\n");
+            fossil_io_printf("  {cyan,bold}--checksum{normal}       Hash files even when size+mtime match\n");
+            fossil_io_printf("  {cyan,bold}--continuous{normal}     Keep watching and sync changes as they happen\n");
+            fossil_io_printf("  {cyan,bold}--durable{normal}        Flush synced files to disk once per pass\n");
+            fossil_io_printf("  {cyan,bold}--bwlimit <rate>{normal} Limit bandwidth (e.g. 512K, 10M, 1G)\n");
+            fossil_io_printf("  {cyan,bold}--iops-limit <n>{normal} Limit I/O operations per second\n");
+            fossil_io_printf("  {cyan,bold}--idle{normal}           Run at idle I/O and CPU priority\n");
         }
         else if (fossil_io_cstring_equals(command, "watch"))
         {
@@ -503,7 +516,15 @@ int fossil_shark_help(ccstring command, ccstring ask, bool show_examples, bool f
             fossil_io_printf("{blue,bold,underline}Options:{normal}\n");
             fossil_io_printf("  {cyan,bold}-r, --recursive{normal}      Include subdirs\n");
             fossil_io_printf("  {cyan,bold}-e, --events <list>{normal}  Event filter\n");
-            fossil_io_printf("  {cyan,bold}-t, --interval <n>{normal}   Poll interval\n");
+            fossil_io_printf("  {cyan,bold}-t, --interval <n>{normal}   Poll interval when no native notifications\n");
+            fossil_io_printf("  {cyan,bold}--poll{normal}               Poll tree snapshots instead of notifications (NFS/SMB)\n");
+            fossil_io_printf("  {cyan,bold}--debounce <ms>{normal}      Coalesce events per path until quiet for <ms>\n");
+            fossil_io_printf("  {cyan,bold}--batch{normal}              Print each coalesced window as one set\n");
+            fossil_io_printf("  {cyan,bold}--exec <cmd>{normal}         Run <cmd> once per batch, substituting the changed paths\n");
+            fossil_io_printf("  {cyan,bold}--jobs <n>{normal}           Maximum concurrent --exec runs (default 1)\n");
+            fossil_io_printf("  {cyan,bold}--restart{normal}            Cancel --exec runs still going when new changes arrive\n");
+            fossil_io_printf("  {cyan,bold}--media <text/jsonl>{normal} One JSON object per event with timestamp and inode\n");
+            fossil_io_printf("  {cyan,bold}--content{normal}            Report modify only when file contents changed\n");
         }
         else if (fossil_io_cstring_equals(command, "rewrite"))
         {
@@ -579,7 +600,11 @@ int fossil_shark_help(ccstring command, ccstring ask, bool show_examples, bool f
             fossil_io_printf("  {cyan,bold}-i, --interactive{normal} Confirm deletions\n");
             fossil_io_printf("  {cyan,bold}-d, --delete{normal}     Remove duplicates\n");
             fossil_io_printf("  {cyan,bold}-l, --link{normal}       Replace duplicates with links\n");
+            fossil_io_printf("  {cyan,bold}--verify{normal}         Confirm hash matches byte-for-byte\n");
             fossil_io_printf("  {cyan,bold}--media <text/fson/json>{normal}  Outputs as selected type text by default\n");
+            fossil_io_printf("  {cyan,bold}--bwlimit <rate>{normal} Limit bandwidth (e.g. 512K, 10M, 1G)\n");
+            fossil_io_printf("  {cyan,bold}--iops-limit <n>{normal} Limit I/O operations per second\n");
+            fossil_io_printf("  {cyan,bold}--idle{normal}           Run at idle I/O and CPU priority\n");
         }
         else if (fossil_io_cstring_equals(command, "link"))
         {
@@ -24,6 +24,11 @@
  */
 #include "fossil/code/introspect.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define FOSSIL_SHARK_INTROSPECT_SSE2 1
+#endif
+
 static ccstring get_mime_type(ccstring path)
 {
     ccstring ext = strrchr(path, '.');
@@ -239,6 +244,164 @@ static ccstring get_mime_type(ccstring path)
     return "application/octet-stream";
 }
 
+/* ---------------- COUNTING ---------------- */
+
+#define INTROSPECT_COUNT_BLOCK (1024 * 1024)
+
+/* Running line/word/byte totals; in_space carries across blocks */
+typedef struct {
+    uint64_t lines;
+    uint64_t words;
+    uint64_t bytes;
+    bool in_space;
+} introspect_count_t;
+
+static inline unsigned introspect_popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Whitespace as wc sees it in the C locale: space and \t \n \v \f \r */
+static inline bool introspect_is_space(uint8_t c) {
+    return c == ' ' || (uint8_t)(c - '\t') <= '\r' - '\t';
+}
+
+/* Printable non-space bytes; only these start a word, as in wc */
+static inline bool introspect_is_graph(uint8_t c) {
+    return (uint8_t)(c - '!') <= '~' - '!';
+}
+
+#if defined(FOSSIL_SHARK_INTROSPECT_SSE2)
+/*
+ * Bit masks of the newlines, whitespace and printable bytes in 64 bytes,
+ * one bit per byte, classified 16 bytes per compare.
+ */
+static inline void introspect_masks(const uint8_t *p, uint64_t *newline, uint64_t *space, uint64_t *graph) {
+    uint64_t n = 0, s = 0, g = 0;
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i ctl = _mm_set1_epi8('\r' - '\t');
+    const __m128i bang = _mm_set1_epi8('!');
+    const __m128i vis = _mm_set1_epi8('~' - '!');
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(p + 16 * i));
+        __m128i off = _mm_sub_epi8(v, tab);
+        __m128i is_sp = _mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(_mm_min_epu8(off, ctl), off));
+        off = _mm_sub_epi8(v, bang);
+        __m128i is_graph = _mm_cmpeq_epi8(_mm_min_epu8(off, vis), off);
+        n |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << (16 * i);
+        s |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_sp) << (16 * i);
+        g |= (uint64_t)(uint16_t)_mm_movemask_epi8(is_graph) << (16 * i);
+    }
+    *newline = n;
+    *space = s;
+    *graph = g;
+}
+#endif
+
+// Helper: byte-at-a-time word state machine; other bytes leave the state alone
+static bool introspect_count_tail(introspect_count_t *count, const uint8_t *p, size_t len, bool in_space) {
+    for (size_t i = 0; i < len; i++) {
+        count->lines += p[i] == '\n';
+        if (introspect_is_space(p[i])) {
+            in_space = true;
+        } else if (introspect_is_graph(p[i])) {
+            count->words += in_space;
+            in_space = false;
+        }
+    }
+    return in_space;
+}
+
+/*
+ * Count one buffer, 64 bytes at a time. In text every byte is either
+ * whitespace or printable, so a word starts at each printable byte whose
+ * predecessor is whitespace: the popcount of graph & (space << 1 | carry),
+ * with the carry taken from the last byte of the previous 64 or of the
+ * previous buffer. Chunks holding control or high bytes, which neither
+ * start nor end a word, go through the byte loop instead, as does
+ * everything on targets without SSE2.
+ */
+static void introspect_count_block(introspect_count_t *count, const uint8_t *p, size_t len) {
+    bool in_space = count->in_space;
+    size_t i = 0;
+
+    count->bytes += len;
+#if defined(FOSSIL_SHARK_INTROSPECT_SSE2)
+    for (; i + 64 <= len; i += 64) {
+        uint64_t newline, space, graph;
+        introspect_masks(p + i, &newline, &space, &graph);
+        if ((space | graph) != UINT64_MAX) {
+            in_space = introspect_count_tail(count, p + i, 64, in_space);
+            continue;
+        }
+        count->lines += introspect_popcount64(newline);
+        count->words += introspect_popcount64(graph & ((space << 1) | (uint64_t)in_space));
+        in_space = (space >> 63) != 0;
+    }
+#endif
+    count->in_space = introspect_count_tail(count, p + i, len - i, in_space);
+}
+
+/* Count a whole file in large blocks, in binary mode so bytes are exact */
+static int introspect_count_file(ccstring path, introspect_count_t *count) {
+    memset(count, 0, sizeof(*count));
+    count->in_space = true;
+
+    uint8_t *buffer = (uint8_t*)fossil_sys_memory_alloc(INTROSPECT_COUNT_BLOCK);
+    if (!cnotnull(buffer))
+        return ENOMEM;
+
+    fossil_io_filesys_file_t stream;
+    if (fossil_io_filesys_file_open(&stream, path, "rb") != 0) {
+        fossil_sys_memory_free(buffer);
+        return errno ? errno : EIO;
+    }
+
+    /* A short read is either EOF or a failure; errno tells them apart */
+    int rc = 0;
+    for (;;) {
+        errno = 0;
+        size_t n = fossil_io_filesys_file_read(&stream, buffer, 1, INTROSPECT_COUNT_BLOCK);
+        if (n > 0)
+            introspect_count_block(count, buffer, n);
+        if (n < INTROSPECT_COUNT_BLOCK) {
+            rc = errno;
+            break;
+        }
+    }
+
+    fossil_io_filesys_file_close(&stream);
+    fossil_sys_memory_free(buffer);
+    return rc;
+}
+
+int fossil_shark_introspect_count(
+    ccstring path,
+    uint64_t *lines,
+    uint64_t *words,
+    uint64_t *bytes
+) {
+    if (!cnotnull(path) || !cnotnull(lines) || !cnotnull(words) || !cnotnull(bytes))
+        return EINVAL;
+
+    introspect_count_t count;
+    int rc = introspect_count_file(path, &count);
+    if (rc != 0)
+        return rc;
+    *lines = count.lines;
+    *words = count.words;
+    *bytes = count.bytes;
+    return 0;
+}
+
 int fossil_shark_introspect(
     ccstring path,
     int show_head_lines,
@@ -260,17 +423,24 @@ int fossil_shark_introspect(
     if (fossil_io_filesys_stat(path, &fsobj) != 0)
         return errno;
 
+    introspect_count_t count = {0};
+    if (count_lines_words_bytes || count_lines_only) {
+        int rc = introspect_count_file(path, &count);
+        if (rc != 0)
+            return rc;
+    }
+    unsigned long long lines = count.lines, words = count.words, bytes = count.bytes;
+
     fossil_io_filesys_file_t file_stream;
     bool need_open =
         (show_head_lines > 0 || show_tail_lines > 0 ||
-         count_lines_words_bytes || count_lines_only ||
          cnotnull(find_pattern));
 
     if (need_open &&
         fossil_io_filesys_file_open(&file_stream, path, "r") != 0)
         return errno;
 
-    unsigned long lines = 0, words = 0, bytes = 0, pattern_matches = 0;
+    unsigned long pattern_matches = 0;
 
     char buffer[4096];
     cstring *tail_buffer = cnull;
@@ -299,27 +469,6 @@ int fossil_shark_introspect(
         buffer[sizeof(buffer) - 1] = '\0';
 
         char* line = buffer;
-        size_t len = strlen(line);
-
-        bytes += len;
-        lines++;
-
-        /* Word count */
-        if (count_lines_words_bytes) {
-            char* p = line;
-            bool in_word = false;
-
-            while (*p) {
-                if (isspace((unsigned char)*p)) {
-                    if (in_word) words++;
-                    in_word = false;
-                } else {
-                    in_word = true;
-                }
-                p++;
-            }
-            if (in_word) words++;
-        }
 
         /* Pattern matching */
         if (cnotnull(find_pattern) &&
@@ -372,11 +521,11 @@ int fossil_shark_introspect(
             fossil_io_printf("  \"size\": %lld,\n", (long long)fsobj.size);
 
         if (count_lines_only || count_lines_words_bytes)
-            fossil_io_printf("  \"lines\": %lu,\n", lines);
+            fossil_io_printf("  \"lines\": %llu,\n", lines);
 
         if (count_lines_words_bytes) {
-            fossil_io_printf("  \"words\": %lu,\n", words);
-            fossil_io_printf("  \"bytes\": %lu,\n", bytes);
+            fossil_io_printf("  \"words\": %llu,\n", words);
+            fossil_io_printf("  \"bytes\": %llu,\n", bytes);
         }
 
         if (show_time) {
@@ -404,11 +553,11 @@ int fossil_shark_introspect(
             fossil_io_printf("  size:i64=%lld\n", (long long)fsobj.size);
 
         if (count_lines_only || count_lines_words_bytes)
-            fossil_io_printf("  lines:u32=%lu\n", lines);
+            fossil_io_printf("  lines:u64=%llu\n", lines);
 
         if (count_lines_words_bytes) {
-            fossil_io_printf("  words:u32=%lu\n", words);
-            fossil_io_printf("  bytes:u32=%lu\n", bytes);
+            fossil_io_printf("  words:u64=%llu\n", words);
+            fossil_io_printf("  bytes:u64=%llu\n", bytes);
         }
 
         if (show_time) {
@@ -437,9 +586,9 @@ int fossil_shark_introspect(
                              (long long)fsobj.size);
 
         if (count_lines_only)
-            fossil_io_printf("{blue,bold}Lines: %lu{normal}\n", lines);
+            fossil_io_printf("{blue,bold}Lines: %llu{normal}\n", lines);
         else if (count_lines_words_bytes)
-            fossil_io_printf("{blue,bold}Lines: %lu Words: %lu Bytes: %lu{normal}\n",
+            fossil_io_printf("{blue,bold}Lines: %llu Words: %llu Bytes: %llu{normal}\n",
                              lines, words, bytes);
 
         if (show_time)
@@ -0,0 +1,390 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "fossil/code/jobs.h"
+
+#if !defined(_WIN32)
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+typedef struct
+{
+#if defined(_WIN32)
+    HANDLE process;
+#else
+    pid_t pid;
+#endif
+    cstring *paths; // kept so a cancelled run's paths carry into its replacement
+    size_t count;
+    bool cancelled;
+} jobs_run_t;
+
+struct fossil_shark_jobs
+{
+    cstring command;
+    size_t max_jobs;
+    bool restart;
+    bool quiet;      // stdout carries machine output; commands write to stderr
+    jobs_run_t *running;
+    size_t running_count;
+    cstring *queued; // paths of the single coalesced queued run
+    size_t queued_count;
+    size_t queued_capacity;
+    bool has_queued;
+};
+
+// Helper: append copies of paths to the queued run; the run is only marked
+// queued once every path is stored, so a failure never runs a partial batch
+static void jobs_queue_paths(fossil_shark_jobs_t *jobs, const char *const *paths, size_t count)
+{
+    if (jobs->queued_count + count > jobs->queued_capacity)
+    {
+        size_t cap = jobs->queued_capacity ? jobs->queued_capacity : 16;
+        while (cap < jobs->queued_count + count)
+            cap *= 2;
+        cstring *grown = fossil_sys_memory_realloc(jobs->queued, cap * sizeof(cstring));
+        if (!grown)
+            goto fail;
+        jobs->queued = grown;
+        jobs->queued_capacity = cap;
+    }
+    size_t base = jobs->queued_count;
+    for (size_t i = 0; i < count; ++i)
+    {
+        cstring dup = fossil_io_cstring_dup(paths[i]);
+        if (!dup)
+        {
+            while (jobs->queued_count > base)
+                fossil_io_cstring_free(jobs->queued[--jobs->queued_count]);
+            goto fail;
+        }
+        jobs->queued[jobs->queued_count++] = dup;
+    }
+    jobs->has_queued = true;
+    return;
+
+fail:
+    fossil_io_fprintf(FOSSIL_STDERR, "{red}Error: out of memory queueing command:{normal} %s\n", jobs->command);
+}
+
+static int jobs_compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(const cstring *)a, *(const cstring *)b);
+}
+
+// Helper: sort and drop repeats so merged batches name each path once
+static size_t jobs_unique_paths(cstring *paths, size_t count)
+{
+    if (count < 2)
+        return count;
+    qsort(paths, count, sizeof(cstring), jobs_compare_paths);
+    size_t out = 1;
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (strcmp(paths[i], paths[out - 1]) == 0)
+            fossil_io_cstring_free(paths[i]);
+        else
+            paths[out++] = paths[i];
+    }
+    return out;
+}
+
+static void jobs_free_paths(cstring *paths, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        fossil_io_cstring_free(paths[i]);
+    fossil_sys_memory_free(paths);
+}
+
+// Helper: append s to buf, growing it; false when out of memory
+static bool jobs_append(char **buf, size_t *len, size_t *cap, const char *s, size_t n)
+{
+    if (*len + n + 1 > *cap)
+    {
+        size_t grow = *cap ? *cap : 256;
+        while (grow < *len + n + 1)
+            grow *= 2;
+        char *next = fossil_sys_memory_realloc(*buf, grow);
+        if (!next)
+            return false;
+        *buf = next;
+        *cap = grow;
+    }
+    memcpy(*buf + *len, s, n);
+    *len += n;
+    (*buf)[*len] = '\0';
+    return true;
+}
+
+// Helper: quote one path so the shell passes it through as a single word
+static bool jobs_append_quoted(char **buf, size_t *len, size_t *cap, const char *path)
+{
+#if defined(_WIN32)
+    // Windows file names cannot contain a double quote
+    return jobs_append(buf, len, cap, "\"", 1) &&
+           jobs_append(buf, len, cap, path, strlen(path)) &&
+           jobs_append(buf, len, cap, "\"", 1);
+#else
+    if (!jobs_append(buf, len, cap, "'", 1))
+        return false;
+    for (const char *p = path; *p; ++p)
+    {
+        bool ok = *p == '\'' ? jobs_append(buf, len, cap, "'\\''", 4)
+                             : jobs_append(buf, len, cap, p, 1);
+        if (!ok)
+            return false;
+    }
+    return jobs_append(buf, len, cap, "'", 1);
+#endif
+}
+
+// Helper: expand every "{}" in the template to the quoted path list
+static char *jobs_expand(const char *command, cstring *paths, size_t count)
+{
+    char *buf = NULL;
+    size_t len = 0, cap = 0;
+    const char *p = command;
+    for (;;)
+    {
+        const char *mark = strstr(p, "{}");
+        size_t n = mark ? (size_t)(mark - p) : strlen(p);
+        if (!jobs_append(&buf, &len, &cap, p, n))
+            goto fail;
+        if (!mark)
+            break;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if ((i > 0 && !jobs_append(&buf, &len, &cap, " ", 1)) ||
+                !jobs_append_quoted(&buf, &len, &cap, paths[i]))
+                goto fail;
+        }
+        p = mark + 2;
+    }
+    return buf;
+
+fail:
+    fossil_sys_memory_free(buf);
+    return NULL;
+}
+
+/* ============================================================================
+ * Process control
+ * ============================================================================ */
+
+// Helper: launch the command line; false when the process could not start
+static bool jobs_spawn(jobs_run_t *run, const char *line, bool quiet)
+{
+#if defined(_WIN32)
+    cstring cmdline = fossil_io_cstring_format("cmd /c %s", line);
+    STARTUPINFOA si;
+    PROCESS_INFORMATION pi;
+    memset(&si, 0, sizeof(si));
+    si.cb = sizeof(si);
+    if (quiet)
+    {
+        si.dwFlags = STARTF_USESTDHANDLES;
+        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        si.hStdOutput = GetStdHandle(STD_ERROR_HANDLE);
+        si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    }
+    BOOL ok = CreateProcessA(NULL, cmdline, NULL, NULL, quiet ? TRUE : FALSE, CREATE_NEW_PROCESS_GROUP,
+                             NULL, NULL, &si, &pi);
+    fossil_io_cstring_free(cmdline);
+    if (!ok)
+        return false;
+    CloseHandle(pi.hThread);
+    run->process = pi.hProcess;
+    return true;
+#else
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+    {
+        // Own process group, so cancelling also stops what the shell started
+        setpgid(0, 0);
+        if (quiet)
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", line, (char *)NULL);
+        _exit(127);
+    }
+    setpgid(pid, pid);
+    run->pid = pid;
+    return true;
+#endif
+}
+
+static void jobs_cancel(jobs_run_t *run)
+{
+    run->cancelled = true;
+#if defined(_WIN32)
+    TerminateProcess(run->process, 1);
+#else
+    kill(-run->pid, SIGTERM);
+#endif
+}
+
+// Helper: collect a finished run without blocking unless wait is set
+static bool jobs_reap(jobs_run_t *run, bool wait, int *status)
+{
+#if defined(_WIN32)
+    if (WaitForSingleObject(run->process, wait ? INFINITE : 0) != WAIT_OBJECT_0)
+        return false;
+    DWORD code = 0;
+    GetExitCodeProcess(run->process, &code);
+    CloseHandle(run->process);
+    *status = (int)code;
+    return true;
+#else
+    int raw = 0;
+    pid_t done;
+    do
+        done = waitpid(run->pid, &raw, wait ? 0 : WNOHANG);
+    while (done < 0 && errno == EINTR);
+    if (done == 0)
+        return false;
+    *status = done < 0 ? 0 : WIFEXITED(raw) ? WEXITSTATUS(raw) : 128 + WTERMSIG(raw);
+    return true;
+#endif
+}
+
+// Start the queued run in a free slot
+static void jobs_start_queued(fossil_shark_jobs_t *jobs)
+{
+    jobs_run_t *run = &jobs->running[jobs->running_count];
+    memset(run, 0, sizeof(*run));
+    run->count = jobs_unique_paths(jobs->queued, jobs->queued_count);
+    run->paths = jobs->queued;
+    jobs->queued = NULL;
+    jobs->queued_count = 0;
+    jobs->queued_capacity = 0;
+    jobs->has_queued = false;
+
+    char *line = jobs_expand(jobs->command, run->paths, run->count);
+    if (line && jobs_spawn(run, line, jobs->quiet))
+    {
+        fossil_io_fprintf(FOSSIL_STDERR, "{cyan}exec:{normal} %s\n", line);
+        jobs->running_count++;
+    }
+    else
+    {
+        fossil_io_fprintf(FOSSIL_STDERR, "{red}Error: could not run command:{normal} %s\n", jobs->command);
+        jobs_free_paths(run->paths, run->count);
+    }
+    fossil_sys_memory_free(line);
+}
+
+int fossil_shark_jobs_create(fossil_shark_jobs_t **out, ccstring command, size_t max_jobs, bool restart,
+                             bool quiet)
+{
+    if (!out || !cnotnull(command))
+        return EINVAL;
+    *out = NULL;
+
+    fossil_shark_jobs_t *jobs = fossil_sys_memory_calloc(1, sizeof(*jobs));
+    if (!jobs)
+        return ENOMEM;
+    jobs->max_jobs = max_jobs ? max_jobs : 1;
+    jobs->restart = restart;
+    jobs->quiet = quiet;
+    jobs->command = fossil_io_cstring_dup(command);
+    jobs->running = fossil_sys_memory_calloc(jobs->max_jobs, sizeof(jobs_run_t));
+    if (!jobs->command || !jobs->running)
+    {
+        fossil_shark_jobs_free(jobs);
+        return ENOMEM;
+    }
+    *out = jobs;
+    return 0;
+}
+
+void fossil_shark_jobs_submit(fossil_shark_jobs_t *jobs, const char *const *paths, size_t count)
+{
+    if (!jobs || count == 0)
+        return;
+
+    if (jobs->restart)
+    {
+        // The runs in flight are working from stale input; replace them
+        for (size_t i = 0; i < jobs->running_count; ++i)
+        {
+            jobs_run_t *run = &jobs->running[i];
+            if (run->cancelled)
+                continue;
+            jobs_cancel(run);
+            jobs_queue_paths(jobs, (const char *const *)run->paths, run->count);
+        }
+    }
+
+    jobs_queue_paths(jobs, paths, count);
+    fossil_shark_jobs_poll(jobs);
+}
+
+bool fossil_shark_jobs_poll(fossil_shark_jobs_t *jobs)
+{
+    if (!jobs)
+        return false;
+
+    for (size_t i = 0; i < jobs->running_count;)
+    {
+        jobs_run_t *run = &jobs->running[i];
+        int status = 0;
+        if (!jobs_reap(run, false, &status))
+        {
+            ++i;
+            continue;
+        }
+        if (run->cancelled)
+            fossil_io_fprintf(FOSSIL_STDERR, "{yellow}exec:{normal} cancelled stale run\n");
+        else if (status != 0)
+            fossil_io_fprintf(FOSSIL_STDERR, "{red}exec: command exited with status %d{normal}\n", status);
+        jobs_free_paths(run->paths, run->count);
+        jobs->running[i] = jobs->running[--jobs->running_count];
+    }
+
+    if (jobs->has_queued && jobs->running_count < jobs->max_jobs)
+        jobs_start_queued(jobs);
+
+    return jobs->running_count > 0 || jobs->has_queued;
+}
+
+void fossil_shark_jobs_free(fossil_shark_jobs_t *jobs)
+{
+    if (!jobs)
+        return;
+    for (size_t i = 0; i < jobs->running_count; ++i)
+    {
+        int status = 0;
+        jobs_reap(&jobs->running[i], true, &status);
+        jobs_free_paths(jobs->running[i].paths, jobs->running[i].count);
+    }
+    jobs_free_paths(jobs->queued, jobs->queued_count);
+    fossil_sys_memory_free(jobs->running);
+    fossil_io_cstring_free(jobs->command);
+    fossil_sys_memory_free(jobs);
+}
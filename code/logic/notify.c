@@ -0,0 +1,347 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "fossil/code/notify.h"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <poll.h>
+
+#define NOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | \
+                     IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF)
+
+// An entry found while registering a new directory, reported as created
+typedef struct
+{
+    cstring path;
+    bool is_dir;
+} notify_pending_t;
+
+struct fossil_shark_notify_s
+{
+    int fd;
+    int root_wd;
+    bool recursive;
+    char **paths;        /* watch descriptor -> watched path */
+    size_t path_cap;
+    notify_pending_t *pending; /* synthetic CREATE events not yet returned */
+    size_t pending_count;
+    size_t pending_pos;
+    size_t pending_cap;
+    char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    size_t buffer_len;
+    size_t buffer_pos;
+};
+
+// Helper: remember which path a watch descriptor refers to
+static int notify_set_path(fossil_shark_notify_t *notify, int wd, ccstring path)
+{
+    if ((size_t)wd >= notify->path_cap)
+    {
+        size_t cap = notify->path_cap ? notify->path_cap : 64;
+        while (cap <= (size_t)wd)
+            cap *= 2;
+        char **paths = (char **)fossil_sys_memory_realloc(notify->paths, cap * sizeof(char *));
+        if (!cnotnull(paths))
+            return ENOMEM;
+        memset(paths + notify->path_cap, 0, (cap - notify->path_cap) * sizeof(char *));
+        notify->paths = paths;
+        notify->path_cap = cap;
+    }
+
+    if (cnotnull(notify->paths[wd]))
+        fossil_io_cstring_free(notify->paths[wd]);
+    notify->paths[wd] = fossil_io_cstring_dup(path);
+    return cnotnull(notify->paths[wd]) ? 0 : ENOMEM;
+}
+
+// Helper: queue a synthetic CREATE for an entry no kernel event will cover
+static void notify_queue(fossil_shark_notify_t *notify, ccstring path, bool is_dir)
+{
+    if (notify->pending_count == notify->pending_cap)
+    {
+        size_t cap = notify->pending_cap ? notify->pending_cap * 2 : 64;
+        notify_pending_t *grown = (notify_pending_t *)fossil_sys_memory_realloc(notify->pending, cap * sizeof(notify_pending_t));
+        if (!cnotnull(grown))
+            return;
+        notify->pending = grown;
+        notify->pending_cap = cap;
+    }
+    cstring copy = fossil_io_cstring_dup(path);
+    if (!cnotnull(copy))
+        return;
+    notify->pending[notify->pending_count].path = copy;
+    notify->pending[notify->pending_count].is_dir = is_dir;
+    notify->pending_count++;
+}
+
+/*
+ * Register a directory and, in recursive mode, everything below it. With
+ * report set the directory is new to us: it was moved in whole, or things
+ * were created in it before its watch existed, so every entry found is
+ * queued as created. A later kernel event for the same entry only repeats
+ * the CREATE, which is harmless; missing it is not.
+ */
+static int notify_add_tree(fossil_shark_notify_t *notify, ccstring path, bool recursive, bool report)
+{
+    int wd = inotify_add_watch(notify->fd, path, NOTIFY_MASK);
+    if (wd < 0)
+        return errno;
+
+    if (notify->root_wd < 0)
+        notify->root_wd = wd;
+
+    int rc = notify_set_path(notify, wd, path);
+    if (rc != 0 || !recursive)
+        return rc;
+
+    DIR *dir = opendir(path);
+    if (!cnotnull(dir))
+        return 0; /* plain file or vanished directory */
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != cnull)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        char child[FOSSIL_FILESYS_MAX_PATH];
+        if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= (int)sizeof(child))
+            continue;
+
+        bool is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            is_dir = lstat(child, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        if (report)
+            notify_queue(notify, child, is_dir);
+        // Subdirectories may disappear while we walk; that is not an error
+        if (is_dir)
+            notify_add_tree(notify, child, true, report);
+    }
+    closedir(dir);
+    return 0;
+}
+
+int fossil_shark_notify_open(fossil_shark_notify_t **out, ccstring path, bool recursive)
+{
+    if (!cnotnull(out) || !cnotnull(path))
+        return EINVAL;
+
+    fossil_shark_notify_t *notify = (fossil_shark_notify_t *)fossil_sys_memory_calloc(1, sizeof(*notify));
+    if (!cnotnull(notify))
+        return ENOMEM;
+
+    notify->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notify->fd < 0)
+    {
+        int err = errno;
+        fossil_sys_memory_free(notify);
+        return err;
+    }
+    notify->root_wd = -1;
+    notify->recursive = recursive;
+
+    int rc = notify_add_tree(notify, path, recursive, false);
+    if (rc != 0)
+    {
+        fossil_shark_notify_close(notify);
+        return rc;
+    }
+
+    *out = notify;
+    return 0;
+}
+
+// Helper: translate one raw inotify record; returns false if it is not reportable
+static bool notify_translate(fossil_shark_notify_t *notify, const struct inotify_event *raw,
+                             fossil_shark_notify_event_t *event)
+{
+    if (raw->mask & IN_Q_OVERFLOW)
+    {
+        event->kind = FOSSIL_SHARK_NOTIFY_OVERFLOW;
+        event->is_dir = true;
+        event->cookie = 0;
+        event->inode = 0;
+        event->path[0] = '\0';
+        return true;
+    }
+
+    if (raw->wd < 0 || (size_t)raw->wd >= notify->path_cap || !cnotnull(notify->paths[raw->wd]))
+        return false;
+
+    ccstring base = notify->paths[raw->wd];
+    if (raw->mask & IN_IGNORED)
+    {
+        fossil_io_cstring_free(notify->paths[raw->wd]);
+        notify->paths[raw->wd] = cnull;
+        return false;
+    }
+
+    // A subdirectory's own watch repeats what its parent already reported
+    if (raw->len == 0 && raw->wd != notify->root_wd)
+        return false;
+
+    if (raw->len > 0)
+        snprintf(event->path, sizeof(event->path), "%s/%s", base, raw->name);
+    else
+        snprintf(event->path, sizeof(event->path), "%s", base);
+
+    event->is_dir = (raw->mask & IN_ISDIR) != 0;
+    event->cookie = raw->cookie;
+    event->inode = 0; // inotify does not report it; see fossil_shark_snapshot_inode
+
+    if (raw->mask & (IN_CREATE | IN_MOVED_TO))
+    {
+        event->kind = FOSSIL_SHARK_NOTIFY_CREATE;
+        // Watch new subdirectories and report what they already hold
+        if (event->is_dir && notify->recursive)
+            notify_add_tree(notify, event->path, true, true);
+    }
+    else if (raw->mask & IN_MOVED_FROM)
+        event->kind = FOSSIL_SHARK_NOTIFY_RENAME;
+    else if (raw->mask & (IN_DELETE | IN_DELETE_SELF))
+        event->kind = FOSSIL_SHARK_NOTIFY_DELETE;
+    else
+        event->kind = FOSSIL_SHARK_NOTIFY_MODIFY;
+
+    return true;
+}
+
+int fossil_shark_notify_read(fossil_shark_notify_t *notify,
+                             fossil_shark_notify_event_t *events, size_t max,
+                             size_t *count, int timeout_ms)
+{
+    if (!cnotnull(notify) || !cnotnull(events) || !cnotnull(count))
+        return EINVAL;
+
+    *count = 0;
+    bool waited = false;
+
+    while (*count < max)
+    {
+        if (notify->pending_pos < notify->pending_count)
+        {
+            notify_pending_t *p = &notify->pending[notify->pending_pos++];
+            fossil_shark_notify_event_t *event = &events[(*count)++];
+            event->kind = FOSSIL_SHARK_NOTIFY_CREATE;
+            event->is_dir = p->is_dir;
+            event->cookie = 0;
+            event->inode = 0;
+            snprintf(event->path, sizeof(event->path), "%s", p->path);
+            fossil_io_cstring_free(p->path);
+            if (notify->pending_pos == notify->pending_count)
+                notify->pending_pos = notify->pending_count = 0;
+            continue;
+        }
+
+        if (notify->buffer_pos >= notify->buffer_len)
+        {
+            ssize_t n = read(notify->fd, notify->buffer, sizeof(notify->buffer));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno != EAGAIN)
+                return errno;
+            if (n <= 0)
+            {
+                // Only block when nothing has been collected yet
+                if (*count > 0 || waited || timeout_ms == 0)
+                    break;
+                struct pollfd pfd = {notify->fd, POLLIN, 0};
+                int rc = poll(&pfd, 1, timeout_ms);
+                if (rc < 0 && errno != EINTR)
+                    return errno;
+                waited = true;
+                continue;
+            }
+            notify->buffer_len = (size_t)n;
+            notify->buffer_pos = 0;
+        }
+
+        const struct inotify_event *raw = (const struct inotify_event *)(const void *)(notify->buffer + notify->buffer_pos);
+        notify->buffer_pos += sizeof(struct inotify_event) + raw->len;
+
+        if (notify_translate(notify, raw, &events[*count]))
+            (*count)++;
+    }
+
+    return 0;
+}
+
+void fossil_shark_notify_close(fossil_shark_notify_t *notify)
+{
+    if (!cnotnull(notify))
+        return;
+
+    for (size_t i = 0; i < notify->path_cap; ++i)
+    {
+        if (cnotnull(notify->paths[i]))
+            fossil_io_cstring_free(notify->paths[i]);
+    }
+    fossil_sys_memory_free(notify->paths);
+    for (size_t i = notify->pending_pos; i < notify->pending_count; ++i)
+        fossil_io_cstring_free(notify->pending[i].path);
+    fossil_sys_memory_free(notify->pending);
+    if (notify->fd >= 0)
+        close(notify->fd);
+    fossil_sys_memory_free(notify);
+}
+
+#else /* no native backend */
+
+int fossil_shark_notify_open(fossil_shark_notify_t **out, ccstring path, bool recursive)
+{
+    (void)path;
+    (void)recursive;
+    if (cnotnull(out))
+        *out = cnull;
+    return ENOSYS;
+}
+
+int fossil_shark_notify_read(fossil_shark_notify_t *notify,
+                             fossil_shark_notify_event_t *events, size_t max,
+                             size_t *count, int timeout_ms)
+{
+    (void)notify;
+    (void)events;
+    (void)max;
+    (void)timeout_ms;
+    if (cnotnull(count))
+        *count = 0;
+    return ENOSYS;
+}
+
+void fossil_shark_notify_close(fossil_shark_notify_t *notify)
+{
+    (void)notify;
+}
+
+#endif
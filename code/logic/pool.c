@@ -0,0 +1,221 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#include "fossil/code/pool.h"
+
+#define POOL_MAX_JOBS 256
+
+typedef struct
+{
+    void (*worker)(void *ctx);
+    void *ctx;
+} pool_start_t;
+
+#if defined(_WIN32)
+
+void fossil_shark_lock_init(fossil_shark_lock_t *lock)
+{
+    InitializeCriticalSection(&lock->mutex);
+    InitializeConditionVariable(&lock->cond);
+}
+
+void fossil_shark_lock_destroy(fossil_shark_lock_t *lock)
+{
+    DeleteCriticalSection(&lock->mutex);
+}
+
+void fossil_shark_lock_acquire(fossil_shark_lock_t *lock)
+{
+    EnterCriticalSection(&lock->mutex);
+}
+
+void fossil_shark_lock_release(fossil_shark_lock_t *lock)
+{
+    LeaveCriticalSection(&lock->mutex);
+}
+
+void fossil_shark_lock_wait(fossil_shark_lock_t *lock)
+{
+    SleepConditionVariableCS(&lock->cond, &lock->mutex, INFINITE);
+}
+
+void fossil_shark_lock_wake_all(fossil_shark_lock_t *lock)
+{
+    WakeAllConditionVariable(&lock->cond);
+}
+
+size_t fossil_shark_pool_default_jobs(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (size_t)info.dwNumberOfProcessors : 1;
+}
+
+static DWORD WINAPI pool_thread(LPVOID arg)
+{
+    pool_start_t *start = (pool_start_t *)arg;
+    start->worker(start->ctx);
+    return 0;
+}
+
+static DWORD WINAPI pool_single(LPVOID arg)
+{
+    fossil_shark_thread_t *thread = (fossil_shark_thread_t *)arg;
+    thread->run(thread->ctx);
+    return 0;
+}
+
+int fossil_shark_thread_start(fossil_shark_thread_t *thread, void (*run)(void *ctx), void *ctx)
+{
+    thread->run = run;
+    thread->ctx = ctx;
+    thread->handle = CreateThread(NULL, 0, pool_single, thread, 0, NULL);
+    return thread->handle ? 0 : (int)GetLastError();
+}
+
+void fossil_shark_thread_join(fossil_shark_thread_t *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+size_t fossil_shark_pool_run(size_t jobs, void (*worker)(void *ctx), void *ctx)
+{
+    if (jobs == 0)
+        jobs = fossil_shark_pool_default_jobs();
+    if (jobs > POOL_MAX_JOBS)
+        jobs = POOL_MAX_JOBS;
+
+    pool_start_t start = {worker, ctx};
+    HANDLE threads[POOL_MAX_JOBS];
+    size_t started = 0;
+    for (size_t i = 1; i < jobs; ++i)
+    {
+        HANDLE h = CreateThread(NULL, 0, pool_thread, &start, 0, NULL);
+        if (!h)
+            break;
+        threads[started++] = h;
+    }
+
+    worker(ctx);
+
+    for (size_t i = 0; i < started; ++i)
+    {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+    return started + 1;
+}
+
+#else /* POSIX */
+
+void fossil_shark_lock_init(fossil_shark_lock_t *lock)
+{
+    pthread_mutex_init(&lock->mutex, NULL);
+    pthread_cond_init(&lock->cond, NULL);
+}
+
+void fossil_shark_lock_destroy(fossil_shark_lock_t *lock)
+{
+    pthread_cond_destroy(&lock->cond);
+    pthread_mutex_destroy(&lock->mutex);
+}
+
+void fossil_shark_lock_acquire(fossil_shark_lock_t *lock)
+{
+    pthread_mutex_lock(&lock->mutex);
+}
+
+void fossil_shark_lock_release(fossil_shark_lock_t *lock)
+{
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+void fossil_shark_lock_wait(fossil_shark_lock_t *lock)
+{
+    pthread_cond_wait(&lock->cond, &lock->mutex);
+}
+
+void fossil_shark_lock_wake_all(fossil_shark_lock_t *lock)
+{
+    pthread_cond_broadcast(&lock->cond);
+}
+
+size_t fossil_shark_pool_default_jobs(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t)n : 1;
+}
+
+static void *pool_thread(void *arg)
+{
+    pool_start_t *start = (pool_start_t *)arg;
+    start->worker(start->ctx);
+    return NULL;
+}
+
+static void *pool_single(void *arg)
+{
+    fossil_shark_thread_t *thread = (fossil_shark_thread_t *)arg;
+    thread->run(thread->ctx);
+    return NULL;
+}
+
+int fossil_shark_thread_start(fossil_shark_thread_t *thread, void (*run)(void *ctx), void *ctx)
+{
+    thread->run = run;
+    thread->ctx = ctx;
+    return pthread_create(&thread->handle, NULL, pool_single, thread);
+}
+
+void fossil_shark_thread_join(fossil_shark_thread_t *thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+size_t fossil_shark_pool_run(size_t jobs, void (*worker)(void *ctx), void *ctx)
+{
+    if (jobs == 0)
+        jobs = fossil_shark_pool_default_jobs();
+    if (jobs > POOL_MAX_JOBS)
+        jobs = POOL_MAX_JOBS;
+
+    pool_start_t start = {worker, ctx};
+    pthread_t threads[POOL_MAX_JOBS];
+    size_t started = 0;
+    for (size_t i = 1; i < jobs; ++i)
+    {
+        if (pthread_create(&threads[started], NULL, pool_thread, &start) != 0)
+            break;
+        started++;
+    }
+
+    worker(ctx);
+
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+    return started + 1;
+}
+
+#endif
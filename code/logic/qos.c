@@ -0,0 +1,189 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "fossil/code/qos.h"
+#include <stdatomic.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/*
+ * The bucket is kept as a "theoretical arrival time" per resource: the
+ * moment at which everything reserved so far has been paid for. Reserving
+ * work pushes it forward by the cost of that work; a caller only sleeps when
+ * it would end up more than one burst ahead of the clock. A single CAS per
+ * call keeps it lock-free across worker threads.
+ */
+#define QOS_BURST_NS 100000000ull /* 100 ms of budget may be spent at once */
+#define QOS_NS_PER_SEC 1000000000.0
+
+#define QOS_IOPRIO_WHO_PROCESS 1
+#define QOS_IOPRIO_CLASS_IDLE 3
+#define QOS_IOPRIO_CLASS_SHIFT 13
+
+static _Atomic uint64_t qos_bytes_per_sec;
+static _Atomic uint64_t qos_ops_per_sec;
+static _Atomic uint64_t qos_byte_tat;
+static _Atomic uint64_t qos_op_tat;
+
+static uint64_t qos_now_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (uint64_t)((double)count.QuadPart * QOS_NS_PER_SEC / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void qos_sleep_ns(uint64_t ns)
+{
+#ifdef _WIN32
+    Sleep((DWORD)((ns + 999999) / 1000000));
+#else
+    struct timespec ts = {(time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull)};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+#endif
+}
+
+// Helper: reserve cost_ns on one bucket and return how long to wait for it
+static uint64_t qos_reserve(_Atomic uint64_t *tat, uint64_t cost_ns, uint64_t now)
+{
+    uint64_t current = atomic_load_explicit(tat, memory_order_relaxed);
+    uint64_t next;
+    do
+    {
+        uint64_t start = current > now ? current : now;
+        next = start + cost_ns;
+    } while (!atomic_compare_exchange_weak_explicit(tat, &current, next,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    return next > now + QOS_BURST_NS ? next - now - QOS_BURST_NS : 0;
+}
+
+static int qos_set_idle(void)
+{
+#if defined(_WIN32)
+    return SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN) ? 0 : (int)GetLastError();
+#else
+    int rc = 0;
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    if (syscall(SYS_ioprio_set, QOS_IOPRIO_WHO_PROCESS, 0,
+                QOS_IOPRIO_CLASS_IDLE << QOS_IOPRIO_CLASS_SHIFT) != 0)
+        rc = errno;
+#endif
+    if (setpriority(PRIO_PROCESS, 0, 19) != 0 && rc == 0)
+        rc = errno;
+    return rc;
+#endif
+}
+
+int fossil_shark_qos_parse_rate(ccstring text, uint64_t *out)
+{
+    if (!cnotnull(text) || !out)
+        return EINVAL;
+
+    char *end = NULL;
+    errno = 0;
+    double value = strtod(text, &end);
+    if (end == text || errno != 0 || value <= 0)
+        return EINVAL;
+
+    double scale = 1.0;
+    switch (*end)
+    {
+    case 'k': case 'K': scale = 1024.0; ++end; break;
+    case 'm': case 'M': scale = 1024.0 * 1024.0; ++end; break;
+    case 'g': case 'G': scale = 1024.0 * 1024.0 * 1024.0; ++end; break;
+    default: break;
+    }
+    if (*end == 'i')
+        ++end;
+    if (*end == 'b' || *end == 'B')
+        ++end;
+    if (strcmp(end, "/s") == 0)
+        end += 2;
+    if (*end != '\0')
+        return EINVAL;
+
+    *out = (uint64_t)(value * scale);
+    return *out ? 0 : EINVAL;
+}
+
+int fossil_shark_qos_configure(uint64_t bytes_per_sec, uint64_t ops_per_sec, bool idle)
+{
+    uint64_t now = qos_now_ns();
+    atomic_store(&qos_byte_tat, now);
+    atomic_store(&qos_op_tat, now);
+    atomic_store(&qos_bytes_per_sec, bytes_per_sec);
+    atomic_store(&qos_ops_per_sec, ops_per_sec);
+
+    return idle ? qos_set_idle() : 0;
+}
+
+bool fossil_shark_qos_active(void)
+{
+    return atomic_load_explicit(&qos_bytes_per_sec, memory_order_relaxed) != 0 ||
+           atomic_load_explicit(&qos_ops_per_sec, memory_order_relaxed) != 0;
+}
+
+void fossil_shark_qos_throttle(size_t bytes, unsigned ops)
+{
+    uint64_t byte_rate = atomic_load_explicit(&qos_bytes_per_sec, memory_order_relaxed);
+    uint64_t op_rate = atomic_load_explicit(&qos_ops_per_sec, memory_order_relaxed);
+    if (!byte_rate && !op_rate)
+        return;
+
+    uint64_t now = qos_now_ns();
+    uint64_t wait = 0;
+
+    if (byte_rate && bytes)
+    {
+        uint64_t cost = (uint64_t)((double)bytes * QOS_NS_PER_SEC / (double)byte_rate);
+        wait = qos_reserve(&qos_byte_tat, cost, now);
+    }
+    if (op_rate && ops)
+    {
+        uint64_t cost = (uint64_t)((double)ops * QOS_NS_PER_SEC / (double)op_rate);
+        uint64_t op_wait = qos_reserve(&qos_op_tat, cost, now);
+        if (op_wait > wait)
+            wait = op_wait;
+    }
+
+    if (wait)
+        qos_sleep_ns(wait);
+}
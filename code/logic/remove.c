@@ -23,6 +23,9 @@
  * -----------------------------------------------------------------------------
  */
 #include "fossil/code/remove.h"
+#include "fossil/code/qos.h"
+
+#define WIPE_CHUNK_SIZE (64 * 1024)
 
 // Helper: ask user for confirmation
 static bool confirm_removal(ccstring path)
@@ -81,7 +84,9 @@ static int wipe_file(ccstring path, int passes)
     size = fossil_io_filesys_file_tell(&f);
     fossil_io_filesys_file_seek(&f, 0, SEEK_SET);
 
-    unsigned char *buffer = (unsigned char *)fossil_sys_memory_alloc((size_t)size);
+    // Overwrite in fixed chunks so huge files neither need a file-sized
+    // buffer nor bypass the I/O budget in one giant write
+    unsigned char *buffer = (unsigned char *)fossil_sys_memory_alloc(WIPE_CHUNK_SIZE);
     if (buffer == cnull)
     {
         fossil_io_filesys_file_close(&f);
@@ -90,9 +95,15 @@ static int wipe_file(ccstring path, int passes)
 
     for (int i = 0; i < passes; i++)
     {
-        memset(buffer, (i % 256), (size_t)size);
+        memset(buffer, (i % 256), WIPE_CHUNK_SIZE);
         fossil_io_filesys_file_seek(&f, 0, SEEK_SET);
-        fossil_io_filesys_file_write(&f, buffer, 1, (size_t)size);
+        for (int64_t done = 0; done < size;)
+        {
+            size_t chunk = (size_t)(size - done < WIPE_CHUNK_SIZE ? size - done : WIPE_CHUNK_SIZE);
+            fossil_shark_qos_throttle(chunk, 1);
+            fossil_io_filesys_file_write(&f, buffer, 1, chunk);
+            done += (int64_t)chunk;
+        }
         fossil_io_filesys_file_flush(&f);
     }
 
@@ -0,0 +1,181 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#include "fossil/code/ring.h"
+#include "fossil/code/pool.h"
+#include <stdatomic.h>
+
+#define RING_CACHE_LINE 64
+
+/*
+ * Records are stored as a 32-bit length followed by the bytes, wrapping
+ * at the end of the buffer. head and tail only ever grow; their difference
+ * is the fill level. Each lives on its own cache line so the two threads
+ * do not bounce a shared line on every record.
+ */
+struct fossil_shark_ring
+{
+    uint8_t *data;
+    size_t mask;
+    _Alignas(RING_CACHE_LINE) _Atomic size_t head; // written by the producer
+    _Alignas(RING_CACHE_LINE) _Atomic size_t tail; // written by the consumer
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t dropped;
+    _Atomic bool waiting; // consumer is asleep, or about to be
+    _Atomic bool closed;
+    fossil_shark_lock_t lock;
+};
+
+// Helper: copy into the ring at a position, wrapping at the end
+static void ring_write_at(fossil_shark_ring_t *ring, size_t pos, const void *src, size_t len)
+{
+    size_t off = pos & ring->mask;
+    size_t first = ring->mask + 1 - off;
+    if (first > len)
+        first = len;
+    memcpy(ring->data + off, src, first);
+    memcpy(ring->data, (const uint8_t *)src + first, len - first);
+}
+
+static void ring_read_at(const fossil_shark_ring_t *ring, size_t pos, void *dst, size_t len)
+{
+    size_t off = pos & ring->mask;
+    size_t first = ring->mask + 1 - off;
+    if (first > len)
+        first = len;
+    memcpy(dst, ring->data + off, first);
+    memcpy((uint8_t *)dst + first, ring->data, len - first);
+}
+
+int fossil_shark_ring_create(fossil_shark_ring_t **out, size_t capacity)
+{
+    if (!out || capacity < 64)
+        return EINVAL;
+    *out = cnull;
+
+    size_t size = 64;
+    while (size < capacity)
+        size <<= 1;
+
+    fossil_shark_ring_t *ring = fossil_sys_memory_calloc(1, sizeof(*ring));
+    if (!ring)
+        return ENOMEM;
+    ring->data = fossil_sys_memory_alloc(size);
+    if (!ring->data)
+    {
+        fossil_sys_memory_free(ring);
+        return ENOMEM;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->waiting, false);
+    atomic_init(&ring->closed, false);
+    fossil_shark_lock_init(&ring->lock);
+    *out = ring;
+    return 0;
+}
+
+bool fossil_shark_ring_push(fossil_shark_ring_t *ring, const void *record, size_t len)
+{
+    uint32_t n = (uint32_t)len;
+    size_t need = sizeof(n) + len;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (len > UINT32_MAX || need > ring->mask + 1 - (head - tail))
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    ring_write_at(ring, head, &n, sizeof(n));
+    ring_write_at(ring, head + sizeof(n), record, len);
+
+    // Publish, then check for a sleeper; pairs with the order in ring_wait
+    atomic_store(&ring->head, head + need);
+    if (atomic_load(&ring->waiting))
+    {
+        fossil_shark_lock_acquire(&ring->lock);
+        fossil_shark_lock_wake_all(&ring->lock);
+        fossil_shark_lock_release(&ring->lock);
+    }
+    return true;
+}
+
+size_t fossil_shark_ring_pop(fossil_shark_ring_t *ring, void *buffer, size_t cap)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head)
+        return 0;
+
+    uint32_t n = 0;
+    ring_read_at(ring, tail, &n, sizeof(n));
+    if (n <= cap)
+        ring_read_at(ring, tail + sizeof(n), buffer, n);
+    else
+        n = 0; // caller's buffer is too small; skip rather than wedge the ring
+    atomic_store_explicit(&ring->tail, tail + sizeof(uint32_t) + n, memory_order_release);
+    return n;
+}
+
+bool fossil_shark_ring_wait(fossil_shark_ring_t *ring)
+{
+    fossil_shark_lock_acquire(&ring->lock);
+    atomic_store(&ring->waiting, true);
+    for (;;)
+    {
+        // Re-check after announcing the wait so a concurrent push is never missed
+        if (atomic_load(&ring->head) != atomic_load_explicit(&ring->tail, memory_order_relaxed))
+            break;
+        if (atomic_load(&ring->closed))
+            break;
+        fossil_shark_lock_wait(&ring->lock);
+    }
+    atomic_store(&ring->waiting, false);
+    fossil_shark_lock_release(&ring->lock);
+    return atomic_load(&ring->head) != atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
+
+void fossil_shark_ring_close(fossil_shark_ring_t *ring)
+{
+    fossil_shark_lock_acquire(&ring->lock);
+    atomic_store(&ring->closed, true);
+    fossil_shark_lock_wake_all(&ring->lock);
+    fossil_shark_lock_release(&ring->lock);
+}
+
+uint64_t fossil_shark_ring_dropped(const fossil_shark_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
+
+void fossil_shark_ring_free(fossil_shark_ring_t *ring)
+{
+    if (!ring)
+        return;
+    fossil_shark_lock_destroy(&ring->lock);
+    fossil_sys_memory_free(ring->data);
+    fossil_sys_memory_free(ring);
+}
@@ -0,0 +1,785 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "fossil/code/snapshot.h"
+#include "fossil/code/hash.h"
+#include "fossil/code/pool.h"
+#include <stdatomic.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+#define SNAPSHOT_MIN_JOBS 4
+#define SNAPSHOT_MAX_JOBS 16
+#define SNAPSHOT_RACY_NS 1000000000ll /* mtimes this close to a scan are not trusted */
+
+typedef struct
+{
+    uint64_t hash;        // hash of the path, used by the lookup table
+    uint64_t dev;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+    size_t path;          // offset of the NUL-terminated path in the arena
+    size_t first_child;   // children of a directory are stored contiguously
+    size_t child_count;
+    bool is_dir;
+    bool listed;          // the child block is complete and may be reused
+    bool gone;            // removed by fossil_shark_snapshot_apply()
+    bool has_content;     // content holds a hash of the bytes at this size and mtime
+    uint64_t content;
+} snapshot_entry_t;
+
+struct fossil_shark_snapshot_s
+{
+    snapshot_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    char *arena;
+    size_t arena_len;
+    size_t arena_cap;
+    size_t *table;        // slot holds entry index + 1, 0 means empty
+    size_t table_mask;
+    size_t live;
+    size_t scanned;       // entries below this index came from the scan; later ones were applied
+    int64_t taken_ns;     // wall clock when the scan started
+    bool recursive;
+    bool fingerprinted;   // some entries carry content hashes worth passing on
+};
+
+typedef struct
+{
+    uint64_t dev;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+    bool is_dir;
+} snapshot_stat_t;
+
+/* ==========================================================================
+    * Platform helpers
+    * ========================================================================== */
+
+static int64_t snapshot_now_ns(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static int snapshot_stat(ccstring path, snapshot_stat_t *out)
+{
+#ifdef _WIN32
+    fossil_io_filesys_obj_t obj;
+    if (fossil_io_filesys_stat(path, &obj) != 0)
+        return errno ? errno : ENOENT;
+    out->dev = 0;
+    out->inode = 0;
+    out->size = obj.size;
+    out->mtime_ns = (int64_t)obj.modified_at * 1000000000ll;
+    out->is_dir = obj.type == FOSSIL_FILESYS_TYPE_DIR;
+#else
+    struct stat st;
+    if (lstat(path, &st) != 0)
+        return errno;
+    out->dev = (uint64_t)st.st_dev;
+    out->inode = (uint64_t)st.st_ino;
+    out->size = (uint64_t)st.st_size;
+#if defined(__APPLE__)
+    out->mtime_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000ll + st.st_mtimespec.tv_nsec;
+#else
+    out->mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+#endif
+    out->is_dir = S_ISDIR(st.st_mode);
+#endif
+    return 0;
+}
+
+/* ==========================================================================
+    * Storage
+    * ========================================================================== */
+
+static int snapshot_reserve(fossil_shark_snapshot_t *snap, size_t entries, size_t bytes)
+{
+    if (snap->count + entries > snap->capacity)
+    {
+        size_t capacity = snap->capacity ? snap->capacity : 256;
+        while (capacity < snap->count + entries)
+            capacity *= 2;
+        snapshot_entry_t *grown = fossil_sys_memory_realloc(snap->entries, capacity * sizeof(snapshot_entry_t));
+        if (!grown)
+            return ENOMEM;
+        snap->entries = grown;
+        snap->capacity = capacity;
+    }
+    if (snap->arena_len + bytes > snap->arena_cap)
+    {
+        size_t capacity = snap->arena_cap ? snap->arena_cap : 16384;
+        while (capacity < snap->arena_len + bytes)
+            capacity *= 2;
+        char *grown = fossil_sys_memory_realloc(snap->arena, capacity);
+        if (!grown)
+            return ENOMEM;
+        snap->arena = grown;
+        snap->arena_cap = capacity;
+    }
+    return 0;
+}
+
+// Helper: append one entry, copying its path into the arena
+static int snapshot_append(fossil_shark_snapshot_t *snap, ccstring path, const snapshot_stat_t *st)
+{
+    size_t len = strlen(path) + 1;
+    if (snapshot_reserve(snap, 1, len) != 0)
+        return ENOMEM;
+
+    snapshot_entry_t *e = &snap->entries[snap->count++];
+    memset(e, 0, sizeof(*e));
+    e->hash = fossil_shark_hash64(path, len - 1);
+    e->dev = st->dev;
+    e->inode = st->inode;
+    e->size = st->size;
+    e->mtime_ns = st->mtime_ns;
+    e->is_dir = st->is_dir;
+    e->path = snap->arena_len;
+    memcpy(snap->arena + snap->arena_len, path, len);
+    snap->arena_len += len;
+    snap->live++;
+    return 0;
+}
+
+static void snapshot_table_insert(fossil_shark_snapshot_t *snap, size_t index)
+{
+    size_t slot = (size_t)snap->entries[index].hash & snap->table_mask;
+    while (snap->table[slot])
+        slot = (slot + 1) & snap->table_mask;
+    snap->table[slot] = index + 1;
+}
+
+// Helper: (re)build the path lookup table at no more than half load
+static int snapshot_table_build(fossil_shark_snapshot_t *snap)
+{
+    size_t size = 64;
+    while (size < snap->count * 2)
+        size *= 2;
+
+    size_t *table = fossil_sys_memory_calloc(size, sizeof(size_t));
+    if (!table)
+        return ENOMEM;
+    if (snap->table)
+        fossil_sys_memory_free(snap->table);
+    snap->table = table;
+    snap->table_mask = size - 1;
+
+    for (size_t i = 0; i < snap->count; ++i)
+        snapshot_table_insert(snap, i);
+    return 0;
+}
+
+static snapshot_entry_t *snapshot_find(const fossil_shark_snapshot_t *snap, ccstring path)
+{
+    if (!snap || !snap->table)
+        return cnull;
+
+    uint64_t hash = fossil_shark_hash64(path, strlen(path));
+    for (size_t slot = (size_t)hash & snap->table_mask; snap->table[slot]; slot = (slot + 1) & snap->table_mask)
+    {
+        snapshot_entry_t *e = &snap->entries[snap->table[slot] - 1];
+        if (e->hash == hash && strcmp(snap->arena + e->path, path) == 0)
+            return e;
+    }
+    return cnull;
+}
+
+/* ==========================================================================
+    * Parallel scan
+    * ========================================================================== */
+
+typedef struct
+{
+    fossil_shark_snapshot_t *snap;
+    const fossil_shark_snapshot_t *prev;
+    fossil_shark_lock_t lock;
+    size_t *queue;        // directories waiting to be listed
+    size_t queue_len;
+    size_t queue_cap;
+    size_t active;        // workers currently listing a directory
+    int error;
+} snapshot_scan_t;
+
+// Helper: stat one child and add it to the worker's private batch
+static void snapshot_add_child(fossil_shark_snapshot_t *batch, ccstring dir, ccstring name)
+{
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    int n = snprintf(path, sizeof(path), "%s/%s", strcmp(dir, "/") == 0 ? "" : dir, name);
+    if (n < 0 || (size_t)n >= sizeof(path))
+        return;
+
+    snapshot_stat_t st;
+    if (snapshot_stat(path, &st) != 0)
+        return; // vanished while scanning
+    snapshot_append(batch, path, &st);
+}
+
+static void snapshot_list_dir(snapshot_scan_t *scan, ccstring dir, const snapshot_entry_t *self,
+                              fossil_shark_snapshot_t *batch)
+{
+    // Unchanged directory: its names are already known, only re-stat them
+    const fossil_shark_snapshot_t *prev = scan->prev;
+    const snapshot_entry_t *old = snapshot_find(prev, dir);
+    if (old && old->is_dir && old->listed && !old->gone &&
+        old->dev == self->dev && old->inode == self->inode &&
+        old->mtime_ns == self->mtime_ns && self->mtime_ns + SNAPSHOT_RACY_NS < prev->taken_ns)
+    {
+        size_t skip = strcmp(dir, "/") == 0 ? 1 : strlen(dir) + 1;
+        for (size_t i = 0; i < old->child_count; ++i)
+        {
+            const snapshot_entry_t *child = &prev->entries[old->first_child + i];
+            if (!child->gone)
+                snapshot_add_child(batch, dir, prev->arena + child->path + skip);
+        }
+        return;
+    }
+
+#ifdef _WIN32
+    fossil_io_filesys_obj_t entries[1024];
+    size_t count = 0;
+    if (fossil_io_filesys_dir_list(dir, entries, 1024, &count) != 0)
+        return;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ccstring name = fossil_io_filesys_basename(entries[i].path);
+        if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0)
+            snapshot_add_child(batch, dir, name);
+    }
+#else
+    DIR *d = opendir(dir);
+    if (!d)
+        return;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != cnull)
+    {
+        if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0)
+            snapshot_add_child(batch, dir, ent->d_name);
+    }
+    closedir(d);
+#endif
+}
+
+// Helper: move a worker's batch into the snapshot as the children of dir
+static int snapshot_merge(snapshot_scan_t *scan, size_t dir, const fossil_shark_snapshot_t *batch)
+{
+    fossil_shark_snapshot_t *snap = scan->snap;
+    if (snapshot_reserve(snap, batch->count, batch->arena_len) != 0)
+        return ENOMEM;
+
+    size_t first = snap->count;
+    size_t base = snap->arena_len;
+    if (batch->arena_len > 0) // an empty directory's batch has no arena
+        memcpy(snap->arena + base, batch->arena, batch->arena_len);
+    snap->arena_len += batch->arena_len;
+
+    for (size_t i = 0; i < batch->count; ++i)
+    {
+        snapshot_entry_t *e = &snap->entries[snap->count++];
+        *e = batch->entries[i];
+        e->path += base;
+        snap->live++;
+
+        if (e->is_dir && snap->recursive)
+        {
+            if (scan->queue_len == scan->queue_cap)
+            {
+                size_t capacity = scan->queue_cap ? scan->queue_cap * 2 : 64;
+                size_t *grown = fossil_sys_memory_realloc(scan->queue, capacity * sizeof(size_t));
+                if (!grown)
+                    return ENOMEM;
+                scan->queue = grown;
+                scan->queue_cap = capacity;
+            }
+            scan->queue[scan->queue_len++] = first + i;
+        }
+    }
+
+    snap->entries[dir].first_child = first;
+    snap->entries[dir].child_count = batch->count;
+    snap->entries[dir].listed = true;
+    return 0;
+}
+
+static void snapshot_worker(void *arg)
+{
+    snapshot_scan_t *scan = (snapshot_scan_t *)arg;
+    fossil_shark_snapshot_t batch = {0};
+    char dir[FOSSIL_FILESYS_MAX_PATH];
+
+    fossil_shark_lock_acquire(&scan->lock);
+    for (;;)
+    {
+        while (scan->queue_len == 0 && scan->active > 0)
+            fossil_shark_lock_wait(&scan->lock);
+        if (scan->queue_len == 0)
+            break;
+
+        size_t index = scan->queue[--scan->queue_len];
+        snapshot_entry_t self = scan->snap->entries[index];
+        snprintf(dir, sizeof(dir), "%s", scan->snap->arena + self.path);
+        scan->active++;
+        fossil_shark_lock_release(&scan->lock);
+
+        batch.count = 0;
+        batch.arena_len = 0;
+        snapshot_list_dir(scan, dir, &self, &batch);
+
+        fossil_shark_lock_acquire(&scan->lock);
+        if (snapshot_merge(scan, index, &batch) != 0)
+            scan->error = ENOMEM;
+        scan->active--;
+        fossil_shark_lock_wake_all(&scan->lock);
+    }
+    fossil_shark_lock_wake_all(&scan->lock);
+    fossil_shark_lock_release(&scan->lock);
+
+    if (batch.entries)
+        fossil_sys_memory_free(batch.entries);
+    if (batch.arena)
+        fossil_sys_memory_free(batch.arena);
+}
+
+/*
+ * Reuse content hashes from the previous scan for files whose identity,
+ * size and mtime are unchanged. An mtime inside the racy window of that
+ * scan could hide a second write in the same tick, so those are hashed
+ * again instead.
+ */
+static void snapshot_carry_content(fossil_shark_snapshot_t *snap, const fossil_shark_snapshot_t *prev)
+{
+    for (size_t i = 0; i < snap->count; ++i)
+    {
+        snapshot_entry_t *e = &snap->entries[i];
+        if (e->is_dir)
+            continue;
+        const snapshot_entry_t *old = snapshot_find(prev, snap->arena + e->path);
+        if (old && old->has_content && !old->gone && old->dev == e->dev && old->inode == e->inode &&
+            old->size == e->size && old->mtime_ns == e->mtime_ns &&
+            old->mtime_ns < prev->taken_ns - SNAPSHOT_RACY_NS)
+        {
+            e->content = old->content;
+            e->has_content = true;
+        }
+    }
+    snap->fingerprinted = true;
+}
+
+int fossil_shark_snapshot_take(fossil_shark_snapshot_t **out, ccstring root, bool recursive,
+                               const fossil_shark_snapshot_t *prev, size_t jobs)
+{
+    if (!cnotnull(out) || !cnotnull(root))
+        return EINVAL;
+    *out = cnull;
+
+    char path[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(path, sizeof(path), "%s", root);
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/')
+        path[--len] = '\0';
+
+    snapshot_stat_t st;
+    int rc = snapshot_stat(path, &st);
+    if (rc != 0)
+        return rc;
+
+    fossil_shark_snapshot_t *snap = fossil_sys_memory_calloc(1, sizeof(*snap));
+    if (!snap)
+        return ENOMEM;
+    snap->recursive = recursive;
+    snap->taken_ns = snapshot_now_ns();
+
+    rc = snapshot_append(snap, path, &st);
+    if (rc == 0 && st.is_dir)
+    {
+        if (jobs == 0)
+        {
+            // Scans are bound by stat latency (network round trips), not CPU
+            jobs = fossil_shark_pool_default_jobs();
+            if (jobs < SNAPSHOT_MIN_JOBS)
+                jobs = SNAPSHOT_MIN_JOBS;
+            if (jobs > SNAPSHOT_MAX_JOBS)
+                jobs = SNAPSHOT_MAX_JOBS;
+        }
+
+        snapshot_scan_t scan = {0};
+        scan.snap = snap;
+        scan.prev = prev;
+        scan.queue = fossil_sys_memory_alloc(64 * sizeof(size_t));
+        if (!scan.queue)
+        {
+            rc = ENOMEM;
+        }
+        else
+        {
+            scan.queue_cap = 64;
+            scan.queue[scan.queue_len++] = 0;
+            fossil_shark_lock_init(&scan.lock);
+            fossil_shark_pool_run(jobs, snapshot_worker, &scan);
+            fossil_shark_lock_destroy(&scan.lock);
+            fossil_sys_memory_free(scan.queue);
+            rc = scan.error;
+        }
+    }
+
+    if (rc == 0)
+        rc = snapshot_table_build(snap);
+    if (rc != 0)
+    {
+        fossil_shark_snapshot_free(snap);
+        return rc;
+    }
+
+    if (prev && prev->fingerprinted)
+        snapshot_carry_content(snap, prev);
+
+    snap->scanned = snap->count;
+    *out = snap;
+    return 0;
+}
+
+/* ==========================================================================
+    * Content fingerprints
+    * ========================================================================== */
+
+typedef struct
+{
+    fossil_shark_snapshot_t *snap;
+    _Atomic size_t next;
+} snapshot_hash_t;
+
+static void snapshot_hash_worker(void *arg)
+{
+    snapshot_hash_t *work = (snapshot_hash_t *)arg;
+    fossil_shark_snapshot_t *snap = work->snap;
+    for (;;)
+    {
+        size_t i = atomic_fetch_add(&work->next, 1);
+        if (i >= snap->count)
+            break;
+        snapshot_entry_t *e = &snap->entries[i];
+        if (e->is_dir || e->gone || e->has_content)
+            continue;
+        uint64_t content = 0;
+        if (fossil_shark_hash_file64(snap->arena + e->path, &content) == 0)
+        {
+            e->content = content;
+            e->has_content = true;
+        }
+    }
+}
+
+int fossil_shark_snapshot_fingerprint(fossil_shark_snapshot_t *snap, size_t jobs)
+{
+    if (!snap)
+        return EINVAL;
+    snapshot_hash_t work;
+    work.snap = snap;
+    atomic_init(&work.next, 0);
+    fossil_shark_pool_run(jobs, snapshot_hash_worker, &work);
+    snap->fingerprinted = true;
+    return 0;
+}
+
+bool fossil_shark_snapshot_lookup(const fossil_shark_snapshot_t *snap, ccstring path,
+                                  fossil_shark_snapshot_info_t *out)
+{
+    const snapshot_entry_t *e = path ? snapshot_find(snap, path) : cnull;
+    if (!e || e->gone || !out)
+        return false;
+    out->inode = e->inode;
+    out->size = e->size;
+    out->mtime_ns = e->mtime_ns;
+    out->is_dir = e->is_dir;
+    out->has_content = e->has_content;
+    out->content = e->content;
+    return true;
+}
+
+void fossil_shark_snapshot_set_content(fossil_shark_snapshot_t *snap, ccstring path, uint64_t content)
+{
+    snapshot_entry_t *e = path ? snapshot_find(snap, path) : cnull;
+    if (!e || e->gone || e->is_dir)
+        return;
+    e->content = content;
+    e->has_content = true;
+    snap->fingerprinted = true;
+}
+
+/* ==========================================================================
+    * Diff
+    * ========================================================================== */
+
+static int snapshot_inode_cmp(const void *a, const void *b)
+{
+    const snapshot_entry_t *x = *(const snapshot_entry_t *const *)a;
+    const snapshot_entry_t *y = *(const snapshot_entry_t *const *)b;
+    if (x->dev != y->dev)
+        return x->dev < y->dev ? -1 : 1;
+    if (x->inode != y->inode)
+        return x->inode < y->inode ? -1 : 1;
+    return 0;
+}
+
+static void snapshot_emit(fossil_shark_snapshot_emit_fn emit, void *user,
+                          fossil_shark_notify_kind_t kind, const fossil_shark_snapshot_t *snap,
+                          const snapshot_entry_t *e, uint32_t cookie)
+{
+    fossil_shark_notify_event_t event;
+    event.kind = kind;
+    event.is_dir = e->is_dir;
+    event.cookie = cookie;
+    event.inode = e->inode;
+    snprintf(event.path, sizeof(event.path), "%s", snap->arena + e->path);
+    emit(&event, user);
+}
+
+size_t fossil_shark_snapshot_diff(const fossil_shark_snapshot_t *old_snap,
+                                  const fossil_shark_snapshot_t *new_snap,
+                                  fossil_shark_snapshot_emit_fn emit, void *user)
+{
+    if (!old_snap || !new_snap || !emit)
+        return 0;
+
+    size_t emitted = 0;
+    const snapshot_entry_t **deleted = fossil_sys_memory_alloc((old_snap->count + 1) * sizeof(*deleted));
+    const snapshot_entry_t **created = fossil_sys_memory_alloc((new_snap->count + 1) * sizeof(*created));
+    if (!deleted || !created)
+    {
+        if (deleted)
+            fossil_sys_memory_free((void *)deleted);
+        if (created)
+            fossil_sys_memory_free((void *)created);
+        return 0;
+    }
+    size_t deleted_count = 0, created_count = 0;
+
+    // Same path, same kind: at most a modification. Replacing a file by
+    // renaming over it changes the inode but is still just new content.
+    for (size_t i = 0; i < old_snap->count; ++i)
+    {
+        const snapshot_entry_t *o = &old_snap->entries[i];
+        if (o->gone)
+            continue;
+        const snapshot_entry_t *n = snapshot_find(new_snap, old_snap->arena + o->path);
+        if (!n || n->gone || n->is_dir != o->is_dir)
+            deleted[deleted_count++] = o;
+    }
+    for (size_t i = 0; i < new_snap->count; ++i)
+    {
+        const snapshot_entry_t *n = &new_snap->entries[i];
+        if (n->gone)
+            continue;
+        const snapshot_entry_t *o = snapshot_find(old_snap, new_snap->arena + n->path);
+        if (!o || o->gone || o->is_dir != n->is_dir)
+        {
+            created[created_count++] = n;
+        }
+        else if (!n->is_dir && (o->inode != n->inode || o->size != n->size || o->mtime_ns != n->mtime_ns))
+        {
+            snapshot_emit(emit, user, FOSSIL_SHARK_NOTIFY_MODIFY, new_snap, n, 0);
+            emitted++;
+        }
+    }
+
+    // An inode that vanished under one name and appeared under another was renamed
+    qsort((void *)deleted, deleted_count, sizeof(*deleted), snapshot_inode_cmp);
+    uint32_t cookie = 0;
+    for (size_t i = 0; i < created_count; ++i)
+    {
+        const snapshot_entry_t *n = created[i];
+        if (n->inode == 0)
+            continue;
+        const snapshot_entry_t **match = bsearch(&n, (void *)deleted, deleted_count, sizeof(*deleted), snapshot_inode_cmp);
+        if (!match || (*match)->is_dir != n->is_dir)
+            continue;
+
+        ++cookie;
+        snapshot_emit(emit, user, FOSSIL_SHARK_NOTIFY_RENAME, old_snap, *match, cookie);
+        snapshot_emit(emit, user, FOSSIL_SHARK_NOTIFY_CREATE, new_snap, n, cookie);
+        emitted += 2;
+
+        // Take both out of the plain delete/create lists
+        size_t at = (size_t)(match - deleted);
+        memmove((void *)(deleted + at), (void *)(deleted + at + 1), (deleted_count - at - 1) * sizeof(*deleted));
+        deleted_count--;
+        created[i] = cnull;
+    }
+
+    for (size_t i = 0; i < deleted_count; ++i, ++emitted)
+        snapshot_emit(emit, user, FOSSIL_SHARK_NOTIFY_DELETE, old_snap, deleted[i], 0);
+    for (size_t i = 0; i < created_count; ++i)
+    {
+        if (created[i])
+        {
+            snapshot_emit(emit, user, FOSSIL_SHARK_NOTIFY_CREATE, new_snap, created[i], 0);
+            emitted++;
+        }
+    }
+
+    fossil_sys_memory_free((void *)deleted);
+    fossil_sys_memory_free((void *)created);
+    return emitted;
+}
+
+/* ==========================================================================
+    * Incremental updates
+    * ========================================================================== */
+
+// Helper: the parent's name list no longer matches the disk
+static void snapshot_unlist_parent(fossil_shark_snapshot_t *snap, ccstring path)
+{
+    char parent[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(parent, sizeof(parent), "%s", path);
+    char *slash = strrchr(parent, '/');
+    if (!slash)
+        return;
+    if (slash == parent)
+        slash[1] = '\0';
+    else
+        *slash = '\0';
+
+    snapshot_entry_t *e = snapshot_find(snap, parent);
+    if (e)
+        e->listed = false;
+}
+
+// Helper: mark an entry and its scanned descendants gone, through the child blocks
+static void snapshot_mark_block_gone(fossil_shark_snapshot_t *snap, snapshot_entry_t *e)
+{
+    if (!e->gone)
+    {
+        e->gone = true;
+        snap->live--;
+    }
+    for (size_t i = 0; i < e->child_count; ++i)
+        snapshot_mark_block_gone(snap, &snap->entries[e->first_child + i]);
+}
+
+/*
+ * Everything below a removed directory went with it. What the scan found
+ * is reached through the child blocks, so removing a large tree costs its
+ * size rather than a pass over the snapshot per directory; only entries
+ * applied since the scan, which belong to no block, are matched by path.
+ */
+static void snapshot_mark_gone(fossil_shark_snapshot_t *snap, snapshot_entry_t *e)
+{
+    snapshot_mark_block_gone(snap, e);
+    if (!e->is_dir)
+        return;
+
+    ccstring prefix = snap->arena + e->path;
+    size_t len = strlen(prefix);
+    for (size_t i = snap->scanned; i < snap->count; ++i)
+    {
+        snapshot_entry_t *child = &snap->entries[i];
+        ccstring p = snap->arena + child->path;
+        if (!child->gone && strncmp(p, prefix, len) == 0 && p[len] == '/')
+        {
+            child->gone = true;
+            snap->live--;
+        }
+    }
+}
+
+void fossil_shark_snapshot_apply(fossil_shark_snapshot_t *snap, const fossil_shark_notify_event_t *event)
+{
+    if (!snap || !event || event->kind == FOSSIL_SHARK_NOTIFY_OVERFLOW)
+        return;
+
+    snapshot_entry_t *e = snapshot_find(snap, event->path);
+    snapshot_stat_t st;
+    bool exists = (event->kind == FOSSIL_SHARK_NOTIFY_CREATE || event->kind == FOSSIL_SHARK_NOTIFY_MODIFY) &&
+                  snapshot_stat(event->path, &st) == 0;
+
+    if (!exists)
+    {
+        if (e)
+        {
+            snapshot_mark_gone(snap, e);
+            snapshot_unlist_parent(snap, event->path);
+        }
+        return;
+    }
+
+    if (e)
+    {
+        if (e->gone)
+            snap->live++;
+        if (e->gone || e->inode != st.inode || e->size != st.size || e->mtime_ns != st.mtime_ns)
+            e->has_content = false;
+        e->gone = false;
+        e->dev = st.dev;
+        e->inode = st.inode;
+        e->size = st.size;
+        e->mtime_ns = st.mtime_ns;
+        if (e->is_dir != st.is_dir)
+            e->listed = false;
+        e->is_dir = st.is_dir;
+        return;
+    }
+
+    if (snapshot_append(snap, event->path, &st) != 0)
+        return;
+    snapshot_unlist_parent(snap, event->path);
+    if (snap->count * 2 > snap->table_mask + 1)
+        snapshot_table_build(snap);
+    else
+        snapshot_table_insert(snap, snap->count - 1);
+}
+
+uint64_t fossil_shark_snapshot_inode(const fossil_shark_snapshot_t *snap, ccstring path)
+{
+    const snapshot_entry_t *e = path ? snapshot_find(snap, path) : cnull;
+    return e ? e->inode : 0;
+}
+
+size_t fossil_shark_snapshot_count(const fossil_shark_snapshot_t *snap)
+{
+    return snap ? snap->live : 0;
+}
+
+void fossil_shark_snapshot_free(fossil_shark_snapshot_t *snap)
+{
+    if (!snap)
+        return;
+    if (snap->entries)
+        fossil_sys_memory_free(snap->entries);
+    if (snap->arena)
+        fossil_sys_memory_free(snap->arena);
+    if (snap->table)
+        fossil_sys_memory_free(snap->table);
+    fossil_sys_memory_free(snap);
+}
@@ -22,26 +22,412 @@
  * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
 #include "fossil/code/sync.h"
+#include "fossil/code/hash.h"
+#include "fossil/code/hashcache.h"
+#include "fossil/code/notify.h"
+#include "fossil/code/qos.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
 
 #define PATH_MAX_LEN 1024
+#define SYNC_COPY_CHUNK (256 * 1024)
+#define SYNC_STAGE_MAX 4096
+
+// A copy finished under its temporary name, waiting to be renamed over dest
+typedef struct
+{
+    cstring tmp;
+    cstring dest;
+} sync_staged_t;
+
+typedef struct
+{
+    bool recursive;
+    bool update;
+    bool delete_flag;
+    ccstring compare_mode;
+    bool checksum;
+    bool durable;
+    fossil_shark_hashcache_t *cache; // digests of files unchanged since an earlier run
+    sync_staged_t *staged;  // --durable copies whose data must reach the disk before their rename
+    size_t staged_count;
+    size_t staged_capacity;
+    bool dirty;             // something was renamed into place since the last flush
+    cstring *written;       // files whose directories await an fsync where syncfs is unavailable
+    size_t written_count;
+    size_t written_capacity;
+} sync_options_t;
+
+static int compute_file_hash(ccstring path, unsigned char *hash_out, size_t hash_out_len)
+{
+    return fossil_io_filesys_file_hash(path, hash_out, hash_out_len, "sha256");
+}
+
+// Helper: check that the comparison policy is one we know
+static bool sync_compare_is_valid(ccstring compare_mode)
+{
+    return fossil_io_cstring_equals(compare_mode, "mtime-size") ||
+           fossil_io_cstring_equals(compare_mode, "size") ||
+           fossil_io_cstring_equals(compare_mode, "xxh3") ||
+           fossil_io_cstring_equals(compare_mode, "sha256");
+}
+
+// Helper: compare file contents with the hash selected by the policy
+static bool sync_same_content(ccstring src, ccstring dest, ccstring compare_mode,
+                              fossil_shark_hashcache_t *cache)
+{
+    if (fossil_io_cstring_equals(compare_mode, "sha256"))
+    {
+        unsigned char src_hash[32], dest_hash[32];
+        if (compute_file_hash(src, src_hash, sizeof(src_hash)) != 0 ||
+            compute_file_hash(dest, dest_hash, sizeof(dest_hash)) != 0)
+            return false;
+        return memcmp(src_hash, dest_hash, sizeof(src_hash)) == 0;
+    }
+
+    fossil_shark_hash128_t src_hash, dest_hash;
+    if (fossil_shark_hashcache_file128(cache, src, &src_hash) != 0 ||
+        fossil_shark_hashcache_file128(cache, dest, &dest_hash) != 0)
+        return false;
+    return src_hash.low == dest_hash.low && src_hash.high == dest_hash.high;
+}
+
+// Helper: carry the source timestamps over so the next run can trust size+mtime
+static void sync_copy_times(ccstring dest, const fossil_io_filesys_obj_t *src_obj)
+{
+#ifndef _WIN32
+    struct utimbuf times = {src_obj->accessed_at, src_obj->modified_at};
+    utime(dest, &times);
+#else
+    (void)dest;
+    (void)src_obj;
+#endif
+}
+
+/*
+ * Decide whether dest is already up to date. Differing sizes always mean a
+ * copy and never cost a read; equal size and mtime are trusted unless
+ * checksum is set. Only the remaining ambiguous case reads file data.
+ */
+static bool sync_is_current(ccstring src, ccstring dest,
+                            const fossil_io_filesys_obj_t *src_obj,
+                            const fossil_io_filesys_obj_t *dest_obj,
+                            ccstring compare_mode, bool checksum,
+                            fossil_shark_hashcache_t *cache)
+{
+    if (src_obj->size != dest_obj->size)
+        return false;
+
+    if (!checksum)
+    {
+        if (fossil_io_cstring_equals(compare_mode, "size"))
+            return true;
+        if (src_obj->modified_at == dest_obj->modified_at)
+            return true;
+        if (fossil_io_cstring_equals(compare_mode, "mtime-size"))
+            return false;
+    }
+
+    if (!sync_same_content(src, dest, compare_mode, cache))
+        return false;
 
-static int compute_file_hash(ccstring path, char *hash_out, size_t hash_out_len)
+    if (src_obj->modified_at != dest_obj->modified_at)
+        sync_copy_times(dest, src_obj);
+    return true;
+}
+
+/* ==========================================================================
+    * Atomic replacement and durability
+    * ========================================================================== */
+
+static unsigned long sync_pid(void)
+{
+#ifdef _WIN32
+    return (unsigned long)GetCurrentProcessId();
+#else
+    return (unsigned long)getpid();
+#endif
+}
+
+// Helper: remember a file renamed into place whose directory entry must reach the disk
+static void sync_note_written(sync_options_t *opts, ccstring path)
+{
+    if (!opts->durable)
+        return;
+    opts->dirty = true;
+#if defined(__linux__)
+    (void)path; // one syncfs covers everything
+#else
+    if (opts->written_count == opts->written_capacity)
+    {
+        size_t capacity = opts->written_capacity ? opts->written_capacity * 2 : 64;
+        cstring *written = fossil_sys_memory_realloc(opts->written, capacity * sizeof(cstring));
+        if (!written)
+            return;
+        opts->written = written;
+        opts->written_capacity = capacity;
+    }
+    opts->written[opts->written_count++] = fossil_io_cstring_dup(path);
+#endif
+}
+
+static void sync_fsync_path(ccstring path)
+{
+#ifdef _WIN32
+    HANDLE h = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+        return;
+    FlushFileBuffers(h);
+    CloseHandle(h);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    fsync(fd);
+    close(fd);
+#endif
+}
+
+#if defined(__linux__)
+// Helper: one syncfs() for the filesystem holding path (or its parent, if path is gone)
+static void sync_syncfs(ccstring path)
 {
-    // Use SHA256 for demonstration; adjust as needed
-    unsigned char hash_bin[32];
-    int rc = fossil_io_filesys_file_hash(path, hash_bin, sizeof(hash_bin), "sha256");
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        char parent[FOSSIL_FILESYS_MAX_PATH];
+        snprintf(parent, sizeof(parent), "%s", path);
+        char *slash = strrchr(parent, '/');
+        if (slash && slash != parent)
+            *slash = '\0';
+        else
+            snprintf(parent, sizeof(parent), ".");
+        fd = open(parent, O_RDONLY);
+    }
+    if (fd >= 0)
+    {
+        syncfs(fd);
+        close(fd);
+    }
+}
+#endif
+
+#if !defined(__linux__) && !defined(_WIN32)
+static int sync_written_cmp(const void *a, const void *b)
+{
+    return strcmp(*(const cstring *)a, *(const cstring *)b);
+}
+#endif
+
+// Helper: move a finished temporary over dest
+static int sync_rename(ccstring tmp, ccstring dest, sync_options_t *opts)
+{
+    int rc = 0;
+#ifdef _WIN32
+    DWORD flags = MOVEFILE_REPLACE_EXISTING | (opts->durable ? MOVEFILE_WRITE_THROUGH : 0);
+    if (!MoveFileExA(tmp, dest, flags))
+        rc = (int)GetLastError();
+#else
+    if (rename(tmp, dest) != 0)
+        rc = errno;
+#endif
     if (rc != 0)
+    {
+        remove(tmp);
         return rc;
+    }
 
-    // Convert binary hash to hex string
-    for (size_t i = 0; i < sizeof(hash_bin) && (i * 2 + 1) < hash_out_len; ++i)
-        sprintf(hash_out + i * 2, "%02x", hash_bin[i]);
-    hash_out[sizeof(hash_bin) * 2] = '\0';
+    sync_note_written(opts, dest);
     return 0;
 }
 
-static int sync_file(ccstring src, ccstring dest, bool update)
+/*
+ * Make everything since the last flush durable, in three steps. First the
+ * staged copies' data reaches the disk, with a single syncfs() on Linux
+ * (an fsync per temporary elsewhere, as there is no filesystem-wide
+ * call). Only then are they renamed over their destinations, so a crash
+ * cannot leave a rename on disk ahead of the data it points to. Last the
+ * renames themselves are flushed: another syncfs() on Linux, elsewhere an
+ * fsync of each affected directory, once rather than after every file.
+ */
+static int sync_flush(sync_options_t *opts, ccstring dest)
+{
+    if (!opts->durable)
+        return 0;
+
+    int rc = 0;
+    if (opts->staged_count > 0)
+    {
+#if defined(__linux__)
+        sync_syncfs(opts->staged[0].tmp);
+#else
+        for (size_t i = 0; i < opts->staged_count; ++i)
+            sync_fsync_path(opts->staged[i].tmp);
+#endif
+        for (size_t i = 0; i < opts->staged_count; ++i)
+        {
+            int err = sync_rename(opts->staged[i].tmp, opts->staged[i].dest, opts);
+            if (err != 0 && rc == 0)
+                rc = err;
+            fossil_io_cstring_free(opts->staged[i].tmp);
+            fossil_io_cstring_free(opts->staged[i].dest);
+        }
+        opts->staged_count = 0;
+    }
+
+    if (!opts->dirty)
+        return rc;
+    opts->dirty = false;
+
+#if defined(__linux__)
+    sync_syncfs(dest);
+#else
+    (void)dest;
+#ifndef _WIN32
+    qsort(opts->written, opts->written_count, sizeof(cstring), sync_written_cmp);
+    char last_dir[FOSSIL_FILESYS_MAX_PATH] = {0};
+    for (size_t i = 0; i < opts->written_count; ++i)
+    {
+        char dir[FOSSIL_FILESYS_MAX_PATH];
+        snprintf(dir, sizeof(dir), "%s", opts->written[i]);
+        char *slash = strrchr(dir, '/');
+        if (slash && slash != dir)
+            *slash = '\0';
+        else
+            snprintf(dir, sizeof(dir), ".");
+        if (strcmp(dir, last_dir) == 0)
+            continue;
+        sync_fsync_path(dir);
+        snprintf(last_dir, sizeof(last_dir), "%s", dir);
+    }
+#endif
+    for (size_t i = 0; i < opts->written_count; ++i)
+        fossil_io_cstring_free(opts->written[i]);
+    opts->written_count = 0;
+#endif
+    return rc;
+}
+
+/*
+ * Hold a finished --durable copy back until the next flush. When the list
+ * cannot grow the file is made durable and renamed on its own, and a full
+ * list is flushed early so a huge pass does not pile up temporaries.
+ */
+static int sync_stage(sync_options_t *opts, ccstring tmp, ccstring dest)
+{
+    if (opts->staged_count == opts->staged_capacity)
+    {
+        size_t capacity = opts->staged_capacity ? opts->staged_capacity * 2 : 64;
+        sync_staged_t *staged = fossil_sys_memory_realloc(opts->staged, capacity * sizeof(sync_staged_t));
+        if (!staged)
+        {
+            sync_fsync_path(tmp);
+            return sync_rename(tmp, dest, opts);
+        }
+        opts->staged = staged;
+        opts->staged_capacity = capacity;
+    }
+
+    cstring tmp_copy = fossil_io_cstring_dup(tmp);
+    cstring dest_copy = fossil_io_cstring_dup(dest);
+    if (!tmp_copy || !dest_copy)
+    {
+        if (tmp_copy)
+            fossil_io_cstring_free(tmp_copy);
+        if (dest_copy)
+            fossil_io_cstring_free(dest_copy);
+        sync_fsync_path(tmp);
+        return sync_rename(tmp, dest, opts);
+    }
+    opts->staged[opts->staged_count].tmp = tmp_copy;
+    opts->staged[opts->staged_count].dest = dest_copy;
+    opts->staged_count++;
+
+    if (opts->staged_count >= SYNC_STAGE_MAX)
+        return sync_flush(opts, dest);
+    return 0;
+}
+
+// Helper: true for the temporaries this process leaves beside their destinations
+static bool sync_is_own_temp(ccstring path)
+{
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".shark-%lu.tmp", sync_pid());
+    size_t len = strlen(path), suffix_len = strlen(suffix);
+    return len > suffix_len && strcmp(path + len - suffix_len, suffix) == 0;
+}
+
+// Helper: chunked copy that stays inside the --bwlimit/--iops-limit budget
+static int sync_copy_throttled(ccstring src, ccstring dest, const fossil_io_filesys_obj_t *src_obj)
+{
+    fossil_io_filesys_file_t in, out;
+    if (fossil_io_filesys_file_open(&in, src, "rb") != 0)
+        return errno ? errno : EIO;
+    if (fossil_io_filesys_file_open(&out, dest, "wb") != 0)
+    {
+        fossil_io_filesys_file_close(&in);
+        return errno ? errno : EIO;
+    }
+
+    int rc = 0;
+    uint8_t *buffer = (uint8_t *)fossil_sys_memory_alloc(SYNC_COPY_CHUNK);
+    if (!cnotnull(buffer))
+        rc = ENOMEM;
+
+    size_t n;
+    while (rc == 0 && (n = fossil_io_filesys_file_read(&in, buffer, 1, SYNC_COPY_CHUNK)) > 0)
+    {
+        fossil_shark_qos_throttle(n, 2);
+        if (fossil_io_filesys_file_write(&out, buffer, 1, n) != n)
+            rc = EIO;
+    }
+
+    if (cnotnull(buffer))
+        fossil_sys_memory_free(buffer);
+    fossil_io_filesys_file_close(&in);
+    fossil_io_filesys_file_close(&out);
+#ifndef _WIN32
+    if (rc == 0)
+        chmod(dest, src_obj->mode);
+#else
+    (void)src_obj;
+#endif
+    return rc;
+}
+
+/*
+ * Copy into a temporary name beside dest and rename it over dest, so readers
+ * only ever see the old file or the complete new one. Under --durable the
+ * rename waits for the next sync_flush, which makes the data durable first.
+ */
+static int sync_replace(ccstring src, ccstring dest,
+                        const fossil_io_filesys_obj_t *src_obj, sync_options_t *opts)
+{
+    char tmp[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(tmp, sizeof(tmp), "%s.shark-%lu.tmp", dest, sync_pid());
+
+    int rc = fossil_shark_qos_active() ? sync_copy_throttled(src, tmp, src_obj)
+                                       : fossil_io_filesys_copy(src, tmp, true);
+    if (rc != 0)
+    {
+        remove(tmp);
+        return rc;
+    }
+    sync_copy_times(tmp, src_obj);
+
+    if (opts->durable)
+        return sync_stage(opts, tmp, dest);
+    return sync_rename(tmp, dest, opts);
+}
+
+static int sync_file(ccstring src, ccstring dest, sync_options_t *opts)
 {
     fossil_io_filesys_obj_t src_obj, dest_obj;
     int rc = fossil_io_filesys_stat(src, &src_obj);
@@ -54,7 +440,7 @@ static int sync_file(ccstring src, ccstring dest, bool update)
     rc = fossil_io_filesys_stat(dest, &dest_obj);
     bool dest_exists = (rc == 0);
 
-    if (dest_exists && update)
+    if (dest_exists && opts->update)
     {
         if (dest_obj.modified_at >= src_obj.modified_at)
         {
@@ -63,25 +449,15 @@ static int sync_file(ccstring src, ccstring dest, bool update)
         }
     }
 
-    // Compare hashes, skip copy if identical
-    char src_hash[65], dest_hash[65];
-    if (compute_file_hash(src, src_hash, sizeof(src_hash)) == 0 &&
-        dest_exists &&
-        compute_file_hash(dest, dest_hash, sizeof(dest_hash)) == 0)
-    {
-        if (strcmp(src_hash, dest_hash) == 0)
-        {
-            // Files are identical, skip copy
-            return 0;
-        }
-    }
+    if (dest_exists && sync_is_current(src, dest, &src_obj, &dest_obj, opts->compare_mode, opts->checksum,
+                                       opts->cache))
+        return 0;
 
-    return fossil_io_filesys_copy(src, dest, true);
+    return sync_replace(src, dest, &src_obj, opts);
 }
 
-// Main sync function
-int fossil_shark_sync(ccstring src, ccstring dest,
-                      bool recursive, bool update, bool delete_flag)
+// Helper: one full pass over src
+static int sync_tree(ccstring src, ccstring dest, sync_options_t *opts)
 {
     int32_t rc = 0;
     fossil_io_filesys_obj_t src_obj;
@@ -91,7 +467,7 @@ int fossil_shark_sync(ccstring src, ccstring dest,
 
     if (src_obj.type != FOSSIL_FILESYS_TYPE_DIR)
     {
-        return sync_file(src, dest, update);
+        return sync_file(src, dest, opts);
     }
 
     // Create destination directory if needed
@@ -120,20 +496,20 @@ int fossil_shark_sync(ccstring src, ccstring dest,
 
         if (entry->type == FOSSIL_FILESYS_TYPE_DIR)
         {
-            if (recursive)
+            if (opts->recursive)
             {
-                fossil_shark_sync(entry->path, dest_path, recursive, update, delete_flag);
+                sync_tree(entry->path, dest_path, opts);
             }
         }
         else if (entry->type == FOSSIL_FILESYS_TYPE_FILE)
         {
-            sync_file(entry->path, dest_path, update);
+            sync_file(entry->path, dest_path, opts);
         }
         // Symlinks and other types can be handled here if needed
     }
 
     // Delete extraneous files in dest
-    if (delete_flag)
+    if (opts->delete_flag)
     {
         fossil_io_filesys_obj_t dest_entries[256];
         size_t dest_entry_count = 0;
@@ -146,6 +522,9 @@ int fossil_shark_sync(ccstring src, ccstring dest,
             fossil_io_filesys_obj_t *dentry = &dest_entries[i];
             if (strcmp(dentry->path, ".") == 0 || strcmp(dentry->path, "..") == 0)
                 continue;
+            // Staged --durable copies are renamed over their real names at the next flush
+            if (sync_is_own_temp(dentry->path))
+                continue;
 
             char src_path[FOSSIL_FILESYS_MAX_PATH];
             snprintf(src_path, sizeof(src_path), "%s/%s", src, dentry->path + strlen(dest) + 1);
@@ -161,3 +540,299 @@ int fossil_shark_sync(ccstring src, ccstring dest,
 
     return 0;
 }
+
+/* ==========================================================================
+    * Continuous mode
+    * ========================================================================== */
+
+#define SYNC_EVENT_BATCH 256
+#define SYNC_COALESCE_MS 200
+#define SYNC_COALESCE_ROUNDS 10
+#define SYNC_POLL_SECONDS 1
+
+typedef struct
+{
+    cstring *paths;
+    size_t count;
+    size_t capacity;
+    bool rescan;
+} sync_changes_t;
+
+static void sync_changes_add(sync_changes_t *changes, ccstring path)
+{
+    if (changes->count == changes->capacity)
+    {
+        size_t capacity = changes->capacity ? changes->capacity * 2 : 64;
+        cstring *paths = fossil_sys_memory_realloc(changes->paths, capacity * sizeof(cstring));
+        if (!paths)
+        {
+            // Out of memory: fall back to a full pass instead of losing the change
+            changes->rescan = true;
+            return;
+        }
+        changes->paths = paths;
+        changes->capacity = capacity;
+    }
+    cstring copy = fossil_io_cstring_dup(path);
+    if (!copy)
+    {
+        changes->rescan = true;
+        return;
+    }
+    changes->paths[changes->count++] = copy;
+}
+
+static void sync_changes_clear(sync_changes_t *changes)
+{
+    for (size_t i = 0; i < changes->count; ++i)
+        fossil_io_cstring_free(changes->paths[i]);
+    changes->count = 0;
+    changes->rescan = false;
+}
+
+static int sync_path_cmp(const void *a, const void *b)
+{
+    return strcmp(*(const cstring *)a, *(const cstring *)b);
+}
+
+// Helper: sort and drop duplicate paths so each one is synced once per batch
+static void sync_changes_unique(sync_changes_t *changes)
+{
+    if (changes->count < 2)
+        return;
+    qsort(changes->paths, changes->count, sizeof(cstring), sync_path_cmp);
+    size_t out = 1;
+    for (size_t i = 1; i < changes->count; ++i)
+    {
+        if (strcmp(changes->paths[i], changes->paths[out - 1]) == 0)
+            fossil_io_cstring_free(changes->paths[i]);
+        else
+            changes->paths[out++] = changes->paths[i];
+    }
+    changes->count = out;
+}
+
+// Helper: true when a parent of path is itself queued as a directory
+static bool sync_covered_by_parent(const sync_changes_t *changes, ccstring root, ccstring path)
+{
+    char parent[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(parent, sizeof(parent), "%s", path);
+    size_t root_len = strlen(root);
+
+    for (;;)
+    {
+        char *slash = strrchr(parent, '/');
+        if (!slash || (size_t)(slash - parent) < root_len)
+            return false;
+        *slash = '\0';
+
+        ccstring key = parent;
+        if (bsearch(&key, changes->paths, changes->count, sizeof(cstring), sync_path_cmp))
+        {
+            fossil_io_filesys_obj_t obj;
+            if (fossil_io_filesys_stat(parent, &obj) == 0 && obj.type == FOSSIL_FILESYS_TYPE_DIR)
+                return true;
+        }
+    }
+}
+
+// Helper: bring the destination copy of one changed source path up to date
+static void sync_apply_path(ccstring src, ccstring dest, ccstring path, sync_options_t *opts)
+{
+    size_t src_len = strlen(src);
+    if (strncmp(path, src, src_len) != 0)
+        return;
+
+    ccstring rel = path + src_len;
+    while (*rel == '/')
+        ++rel;
+
+    char dest_path[FOSSIL_FILESYS_MAX_PATH];
+    if (*rel)
+        snprintf(dest_path, sizeof(dest_path), "%s/%s", dest, rel);
+    else
+        snprintf(dest_path, sizeof(dest_path), "%s", dest);
+
+    fossil_io_filesys_obj_t obj;
+    if (fossil_io_filesys_stat(path, &obj) != 0)
+    {
+        if (opts->delete_flag && fossil_io_filesys_exists(dest_path) == 1)
+            fossil_io_filesys_remove(dest_path, true);
+        return;
+    }
+
+    if (obj.type == FOSSIL_FILESYS_TYPE_DIR)
+    {
+        // A non-recursive sync only ever mirrors the top level
+        if (opts->recursive || !*rel)
+            sync_tree(path, dest_path, opts);
+        return;
+    }
+
+    if (obj.type != FOSSIL_FILESYS_TYPE_FILE)
+        return;
+
+    char parent[FOSSIL_FILESYS_MAX_PATH];
+    snprintf(parent, sizeof(parent), "%s", dest_path);
+    char *slash = strrchr(parent, '/');
+    if (slash && slash != parent)
+    {
+        *slash = '\0';
+        if (fossil_io_filesys_exists(parent) != 1)
+            fossil_io_filesys_dir_create(parent, true);
+    }
+    sync_file(path, dest_path, opts);
+}
+
+// Helper: no native notifications, so keep doing full passes on a timer
+static int sync_poll_forever(ccstring src, ccstring dest, sync_options_t *opts)
+{
+    for (;;)
+    {
+#ifdef _WIN32
+        Sleep(SYNC_POLL_SECONDS * 1000);
+#else
+        sleep(SYNC_POLL_SECONDS);
+#endif
+        sync_tree(src, dest, opts);
+        sync_flush(opts, dest);
+    }
+    return 0;
+}
+
+/*
+ * Watch src and mirror every change into dest. Events are gathered until the
+ * source has been quiet for SYNC_COALESCE_MS (bounded, so a constantly busy
+ * tree still gets synced), then only the affected paths are re-synced. A lost
+ * event queue triggers one full pass instead.
+ */
+static int sync_continuous(ccstring src, ccstring dest, sync_options_t *opts)
+{
+    fossil_shark_notify_t *notify = NULL;
+    int rc = fossil_shark_notify_open(&notify, src, opts->recursive);
+    if (rc != 0)
+    {
+        fossil_io_printf("{yellow}Warning: change notifications unavailable, rescanning every %d second(s){normal}\n",
+                         SYNC_POLL_SECONDS);
+        rc = sync_tree(src, dest, opts);
+        sync_flush(opts, dest);
+        if (rc != 0)
+            return rc;
+        return sync_poll_forever(src, dest, opts);
+    }
+
+    // Initial pass runs after the watches exist so nothing changed in between is missed
+    rc = sync_tree(src, dest, opts);
+    sync_flush(opts, dest);
+    if (rc != 0)
+    {
+        fossil_shark_notify_close(notify);
+        return rc;
+    }
+    fossil_io_printf("{cyan}Watching %s for changes...{normal}\n", src);
+
+    fossil_shark_notify_event_t *events =
+        fossil_sys_memory_alloc(SYNC_EVENT_BATCH * sizeof(fossil_shark_notify_event_t));
+    if (!events)
+    {
+        fossil_shark_notify_close(notify);
+        return ENOMEM;
+    }
+
+    sync_changes_t changes = {0};
+    for (;;)
+    {
+        int timeout = -1;
+        for (int round = 0; round < SYNC_COALESCE_ROUNDS; ++round)
+        {
+            size_t count = 0;
+            rc = fossil_shark_notify_read(notify, events, SYNC_EVENT_BATCH, &count, timeout);
+            if (rc != 0)
+                break;
+            if (count == 0)
+                break;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (events[i].kind == FOSSIL_SHARK_NOTIFY_OVERFLOW)
+                    changes.rescan = true;
+                else if (!changes.rescan)
+                    sync_changes_add(&changes, events[i].path);
+            }
+            timeout = SYNC_COALESCE_MS;
+        }
+        if (rc != 0)
+            break;
+
+        if (changes.rescan)
+        {
+            sync_tree(src, dest, opts);
+        }
+        else
+        {
+            sync_changes_unique(&changes);
+            for (size_t i = 0; i < changes.count; ++i)
+            {
+                if (sync_covered_by_parent(&changes, src, changes.paths[i]))
+                    continue;
+                sync_apply_path(src, dest, changes.paths[i], opts);
+            }
+        }
+        sync_changes_clear(&changes);
+        sync_flush(opts, dest);
+    }
+
+    sync_changes_clear(&changes);
+    fossil_sys_memory_free(changes.paths);
+    fossil_sys_memory_free(events);
+    fossil_shark_notify_close(notify);
+    return rc;
+}
+
+// Main sync function
+int fossil_shark_sync(ccstring src, ccstring dest,
+                      bool recursive, bool update, bool delete_flag,
+                      ccstring compare_mode, bool checksum, bool continuous, bool durable)
+{
+    if (!cnotnull(src) || !cnotnull(dest))
+        return EINVAL;
+    if (!cnotnull(compare_mode))
+        compare_mode = "xxh3";
+    if (!sync_compare_is_valid(compare_mode))
+    {
+        fossil_io_printf("{red}Error: Unknown compare mode '%s' (use mtime-size, size, xxh3 or sha256){normal}\n", compare_mode);
+        return EINVAL;
+    }
+
+    sync_options_t opts = {
+        .recursive = recursive,
+        .update = update,
+        .delete_flag = delete_flag,
+        .compare_mode = compare_mode,
+        .checksum = checksum,
+        .durable = durable,
+    };
+
+    // sha256 is computed fresh every time; the cache only holds XXH3 digests
+    if (checksum || fossil_io_cstring_equals(compare_mode, "xxh3"))
+        fossil_shark_hashcache_open(&opts.cache, cnull);
+
+    int rc;
+    if (continuous)
+    {
+        rc = sync_continuous(src, dest, &opts);
+    }
+    else
+    {
+        rc = sync_tree(src, dest, &opts);
+        int flush_rc = sync_flush(&opts, dest);
+        if (rc == 0)
+            rc = flush_rc;
+    }
+    if (opts.written)
+        fossil_sys_memory_free(opts.written);
+    if (opts.staged)
+        fossil_sys_memory_free(opts.staged);
+    fossil_shark_hashcache_close(opts.cache);
+    return rc;
+}
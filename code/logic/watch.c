@@ -22,202 +22,815 @@
  * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
  * -----------------------------------------------------------------------------
  */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "fossil/code/watch.h"
+#include "fossil/code/notify.h"
+#include "fossil/code/snapshot.h"
+#include "fossil/code/hash.h"
+#include "fossil/code/jobs.h"
+#include "fossil/code/ring.h"
+#include "fossil/code/pool.h"
+#include <time.h>
+
+#define WATCH_EVENT_BATCH 256
 
-__attribute__((unused)) static void fossil_shark_watch_file(const char *path, const char *events, fossil_io_filesys_obj_t *prev_obj)
+/*
+ * A burst that never goes quiet (a log being appended to) is still flushed
+ * once the window has been stretched this many times.
+ */
+#define WATCH_DEBOUNCE_MAX_FACTOR 10
+#define WATCH_BATCH_DEFAULT_MS 100
+#define WATCH_JOBS_POLL_MS 50 // how often finished --exec runs are collected
+#define WATCH_RING_BYTES (4u << 20) // --media jsonl backlog between reader and writer
+#define WATCH_OUT_BUFFER (64u << 10)
+#define WATCH_CONTENT_EAGER_BYTES (1u << 20) // --content keeps files up to this size hashed
+#define WATCH_CONTENT_RACY_NS 1000000000ll      // mtimes this recent may hide a same-tick write
+
+// Net effect of everything seen for one path since the last flush
+typedef struct
 {
-    fossil_io_filesys_obj_t curr_obj;
-    int rc = fossil_io_filesys_stat(path, &curr_obj);
-    if (rc != 0)
+    fossil_shark_watch_net_t net;
+    uint64_t hash;
+    bool live;     // still stands for an event once collapsed
+    bool shown;    // passes the event filter
+    bool has_before;                     // --content: state before the window opened
+    fossil_shark_snapshot_info_t before;
+} watch_pending_t;
+
+typedef struct
+{
+    const char *root;
+    const char *events;
+    bool root_gone;
+    int debounce_ms; // 0 reports every event as it arrives
+    bool batch;      // print each flushed window as one set
+    fossil_shark_jobs_t *jobs; // runs --exec once per flushed window
+    bool jobs_active;          // a run is in flight or queued
+    fossil_shark_ring_t *ring; // --media jsonl: events on their way to the writer
+    fossil_shark_thread_t writer;
+    uint64_t batch_seq; // number of the window being flushed
+    bool content;       // report modify only when the bytes changed
+    const fossil_shark_snapshot_t *diff_old; // snapshots being diffed, for --content
+    fossil_shark_snapshot_t *diff_new;
+    fossil_shark_snapshot_t *snap;                 // native backend's live snapshot
+    const fossil_shark_snapshot_info_t *ev_before; // entry state before the event being dispatched
+    watch_pending_t *pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    size_t *table; // open addressing, pending index + 1, 0 means empty
+    size_t table_mask;
+    uint64_t first_ns; // first event of the open window
+    uint64_t last_ns;  // latest event of the open window
+} watch_ctx_t;
+
+static uint64_t fossil_shark_watch_now_ns(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (uint64_t)((double)count.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Helper: does the user's event filter include this kind? No filter means all
+static bool fossil_shark_watch_wants(const char *events, const char *kind)
+{
+    return !cnotnull(events) || fossil_io_cstring_icontains(events, kind);
+}
+
+static void fossil_shark_watch_emit(const char *etype, const char *path)
+{
+    cstring msg = fossil_io_cstring_format("{yellow}%s:{normal} %s\n", etype, path);
+    fossil_io_filesys_file_write(FOSSIL_STDOUT, msg, fossil_io_cstring_length(msg), 1);
+    fossil_io_cstring_free(msg);
+}
+
+// Helper: map an event to its filter name and printed label; false for none
+static bool fossil_shark_watch_classify(const fossil_shark_notify_event_t *ev,
+                                        const char **filter, const char **etype)
+{
+    switch (ev->kind)
     {
-        if (errno == ENOENT && fossil_io_cstring_icontains(events, "delete"))
-        {
-            cstring del_msg = fossil_io_cstring_format("{red}File deleted:{normal} %s\n", path);
-            fossil_io_filesys_file_write(FOSSIL_STDOUT, del_msg, fossil_io_cstring_length(del_msg), 1);
-            fossil_io_cstring_free(del_msg);
-        }
-        return;
+    case FOSSIL_SHARK_NOTIFY_CREATE:
+        // A paired cookie means this is the new name of a rename
+        *filter = ev->cookie ? "rename" : "create";
+        *etype = ev->cookie ? "renamed" : "created";
+        return true;
+    case FOSSIL_SHARK_NOTIFY_DELETE:
+        *filter = "delete";
+        *etype = "deleted";
+        return true;
+    case FOSSIL_SHARK_NOTIFY_MODIFY:
+        *filter = "modify";
+        *etype = "modified";
+        return true;
+    case FOSSIL_SHARK_NOTIFY_RENAME:
+        *filter = "rename";
+        *etype = "renamed";
+        return true;
+    default:
+        return false;
     }
+}
+
+/* ============================================================================
+ * JSON lines output
+ * ============================================================================ */
+
+/*
+ * The reader only copies a fixed header and the path into the ring; a
+ * writer thread does the formatting and hands stdout large blocks. When
+ * the consumer of stdout falls behind, the ring fills and events are
+ * dropped and counted instead of stalling the kernel queue behind it.
+ */
+typedef struct
+{
+    uint64_t time_ns;
+    uint64_t inode;
+    uint64_t batch;
+    uint32_t cookie;
+    uint16_t kind;
+    uint8_t is_dir;
+    uint8_t reserved;
+} watch_record_t;
+
+typedef struct
+{
+    char data[WATCH_OUT_BUFFER];
+    size_t len;
+} watch_out_t;
+
+static void fossil_shark_watch_out_flush(watch_out_t *out)
+{
+    if (out->len > 0)
+    {
+        fwrite(out->data, 1, out->len, stdout);
+        fflush(stdout);
+        out->len = 0;
+    }
+}
+
+static void fossil_shark_watch_out(watch_out_t *out, const char *s, size_t n)
+{
+    if (out->len + n > sizeof(out->data))
+        fossil_shark_watch_out_flush(out);
+    memcpy(out->data + out->len, s, n);
+    out->len += n;
+}
 
-    // Check modification time
-    if (curr_obj.modified_at != prev_obj->modified_at && fossil_io_cstring_icontains(events, "modify"))
+// Helper: append a path as a JSON string body, escaping quotes and control bytes
+static void fossil_shark_watch_out_json(watch_out_t *out, const char *s, size_t n)
+{
+    size_t run = 0;
+    for (size_t i = 0; i < n; ++i)
     {
-        cstring mod_msg = fossil_io_cstring_format("{yellow}File modified:{normal} %s\n", path);
-        fossil_io_filesys_file_write(FOSSIL_STDOUT, mod_msg, fossil_io_cstring_length(mod_msg), 1);
-        fossil_io_cstring_free(mod_msg);
+        unsigned char c = (unsigned char)s[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        fossil_shark_watch_out(out, s + run, i - run);
+        char esc[8];
+        int len = (c == '"' || c == '\\') ? snprintf(esc, sizeof(esc), "\\%c", c)
+                                          : snprintf(esc, sizeof(esc), "\\u%04x", c);
+        fossil_shark_watch_out(out, esc, (size_t)len);
+        run = i + 1;
     }
+    fossil_shark_watch_out(out, s + run, n - run);
+}
 
-    // Check size change
-    if (curr_obj.size != prev_obj->size && fossil_io_cstring_icontains(events, "modify"))
+static const char *fossil_shark_watch_json_type(const watch_record_t *rec)
+{
+    switch (rec->kind)
     {
-        cstring size_msg = fossil_io_cstring_format("{cyan}File size changed:{normal} %s\n", path);
-        fossil_io_filesys_file_write(FOSSIL_STDOUT, size_msg, fossil_io_cstring_length(size_msg), 1);
-        fossil_io_cstring_free(size_msg);
+    case FOSSIL_SHARK_NOTIFY_CREATE:
+        return rec->cookie ? "rename_to" : "create";
+    case FOSSIL_SHARK_NOTIFY_DELETE:
+        return "delete";
+    case FOSSIL_SHARK_NOTIFY_MODIFY:
+        return "modify";
+    case FOSSIL_SHARK_NOTIFY_RENAME:
+        return "rename_from";
+    default:
+        return "overflow";
     }
+}
 
-    *prev_obj = curr_obj;
+static void fossil_shark_watch_out_dropped(watch_out_t *out, uint64_t count, uint64_t total)
+{
+    char line[128];
+    int n = snprintf(line, sizeof(line), "{\"ts\":%llu,\"type\":\"dropped\",\"count\":%llu,\"total\":%llu}\n",
+                     (unsigned long long)fossil_shark_watch_now_ns(), (unsigned long long)count,
+                     (unsigned long long)total);
+    fossil_shark_watch_out(out, line, (size_t)n);
 }
 
-#if !defined(_WIN32) && !defined(_WIN64)
-__attribute__((unused)) static void fossil_shark_watch_dir(const char *dir_path, const char *events, int interval)
+// Writer thread: drain the ring into stdout until it is closed
+static void fossil_shark_watch_writer(void *arg)
 {
-    fossil_io_filesys_obj_t entries[256];
-    size_t entry_count = 0;
-    if (fossil_io_filesys_dir_list(dir_path, entries, 256, &entry_count) != 0)
+    fossil_shark_ring_t *ring = (fossil_shark_ring_t *)arg;
+    watch_out_t *out = fossil_sys_memory_alloc(sizeof(watch_out_t));
+    char *record = fossil_sys_memory_alloc(sizeof(watch_record_t) + FOSSIL_FILESYS_MAX_PATH);
+    uint64_t reported = 0;
+    if (!out || !record)
+    {
+        // Nothing can be written; keep draining so the reader is not starved
+        char sink[sizeof(watch_record_t) + FOSSIL_FILESYS_MAX_PATH];
+        while (fossil_shark_ring_wait(ring))
+            while (fossil_shark_ring_pop(ring, sink, sizeof(sink)) > 0)
+                ;
+        fossil_sys_memory_free(out);
+        fossil_sys_memory_free(record);
         return;
+    }
+    out->len = 0;
 
-    for (size_t i = 0; i < entry_count; ++i)
+    for (;;)
     {
-        fossil_io_filesys_obj_t *entry = &entries[i];
-        // Skip "." and ".."
-        if (strcmp(entry->path, ".") == 0 || strcmp(entry->path, "..") == 0)
+        size_t len = fossil_shark_ring_pop(ring, record, sizeof(watch_record_t) + FOSSIL_FILESYS_MAX_PATH);
+        uint64_t dropped = fossil_shark_ring_dropped(ring);
+        if (dropped != reported)
+        {
+            fossil_shark_watch_out_dropped(out, dropped - reported, dropped);
+            reported = dropped;
+        }
+
+        if (len < sizeof(watch_record_t))
+        {
+            fossil_shark_watch_out_flush(out); // idle: let the consumer see everything so far
+            if (!fossil_shark_ring_wait(ring))
+                break;
             continue;
+        }
+
+        watch_record_t rec;
+        memcpy(&rec, record, sizeof(rec));
+        char head[160];
+        int n = snprintf(head, sizeof(head), "{\"ts\":%llu,\"type\":\"%s\",\"path\":\"",
+                         (unsigned long long)rec.time_ns, fossil_shark_watch_json_type(&rec));
+        fossil_shark_watch_out(out, head, (size_t)n);
+        fossil_shark_watch_out_json(out, record + sizeof(rec), len - sizeof(rec));
+        n = snprintf(head, sizeof(head), "\",\"inode\":%llu,\"dir\":%s",
+                     (unsigned long long)rec.inode, rec.is_dir ? "true" : "false");
+        fossil_shark_watch_out(out, head, (size_t)n);
+        if (rec.cookie)
+        {
+            n = snprintf(head, sizeof(head), ",\"cookie\":%u", (unsigned)rec.cookie);
+            fossil_shark_watch_out(out, head, (size_t)n);
+        }
+        if (rec.batch)
+        {
+            n = snprintf(head, sizeof(head), ",\"batch\":%llu", (unsigned long long)rec.batch);
+            fossil_shark_watch_out(out, head, (size_t)n);
+        }
+        fossil_shark_watch_out(out, "}\n", 2);
+    }
+
+    fossil_shark_watch_out_flush(out);
+    fossil_sys_memory_free(record);
+    fossil_sys_memory_free(out);
+}
+
+// Helper: queue one event for the writer; never blocks the reader
+static void fossil_shark_watch_push(watch_ctx_t *ctx, const fossil_shark_notify_event_t *ev)
+{
+    char record[sizeof(watch_record_t) + FOSSIL_FILESYS_MAX_PATH];
+    watch_record_t rec;
+    rec.time_ns = fossil_shark_watch_now_ns();
+    rec.inode = ev->inode;
+    rec.batch = ctx->batch ? ctx->batch_seq : 0;
+    rec.cookie = ev->cookie;
+    rec.kind = (uint16_t)ev->kind;
+    rec.is_dir = ev->is_dir;
+    rec.reserved = 0;
+
+    size_t len = strnlen(ev->path, FOSSIL_FILESYS_MAX_PATH);
+    memcpy(record, &rec, sizeof(rec));
+    memcpy(record + sizeof(rec), ev->path, len);
+    fossil_shark_ring_push(ctx->ring, record, sizeof(rec) + len);
+}
+
+static int fossil_shark_watch_writer_start(watch_ctx_t *ctx)
+{
+    int rc = fossil_shark_ring_create(&ctx->ring, WATCH_RING_BYTES);
+    if (rc != 0)
+        return rc;
+    rc = fossil_shark_thread_start(&ctx->writer, fossil_shark_watch_writer, ctx->ring);
+    if (rc != 0)
+    {
+        fossil_shark_ring_free(ctx->ring);
+        ctx->ring = NULL;
+    }
+    return rc;
+}
+
+// Helper: let the writer drain what is queued, then stop it
+static void fossil_shark_watch_writer_stop(watch_ctx_t *ctx)
+{
+    if (!ctx->ring)
+        return;
+    fossil_shark_ring_close(ctx->ring);
+    fossil_shark_thread_join(&ctx->writer);
+    uint64_t dropped = fossil_shark_ring_dropped(ctx->ring);
+    if (dropped > 0)
+    {
+        cstring msg = fossil_io_cstring_format(
+            "{red}Warning: %llu event(s) dropped, output could not keep up{normal}\n",
+            (unsigned long long)dropped);
+        fossil_io_filesys_file_write(FOSSIL_STDERR, msg, fossil_io_cstring_length(msg), 1);
+        fossil_io_cstring_free(msg);
+    }
+    fossil_shark_ring_free(ctx->ring);
+    ctx->ring = NULL;
+}
 
-        if (entry->type == FOSSIL_FILESYS_TYPE_DIR)
+// Helper: print one event if it passes the filter; shared by every backend
+static void fossil_shark_watch_report(watch_ctx_t *ctx, const fossil_shark_notify_event_t *ev)
+{
+    const char *filter = NULL;
+    const char *etype = NULL;
+
+    if (ev->kind == FOSSIL_SHARK_NOTIFY_DELETE && strcmp(ev->path, ctx->root) == 0)
+        ctx->root_gone = true;
+
+    if (!fossil_shark_watch_classify(ev, &filter, &etype) ||
+        !fossil_shark_watch_wants(ctx->events, filter))
+        return;
+    if (ctx->ring)
+        fossil_shark_watch_push(ctx, ev);
+    else
+        fossil_shark_watch_emit(etype, ev->path);
+}
+
+// Helper: the watched path itself disappeared
+static void fossil_shark_watch_report_root(watch_ctx_t *ctx)
+{
+    fossil_shark_notify_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.kind = FOSSIL_SHARK_NOTIFY_DELETE;
+    snprintf(ev.path, sizeof(ev.path), "%s", ctx->root);
+    fossil_shark_watch_report(ctx, &ev);
+    ctx->root_gone = true;
+}
+
+/* ============================================================================
+ * Content changes
+ * ============================================================================ */
+
+// Helper: hash a small file into the snapshot so a later touch can be told apart
+static void fossil_shark_watch_content_seed(fossil_shark_snapshot_t *snap, const char *path)
+{
+    fossil_shark_snapshot_info_t now;
+    uint64_t content = 0;
+    if (fossil_shark_snapshot_lookup(snap, path, &now) && !now.is_dir && !now.has_content &&
+        now.size <= WATCH_CONTENT_EAGER_BYTES && fossil_shark_hash_file64(path, &content) == 0)
+        fossil_shark_snapshot_set_content(snap, path, content);
+}
+
+static bool fossil_shark_watch_content_racy(int64_t mtime_ns)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return mtime_ns >= (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec - WATCH_CONTENT_RACY_NS;
+}
+
+/*
+ * Decide whether a modify event changed the file's bytes. A size change
+ * always does and needs no read, which keeps appends to large files cheap.
+ * An unchanged mtime means only attributes moved (chmod, chown, xattrs).
+ * Otherwise, as for touch or a rewrite of the same bytes, the file is
+ * hashed and compared with the fingerprint taken before the event.
+ */
+static bool fossil_shark_watch_content_changed(const fossil_shark_snapshot_info_t *before,
+                                               fossil_shark_snapshot_t *after, const char *path)
+{
+    fossil_shark_snapshot_info_t now;
+    if (!fossil_shark_snapshot_lookup(after, path, &now) || now.is_dir)
+        return true;
+
+    if (now.size != before->size)
+    {
+        fossil_shark_watch_content_seed(after, path);
+        return true;
+    }
+    if (now.inode == before->inode && now.mtime_ns == before->mtime_ns &&
+        !fossil_shark_watch_content_racy(now.mtime_ns))
+        return false;
+
+    uint64_t content = now.content;
+    if (!now.has_content)
+    {
+        if (fossil_shark_hash_file64(path, &content) != 0)
+            return true;
+        fossil_shark_snapshot_set_content(after, path, content);
+    }
+    return !before->has_content || before->content != content;
+}
+
+/* ============================================================================
+ * Coalescing
+ * ============================================================================ */
+
+// Helper: find or add the pending slot for a path; NULL when out of memory
+static watch_pending_t *fossil_shark_watch_pending(watch_ctx_t *ctx, const char *path)
+{
+    uint64_t hash = fossil_shark_hash64(path, strlen(path));
+    if (ctx->table)
+    {
+        for (size_t slot = (size_t)hash & ctx->table_mask; ctx->table[slot];
+             slot = (slot + 1) & ctx->table_mask)
         {
-            fossil_shark_watch_dir(entry->path, events, interval);
+            watch_pending_t *p = &ctx->pending[ctx->table[slot] - 1];
+            if (p->hash == hash && strcmp(p->net.event.path, path) == 0)
+                return p;
         }
-        else if (entry->type == FOSSIL_FILESYS_TYPE_FILE)
+    }
+
+    if (ctx->pending_count == ctx->pending_capacity)
+    {
+        size_t cap = ctx->pending_capacity ? ctx->pending_capacity * 2 : 64;
+        watch_pending_t *grown = fossil_sys_memory_realloc(ctx->pending, cap * sizeof(*grown));
+        if (!grown)
+            return NULL;
+        ctx->pending = grown;
+        ctx->pending_capacity = cap;
+    }
+
+    // Keep the table at most half full so probes stay short
+    if ((ctx->pending_count + 1) * 2 > (ctx->table ? ctx->table_mask + 1 : 0))
+    {
+        size_t size = ctx->table ? (ctx->table_mask + 1) * 2 : 128;
+        size_t *table = fossil_sys_memory_calloc(size, sizeof(size_t));
+        if (!table)
+            return NULL;
+        for (size_t i = 0; i < ctx->pending_count; ++i)
         {
-            fossil_io_filesys_obj_t st;
-            if (fossil_io_filesys_stat(entry->path, &st) == 0)
+            size_t slot = (size_t)ctx->pending[i].hash & (size - 1);
+            while (table[slot])
+                slot = (slot + 1) & (size - 1);
+            table[slot] = i + 1;
+        }
+        fossil_sys_memory_free(ctx->table);
+        ctx->table = table;
+        ctx->table_mask = size - 1;
+    }
+
+    watch_pending_t *p = &ctx->pending[ctx->pending_count++];
+    memset(p, 0, sizeof(*p));
+    p->hash = hash;
+    size_t slot = (size_t)hash & ctx->table_mask;
+    while (ctx->table[slot])
+        slot = (slot + 1) & ctx->table_mask;
+    ctx->table[slot] = ctx->pending_count;
+    return p;
+}
+
+/*
+ * Fold an event into the net change for its path. Only whether the path
+ * existed before the window and whether it exists now matter, so
+ * create+modify+modify is one create, create+delete is nothing, and
+ * delete+create (an editor's save-by-replace) is a modify.
+ */
+void fossil_shark_watch_fold(fossil_shark_watch_net_t *net, const fossil_shark_notify_event_t *ev,
+                             bool existed_before)
+{
+    bool fresh = net->event.kind == 0;
+    bool removed = ev->kind == FOSSIL_SHARK_NOTIFY_DELETE || ev->kind == FOSSIL_SHARK_NOTIFY_RENAME;
+    if (fresh)
+    {
+        // A create can land on an existing name (rename over it); the caller knows
+        net->existed = ev->kind != FOSSIL_SHARK_NOTIFY_CREATE || existed_before;
+        net->event = *ev;
+        if (ev->kind == FOSSIL_SHARK_NOTIFY_CREATE && net->existed)
+            net->modified = true;
+    }
+    else if (ev->kind != FOSSIL_SHARK_NOTIFY_MODIFY)
+    {
+        net->event = *ev;
+    }
+    else
+    {
+        net->event.is_dir = ev->is_dir;
+    }
+
+    if (ev->kind == FOSSIL_SHARK_NOTIFY_MODIFY || (!fresh && !net->exists && !removed))
+        net->modified = true;
+    net->exists = !removed;
+}
+
+bool fossil_shark_watch_collapse(const fossil_shark_watch_net_t *net, fossil_shark_notify_event_t *out)
+{
+    fossil_shark_notify_kind_t last = net->event.kind;
+    *out = net->event;
+    if (!net->existed && net->exists)
+        out->kind = FOSSIL_SHARK_NOTIFY_CREATE;
+    else if (net->existed && !net->exists)
+        out->kind = last == FOSSIL_SHARK_NOTIFY_RENAME ? FOSSIL_SHARK_NOTIFY_RENAME : FOSSIL_SHARK_NOTIFY_DELETE;
+    else if (net->existed && net->modified)
+        out->kind = FOSSIL_SHARK_NOTIFY_MODIFY, out->cookie = 0;
+    else
+        return false; // appeared and vanished inside the window
+    return true;
+}
+
+// Helper: hold an event back in the open window
+static void fossil_shark_watch_coalesce(watch_ctx_t *ctx, const fossil_shark_notify_event_t *ev)
+{
+    watch_pending_t *p = fossil_shark_watch_pending(ctx, ev->path);
+    if (!p)
+    {
+        fossil_shark_watch_report(ctx, ev); // no memory to hold it back
+        return;
+    }
+
+    bool fresh = p->net.event.kind == 0;
+    if (fresh)
+    {
+        p->has_before = ctx->ev_before != NULL;
+        if (p->has_before)
+            p->before = *ctx->ev_before;
+    }
+    fossil_shark_watch_fold(&p->net, ev, ctx->ev_before != NULL);
+
+    uint64_t now = fossil_shark_watch_now_ns();
+    if (ctx->pending_count == 1 && fresh)
+        ctx->first_ns = now;
+    ctx->last_ns = now;
+}
+
+// Report the open window in first-seen order and start a new one
+static void fossil_shark_watch_flush(watch_ctx_t *ctx)
+{
+    if (ctx->pending_count == 0)
+        return;
+
+    // Collapse every entry first so a batch header can give the batch size
+    size_t shown = 0;
+    for (size_t i = 0; i < ctx->pending_count; ++i)
+    {
+        watch_pending_t *p = &ctx->pending[i];
+        const char *filter, *etype;
+        p->live = fossil_shark_watch_collapse(&p->net, &p->net.event);
+        // Judge content on the net result, so truncate-then-rewrite of the same bytes is no change
+        if (p->live && ctx->content && p->has_before && p->net.event.kind == FOSSIL_SHARK_NOTIFY_MODIFY &&
+            !p->net.event.is_dir && !p->before.is_dir &&
+            !fossil_shark_watch_content_changed(&p->before, ctx->snap, p->net.event.path))
+            p->live = false;
+        p->shown = p->live && fossil_shark_watch_classify(&p->net.event, &filter, &etype) &&
+                   fossil_shark_watch_wants(ctx->events, filter);
+        shown += p->shown;
+    }
+
+    if (ctx->batch && shown > 0)
+    {
+        ctx->batch_seq++;
+        if (!ctx->ring)
+            fossil_io_printf("{cyan,bold}batch:{normal} %zu change(s)\n", shown);
+    }
+
+    for (size_t i = 0; i < ctx->pending_count; ++i)
+    {
+        if (ctx->pending[i].live)
+            fossil_shark_watch_report(ctx, &ctx->pending[i].net.event);
+    }
+
+    if (ctx->jobs && shown > 0)
+    {
+        const char **paths = fossil_sys_memory_alloc(shown * sizeof(char *));
+        if (paths)
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < ctx->pending_count; ++i)
             {
-                fossil_io_filesys_obj_t prev_obj = st;
-                while (1)
-                {
-                    sleep(interval);
-                    fossil_shark_watch_file(entry->path, events, &prev_obj);
-                }
+                if (ctx->pending[i].shown)
+                    paths[n++] = ctx->pending[i].net.event.path;
             }
+            fossil_shark_jobs_submit(ctx->jobs, paths, n);
+            fossil_sys_memory_free(paths);
         }
     }
+
+    ctx->pending_count = 0;
+    memset(ctx->table, 0, (ctx->table_mask + 1) * sizeof(size_t));
 }
-#endif
 
-#if defined(_WIN32) || defined(_WIN64)
+// Entry point for every backend: report now, or hold back until the window closes
+static void fossil_shark_watch_dispatch(const fossil_shark_notify_event_t *ev, void *user)
+{
+    watch_ctx_t *ctx = (watch_ctx_t *)user;
+    if (ev->kind == FOSSIL_SHARK_NOTIFY_OVERFLOW)
+        return;
+    if (ctx->debounce_ms <= 0)
+        fossil_shark_watch_report(ctx, ev);
+    else
+        fossil_shark_watch_coalesce(ctx, ev);
+}
 
-static wchar_t *fossil_utf8_to_wide(const char *s)
+// Snapshot diff callback: drops content-neutral modifies before dispatching
+static void fossil_shark_watch_diff_event(const fossil_shark_notify_event_t *ev, void *user)
 {
-    if (!s)
-        return NULL;
-    int len = MultiByteToWideChar(CP_UTF8, 0, s, -1, NULL, 0);
-    wchar_t *w = (wchar_t *)malloc(len * sizeof(wchar_t));
-    if (!w)
-        return NULL;
-    MultiByteToWideChar(CP_UTF8, 0, s, -1, w, len);
-    return w;
+    watch_ctx_t *ctx = (watch_ctx_t *)user;
+    fossil_shark_snapshot_info_t before;
+    if (ctx->content && ev->kind == FOSSIL_SHARK_NOTIFY_MODIFY && !ev->is_dir &&
+        fossil_shark_snapshot_lookup(ctx->diff_old, ev->path, &before) &&
+        !fossil_shark_watch_content_changed(&before, ctx->diff_new, ev->path))
+        return;
+    fossil_shark_watch_dispatch(ev, user);
 }
 
-static int fossil_shark_watch_windows_recursive(
-    const char *path,
-    const char *events)
+// Helper: report what changed between two snapshots
+static void fossil_shark_watch_diff(watch_ctx_t *ctx, const fossil_shark_snapshot_t *old_snap,
+                                    fossil_shark_snapshot_t *new_snap)
 {
-    wchar_t *wpath = fossil_utf8_to_wide(path);
-    if (!wpath)
-        return ERROR_NOT_ENOUGH_MEMORY;
+    if (ctx->content)
+        fossil_shark_snapshot_fingerprint(new_snap, 0);
+    ctx->diff_old = old_snap;
+    ctx->diff_new = new_snap;
+    fossil_shark_snapshot_diff(old_snap, new_snap, fossil_shark_watch_diff_event, ctx);
+    ctx->diff_old = NULL;
+    ctx->diff_new = NULL;
+}
 
-    HANDLE dir = CreateFileW(
-        wpath,
-        FILE_LIST_DIRECTORY,
-        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-        NULL,
-        OPEN_EXISTING,
-        FILE_FLAG_BACKUP_SEMANTICS,
-        NULL);
+// Helper: milliseconds until the open window must be flushed, -1 when none is open
+static int fossil_shark_watch_timeout(const watch_ctx_t *ctx)
+{
+    if (ctx->pending_count == 0)
+        return ctx->jobs_active ? WATCH_JOBS_POLL_MS : -1;
 
-    free(wpath);
+    uint64_t window = (uint64_t)ctx->debounce_ms * 1000000ull;
+    uint64_t quiet = ctx->last_ns + window;
+    uint64_t cap = ctx->first_ns + window * WATCH_DEBOUNCE_MAX_FACTOR;
+    uint64_t deadline = quiet < cap ? quiet : cap;
+    uint64_t now = fossil_shark_watch_now_ns();
+    if (now >= deadline)
+        return 0;
+    int ms = (int)((deadline - now + 999999) / 1000000);
+    return ctx->jobs_active && ms > WATCH_JOBS_POLL_MS ? WATCH_JOBS_POLL_MS : ms;
+}
 
-    if (dir == INVALID_HANDLE_VALUE)
-        return GetLastError();
+static void fossil_shark_watch_ctx_free(watch_ctx_t *ctx)
+{
+    fossil_shark_jobs_free(ctx->jobs);
+    ctx->jobs = NULL;
+    fossil_shark_watch_writer_stop(ctx);
+    fossil_sys_memory_free(ctx->pending);
+    fossil_sys_memory_free(ctx->table);
+    ctx->pending = NULL;
+    ctx->table = NULL;
+}
 
-    BYTE buffer[64 * 1024];
-    DWORD bytes;
+/*
+ * Native backend: block in the kernel until something changes, so an idle
+ * watch costs no CPU and events are reported as soon as they happen. A
+ * snapshot kept current from the event stream turns a queue overflow into
+ * a rescan that reports exactly what was missed.
+ */
+static int fossil_shark_watch_native(fossil_shark_notify_t *notify, watch_ctx_t *ctx, bool recursive)
+{
+    fossil_shark_notify_event_t *batch =
+        fossil_sys_memory_alloc(WATCH_EVENT_BATCH * sizeof(fossil_shark_notify_event_t));
+    if (!batch)
+    {
+        fossil_shark_notify_close(notify);
+        return ENOMEM;
+    }
+
+    fossil_shark_snapshot_t *snap = cnull;
+    fossil_shark_snapshot_take(&snap, ctx->root, recursive, cnull, 0);
+    if (ctx->content && snap)
+        fossil_shark_snapshot_fingerprint(snap, 0);
+    ctx->snap = snap;
 
-    while (1)
+    int rc = 0;
+    while (!ctx->root_gone)
     {
-        if (!ReadDirectoryChangesW(
-                dir,
-                buffer,
-                sizeof(buffer),
-                TRUE, /* recursive */
-                FILE_NOTIFY_CHANGE_FILE_NAME |
-                    FILE_NOTIFY_CHANGE_DIR_NAME |
-                    FILE_NOTIFY_CHANGE_SIZE |
-                    FILE_NOTIFY_CHANGE_LAST_WRITE,
-                &bytes,
-                NULL,
-                NULL))
+        size_t count = 0;
+        rc = fossil_shark_notify_read(notify, batch, WATCH_EVENT_BATCH, &count,
+                                      fossil_shark_watch_timeout(ctx));
+        if (rc != 0)
             break;
 
-        FILE_NOTIFY_INFORMATION *fni =
-            (FILE_NOTIFY_INFORMATION *)buffer;
-
-        do
+        for (size_t i = 0; i < count && !ctx->root_gone; ++i)
         {
-            char filename[1024];
-            int flen = WideCharToMultiByte(
-                CP_UTF8, 0,
-                fni->FileName,
-                fni->FileNameLength / sizeof(WCHAR),
-                filename,
-                sizeof(filename) - 1,
-                NULL,
-                NULL);
-            filename[flen] = '\0';
+            if (batch[i].kind != FOSSIL_SHARK_NOTIFY_OVERFLOW)
+            {
+                const char *changed = batch[i].path;
+                fossil_shark_snapshot_info_t before;
+                bool has_before = fossil_shark_snapshot_lookup(snap, changed, &before);
 
-            bool emit = false;
-            const char *etype = NULL;
+                // Apply first: the snapshot supplies the inode inotify leaves out
+                fossil_shark_snapshot_apply(snap, &batch[i]);
+                batch[i].inode = fossil_shark_snapshot_inode(snap, changed);
+                if (ctx->content && batch[i].kind == FOSSIL_SHARK_NOTIFY_CREATE && !batch[i].is_dir)
+                    fossil_shark_watch_content_seed(snap, changed);
 
-            switch (fni->Action)
-            {
-            case FILE_ACTION_ADDED:
-                emit = fossil_io_cstring_icontains(events, "create");
-                etype = "created";
-                break;
-            case FILE_ACTION_REMOVED:
-                emit = fossil_io_cstring_icontains(events, "delete");
-                etype = "deleted";
-                break;
-            case FILE_ACTION_MODIFIED:
-                emit = fossil_io_cstring_icontains(events, "modify");
-                etype = "modified";
-                break;
-            case FILE_ACTION_RENAMED_OLD_NAME:
-            case FILE_ACTION_RENAMED_NEW_NAME:
-                emit = fossil_io_cstring_icontains(events, "rename");
-                etype = "renamed";
-                break;
+                // Coalescing compares against the state before the window (existence, --content)
+                ctx->ev_before = has_before ? &before : NULL;
+                fossil_shark_watch_dispatch(&batch[i], ctx);
+                ctx->ev_before = NULL;
+                continue;
             }
 
-            if (emit)
+            if (ctx->ring)
+                fossil_shark_watch_push(ctx, &batch[i]);
+            else
+                fossil_io_printf("{red}Warning: event queue overflowed, rescanning{normal}\n");
+            fossil_shark_snapshot_t *fresh = cnull;
+            int scan_rc = fossil_shark_snapshot_take(&fresh, ctx->root, recursive, snap, 0);
+            if (scan_rc == ENOENT)
+            {
+                fossil_shark_watch_report_root(ctx);
+            }
+            else if (scan_rc == 0)
             {
-                cstring msg = fossil_io_cstring_format(
-                    "{yellow}%s:{normal} %s\n",
-                    etype, filename);
-                fossil_io_filesys_file_write(
-                    FOSSIL_STDOUT,
-                    msg,
-                    fossil_io_cstring_length(msg),
-                    1);
-                fossil_io_cstring_free(msg);
+                fossil_shark_watch_diff(ctx, snap, fresh);
+                fossil_shark_snapshot_free(snap);
+                snap = fresh;
+                ctx->snap = snap;
             }
+        }
 
-            if (!fni->NextEntryOffset)
-                break;
+        if (fossil_shark_watch_timeout(ctx) == 0)
+            fossil_shark_watch_flush(ctx);
+        ctx->jobs_active = fossil_shark_jobs_poll(ctx->jobs);
+    }
+    fossil_shark_watch_flush(ctx);
 
-            fni = (FILE_NOTIFY_INFORMATION *)((BYTE *)fni + fni->NextEntryOffset);
-        } while (1);
+    ctx->snap = NULL;
+    fossil_shark_snapshot_free(snap);
+    fossil_sys_memory_free(batch);
+    fossil_shark_notify_close(notify);
+    return rc;
+}
+
+// Polling backend for filesystems without change notifications (NFS, SMB)
+static int fossil_shark_watch_poll(watch_ctx_t *ctx, bool recursive, int interval)
+{
+    fossil_shark_snapshot_t *prev = cnull;
+    int rc = fossil_shark_snapshot_take(&prev, ctx->root, recursive, cnull, 0);
+    if (rc != 0)
+        return rc;
+    if (ctx->content)
+        fossil_shark_snapshot_fingerprint(prev, 0);
+
+    while (!ctx->root_gone)
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        Sleep((DWORD)(interval * 1000));
+#else
+        sleep(interval);
+#endif
+
+        fossil_shark_snapshot_t *next = cnull;
+        rc = fossil_shark_snapshot_take(&next, ctx->root, recursive, prev, 0);
+        if (rc == ENOENT)
+        {
+            fossil_shark_watch_report_root(ctx);
+            rc = 0;
+            break;
+        }
+        if (rc != 0)
+            continue; // transient errors are common on network mounts
+
+        // One pass is already one window, so flush what it found right away
+        fossil_shark_watch_diff(ctx, prev, next);
+        fossil_shark_watch_flush(ctx);
+        fossil_shark_jobs_poll(ctx->jobs);
+        fossil_shark_snapshot_free(prev);
+        prev = next;
     }
 
-    CloseHandle(dir);
-    return 0;
+    fossil_shark_snapshot_free(prev);
+    return rc;
 }
 
-static int fossil_shark_watch_windows(
-    const char *path,
-    const char *events)
+#if defined(_WIN32) || defined(_WIN64)
+
+static wchar_t *fossil_utf8_to_wide(const char *s)
 {
-    wchar_t *wpath = fossil_utf8_to_wide(path);
+    if (!s)
+        return NULL;
+    int len = MultiByteToWideChar(CP_UTF8, 0, s, -1, NULL, 0);
+    wchar_t *w = (wchar_t *)malloc(len * sizeof(wchar_t));
+    if (!w)
+        return NULL;
+    MultiByteToWideChar(CP_UTF8, 0, s, -1, w, len);
+    return w;
+}
+
+/*
+ * ReadDirectoryChangesW backend. Each notification becomes an event on the
+ * same path as the other backends, so the filter, coalescing, --media jsonl
+ * and --exec behave alike; one call's worth of notifications is one window.
+ */
+static int fossil_shark_watch_windows(watch_ctx_t *ctx, bool recursive)
+{
+    wchar_t *wpath = fossil_utf8_to_wide(ctx->root);
     if (!wpath)
         return ERROR_NOT_ENOUGH_MEMORY;
 
@@ -233,18 +846,24 @@ static int fossil_shark_watch_windows(
     free(wpath);
 
     if (dir == INVALID_HANDLE_VALUE)
-        return GetLastError();
+    {
+        DWORD err = GetLastError();
+        if (err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND)
+            fossil_shark_watch_report_root(ctx);
+        return err;
+    }
 
     BYTE buffer[64 * 1024];
     DWORD bytes;
+    uint32_t cookie = 0;
 
-    while (1)
+    while (!ctx->root_gone)
     {
         if (!ReadDirectoryChangesW(
                 dir,
                 buffer,
                 sizeof(buffer),
-                FALSE, /* non-recursive */
+                recursive ? TRUE : FALSE,
                 FILE_NOTIFY_CHANGE_FILE_NAME |
                     FILE_NOTIFY_CHANGE_DIR_NAME |
                     FILE_NOTIFY_CHANGE_SIZE |
@@ -252,7 +871,11 @@ static int fossil_shark_watch_windows(
                 &bytes,
                 NULL,
                 NULL))
+        {
+            if (GetFileAttributesA(ctx->root) == INVALID_FILE_ATTRIBUTES)
+                fossil_shark_watch_report_root(ctx);
             break;
+        }
 
         FILE_NOTIFY_INFORMATION *fni =
             (FILE_NOTIFY_INFORMATION *)buffer;
@@ -270,49 +893,45 @@ static int fossil_shark_watch_windows(
                 NULL);
             filename[flen] = '\0';
 
-            bool emit = false;
-            const char *etype = NULL;
+            fossil_shark_notify_event_t ev;
+            memset(&ev, 0, sizeof(ev));
+            snprintf(ev.path, sizeof(ev.path), "%s\\%s", ctx->root, filename);
+            DWORD attrs = GetFileAttributesA(ev.path);
+            ev.is_dir = attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY);
 
             switch (fni->Action)
             {
             case FILE_ACTION_ADDED:
-                emit = fossil_io_cstring_icontains(events, "create");
-                etype = "created";
+                ev.kind = FOSSIL_SHARK_NOTIFY_CREATE;
                 break;
             case FILE_ACTION_REMOVED:
-                emit = fossil_io_cstring_icontains(events, "delete");
-                etype = "deleted";
+                ev.kind = FOSSIL_SHARK_NOTIFY_DELETE;
                 break;
             case FILE_ACTION_MODIFIED:
-                emit = fossil_io_cstring_icontains(events, "modify");
-                etype = "modified";
+                ev.kind = FOSSIL_SHARK_NOTIFY_MODIFY;
                 break;
             case FILE_ACTION_RENAMED_OLD_NAME:
+                // The new name follows under the same cookie
+                ev.kind = FOSSIL_SHARK_NOTIFY_RENAME;
+                ev.cookie = ++cookie;
+                break;
             case FILE_ACTION_RENAMED_NEW_NAME:
-                emit = fossil_io_cstring_icontains(events, "rename");
-                etype = "renamed";
+                ev.kind = FOSSIL_SHARK_NOTIFY_CREATE;
+                ev.cookie = cookie;
                 break;
             }
 
-            if (emit)
-            {
-                cstring msg = fossil_io_cstring_format(
-                    "{yellow}%s:{normal} %s\n",
-                    etype,
-                    filename);
-                fossil_io_filesys_file_write(
-                    FOSSIL_STDOUT,
-                    msg,
-                    fossil_io_cstring_length(msg),
-                    1);
-                fossil_io_cstring_free(msg);
-            }
+            if (ev.kind != 0)
+                fossil_shark_watch_dispatch(&ev, ctx);
 
             if (!fni->NextEntryOffset)
                 break;
 
             fni = (FILE_NOTIFY_INFORMATION *)((BYTE *)fni + fni->NextEntryOffset);
         } while (1);
+
+        fossil_shark_watch_flush(ctx);
+        fossil_shark_jobs_poll(ctx->jobs);
     }
 
     CloseHandle(dir);
@@ -322,12 +941,42 @@ static int fossil_shark_watch_windows(
 #endif
 
 int fossil_shark_watch(const char *path, bool recursive,
-                       const char *events, int interval)
+                       const char *events, int interval, bool poll,
+                       int debounce_ms, bool batch,
+                       const char *exec, size_t jobs, bool restart,
+                       const char *media, bool content)
 {
     if (interval <= 0)
     {
         interval = 1; /* safety default */
     }
+    bool jsonl = cnotnull(media) && fossil_io_cstring_iequals(media, "jsonl");
+    if (debounce_ms < 0 || (cnotnull(media) && !jsonl && !fossil_io_cstring_iequals(media, "text")))
+        return EINVAL;
+    if ((batch || cnotnull(exec) || content) && debounce_ms == 0)
+        debounce_ms = WATCH_BATCH_DEFAULT_MS;
+
+    watch_ctx_t ctx = {0};
+    ctx.root = path;
+    ctx.events = events;
+    ctx.debounce_ms = debounce_ms;
+    ctx.batch = batch;
+    ctx.content = content;
+    if (cnotnull(exec))
+    {
+        int jobs_rc = fossil_shark_jobs_create(&ctx.jobs, exec, jobs, restart, jsonl);
+        if (jobs_rc != 0)
+            return jobs_rc;
+    }
+    if (jsonl)
+    {
+        int writer_rc = fossil_shark_watch_writer_start(&ctx);
+        if (writer_rc != 0)
+        {
+            fossil_shark_watch_ctx_free(&ctx);
+            return writer_rc;
+        }
+    }
 
 #if defined(_WIN32) || defined(_WIN64)
 
@@ -336,27 +985,30 @@ int fossil_shark_watch(const char *path, bool recursive,
         path,
         interval,
         recursive ? " (recursive enabled)" : "");
+    // Keep stdout clean for machine-readable output
     fossil_io_filesys_file_write(
-        FOSSIL_STDOUT,
+        ctx.ring ? FOSSIL_STDERR : FOSSIL_STDOUT,
         msg,
         fossil_io_cstring_length(msg),
         1);
     fossil_io_cstring_free(msg);
 
-    while (1)
+    if (poll)
     {
-        if (recursive)
-        {
-            fossil_shark_watch_windows_recursive(path, events);
-        }
-        else
-        {
-            fossil_shark_watch_windows(path, events);
-        }
+        int poll_rc = fossil_shark_watch_poll(&ctx, recursive, interval);
+        fossil_shark_watch_ctx_free(&ctx);
+        return poll_rc;
+    }
+
+    while (!ctx.root_gone)
+    {
+        fossil_shark_watch_windows(&ctx, recursive);
 
         /* Windows sleep uses milliseconds */
         Sleep((DWORD)(interval * 1000));
     }
+    fossil_shark_watch_ctx_free(&ctx);
+    return 0;
 
 #else /* POSIX */
 
@@ -371,7 +1023,28 @@ int fossil_shark_watch(const char *path, bool recursive,
             fossil_io_cstring_length(err_msg),
             1);
         fossil_io_cstring_free(err_msg);
-        return errno;
+        int stat_rc = errno;
+        fossil_shark_watch_ctx_free(&ctx);
+        return stat_rc;
+    }
+
+    bool recursive_dir = recursive && st.type == FOSSIL_FILESYS_TYPE_DIR;
+    fossil_shark_notify_t *notify = cnull;
+    if (!poll && fossil_shark_notify_open(&notify, path, recursive_dir) == 0)
+    {
+        cstring native_msg = fossil_io_cstring_format(
+            "{green,bold}Watching %s for changes...{reset}%s\n",
+            path,
+            recursive_dir ? " (recursive enabled)" : "");
+        fossil_io_filesys_file_write(
+            ctx.ring ? FOSSIL_STDERR : FOSSIL_STDOUT,
+            native_msg,
+            fossil_io_cstring_length(native_msg),
+            1);
+        fossil_io_cstring_free(native_msg);
+        int native_rc = fossil_shark_watch_native(notify, &ctx, recursive_dir);
+        fossil_shark_watch_ctx_free(&ctx);
+        return native_rc;
     }
 
     cstring msg = fossil_io_cstring_format(
@@ -380,25 +1053,15 @@ int fossil_shark_watch(const char *path, bool recursive,
         interval,
         recursive ? " (recursive enabled)" : "");
     fossil_io_filesys_file_write(
-        FOSSIL_STDOUT,
+        ctx.ring ? FOSSIL_STDERR : FOSSIL_STDOUT,
         msg,
         fossil_io_cstring_length(msg),
         1);
     fossil_io_cstring_free(msg);
 
-    if (recursive && st.type == FOSSIL_FILESYS_TYPE_DIR)
-    {
-        fossil_shark_watch_dir(path, events, interval);
-    }
-    else
-    {
-        fossil_io_filesys_obj_t prev_obj = st;
-        while (1)
-        {
-            sleep(interval);
-            fossil_shark_watch_file(path, events, &prev_obj);
-        }
-    }
+    int poll_rc = fossil_shark_watch_poll(&ctx, recursive_dir, interval);
+    fossil_shark_watch_ctx_free(&ctx);
+    return poll_rc;
 
 #endif
 
@@ -25,6 +25,7 @@
 #include <fossil/maip/framework.h>
 
 #include "fossil/code/app.h"
+#include "fossil/code/diff.h"
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Utilites
@@ -56,20 +57,62 @@ FOSSIL_TEARDOWN(c_compare_command_suite)
 // as samples for library usage.
 // * * * * * * * * * * * * * * * * * * * * * * * *
 
+// Helper: kept lines must pair up equal and in order; returns how many are kept
+static size_t diff_kept_pairs(const uint32_t *a, size_t n, const uint32_t *b, size_t m,
+                              const bool *removed, const bool *added, bool *consistent)
+{
+    size_t i = 0, j = 0, kept = 0;
+    *consistent = true;
+    for (;;)
+    {
+        while (i < n && removed[i])
+            ++i;
+        while (j < m && added[j])
+            ++j;
+        if (i == n || j == m)
+            break;
+        if (a[i] != b[j])
+            *consistent = false;
+        ++i;
+        ++j;
+        ++kept;
+    }
+    if (i != n || j != m)
+        *consistent = false;
+    return kept;
+}
+
+// Helper: longest common subsequence by the quadratic table
+static size_t diff_lcs_length(const uint32_t *a, size_t n, const uint32_t *b, size_t m)
+{
+    size_t table[13][13] = {{0}};
+    for (size_t i = 1; i <= n; ++i)
+    {
+        for (size_t j = 1; j <= m; ++j)
+        {
+            if (a[i - 1] == b[j - 1])
+                table[i][j] = table[i - 1][j - 1] + 1;
+            else
+                table[i][j] = table[i - 1][j] > table[i][j - 1] ? table[i - 1][j] : table[i][j - 1];
+        }
+    }
+    return table[n][m];
+}
+
 // Test cases for fossil_shark_compare function
 
 FOSSIL_TEST(c_test_compare_null_parameters)
 {
     // Test with null path1
-    int result = fossil_shark_compare(cnull, "test.txt", true, false, 0, false);
+    int result = fossil_shark_compare(cnull, "test.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Test with null path2
-    result = fossil_shark_compare("test.txt", cnull, true, false, 0, false);
+    result = fossil_shark_compare("test.txt", cnull, true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Test with both null
-    result = fossil_shark_compare(cnull, cnull, true, false, 0, false);
+    result = fossil_shark_compare(cnull, cnull, true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 }
 
@@ -87,7 +130,7 @@ FOSSIL_TEST(c_test_compare_identical_text_files)
     fclose(file2);
 
     // Compare identical files
-    int result = fossil_shark_compare("identical1.txt", "identical2.txt", true, false, 0, false);
+    int result = fossil_shark_compare("identical1.txt", "identical2.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     // Clean up
@@ -109,7 +152,7 @@ FOSSIL_TEST(c_test_compare_different_text_files)
     fclose(file2);
 
     // Compare different files
-    int result = fossil_shark_compare("different1.txt", "different2.txt", true, false, 0, false);
+    int result = fossil_shark_compare("different1.txt", "different2.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Clean up
@@ -132,7 +175,7 @@ FOSSIL_TEST(c_test_compare_identical_binary_files)
     fclose(file2);
 
     // Compare identical binary files
-    int result = fossil_shark_compare("binary1.bin", "binary2.bin", false, true, 0, false);
+    int result = fossil_shark_compare("binary1.bin", "binary2.bin", false, true, 0, false, cnull, false, false, false, 0);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     // Clean up
@@ -156,7 +199,7 @@ FOSSIL_TEST(c_test_compare_different_binary_files)
     fclose(file2);
 
     // Compare different binary files
-    int result = fossil_shark_compare("binary_diff1.bin", "binary_diff2.bin", false, true, 0, false);
+    int result = fossil_shark_compare("binary_diff1.bin", "binary_diff2.bin", false, true, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Clean up
@@ -178,7 +221,7 @@ FOSSIL_TEST(c_test_compare_case_sensitive)
     fclose(file2);
 
     // Compare with case sensitivity (should find differences)
-    int result = fossil_shark_compare("case1.txt", "case2.txt", true, false, 0, false);
+    int result = fossil_shark_compare("case1.txt", "case2.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Clean up
@@ -200,7 +243,7 @@ FOSSIL_TEST(c_test_compare_case_insensitive)
     fclose(file2);
 
     // Compare with case insensitivity (should be identical)
-    int result = fossil_shark_compare("case_ignore1.txt", "case_ignore2.txt", true, false, 0, true);
+    int result = fossil_shark_compare("case_ignore1.txt", "case_ignore2.txt", true, false, 0, true, cnull, false, false, false, 0);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     // Clean up
@@ -222,7 +265,7 @@ FOSSIL_TEST(c_test_compare_with_context_lines)
     fclose(file2);
 
     // Compare with context lines
-    int result = fossil_shark_compare("context1.txt", "context2.txt", true, false, 2, false);
+    int result = fossil_shark_compare("context1.txt", "context2.txt", true, false, 2, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Clean up
@@ -242,7 +285,7 @@ FOSSIL_TEST(c_test_compare_empty_files)
     fclose(file2);
 
     // Compare empty files
-    int result = fossil_shark_compare("empty1.txt", "empty2.txt", true, false, 0, false);
+    int result = fossil_shark_compare("empty1.txt", "empty2.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     // Clean up
@@ -264,7 +307,7 @@ FOSSIL_TEST(c_test_compare_different_length_files)
     fclose(file2);
 
     // Compare files with different lengths
-    int result = fossil_shark_compare("short.txt", "long.txt", true, false, 0, false);
+    int result = fossil_shark_compare("short.txt", "long.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Clean up
@@ -275,7 +318,7 @@ FOSSIL_TEST(c_test_compare_different_length_files)
 FOSSIL_TEST(c_test_compare_nonexistent_files)
 {
     // Try to compare non-existent files
-    int result = fossil_shark_compare("nonexistent1.txt", "nonexistent2.txt", true, false, 0, false);
+    int result = fossil_shark_compare("nonexistent1.txt", "nonexistent2.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 }
 
@@ -288,7 +331,7 @@ FOSSIL_TEST(c_test_compare_one_nonexistent_file)
     fclose(file1);
 
     // Try to compare existing file with non-existent file
-    int result = fossil_shark_compare("exists.txt", "nonexistent.txt", true, false, 0, false);
+    int result = fossil_shark_compare("exists.txt", "nonexistent.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Clean up
@@ -309,7 +352,7 @@ FOSSIL_TEST(c_test_compare_neither_text_nor_binary)
     fclose(file2);
 
     // Try to compare without specifying text or binary mode
-    int result = fossil_shark_compare("neither1.txt", "neither2.txt", false, false, 0, false);
+    int result = fossil_shark_compare("neither1.txt", "neither2.txt", false, false, 0, false, cnull, false, false, false, 0);
     ASSUME_NOT_EQUAL_I32(0, result);
 
     // Clean up
@@ -337,7 +380,7 @@ FOSSIL_TEST(c_test_compare_large_files)
     fclose(file2);
 
     // Compare large identical files
-    int result = fossil_shark_compare("large1.txt", "large2.txt", true, false, 0, false);
+    int result = fossil_shark_compare("large1.txt", "large2.txt", true, false, 0, false, cnull, false, false, false, 0);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     // Clean up
@@ -345,6 +388,301 @@ FOSSIL_TEST(c_test_compare_large_files)
     remove("large2.txt");
 }
 
+FOSSIL_TEST(c_test_compare_inserted_line_algorithms)
+{
+    FILE *file1 = fopen("inserted1.txt", "w");
+    ASSUME_NOT_CNULL(file1);
+    FILE *file2 = fopen("inserted2.txt", "w");
+    ASSUME_NOT_CNULL(file2);
+    for (int i = 0; i < 200; i++)
+    {
+        fprintf(file1, "key_%d = %d\n", i, i);
+        if (i == 50)
+            fprintf(file2, "new_key = 1\n");
+        fprintf(file2, "key_%d = %d\n", i, i);
+    }
+    fclose(file1);
+    fclose(file2);
+
+    // One inserted line is a difference for both algorithms
+    int result = fossil_shark_compare("inserted1.txt", "inserted2.txt", true, false, 3, false, "myers", false, false, false, 0);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    result = fossil_shark_compare("inserted1.txt", "inserted2.txt", true, false, 3, false, "histogram", false, false, false, 0);
+    ASSUME_NOT_EQUAL_I32(0, result);
+
+    // An unknown algorithm is an error even for identical files
+    result = fossil_shark_compare("inserted1.txt", "inserted1.txt", true, false, 3, false, "bogus", false, false, false, 0);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    result = fossil_shark_compare("inserted1.txt", "inserted1.txt", true, false, 3, false, "histogram", false, false, false, 0);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    remove("inserted1.txt");
+    remove("inserted2.txt");
+}
+
+FOSSIL_TEST(c_test_compare_diff_inserted_line)
+{
+    uint32_t a[200], b[201];
+    for (uint32_t i = 0; i < 200; i++)
+        a[i] = i;
+    for (uint32_t i = 0, j = 0; j < 201; j++)
+        b[j] = j == 50 ? 200 : a[i++];
+
+    const fossil_shark_diff_algorithm_t algorithms[] = {FOSSIL_SHARK_DIFF_MYERS, FOSSIL_SHARK_DIFF_HISTOGRAM};
+    for (size_t k = 0; k < 2; k++)
+    {
+        bool removed[200], added[201];
+        ASSUME_ITS_EQUAL_I32(0, fossil_shark_diff(a, 200, b, 201, 201, algorithms[k], removed, added));
+
+        size_t removed_count = 0, added_count = 0;
+        for (size_t i = 0; i < 200; i++)
+            removed_count += removed[i];
+        for (size_t j = 0; j < 201; j++)
+            added_count += added[j];
+        ASSUME_ITS_EQUAL_I32(0, (int)removed_count);
+        ASSUME_ITS_EQUAL_I32(1, (int)added_count);
+        ASSUME_ITS_TRUE(added[50]);
+    }
+}
+
+FOSSIL_TEST(c_test_compare_diff_myers_minimal)
+{
+    // Small sequences over three IDs hold many equal-length alternatives;
+    // Myers must always keep as many lines as the longest common subsequence
+    uint32_t seed = 2024;
+    for (int trial = 0; trial < 500; trial++)
+    {
+        uint32_t a[12], b[12];
+        seed = seed * 1103515245u + 12345u;
+        size_t n = (seed >> 16) % 13;
+        seed = seed * 1103515245u + 12345u;
+        size_t m = (seed >> 16) % 13;
+        for (size_t i = 0; i < n; i++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            a[i] = (seed >> 16) % 3;
+        }
+        for (size_t j = 0; j < m; j++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            b[j] = (seed >> 16) % 3;
+        }
+
+        bool removed[12], added[12], consistent;
+        ASSUME_ITS_EQUAL_I32(0, fossil_shark_diff(a, n, b, m, 3, FOSSIL_SHARK_DIFF_MYERS, removed, added));
+        size_t kept = diff_kept_pairs(a, n, b, m, removed, added, &consistent);
+        ASSUME_ITS_TRUE(consistent);
+        ASSUME_ITS_EQUAL_I32((int)diff_lcs_length(a, n, b, m), (int)kept);
+
+        // Histogram need not be minimal, but its script must still be valid
+        ASSUME_ITS_EQUAL_I32(0, fossil_shark_diff(a, n, b, m, 3, FOSSIL_SHARK_DIFF_HISTOGRAM, removed, added));
+        diff_kept_pairs(a, n, b, m, removed, added, &consistent);
+        ASSUME_ITS_TRUE(consistent);
+    }
+}
+
+FOSSIL_TEST(c_test_compare_binary_all_ranges)
+{
+    unsigned char data1[300000], data2[300000];
+    for (size_t i = 0; i < sizeof(data1); i++)
+        data1[i] = data2[i] = (unsigned char)(i * 31);
+    // Two separate runs, the second spanning a 4 KiB boundary
+    memset(data2 + 100, 0xAA, 10);
+    for (size_t i = 4090; i < 4100; i++)
+        data2[i] = (unsigned char)~data1[i];
+
+    FILE *file1 = fopen("ranges1.bin", "wb");
+    ASSUME_NOT_CNULL(file1);
+    fwrite(data1, 1, sizeof(data1), file1);
+    fclose(file1);
+    FILE *file2 = fopen("ranges2.bin", "wb");
+    ASSUME_NOT_CNULL(file2);
+    fwrite(data2, 1, sizeof(data2), file2);
+    fclose(file2);
+
+    int result = fossil_shark_compare("ranges1.bin", "ranges2.bin", false, true, 0, false, cnull, true, false, false, 0);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    result = fossil_shark_compare("ranges1.bin", "ranges1.bin", false, true, 0, false, cnull, true, false, false, 0);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    fossil_shark_compare_range_t ranges[4];
+    size_t count = 0;
+    result = fossil_shark_compare_binary("ranges1.bin", "ranges2.bin", true, 0, ranges, 4, &count);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    ASSUME_ITS_EQUAL_I32(2, (int)count);
+    ASSUME_ITS_EQUAL_I32(100, (int)ranges[0].start);
+    ASSUME_ITS_EQUAL_I32(110, (int)ranges[0].end);
+    ASSUME_ITS_EQUAL_I32(4090, (int)ranges[1].start);
+    ASSUME_ITS_EQUAL_I32(4100, (int)ranges[1].end);
+
+    // Without all_ranges only the first differing byte comes back
+    result = fossil_shark_compare_binary("ranges1.bin", "ranges2.bin", false, 0, ranges, 4, &count);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    ASSUME_ITS_EQUAL_I32(1, (int)count);
+    ASSUME_ITS_EQUAL_I32(100, (int)ranges[0].start);
+
+    remove("ranges1.bin");
+    remove("ranges2.bin");
+}
+
+FOSSIL_TEST(c_test_compare_binary_parallel_jobs)
+{
+    // Four 8 MiB spans; the first difference is in the third and the fourth
+    // differs too, so the lower span must win however the workers race
+    enum { BLOCK = 1024 * 1024, BLOCKS = 32 };
+    unsigned char *data = malloc(BLOCK);
+    ASSUME_NOT_CNULL(data);
+    for (size_t i = 0; i < BLOCK; i++)
+        data[i] = (unsigned char)(i * 7);
+
+    FILE *file1 = fopen("parallel1.bin", "wb");
+    ASSUME_NOT_CNULL(file1);
+    FILE *file2 = fopen("parallel2.bin", "wb");
+    ASSUME_NOT_CNULL(file2);
+    for (int b = 0; b < BLOCKS; b++)
+    {
+        fwrite(data, 1, BLOCK, file1);
+        if (b == 19 || b == 30)
+            data[BLOCK - 5] ^= 0xFF;
+        fwrite(data, 1, BLOCK, file2);
+        if (b == 19 || b == 30)
+            data[BLOCK - 5] ^= 0xFF;
+    }
+    fclose(file1);
+    fclose(file2);
+    free(data);
+
+    int result = fossil_shark_compare("parallel1.bin", "parallel2.bin", false, true, 0, false, cnull, false, false, false, 4);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    result = fossil_shark_compare("parallel1.bin", "parallel1.bin", false, true, 0, false, cnull, false, false, false, 4);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    fossil_shark_compare_range_t first;
+    size_t count = 0;
+    for (size_t jobs = 1; jobs <= 4; jobs *= 2)
+    {
+        result = fossil_shark_compare_binary("parallel1.bin", "parallel2.bin", false, jobs, &first, 1, &count);
+        ASSUME_NOT_EQUAL_I32(0, result);
+        ASSUME_ITS_EQUAL_I32(1, (int)count);
+        ASSUME_ITS_TRUE(first.start == (uint64_t)19 * BLOCK + BLOCK - 5);
+    }
+
+    remove("parallel1.bin");
+    remove("parallel2.bin");
+}
+
+FOSSIL_TEST(c_test_compare_delta_roundtrip)
+{
+    unsigned char old_data[200000], new_data[210000];
+    for (size_t i = 0; i < sizeof(old_data); i++)
+        old_data[i] = (unsigned char)((i * 2654435761u) >> 13);
+    // New version: a patched region, an insertion and a moved block
+    memcpy(new_data, old_data, 100000);
+    memset(new_data + 5000, 0x5A, 64);
+    memset(new_data + 100000, 0xC3, 10000);
+    memcpy(new_data + 110000, old_data + 100000, 100000);
+    memcpy(new_data + 150000, old_data, 4096);
+
+    FILE *file = fopen("delta_old.bin", "wb");
+    ASSUME_NOT_CNULL(file);
+    fwrite(old_data, 1, sizeof(old_data), file);
+    fclose(file);
+    file = fopen("delta_new.bin", "wb");
+    ASSUME_NOT_CNULL(file);
+    fwrite(new_data, 1, sizeof(new_data), file);
+    fclose(file);
+
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_compare_delta("delta_old.bin", "delta_new.bin", "delta.patch"));
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_compare_apply("delta_old.bin", "delta.patch", "delta_out.bin"));
+    int result = fossil_shark_compare("delta_new.bin", "delta_out.bin", false, true, 0, false, cnull, false, false, false, 0);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // The patch only applies to the file it was made against
+    ASSUME_NOT_EQUAL_I32(0, fossil_shark_compare_apply("delta_new.bin", "delta.patch", "delta_bad.bin"));
+
+    remove("delta_old.bin");
+    remove("delta_new.bin");
+    remove("delta.patch");
+    remove("delta_out.bin");
+}
+
+FOSSIL_TEST(c_test_compare_ignore_space)
+{
+    FILE *file1 = fopen("space1.txt", "w");
+    ASSUME_NOT_CNULL(file1);
+    fprintf(file1, "int  x =\t1;\n  Return X;\n");
+    fclose(file1);
+
+    FILE *file2 = fopen("space2.txt", "w");
+    ASSUME_NOT_CNULL(file2);
+    fprintf(file2, "int x = 1;\nreturn x;   \n");
+    fclose(file2);
+
+    int result = fossil_shark_compare("space1.txt", "space2.txt", true, false, 0, false, cnull, false, true, false, 0);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    result = fossil_shark_compare("space1.txt", "space2.txt", true, false, 0, true, cnull, false, true, false, 0);
+    ASSUME_ITS_EQUAL_I32(0, result);
+    result = fossil_shark_compare("space1.txt", "space2.txt", true, false, 0, true, cnull, false, false, false, 0);
+    ASSUME_NOT_EQUAL_I32(0, result);
+
+    remove("space1.txt");
+    remove("space2.txt");
+}
+
+FOSSIL_TEST(c_test_compare_recursive_trees)
+{
+    mkdir("tree_a", 0700);
+    mkdir("tree_a/sub", 0700);
+    mkdir("tree_b", 0700);
+    mkdir("tree_b/sub", 0700);
+
+    const char *files[] = {"same.txt", "sub/same.txt", "sub/changed.txt"};
+    for (size_t i = 0; i < 3; i++)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "tree_a/%s", files[i]);
+        FILE *file = fopen(path, "w");
+        ASSUME_NOT_CNULL(file);
+        fprintf(file, "content %zu\n", i);
+        fclose(file);
+        snprintf(path, sizeof(path), "tree_b/%s", files[i]);
+        file = fopen(path, "w");
+        ASSUME_NOT_CNULL(file);
+        fprintf(file, i == 2 ? "CONTENT %zu\n" : "content %zu\n", i);
+        fclose(file);
+    }
+
+    // Same entries and sizes everywhere, so only hashing tells the trees apart
+    int result = fossil_shark_compare("tree_a", "tree_b", false, false, 0, false, cnull, false, false, true, 2);
+    ASSUME_NOT_EQUAL_I32(0, result);
+
+    FILE *file = fopen("tree_b/sub/changed.txt", "w");
+    ASSUME_NOT_CNULL(file);
+    fprintf(file, "content %zu\n", (size_t)2);
+    fclose(file);
+    result = fossil_shark_compare("tree_a", "tree_b", false, false, 0, false, cnull, false, false, true, 2);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // An entry on one side only
+    mkdir("tree_a/gone", 0700);
+    result = fossil_shark_compare("tree_a", "tree_b", false, false, 0, false, cnull, false, false, true, 2);
+    ASSUME_NOT_EQUAL_I32(0, result);
+    rmdir("tree_a/gone");
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "tree_a/%s", files[i]);
+        remove(path);
+        snprintf(path, sizeof(path), "tree_b/%s", files[i]);
+        remove(path);
+    }
+    rmdir("tree_a/sub");
+    rmdir("tree_b/sub");
+    rmdir("tree_a");
+    rmdir("tree_b");
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -365,6 +703,14 @@ FOSSIL_TEST_GROUP(c_compare_command_tests)
     FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_one_nonexistent_file);
     FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_neither_text_nor_binary);
     FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_large_files);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_inserted_line_algorithms);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_diff_inserted_line);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_diff_myers_minimal);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_binary_all_ranges);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_binary_parallel_jobs);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_delta_roundtrip);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_ignore_space);
+    FOSSIL_ADD_TEST(c_compare_command_suite, c_test_compare_recursive_trees);
 
     FOSSIL_ADD_SUITE(c_compare_command_suite);
 }
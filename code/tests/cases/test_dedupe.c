@@ -57,10 +57,10 @@ static void create_file(const char* path, const char* content)
 
 FOSSIL_TEST(c_test_dedupe_null_parameters)
 {
-    int result = fossil_shark_dedupe(cnull, true, false, false, false, "text");
+    int result = fossil_shark_dedupe(cnull, true, false, false, false, "text", false, false, 1, false, false, false);
     ASSUME_NOT_EQUAL_I32(0, result);
 
-    result = fossil_shark_dedupe("testdir", true, false, false, false, cnull);
+    result = fossil_shark_dedupe("testdir", true, false, false, false, cnull, false, false, 1, false, false, false);
     ASSUME_NOT_EQUAL_I32(0, result);
 }
 
@@ -68,7 +68,7 @@ FOSSIL_TEST(c_test_dedupe_empty_directory)
 {
     mkdir("empty_dedupe_dir", 0700);
 
-    int result = fossil_shark_dedupe("empty_dedupe_dir", true, false, false, false, "text");
+    int result = fossil_shark_dedupe("empty_dedupe_dir", true, false, false, false, "text", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     rmdir("empty_dedupe_dir");
@@ -82,7 +82,7 @@ FOSSIL_TEST(c_test_dedupe_no_duplicates)
     create_file("nodupe_dir/file2.txt", "beta");
     create_file("nodupe_dir/file3.txt", "gamma");
 
-    int result = fossil_shark_dedupe("nodupe_dir", true, false, false, false, "text");
+    int result = fossil_shark_dedupe("nodupe_dir", true, false, false, false, "text", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     remove("nodupe_dir/file1.txt");
@@ -99,7 +99,7 @@ FOSSIL_TEST(c_test_dedupe_detect_duplicates_by_hash)
     create_file("hash_dupe_dir/b.txt", "SAME_CONTENT"); // duplicate
     create_file("hash_dupe_dir/c.txt", "DIFFERENT");
 
-    int result = fossil_shark_dedupe("hash_dupe_dir", true, false, false, false, "text");
+    int result = fossil_shark_dedupe("hash_dupe_dir", true, false, false, false, "text", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     remove("hash_dupe_dir/a.txt");
@@ -116,7 +116,7 @@ FOSSIL_TEST(c_test_dedupe_detect_duplicates_by_size)
     create_file("size_dupe_dir/y.txt", "12345"); // same size
     create_file("size_dupe_dir/z.txt", "999");
 
-    int result = fossil_shark_dedupe("size_dupe_dir", false, false, false, false, "text");
+    int result = fossil_shark_dedupe("size_dupe_dir", false, false, false, false, "text", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     remove("size_dupe_dir/x.txt");
@@ -132,7 +132,7 @@ FOSSIL_TEST(c_test_dedupe_delete_duplicates)
     create_file("delete_dupe_dir/a.txt", "DUPLICATE");
     create_file("delete_dupe_dir/b.txt", "DUPLICATE");
 
-    int result = fossil_shark_dedupe("delete_dupe_dir", true, false, true, false, "text");
+    int result = fossil_shark_dedupe("delete_dupe_dir", true, false, true, false, "text", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     // One file should remain
@@ -151,7 +151,7 @@ FOSSIL_TEST(c_test_dedupe_link_duplicates)
     create_file("link_dupe_dir/a.txt", "LINKME");
     create_file("link_dupe_dir/b.txt", "LINKME");
 
-    int result = fossil_shark_dedupe("link_dupe_dir", true, false, false, true, "text");
+    int result = fossil_shark_dedupe("link_dupe_dir", true, false, false, true, "text", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     // Expect link behavior (implementation dependent check)
@@ -167,7 +167,7 @@ FOSSIL_TEST(c_test_dedupe_json_output)
     create_file("json_dupe_dir/a.txt", "JSONDATA");
     create_file("json_dupe_dir/b.txt", "JSONDATA");
 
-    int result = fossil_shark_dedupe("json_dupe_dir", true, false, false, false, "json");
+    int result = fossil_shark_dedupe("json_dupe_dir", true, false, false, false, "json", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     remove("json_dupe_dir/a.txt");
@@ -182,7 +182,7 @@ FOSSIL_TEST(c_test_dedupe_fson_output)
     create_file("fson_dupe_dir/a.txt", "FSONDATA");
     create_file("fson_dupe_dir/b.txt", "FSONDATA");
 
-    int result = fossil_shark_dedupe("fson_dupe_dir", true, false, false, false, "fson");
+    int result = fossil_shark_dedupe("fson_dupe_dir", true, false, false, false, "fson", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     remove("fson_dupe_dir/a.txt");
@@ -192,7 +192,7 @@ FOSSIL_TEST(c_test_dedupe_fson_output)
 
 FOSSIL_TEST(c_test_dedupe_invalid_directory)
 {
-    int result = fossil_shark_dedupe("nonexistent_dir", true, false, false, false, "text");
+    int result = fossil_shark_dedupe("nonexistent_dir", true, false, false, false, "text", false, false, 1, false, false, false);
     ASSUME_NOT_EQUAL_I32(0, result);
 }
 
@@ -204,12 +204,226 @@ FOSSIL_TEST(c_test_dedupe_mixed_files_and_duplicates)
     create_file("mixed_dupe_dir/b.txt", "DUP");
     create_file("mixed_dupe_dir/c.txt", "UNIQUE");
 
-    int result = fossil_shark_dedupe("mixed_dupe_dir", true, false, true, false, "text");
+    int result = fossil_shark_dedupe("mixed_dupe_dir", true, false, true, false, "text", false, false, 1, false, false, false);
     ASSUME_ITS_EQUAL_I32(0, result);
 
     rmdir("mixed_dupe_dir");
 }
 
+FOSSIL_TEST(c_test_dedupe_same_head_tail_different_middle)
+{
+    mkdir("partial_dupe_dir", 0700);
+
+    // Same size, same first and last KiB, different bytes in between
+    char content[32768 + 1];
+    memset(content, 'A', 32768);
+    content[32768] = '\0';
+    create_file("partial_dupe_dir/a.bin", content);
+    content[16384] = 'B';
+    create_file("partial_dupe_dir/b.bin", content);
+
+    int result = fossil_shark_dedupe("partial_dupe_dir", true, false, true, false, "text", false, false, 1, false, false, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // Not duplicates, so nothing may be deleted
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("partial_dupe_dir/a.bin"));
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("partial_dupe_dir/b.bin"));
+
+    remove("partial_dupe_dir/a.bin");
+    remove("partial_dupe_dir/b.bin");
+    rmdir("partial_dupe_dir");
+}
+
+FOSSIL_TEST(c_test_dedupe_two_window_boundary)
+{
+    mkdir("boundary_dupe_dir", 0700);
+
+    // Exactly two partial windows long, differing only in the second half
+    char content[8192 + 1];
+    memset(content, 'A', 8192);
+    content[8192] = '\0';
+    create_file("boundary_dupe_dir/a.bin", content);
+    content[6000] = 'B';
+    create_file("boundary_dupe_dir/b.bin", content);
+
+    int result = fossil_shark_dedupe("boundary_dupe_dir", true, false, true, false, "text", false, false, 1, false, false, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("boundary_dupe_dir/a.bin"));
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("boundary_dupe_dir/b.bin"));
+
+    remove("boundary_dupe_dir/a.bin");
+    remove("boundary_dupe_dir/b.bin");
+    rmdir("boundary_dupe_dir");
+}
+
+FOSSIL_TEST(c_test_dedupe_skips_hardlinked_inode)
+{
+    mkdir("inode_dupe_dir", 0700);
+
+    create_file("inode_dupe_dir/a.txt", "SAMEINODE");
+    fossil_io_filesys_link_create("inode_dupe_dir/a.txt", "inode_dupe_dir/b.txt", false);
+    create_file("inode_dupe_dir/c.txt", "SAMEINODE");
+
+    int result = fossil_shark_dedupe("inode_dupe_dir", true, false, true, false, "text", false, false, 1, false, false, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // b.txt is another name for the kept file, so only the real copy goes
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("inode_dupe_dir/a.txt"));
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("inode_dupe_dir/b.txt"));
+    ASSUME_ITS_FALSE(fossil_io_filesys_exists("inode_dupe_dir/c.txt"));
+
+    remove("inode_dupe_dir/a.txt");
+    remove("inode_dupe_dir/b.txt");
+    remove("inode_dupe_dir/c.txt");
+    rmdir("inode_dupe_dir");
+}
+
+FOSSIL_TEST(c_test_dedupe_blocks_shared_content)
+{
+    mkdir("blocks_dupe_dir", 0700);
+
+    // Same pseudo-random text, one with a few bytes inserted near the start
+    static char content[131072 + 8 + 1];
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < 131072; ++i)
+    {
+        seed = seed * 1103515245u + 12345u;
+        content[i] = (char)('a' + (seed >> 16) % 26);
+    }
+    content[131072] = '\0';
+    create_file("blocks_dupe_dir/a.txt", content);
+    memmove(content + 1008, content + 1000, 131072 - 1000 + 1);
+    memcpy(content + 1000, "INSERTED", 8);
+    create_file("blocks_dupe_dir/b.txt", content);
+
+    int result = fossil_shark_dedupe("blocks_dupe_dir", false, false, true, false, "text", false, false, 1, false, false, true);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // Block analysis only reports; both files stay
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("blocks_dupe_dir/a.txt"));
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("blocks_dupe_dir/b.txt"));
+
+    // Everything past the insertion is shared, so one pair holds most of a file
+    fossil_shark_dedupe_blocks_t stats;
+    result = fossil_shark_dedupe_blocks("blocks_dupe_dir", false, 1, &stats);
+    ASSUME_ITS_EQUAL_I32(0, result);
+    ASSUME_ITS_TRUE(stats.total_bytes == 131072 * 2 + 8);
+    ASSUME_ITS_EQUAL_I32(1, (int)stats.pairs);
+    ASSUME_ITS_TRUE(stats.top_shared >= 100000);
+    ASSUME_ITS_TRUE(stats.top_shared <= 131072 - 1000);
+    ASSUME_ITS_TRUE(stats.total_bytes - stats.unique_bytes == stats.top_shared);
+
+    remove("blocks_dupe_dir/a.txt");
+    remove("blocks_dupe_dir/b.txt");
+    rmdir("blocks_dupe_dir");
+}
+
+FOSSIL_TEST(c_test_dedupe_verify_large_duplicates)
+{
+    mkdir("verify_dupe_dir", 0700);
+
+    char content[65536 + 1];
+    for (size_t i = 0; i < 65536; ++i)
+        content[i] = (char)('a' + i % 26);
+    content[65536] = '\0';
+    create_file("verify_dupe_dir/a.bin", content);
+    create_file("verify_dupe_dir/b.bin", content);
+
+    int result = fossil_shark_dedupe("verify_dupe_dir", true, false, true, false, "text", true, false, 1, false, false, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // Exactly one copy is left
+    ASSUME_ITS_TRUE(
+        fossil_io_filesys_exists("verify_dupe_dir/a.bin") !=
+        fossil_io_filesys_exists("verify_dupe_dir/b.bin")
+    );
+
+    remove("verify_dupe_dir/a.bin");
+    remove("verify_dupe_dir/b.bin");
+    rmdir("verify_dupe_dir");
+}
+
+FOSSIL_TEST(c_test_dedupe_recursive_jobs)
+{
+    mkdir("recursive_dupe_dir", 0700);
+    mkdir("recursive_dupe_dir/sub", 0700);
+    mkdir("recursive_dupe_dir/sub/deeper", 0700);
+    create_file("recursive_dupe_dir/a.txt", "nested duplicate");
+    create_file("recursive_dupe_dir/sub/deeper/b.txt", "nested duplicate");
+    create_file("recursive_dupe_dir/sub/c.txt", "unique content");
+
+    // Without --recursive the copy in the subdirectory is not seen
+    int result = fossil_shark_dedupe("recursive_dupe_dir", true, false, true, false, "text", false, false, 4, false, false, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("recursive_dupe_dir/sub/deeper/b.txt"));
+
+    result = fossil_shark_dedupe("recursive_dupe_dir", true, false, true, false, "text", false, true, 4, false, false, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // The lexically first path is kept
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("recursive_dupe_dir/a.txt"));
+    ASSUME_ITS_FALSE(fossil_io_filesys_exists("recursive_dupe_dir/sub/deeper/b.txt"));
+    ASSUME_ITS_TRUE(fossil_io_filesys_exists("recursive_dupe_dir/sub/c.txt"));
+
+    remove("recursive_dupe_dir/a.txt");
+    remove("recursive_dupe_dir/sub/c.txt");
+    rmdir("recursive_dupe_dir/sub/deeper");
+    rmdir("recursive_dupe_dir/sub");
+    rmdir("recursive_dupe_dir");
+}
+
+FOSSIL_TEST(c_test_dedupe_hardlink_duplicates)
+{
+    mkdir("hardlink_dupe_dir", 0700);
+    create_file("hardlink_dupe_dir/a.txt", "linked content");
+    create_file("hardlink_dupe_dir/b.txt", "linked content");
+
+    int result = fossil_shark_dedupe("hardlink_dupe_dir", true, false, false, false, "text", false, false, 1, false, true, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    // Both paths remain, now as two names of one inode
+    struct stat sa, sb;
+    ASSUME_ITS_EQUAL_I32(0, stat("hardlink_dupe_dir/a.txt", &sa));
+    ASSUME_ITS_EQUAL_I32(0, stat("hardlink_dupe_dir/b.txt", &sb));
+    ASSUME_ITS_TRUE(sa.st_ino == sb.st_ino);
+    ASSUME_ITS_TRUE(sb.st_nlink == 2);
+
+    remove("hardlink_dupe_dir/a.txt");
+    remove("hardlink_dupe_dir/b.txt");
+    rmdir("hardlink_dupe_dir");
+}
+
+FOSSIL_TEST(c_test_dedupe_hardlink_same_size_mtime_different_content)
+{
+    mkdir("mtime_dupe_dir", 0700);
+    create_file("mtime_dupe_dir/a.txt", "AAAA");
+    create_file("mtime_dupe_dir/b.txt", "BBBB");
+    struct utimbuf times = {1000000000, 1000000000};
+    utime("mtime_dupe_dir/a.txt", &times);
+    utime("mtime_dupe_dir/b.txt", &times);
+
+    // Without --hash the report groups on size and mtime, but linking must not
+    int result = fossil_shark_dedupe("mtime_dupe_dir", false, false, false, false, "text", false, false, 1, false, true, false);
+    ASSUME_ITS_EQUAL_I32(0, result);
+
+    struct stat sa, sb;
+    ASSUME_ITS_EQUAL_I32(0, stat("mtime_dupe_dir/a.txt", &sa));
+    ASSUME_ITS_EQUAL_I32(0, stat("mtime_dupe_dir/b.txt", &sb));
+    ASSUME_ITS_TRUE(sa.st_ino != sb.st_ino);
+
+    char buffer[8] = {0};
+    FILE *f = fopen("mtime_dupe_dir/b.txt", "r");
+    ASSUME_NOT_CNULL(f);
+    fread(buffer, 1, sizeof(buffer) - 1, f);
+    fclose(f);
+    ASSUME_ITS_TRUE(strcmp(buffer, "BBBB") == 0);
+
+    remove("mtime_dupe_dir/a.txt");
+    remove("mtime_dupe_dir/b.txt");
+    rmdir("mtime_dupe_dir");
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Test Group Registration
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -227,6 +441,14 @@ FOSSIL_TEST_GROUP(c_dedupe_command_tests)
     FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_fson_output);
     FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_invalid_directory);
     FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_mixed_files_and_duplicates);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_same_head_tail_different_middle);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_two_window_boundary);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_verify_large_duplicates);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_recursive_jobs);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_hardlink_duplicates);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_hardlink_same_size_mtime_different_content);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_skips_hardlinked_inode);
+    FOSSIL_ADD_TEST(c_dedupe_command_suite, c_test_dedupe_blocks_shared_content);
 
     FOSSIL_ADD_SUITE(c_dedupe_command_suite);
 }
@@ -0,0 +1,158 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#include <fossil/maip/framework.h>
+
+#include "fossil/code/app.h"
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Fossil Logic Introspect Test Suite
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+FOSSIL_SUITE(c_introspect_command_suite);
+
+FOSSIL_SETUP(c_introspect_command_suite)
+{
+    // Setup test environment
+}
+
+FOSSIL_TEARDOWN(c_introspect_command_suite)
+{
+    // Cleanup after tests
+}
+
+// Helper: write 194 bytes of spaces (three 64-byte chunks and a 2-byte tail)
+// with each string placed at its offset
+typedef struct
+{
+    size_t offset;
+    const char *text;
+} placed_t;
+
+static void create_placed(const char *path, const placed_t *placed, size_t count)
+{
+    char content[194];
+    memset(content, ' ', sizeof(content));
+    for (size_t i = 0; i < count; ++i)
+        memcpy(content + placed[i].offset, placed[i].text, strlen(placed[i].text));
+
+    FILE *f = fopen(path, "wb");
+    ASSUME_NOT_CNULL(f);
+    fwrite(content, 1, sizeof(content), f);
+    fclose(f);
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Test Cases
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+FOSSIL_TEST(c_test_introspect_null_parameters)
+{
+    uint64_t lines, words, bytes;
+    ASSUME_ITS_EQUAL_I32(EINVAL, fossil_shark_introspect_count(cnull, &lines, &words, &bytes));
+    ASSUME_ITS_EQUAL_I32(EINVAL, fossil_shark_introspect_count("count_args.txt", cnull, &words, &bytes));
+    ASSUME_NOT_EQUAL_I32(0, fossil_shark_introspect_count("missing_count.txt", &lines, &words, &bytes));
+}
+
+FOSSIL_TEST(c_test_introspect_count_read_error)
+{
+    // A directory opens on some platforms but fails on the first read
+    uint64_t lines, words, bytes;
+    mkdir("count_dir", 0700);
+    ASSUME_NOT_EQUAL_I32(0, fossil_shark_introspect_count("count_dir", &lines, &words, &bytes));
+    rmdir("count_dir");
+}
+
+FOSSIL_TEST(c_test_introspect_count_chunk_boundaries)
+{
+    // Words straddle 15/16, 31/32 and 63/64, one starts right at 128 and
+    // a newline splits the tail; plain text, so every full chunk is counted
+    // from its masks. LC_ALL=C wc: 3 7 194
+    const placed_t placed[] = {
+        {0, "\n"}, {13, "abcd"}, {31, "ef"}, {47, "\n"}, {62, "wxyz"}, {100, "pq"}, {128, "mn"}, {189, "ta\nil"}
+    };
+    create_placed("count_ascii.txt", placed, sizeof(placed) / sizeof(placed[0]));
+
+    uint64_t lines = 0, words = 0, bytes = 0;
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_introspect_count("count_ascii.txt", &lines, &words, &bytes));
+    ASSUME_ITS_EQUAL_I32(3, (int)lines);
+    ASSUME_ITS_EQUAL_I32(7, (int)words);
+    ASSUME_ITS_EQUAL_I32(194, (int)bytes);
+
+    remove("count_ascii.txt");
+}
+
+FOSSIL_TEST(c_test_introspect_count_neutral_bytes)
+{
+    // Control and high bytes neither start nor end a word: one sits inside
+    // a word across 15/16, one leads a word at 63/64, one pair stands alone,
+    // one joins a word across 127/128 and one leads a word in the tail.
+    // LC_ALL=C wc: 0 5 194
+    const placed_t placed[] = {
+        {10, "ab\x01" "cd\x01x"}, {40, "\xc3\xa9t\xc3\xa9"}, {63, "\x7fy"}, {70, "\x01\x02"}, {127, "z\xffz"},
+        {191, "\x01q"}
+    };
+    create_placed("count_neutral.txt", placed, sizeof(placed) / sizeof(placed[0]));
+
+    uint64_t lines = 0, words = 0, bytes = 0;
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_introspect_count("count_neutral.txt", &lines, &words, &bytes));
+    ASSUME_ITS_EQUAL_I32(0, (int)lines);
+    ASSUME_ITS_EQUAL_I32(5, (int)words);
+    ASSUME_ITS_EQUAL_I32(194, (int)bytes);
+
+    remove("count_neutral.txt");
+}
+
+FOSSIL_TEST(c_test_introspect_count_word_spans_chunks)
+{
+    // One word running through every chunk and the tail. LC_ALL=C wc: 0 1 194
+    FILE *f = fopen("count_word.txt", "wb");
+    ASSUME_NOT_CNULL(f);
+    for (int i = 0; i < 194; ++i)
+        fputc('a', f);
+    fclose(f);
+
+    uint64_t lines = 0, words = 0, bytes = 0;
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_introspect_count("count_word.txt", &lines, &words, &bytes));
+    ASSUME_ITS_EQUAL_I32(0, (int)lines);
+    ASSUME_ITS_EQUAL_I32(1, (int)words);
+    ASSUME_ITS_EQUAL_I32(194, (int)bytes);
+
+    remove("count_word.txt");
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Fossil Logic Test Pool
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+FOSSIL_TEST_GROUP(c_introspect_command_tests)
+{
+    FOSSIL_ADD_TEST(c_introspect_command_suite, c_test_introspect_null_parameters);
+    FOSSIL_ADD_TEST(c_introspect_command_suite, c_test_introspect_count_read_error);
+    FOSSIL_ADD_TEST(c_introspect_command_suite, c_test_introspect_count_chunk_boundaries);
+    FOSSIL_ADD_TEST(c_introspect_command_suite, c_test_introspect_count_neutral_bytes);
+    FOSSIL_ADD_TEST(c_introspect_command_suite, c_test_introspect_count_word_spans_chunks);
+
+    FOSSIL_ADD_SUITE(c_introspect_command_suite);
+}
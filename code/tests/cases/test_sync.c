@@ -58,28 +58,28 @@ FOSSIL_TEARDOWN(c_sync_command_suite)
 
 FOSSIL_TEST(c_test_sync_null_source)
 {
-    int result = fossil_shark_sync(cnull, "dest", false, false, false);
+    int result = fossil_shark_sync(cnull, "dest", false, false, false, "xxh3", false, false, false);
     ASSUME_NOT_EQUAL_I32(result, 0);
 }
 
 FOSSIL_TEST(c_test_sync_null_destination)
 {
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_src.txt");
-    int result = fossil_shark_sync("test_sync_src.txt", cnull, false, false, false);
+    int result = fossil_shark_sync("test_sync_src.txt", cnull, false, false, false, "xxh3", false, false, false);
     ASSUME_NOT_EQUAL_I32(result, 0);
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_src.txt");
 }
 
 FOSSIL_TEST(c_test_sync_nonexistent_source)
 {
-    int result = fossil_shark_sync("nonexistent_sync_src.txt", "sync_dest.txt", false, false, false);
+    int result = fossil_shark_sync("nonexistent_sync_src.txt", "sync_dest.txt", false, false, false, "xxh3", false, false, false);
     ASSUME_NOT_EQUAL_I32(result, 0);
 }
 
 FOSSIL_TEST(c_test_sync_single_file)
 {
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_file_src.txt");
-    int result = fossil_shark_sync("test_sync_file_src.txt", "test_sync_file_dest.txt", false, false, false);
+    int result = fossil_shark_sync("test_sync_file_src.txt", "test_sync_file_dest.txt", false, false, false, "xxh3", false, false, false);
     ASSUME_ITS_EQUAL_I32(result, 0);
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_file_src.txt");
     if (FOSSIL_SANITY_SYS_FILE_EXISTS("test_sync_file_dest.txt"))
@@ -92,7 +92,7 @@ FOSSIL_TEST(c_test_sync_directory_non_recursive)
 {
     FOSSIL_SANITY_SYS_CREATE_DIR("test_sync_src_dir");
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_src_dir/file1.txt");
-    int result = fossil_shark_sync("test_sync_src_dir", "test_sync_dest_dir", false, false, false);
+    int result = fossil_shark_sync("test_sync_src_dir", "test_sync_dest_dir", false, false, false, "xxh3", false, false, false);
     ASSUME_ITS_EQUAL_I32(result, 0);
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_src_dir/file1.txt");
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_src_dir");
@@ -106,7 +106,7 @@ FOSSIL_TEST(c_test_sync_directory_recursive)
 {
     FOSSIL_SANITY_SYS_CREATE_DIR("test_sync_rec_src");
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_rec_src/file1.txt");
-    int result = fossil_shark_sync("test_sync_rec_src", "test_sync_rec_dest", true, false, false);
+    int result = fossil_shark_sync("test_sync_rec_src", "test_sync_rec_dest", true, false, false, "xxh3", false, false, false);
     ASSUME_ITS_EQUAL_I32(result, 0);
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_rec_src/file1.txt");
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_rec_src");
@@ -119,7 +119,7 @@ FOSSIL_TEST(c_test_sync_directory_recursive)
 FOSSIL_TEST(c_test_sync_update_flag)
 {
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_update_src.txt");
-    int result = fossil_shark_sync("test_sync_update_src.txt", "test_sync_update_dest.txt", false, true, false);
+    int result = fossil_shark_sync("test_sync_update_src.txt", "test_sync_update_dest.txt", false, true, false, "xxh3", false, false, false);
     ASSUME_ITS_EQUAL_I32(result, 0);
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_update_src.txt");
     if (FOSSIL_SANITY_SYS_FILE_EXISTS("test_sync_update_dest.txt"))
@@ -132,7 +132,7 @@ FOSSIL_TEST(c_test_sync_delete_flag)
 {
     FOSSIL_SANITY_SYS_CREATE_DIR("test_sync_del_src");
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_del_src/file1.txt");
-    int result = fossil_shark_sync("test_sync_del_src", "test_sync_del_dest", true, false, true);
+    int result = fossil_shark_sync("test_sync_del_src", "test_sync_del_dest", true, false, true, "xxh3", false, false, false);
     ASSUME_ITS_EQUAL_I32(result, 0);
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_del_src/file1.txt");
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_del_src");
@@ -146,12 +146,178 @@ FOSSIL_TEST(c_test_sync_identical_files)
 {
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_identical_src.txt");
     FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_identical_dest.txt");
-    int result = fossil_shark_sync("test_sync_identical_src.txt", "test_sync_identical_dest.txt", false, false, false);
+    int result = fossil_shark_sync("test_sync_identical_src.txt", "test_sync_identical_dest.txt", false, false, false, "xxh3", false, false, false);
     ASSUME_ITS_EQUAL_I32(result, 0);
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_identical_src.txt");
     FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_identical_dest.txt");
 }
 
+FOSSIL_TEST(c_test_sync_invalid_compare_mode)
+{
+    FOSSIL_SANITY_SYS_CREATE_FILE("test_sync_mode_src.txt");
+    int result = fossil_shark_sync("test_sync_mode_src.txt", "test_sync_mode_dest.txt", false, false, false, "md5", false, false, false);
+    ASSUME_NOT_EQUAL_I32(result, 0);
+    FOSSIL_SANITY_SYS_DELETE_FILE("test_sync_mode_src.txt");
+}
+
+FOSSIL_TEST(c_test_sync_continuous_rejects_bad_arguments)
+{
+    // Argument errors must be reported before continuous mode starts waiting
+    int result = fossil_shark_sync(cnull, "dest", false, false, false, "xxh3", false, true, false);
+    ASSUME_NOT_EQUAL_I32(result, 0);
+    result = fossil_shark_sync("src", "dest", false, false, false, "md5", false, true, false);
+    ASSUME_NOT_EQUAL_I32(result, 0);
+}
+
+FOSSIL_TEST(c_test_sync_compare_size_differs)
+{
+    FILE *src = fopen("test_sync_size_src.txt", "w");
+    ASSUME_NOT_CNULL(src);
+    fprintf(src, "longer content");
+    fclose(src);
+
+    FILE *dest = fopen("test_sync_size_dest.txt", "w");
+    ASSUME_NOT_CNULL(dest);
+    fprintf(dest, "short");
+    fclose(dest);
+
+    int result = fossil_shark_sync("test_sync_size_src.txt", "test_sync_size_dest.txt", false, false, false, "size", false, false, false);
+    ASSUME_ITS_EQUAL_I32(result, 0);
+
+    fossil_io_filesys_obj_t obj;
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_stat("test_sync_size_dest.txt", &obj), 0);
+    ASSUME_ITS_EQUAL_I32((int)obj.size, (int)strlen("longer content"));
+
+    remove("test_sync_size_src.txt");
+    remove("test_sync_size_dest.txt");
+}
+
+FOSSIL_TEST(c_test_sync_checksum_detects_same_size_change)
+{
+    FILE *src = fopen("test_sync_sum_src.txt", "w");
+    ASSUME_NOT_CNULL(src);
+    fprintf(src, "AAAA");
+    fclose(src);
+
+    FILE *dest = fopen("test_sync_sum_dest.txt", "w");
+    ASSUME_NOT_CNULL(dest);
+    fprintf(dest, "BBBB");
+    fclose(dest);
+
+    int result = fossil_shark_sync("test_sync_sum_src.txt", "test_sync_sum_dest.txt", false, false, false, "xxh3", true, false, false);
+    ASSUME_ITS_EQUAL_I32(result, 0);
+
+    char buffer[8] = {0};
+    FILE *check = fopen("test_sync_sum_dest.txt", "r");
+    ASSUME_NOT_CNULL(check);
+    fread(buffer, 1, sizeof(buffer) - 1, check);
+    fclose(check);
+    ASSUME_ITS_EQUAL_I32(strcmp(buffer, "AAAA"), 0);
+
+    remove("test_sync_sum_src.txt");
+    remove("test_sync_sum_dest.txt");
+}
+
+FOSSIL_TEST(c_test_sync_durable_replaces_existing)
+{
+    FILE *src = fopen("test_sync_durable_src.txt", "w");
+    ASSUME_NOT_CNULL(src);
+    fprintf(src, "new");
+    fclose(src);
+
+    FILE *dest = fopen("test_sync_durable_dest.txt", "w");
+    ASSUME_NOT_CNULL(dest);
+    fprintf(dest, "old and longer");
+    fclose(dest);
+
+    int result = fossil_shark_sync("test_sync_durable_src.txt", "test_sync_durable_dest.txt", false, false, false, "xxh3", false, false, true);
+    ASSUME_ITS_EQUAL_I32(result, 0);
+
+    char buffer[32] = {0};
+    FILE *check = fopen("test_sync_durable_dest.txt", "r");
+    ASSUME_NOT_CNULL(check);
+    fread(buffer, 1, sizeof(buffer) - 1, check);
+    fclose(check);
+    ASSUME_ITS_EQUAL_I32(strcmp(buffer, "new"), 0);
+
+    remove("test_sync_durable_src.txt");
+    remove("test_sync_durable_dest.txt");
+}
+
+FOSSIL_TEST(c_test_sync_durable_tree_with_delete)
+{
+    // Copies wait under temporary names until the pass ends; --delete must not
+    // take them for extraneous files, and none may be left behind
+    mkdir("test_sync_durable_tree", 0700);
+    mkdir("test_sync_durable_copy", 0700);
+    const char *names[] = {"a.txt", "b.txt", "c.txt"};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "test_sync_durable_tree/%s", names[i]);
+        FILE *file = fopen(path, "w");
+        ASSUME_NOT_CNULL(file);
+        fprintf(file, "content %zu", i);
+        fclose(file);
+    }
+
+    int result = fossil_shark_sync("test_sync_durable_tree", "test_sync_durable_copy", true, false, true, "xxh3", false, false, true);
+    ASSUME_ITS_EQUAL_I32(result, 0);
+
+    size_t entries = 0;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        char path[64], buffer[32] = {0}, expected[32];
+        snprintf(path, sizeof(path), "test_sync_durable_copy/%s", names[i]);
+        FILE *check = fopen(path, "r");
+        ASSUME_NOT_CNULL(check);
+        fread(buffer, 1, sizeof(buffer) - 1, check);
+        fclose(check);
+        snprintf(expected, sizeof(expected), "content %zu", i);
+        ASSUME_ITS_EQUAL_I32(strcmp(buffer, expected), 0);
+    }
+    fossil_io_filesys_obj_t listed[16];
+    ASSUME_ITS_EQUAL_I32(fossil_io_filesys_dir_list("test_sync_durable_copy", listed, 16, &entries), 0);
+    size_t files = 0;
+    for (size_t i = 0; i < entries; ++i)
+        files += listed[i].type == FOSSIL_FILESYS_TYPE_FILE;
+    ASSUME_ITS_EQUAL_I32((int)files, 3);
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "test_sync_durable_tree/%s", names[i]);
+        remove(path);
+        snprintf(path, sizeof(path), "test_sync_durable_copy/%s", names[i]);
+        remove(path);
+    }
+    rmdir("test_sync_durable_tree");
+    rmdir("test_sync_durable_copy");
+}
+
+FOSSIL_TEST(c_test_sync_bandwidth_limited)
+{
+    FILE *src = fopen("test_sync_qos_src.txt", "w");
+    ASSUME_NOT_CNULL(src);
+    fprintf(src, "throttled content");
+    fclose(src);
+
+    ASSUME_ITS_EQUAL_I32(fossil_shark_qos_configure(1024 * 1024, 1000, false), 0);
+    int result = fossil_shark_sync("test_sync_qos_src.txt", "test_sync_qos_dest.txt", false, false, false, "xxh3", false, false, false);
+    fossil_shark_qos_configure(0, 0, false);
+    ASSUME_ITS_EQUAL_I32(result, 0);
+
+    char buffer[32] = {0};
+    FILE *check = fopen("test_sync_qos_dest.txt", "r");
+    ASSUME_NOT_CNULL(check);
+    fread(buffer, 1, sizeof(buffer) - 1, check);
+    fclose(check);
+    ASSUME_ITS_EQUAL_I32(strcmp(buffer, "throttled content"), 0);
+
+    remove("test_sync_qos_src.txt");
+    remove("test_sync_qos_dest.txt");
+}
+
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Pool
 // * * * * * * * * * * * * * * * * * * * * * * * *
@@ -167,6 +333,13 @@ FOSSIL_TEST_GROUP(c_sync_command_tests)
     FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_update_flag);
     FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_delete_flag);
     FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_identical_files);
+    FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_invalid_compare_mode);
+    FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_continuous_rejects_bad_arguments);
+    FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_compare_size_differs);
+    FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_checksum_detects_same_size_change);
+    FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_durable_replaces_existing);
+    FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_durable_tree_with_delete);
+    FOSSIL_ADD_TEST(c_sync_command_suite, c_test_sync_bandwidth_limited);
 
     FOSSIL_ADD_SUITE(c_sync_command_suite);
 }
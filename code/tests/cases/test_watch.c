@@ -0,0 +1,302 @@
+/**
+ * -----------------------------------------------------------------------------
+ * Project: Fossil Logic
+ *
+ * This file is part of the Fossil Logic project, which aims to develop
+ * high-performance, cross-platform applications and libraries. The code
+ * contained herein is licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License. You may obtain
+ * a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ * Author: Michael Gene Brockus (Dreamer)
+ * Date: 04/05/2013
+ *
+ * Copyright (C) 2013-Current Fossil Logic. All rights reserved.
+ * -----------------------------------------------------------------------------
+ */
+#include <fossil/maip/framework.h>
+
+#include "fossil/code/app.h"
+#include "fossil/code/snapshot.h"
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Fossil Logic Watch Test Suite
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+FOSSIL_SUITE(c_watch_command_suite);
+
+FOSSIL_SETUP(c_watch_command_suite)
+{
+    // Setup test environment
+}
+
+FOSSIL_TEARDOWN(c_watch_command_suite)
+{
+    // Cleanup after tests
+}
+
+// Helper: create file with content
+static void create_file(const char *path, const char *content)
+{
+    FILE *f = fopen(path, "w");
+    ASSUME_NOT_CNULL(f);
+    fprintf(f, "%s", content);
+    fclose(f);
+}
+
+// Events gathered from a snapshot diff
+typedef struct
+{
+    fossil_shark_notify_event_t events[16];
+    size_t count;
+} collected_t;
+
+static void collect_event(const fossil_shark_notify_event_t *event, void *user)
+{
+    collected_t *c = (collected_t *)user;
+    if (c->count < 16)
+        c->events[c->count++] = *event;
+}
+
+// Helper: the collected event for path, or null
+static const fossil_shark_notify_event_t *find_event(const collected_t *c, const char *path)
+{
+    for (size_t i = 0; i < c->count; ++i)
+    {
+        if (strcmp(c->events[i].path, path) == 0)
+            return &c->events[i];
+    }
+    return cnull;
+}
+
+// Helper: an event of kind for path
+static fossil_shark_notify_event_t make_event(fossil_shark_notify_kind_t kind, const char *path)
+{
+    fossil_shark_notify_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.kind = kind;
+    snprintf(ev.path, sizeof(ev.path), "%s", path);
+    return ev;
+}
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Test Cases
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+FOSSIL_TEST(c_test_watch_snapshot_diff_changes)
+{
+    mkdir("snap_root", 0700);
+    create_file("snap_root/gone.txt", "gone");
+    create_file("snap_root/mod.txt", "before");
+    create_file("snap_root/old.txt", "moving");
+    create_file("snap_root/same.txt", "same");
+
+    fossil_shark_snapshot_t *before = cnull, *after = cnull;
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_snapshot_take(&before, "snap_root", true, cnull, 1));
+
+    create_file("snap_root/new.txt", "new");
+    remove("snap_root/gone.txt");
+    create_file("snap_root/mod.txt", "after, and longer");
+    rename("snap_root/old.txt", "snap_root/renamed.txt");
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_snapshot_take(&after, "snap_root", true, cnull, 1));
+
+    collected_t c = {0};
+    size_t emitted = fossil_shark_snapshot_diff(before, after, collect_event, &c);
+    ASSUME_ITS_EQUAL_I32(5, (int)emitted);
+    ASSUME_ITS_EQUAL_I32(5, (int)c.count);
+
+    const fossil_shark_notify_event_t *ev = find_event(&c, "snap_root/new.txt");
+    ASSUME_NOT_CNULL(ev);
+    ASSUME_ITS_TRUE(ev->kind == FOSSIL_SHARK_NOTIFY_CREATE && ev->cookie == 0);
+    ev = find_event(&c, "snap_root/gone.txt");
+    ASSUME_NOT_CNULL(ev);
+    ASSUME_ITS_TRUE(ev->kind == FOSSIL_SHARK_NOTIFY_DELETE);
+    ev = find_event(&c, "snap_root/mod.txt");
+    ASSUME_NOT_CNULL(ev);
+    ASSUME_ITS_TRUE(ev->kind == FOSSIL_SHARK_NOTIFY_MODIFY);
+    ASSUME_ITS_TRUE(find_event(&c, "snap_root/same.txt") == cnull);
+
+    // The renamed inode pairs its old and new names under one cookie
+    const fossil_shark_notify_event_t *from = find_event(&c, "snap_root/old.txt");
+    const fossil_shark_notify_event_t *to = find_event(&c, "snap_root/renamed.txt");
+    ASSUME_NOT_CNULL(from);
+    ASSUME_NOT_CNULL(to);
+    ASSUME_ITS_TRUE(from->kind == FOSSIL_SHARK_NOTIFY_RENAME);
+    ASSUME_ITS_TRUE(to->kind == FOSSIL_SHARK_NOTIFY_CREATE);
+    ASSUME_ITS_TRUE(from->cookie != 0 && from->cookie == to->cookie);
+
+    // Nothing changed since the second scan
+    collected_t none = {0};
+    ASSUME_ITS_EQUAL_I32(0, (int)fossil_shark_snapshot_diff(after, after, collect_event, &none));
+
+    fossil_shark_snapshot_free(before);
+    fossil_shark_snapshot_free(after);
+    remove("snap_root/new.txt");
+    remove("snap_root/mod.txt");
+    remove("snap_root/renamed.txt");
+    remove("snap_root/same.txt");
+    rmdir("snap_root");
+}
+
+FOSSIL_TEST(c_test_watch_snapshot_apply_removed_tree)
+{
+    mkdir("apply_root", 0700);
+    mkdir("apply_root/tree", 0700);
+    mkdir("apply_root/tree/sub", 0700);
+    create_file("apply_root/keep.txt", "keep");
+    create_file("apply_root/tree/a.txt", "a");
+    create_file("apply_root/tree/sub/b.txt", "b");
+
+    fossil_shark_snapshot_t *snap = cnull;
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_snapshot_take(&snap, "apply_root", true, cnull, 1));
+    ASSUME_ITS_EQUAL_I32(6, (int)fossil_shark_snapshot_count(snap));
+
+    // A file created after the scan belongs to no scanned directory's block
+    create_file("apply_root/tree/sub/late.txt", "late");
+    fossil_shark_notify_event_t ev = make_event(FOSSIL_SHARK_NOTIFY_CREATE, "apply_root/tree/sub/late.txt");
+    fossil_shark_snapshot_apply(snap, &ev);
+    ASSUME_ITS_EQUAL_I32(7, (int)fossil_shark_snapshot_count(snap));
+
+    // Removing the directory takes everything below it along
+    remove("apply_root/tree/sub/late.txt");
+    remove("apply_root/tree/sub/b.txt");
+    remove("apply_root/tree/a.txt");
+    rmdir("apply_root/tree/sub");
+    rmdir("apply_root/tree");
+    ev = make_event(FOSSIL_SHARK_NOTIFY_DELETE, "apply_root/tree");
+    ev.is_dir = true;
+    fossil_shark_snapshot_apply(snap, &ev);
+    ASSUME_ITS_EQUAL_I32(2, (int)fossil_shark_snapshot_count(snap));
+
+    fossil_shark_snapshot_free(snap);
+    remove("apply_root/keep.txt");
+    rmdir("apply_root");
+}
+
+FOSSIL_TEST(c_test_watch_coalesce_create_modify)
+{
+    fossil_shark_watch_net_t net;
+    memset(&net, 0, sizeof(net));
+    fossil_shark_notify_event_t create = make_event(FOSSIL_SHARK_NOTIFY_CREATE, "f.txt");
+    fossil_shark_notify_event_t modify = make_event(FOSSIL_SHARK_NOTIFY_MODIFY, "f.txt");
+    fossil_shark_watch_fold(&net, &create, false);
+    fossil_shark_watch_fold(&net, &modify, false);
+    fossil_shark_watch_fold(&net, &modify, false);
+
+    fossil_shark_notify_event_t out;
+    ASSUME_ITS_TRUE(fossil_shark_watch_collapse(&net, &out));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_SHARK_NOTIFY_CREATE, out.kind);
+}
+
+FOSSIL_TEST(c_test_watch_coalesce_create_delete)
+{
+    fossil_shark_watch_net_t net;
+    memset(&net, 0, sizeof(net));
+    fossil_shark_notify_event_t create = make_event(FOSSIL_SHARK_NOTIFY_CREATE, "tmp.swp");
+    fossil_shark_notify_event_t modify = make_event(FOSSIL_SHARK_NOTIFY_MODIFY, "tmp.swp");
+    fossil_shark_notify_event_t remove = make_event(FOSSIL_SHARK_NOTIFY_DELETE, "tmp.swp");
+    fossil_shark_watch_fold(&net, &create, false);
+    fossil_shark_watch_fold(&net, &modify, false);
+    fossil_shark_watch_fold(&net, &remove, false);
+
+    fossil_shark_notify_event_t out;
+    ASSUME_ITS_FALSE(fossil_shark_watch_collapse(&net, &out));
+}
+
+FOSSIL_TEST(c_test_watch_coalesce_delete_create)
+{
+    // An editor saving by writing a new file over the old name
+    fossil_shark_watch_net_t net;
+    memset(&net, 0, sizeof(net));
+    fossil_shark_notify_event_t remove = make_event(FOSSIL_SHARK_NOTIFY_DELETE, "doc.txt");
+    fossil_shark_notify_event_t create = make_event(FOSSIL_SHARK_NOTIFY_CREATE, "doc.txt");
+    fossil_shark_watch_fold(&net, &remove, true);
+    fossil_shark_watch_fold(&net, &create, true);
+
+    fossil_shark_notify_event_t out;
+    ASSUME_ITS_TRUE(fossil_shark_watch_collapse(&net, &out));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_SHARK_NOTIFY_MODIFY, out.kind);
+}
+
+FOSSIL_TEST(c_test_watch_coalesce_modify_delete)
+{
+    fossil_shark_watch_net_t net;
+    memset(&net, 0, sizeof(net));
+    fossil_shark_notify_event_t modify = make_event(FOSSIL_SHARK_NOTIFY_MODIFY, "log.txt");
+    fossil_shark_notify_event_t remove = make_event(FOSSIL_SHARK_NOTIFY_DELETE, "log.txt");
+    fossil_shark_watch_fold(&net, &modify, true);
+    fossil_shark_watch_fold(&net, &remove, true);
+
+    fossil_shark_notify_event_t out;
+    ASSUME_ITS_TRUE(fossil_shark_watch_collapse(&net, &out));
+    ASSUME_ITS_EQUAL_I32(FOSSIL_SHARK_NOTIFY_DELETE, out.kind);
+}
+
+#if defined(__linux__)
+FOSSIL_TEST(c_test_watch_notify_moved_in_directory)
+{
+    mkdir("notify_root", 0700);
+    mkdir("notify_src", 0700);
+    mkdir("notify_src/sub", 0700);
+    create_file("notify_src/a.txt", "a");
+    create_file("notify_src/sub/b.txt", "b");
+
+    fossil_shark_notify_t *notify = cnull;
+    ASSUME_ITS_EQUAL_I32(0, fossil_shark_notify_open(&notify, "notify_root", true));
+    ASSUME_ITS_EQUAL_I32(0, rename("notify_src", "notify_root/moved"));
+
+    // Everything already inside the moved directory is reported as created
+    bool saw_dir = false, saw_file = false, saw_nested = false;
+    fossil_shark_notify_event_t events[16];
+    for (int tries = 0; tries < 10 && !(saw_dir && saw_file && saw_nested); ++tries)
+    {
+        size_t count = 0;
+        ASSUME_ITS_EQUAL_I32(0, fossil_shark_notify_read(notify, events, 16, &count, 100));
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (events[i].kind != FOSSIL_SHARK_NOTIFY_CREATE)
+                continue;
+            saw_dir |= strcmp(events[i].path, "notify_root/moved") == 0;
+            saw_file |= strcmp(events[i].path, "notify_root/moved/a.txt") == 0;
+            saw_nested |= strcmp(events[i].path, "notify_root/moved/sub/b.txt") == 0;
+        }
+    }
+    fossil_shark_notify_close(notify);
+    ASSUME_ITS_TRUE(saw_dir);
+    ASSUME_ITS_TRUE(saw_file);
+    ASSUME_ITS_TRUE(saw_nested);
+
+    remove("notify_root/moved/sub/b.txt");
+    remove("notify_root/moved/a.txt");
+    rmdir("notify_root/moved/sub");
+    rmdir("notify_root/moved");
+    rmdir("notify_root");
+}
+#endif
+
+// * * * * * * * * * * * * * * * * * * * * * * * *
+// * Test Group Registration
+// * * * * * * * * * * * * * * * * * * * * * * * *
+
+FOSSIL_TEST_GROUP(c_watch_command_tests)
+{
+    FOSSIL_ADD_TEST(c_watch_command_suite, c_test_watch_snapshot_diff_changes);
+    FOSSIL_ADD_TEST(c_watch_command_suite, c_test_watch_snapshot_apply_removed_tree);
+    FOSSIL_ADD_TEST(c_watch_command_suite, c_test_watch_coalesce_create_modify);
+    FOSSIL_ADD_TEST(c_watch_command_suite, c_test_watch_coalesce_create_delete);
+    FOSSIL_ADD_TEST(c_watch_command_suite, c_test_watch_coalesce_delete_create);
+    FOSSIL_ADD_TEST(c_watch_command_suite, c_test_watch_coalesce_modify_delete);
+#if defined(__linux__)
+    FOSSIL_ADD_TEST(c_watch_command_suite, c_test_watch_notify_moved_in_directory);
+#endif
+
+    FOSSIL_ADD_SUITE(c_watch_command_suite);
+}
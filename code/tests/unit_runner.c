@@ -19,6 +19,8 @@ FOSSIL_TEST_EXPORT(c_cryptic_command_tests);
 FOSSIL_TEST_EXPORT(c_rename_command_tests);
 FOSSIL_TEST_EXPORT(c_dedupe_command_tests);
 FOSSIL_TEST_EXPORT(c_remove_command_tests);
+FOSSIL_TEST_EXPORT(c_watch_command_tests);
+FOSSIL_TEST_EXPORT(c_introspect_command_tests);
 
 // * * * * * * * * * * * * * * * * * * * * * * * *
 // * Fossil Logic Test Runner
@@ -39,6 +41,8 @@ int main(int argc, char **argv) {
     FOSSIL_TEST_IMPORT(c_rename_command_tests);
     FOSSIL_TEST_IMPORT(c_dedupe_command_tests);
     FOSSIL_TEST_IMPORT(c_remove_command_tests);
+    FOSSIL_TEST_IMPORT(c_watch_command_tests);
+    FOSSIL_TEST_IMPORT(c_introspect_command_tests);
 
     FOSSIL_RUN_ALL();
     FOSSIL_SUMMARY();